@@ -0,0 +1,172 @@
+#ifndef ARRAYLIST_H
+#define ARRAYLIST_H
+
+#include "Types.h"
+#include "Exception.h"
+
+template<typename T>
+class ArrayList
+{
+private:
+
+	static const int DefaultCapacity = 4;
+
+	T* items;
+	int count;
+	int capacity;
+
+public:
+
+	ArrayList()
+	{
+		init(0);
+	}
+
+	ArrayList(int capacity)
+	{
+		init(capacity);
+	}
+
+	ArrayList(const ArrayList<T>& other)
+	{
+		init(other.count);
+		for(int i = 0; i < other.count; i++)
+		{
+			items[i] = other.items[i];
+		}
+		count = other.count;
+	}
+
+	~ArrayList()
+	{
+		delete[] items;
+	}
+
+	ArrayList<T>& operator = (const ArrayList<T>& other)
+	{
+		if (this != &other)
+		{
+			Clear();
+			EnsureCapacity(other.count);
+			for(int i = 0; i < other.count; i++)
+			{
+				items[i] = other.items[i];
+			}
+			count = other.count;
+		}
+		return *this;
+	}
+
+	ReadOnlyProperty<int> Count;
+
+	ReadOnlyProperty<int> Capacity;
+
+	void Add(const T& item)
+	{
+		if (count == capacity)
+		{
+			EnsureCapacity(count + 1);
+		}
+		items[count++] = item;
+	}
+
+	void Insert(int index, const T& item)
+	{
+		if (index < 0 || index > count)
+		{
+			throw new ArgumentOutOfRangeException("index", index,
+				"ArrayList index out of range.");
+		}
+		if (count == capacity)
+		{
+			EnsureCapacity(count + 1);
+		}
+		for(int i = count; i > index; i--)
+		{
+			items[i] = items[i - 1];
+		}
+		items[index] = item;
+		count++;
+	}
+
+	void RemoveAt(int index)
+	{
+		RemoveRange(index, 1);
+	}
+
+	void RemoveRange(int index, int length)
+	{
+		if (index < 0 || length < 0 || index + length > count)
+		{
+			throw new ArgumentOutOfRangeException("index", index,
+				"ArrayList index out of range.");
+		}
+		for(int i = index + length; i < count; i++)
+		{
+			items[i - length] = items[i];
+		}
+		count -= length;
+	}
+
+	void Clear()
+	{
+		count = 0;
+	}
+
+	// Grows the storage so that at least min items fit without
+	// reallocating. Existing items are preserved.
+	void EnsureCapacity(int min)
+	{
+		if (min <= capacity)
+		{
+			return;
+		}
+		int newCapacity = capacity == 0 ? DefaultCapacity : capacity * 2;
+		if (newCapacity < min)
+		{
+			newCapacity = min;
+		}
+		T* newItems = new T[newCapacity];
+		for(int i = 0; i < count; i++)
+		{
+			newItems[i] = items[i];
+		}
+		delete[] items;
+		items = newItems;
+		capacity = newCapacity;
+	}
+
+	T& operator[](int index)
+	{
+		return items[index];
+	}
+
+	const T& operator[](int index) const
+	{
+		return items[index];
+	}
+
+private:
+
+	void init(int capacity)
+	{
+		this->Count = Functor::New(this, &ArrayList::get_Count);
+		this->Capacity = Functor::New(this, &ArrayList::get_Capacity);
+		this->items = capacity > 0 ? new T[capacity] : nullptr;
+		this->count = 0;
+		this->capacity = capacity;
+	}
+
+	int get_Count()
+	{
+		return count;
+	}
+
+	int get_Capacity()
+	{
+		return capacity;
+	}
+
+};
+
+#endif
@@ -0,0 +1,218 @@
+#include "ChannelState.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    /// <summary>
+    /// Marks every value as Unset.
+    /// </summary>
+    void ChannelState::Reset()
+    {
+        for(int i = 0; i < ControllerCount; i++)
+        {
+            controllers[i] = Unset;
+        }
+
+        parameterCount = 0;
+        registered = NullParameter;
+        nonRegistered = NullParameter;
+        registeredSelected = false;
+
+        program = Unset;
+        pressure = Unset;
+        pitchBend = Unset;
+    }
+
+    /// <summary>
+    /// Updates the state with a ChannelMessage.
+    /// </summary>
+    /// <param name="message">
+    /// The ChannelMessage as a packed integer.
+    /// </param>
+    void ChannelState::Process(int message)
+    {
+        int data1 = ShortMessageClass::UnpackData1(message);
+        int data2 = ShortMessageClass::UnpackData2(message);
+
+        switch(ChannelMessageClass::UnpackCommand(message))
+        {
+            case ChannelCommand::Controller:
+                switch((ControllerType)data1)
+                {
+                    case ControllerType::AllControllersOff:
+                        controllers[(int)ControllerType::ModulationWheel] = Unset;
+                        controllers[(int)ControllerType::ModulationWheelFine] = Unset;
+                        controllers[(int)ControllerType::Expression] = Unset;
+                        controllers[(int)ControllerType::ExpressionFine] = Unset;
+                        controllers[(int)ControllerType::HoldPedal1] = Unset;
+                        controllers[(int)ControllerType::Portamento] = Unset;
+                        controllers[(int)ControllerType::SustenutoPedal] = Unset;
+                        controllers[(int)ControllerType::SoftPedal] = Unset;
+                        registered = NullParameter;
+                        nonRegistered = NullParameter;
+                        pressure = Unset;
+                        pitchBend = Unset;
+                        break;
+
+                    case ControllerType::RegisteredParameterCoarse:
+                        registered = (short)((data2 << 7) | (registered & 0x7F));
+                        registeredSelected = true;
+                        break;
+
+                    case ControllerType::RegisteredParameterFine:
+                        registered = (short)((registered & ~0x7F) | data2);
+                        registeredSelected = true;
+                        break;
+
+                    case ControllerType::NonRegisteredParameterCoarse:
+                        nonRegistered = (short)((data2 << 7) | (nonRegistered & 0x7F));
+                        registeredSelected = false;
+                        break;
+
+                    case ControllerType::NonRegisteredParameterFine:
+                        nonRegistered = (short)((nonRegistered & ~0x7F) | data2);
+                        registeredSelected = false;
+                        break;
+
+                    case ControllerType::DataEntrySlider:
+                        SetParameter(false, data2);
+                        break;
+
+                    case ControllerType::DataEntrySliderFine:
+                        SetParameter(true, data2);
+                        break;
+
+                    // The data buttons step a value the receiver holds
+                    // and are not state.
+                    case ControllerType::DataButtonIncrement:
+                    case ControllerType::DataButtonDecrement:
+                        break;
+
+                    default:
+                        // Channel mode messages are not state.
+                        if(data1 < (int)ControllerType::AllSoundOff)
+                        {
+                            controllers[data1] = (sbyte)data2;
+                        }
+                        break;
+                }
+                break;
+
+            case ChannelCommand::ProgramChange:
+                program = (sbyte)data1;
+                break;
+
+            case ChannelCommand::ChannelPressure:
+                pressure = (sbyte)data1;
+                break;
+
+            case ChannelCommand::PitchWheel:
+                pitchBend = (short)((data2 << 7) | data1);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    /// <summary>
+    /// Gets the number of the parameter data entry sets, with
+    /// RegisteredFlag for a registered parameter, or NullParameter.
+    /// </summary>
+    int ChannelState::GetSelected() const
+    {
+        if(registeredSelected)
+        {
+            return registered == NullParameter ? NullParameter : registered | RegisteredFlag;
+        }
+
+        return nonRegistered;
+    }
+
+    /// <summary>
+    /// Gets the value a receiver holds for a controller that a reset all
+    /// controllers message leaves alone, once it has been reset.
+    /// </summary>
+    /// <returns>
+    /// The default value, or Unset if a reset all controllers message
+    /// resets the controller or the controller has no default.
+    /// </returns>
+    int ChannelState::GetDefault(int controller)
+    {
+        switch((ControllerType)controller)
+        {
+            case ControllerType::BankSelect:
+            case ControllerType::BankSelectFine:
+            case ControllerType::TremeloLevel:
+            case ControllerType::ChorusLevel:
+            case ControllerType::CelesteLevel:
+            case ControllerType::PhaserLevel:
+                return 0;
+
+            case ControllerType::Volume:
+                return 100;
+
+            case ControllerType::Pan:
+                return 64;
+
+            case ControllerType::EffectsLevel:
+                return 40;
+
+            default:
+                // The sound controllers are centred.
+                if(controller >= (int)ControllerType::SoundVariation &&
+                    controller <= (int)ControllerType::SoundControl10)
+                {
+                    return 64;
+                }
+
+                return Unset;
+        }
+    }
+
+    void ChannelState::SetParameter(bool fine, int value)
+    {
+        int number = GetSelected();
+
+        if(number == NullParameter)
+        {
+            return;
+        }
+
+        int index = 0;
+
+        while(index < parameterCount && parameters[index].number != number)
+        {
+            index++;
+        }
+
+        if(index == parameterCount)
+        {
+            // Forget the parameter given a value first to make room.
+            if(parameterCount == ParameterCount)
+            {
+                for(int i = 1; i < ParameterCount; i++)
+                {
+                    parameters[i - 1] = parameters[i];
+                }
+
+                parameterCount--;
+                index--;
+            }
+
+            parameters[index].number = (short)number;
+            parameters[index].coarse = Unset;
+            parameters[index].fine = Unset;
+            parameterCount++;
+        }
+
+        if(fine)
+        {
+            parameters[index].fine = (sbyte)value;
+        }
+        else
+        {
+            parameters[index].coarse = (sbyte)value;
+        }
+    }
+
+}}}
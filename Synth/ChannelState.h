@@ -0,0 +1,133 @@
+#ifndef CHANNELSTATE_H
+#define CHANNELSTATE_H
+
+#include "Types.h"
+#include "ChannelMessage.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    /// <summary>
+    /// Represents the controller, program, pitch wheel and pressure state of
+    /// a single MIDI channel.
+    /// </summary>
+    /// <remarks>
+    /// Values that have not been set by a ChannelMessage are Unset, so that
+    /// only state that was actually present in a Sequence is chased.
+    ///
+    /// The parameter selects and data entry controllers are not kept as
+    /// controllers. Instead, the value data entry gives each registered
+    /// and non-registered parameter is kept with the parameter's number,
+    /// together with the parameter selected last, so that every value can
+    /// be sent again to the parameter it was meant for.
+    ///
+    /// A reset all controllers message resets what RP-015 says it resets:
+    /// the modulation wheel, expression, the pedals, the parameter select,
+    /// the pitch wheel and the pressure. Bank, program, volume, pan, the
+    /// sound and effect controllers and the parameter values are left
+    /// alone.
+    /// </remarks>
+    struct ChannelState
+    {
+        /// <summary>
+        /// Marks a value that has not been set.
+        /// </summary>
+        static const int Unset = -1;
+
+        /// <summary>
+        /// The number of controllers.
+        /// </summary>
+        static const int ControllerCount = 128;
+
+        /// <summary>
+        /// The most parameter values kept. When more parameters are given
+        /// values, the one given a value first is forgotten.
+        /// </summary>
+        static const int ParameterCount = 16;
+
+        /// <summary>
+        /// The number of the null parameter, which selects no parameter.
+        /// </summary>
+        static const int NullParameter = 0x3FFF;
+
+        /// <summary>
+        /// Marks the number of a registered parameter.
+        /// </summary>
+        static const int RegisteredFlag = 0x4000;
+
+        // The value data entry gave a parameter.
+        struct Parameter
+        {
+            // The 14-bit parameter number, with RegisteredFlag for a
+            // registered parameter.
+            short number;
+
+            // The DataEntrySlider and DataEntrySliderFine values.
+            sbyte coarse;
+
+            sbyte fine;
+        };
+
+        // The value of each ControllerType. The parameter selects and data
+        // entry controllers are always Unset.
+        sbyte controllers[ControllerCount];
+
+        // The parameter values in the order they were first given.
+        Parameter parameters[ParameterCount];
+
+        int parameterCount;
+
+        // The registered and non-registered parameter numbers selected,
+        // and whether the registered one was selected last.
+        short registered;
+
+        short nonRegistered;
+
+        bool registeredSelected;
+
+        // The program number.
+        sbyte program;
+
+        // The channel pressure.
+        sbyte pressure;
+
+        // The 14-bit pitch wheel value.
+        short pitchBend;
+
+        /// <summary>
+        /// Marks every value as Unset.
+        /// </summary>
+        void Reset();
+
+        /// <summary>
+        /// Updates the state with a ChannelMessage.
+        /// </summary>
+        /// <param name="message">
+        /// The ChannelMessage as a packed integer.
+        /// </param>
+        void Process(int message);
+
+        /// <summary>
+        /// Gets the number of the parameter data entry sets, with
+        /// RegisteredFlag for a registered parameter, or NullParameter.
+        /// </summary>
+        int GetSelected() const;
+
+        /// <summary>
+        /// Gets the value a receiver holds for a controller that a reset
+        /// all controllers message leaves alone, once it has been reset.
+        /// </summary>
+        /// <returns>
+        /// The default value, or Unset if a reset all controllers message
+        /// resets the controller or the controller has no default.
+        /// </returns>
+        static int GetDefault(int controller);
+
+    private:
+
+        // Stores a data entry value for the selected parameter.
+        void SetParameter(bool fine, int value);
+    };
+
+}}}
+
+#endif
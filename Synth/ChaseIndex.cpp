@@ -0,0 +1,465 @@
+#include "ChaseIndex.h"
+#include "Sequence.h"
+#include "SequenceSnapshot.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef ChaseIndexClass cls;
+
+    void cls::init()
+    {
+        this->Interval = Functor::New(this, &cls::get_Interval, &cls::set_Interval);
+        this->Count = Functor::New(this, &cls::get_Count);
+        this->IsValid = Functor::New(this, &cls::get_IsValid);
+        this->sequence = nullptr;
+        this->snapshot = nullptr;
+        this->interval = 1;
+        this->trackCount = 0;
+        this->valid = false;
+
+        for(int i = 0; i < ChannelCount; i++)
+        {
+            channels[i].Reset();
+        }
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the ChaseIndex class with the
+    /// specified snapshot interval.
+    /// </summary>
+    /// <param name="interval">
+    /// The number of ticks between snapshots.
+    /// </param>
+    ChaseIndexClass::ChaseIndexClass(int interval)
+    {
+        init();
+        Interval = interval;
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Takes the snapshots of the specified Sequence.
+    /// </summary>
+    void ChaseIndexClass::Build(Sequence sequence)
+    {
+        Detach();
+
+        this->sequence = &sequence;
+        this->snapshot = nullptr;
+        this->trackCount = sequence.Count;
+
+        MergeQueueClass queue;
+
+        queue.Reset(sequence, 0);
+
+        Build(queue);
+
+        List<Track>::iterator it = sequence.GetIterator();
+        for(it = it.begin(); it != it.end(); it++)
+        {
+            ((Track)it).Attach(*this);
+        }
+
+        valid = true;
+    }
+
+    /// <summary>
+    /// Takes the snapshots of the specified SequenceSnapshot.
+    /// </summary>
+    void ChaseIndexClass::Build(SequenceSnapshot snapshot)
+    {
+        Detach();
+
+        this->sequence = nullptr;
+        this->snapshot = &snapshot;
+        this->trackCount = snapshot.Count;
+
+        MergeQueueClass queue;
+
+        queue.Reset(snapshot, 0);
+
+        Build(queue);
+
+        valid = true;
+    }
+
+    void ChaseIndexClass::Build(MergeQueue queue)
+    {
+        snapshots.Clear();
+        cursors.Clear();
+
+        ChannelState state[ChannelCount];
+
+        for(int i = 0; i < ChannelCount; i++)
+        {
+            state[i].Reset();
+        }
+
+        int next = 0;
+
+        while(!queue.IsEmpty)
+        {
+            int ticks = queue.NextPosition;
+
+            // Only the last interval boundary crossed gets a snapshot, so
+            // long gaps between MidiEvents do not fill up the index.
+            if(ticks >= next)
+            {
+                int boundary = ticks - ticks % interval;
+
+                AddSnapshot(boundary, queue, state);
+
+                next = boundary + interval;
+            }
+
+            Process(state, queue.Dequeue().MidiMessage);
+        }
+    }
+
+    /// <summary>
+    /// Restores the channel state at the specified position and
+    /// positions the MergeQueue at the first MidiEvent at or after it.
+    /// </summary>
+    /// <param name="position">
+    /// The position in absolute ticks to seek to.
+    /// </param>
+    /// <param name="queue">
+    /// The MergeQueue to position.
+    /// </param>
+    void ChaseIndexClass::Seek(int position, MergeQueue queue)
+    {
+        REGION(Require)
+
+        if(sequence == nullptr && snapshot == nullptr)
+        {
+            throw new InvalidOperationException("The ChaseIndex has not been built.");
+        }
+        else if(position < 0)
+        {
+            throw new ArgumentOutOfRangeException("position", position,
+                "Position out of range.");
+        }
+
+        ENDREGION()
+
+        if(snapshot != nullptr)
+        {
+            // Only a new Interval invalidates the snapshots.
+            if(!valid)
+            {
+                Build(*snapshot);
+            }
+        }
+        else if(!valid || trackCount != sequence->Count)
+        {
+            Build(*sequence);
+        }
+
+        int index = FindSnapshot(position);
+
+        if(index < 0)
+        {
+            for(int i = 0; i < ChannelCount; i++)
+            {
+                channels[i].Reset();
+            }
+
+            if(snapshot != nullptr)
+            {
+                queue.Reset(*snapshot, 0);
+            }
+            else
+            {
+                queue.Reset(*sequence, 0);
+            }
+        }
+        else
+        {
+            for(int i = 0; i < ChannelCount; i++)
+            {
+                channels[i] = snapshots[index].channels[i];
+            }
+
+            queue.Reset(cursors, index * trackCount, trackCount);
+        }
+
+        while(!queue.IsEmpty && queue.NextPosition < position)
+        {
+            Process(channels, queue.Dequeue().MidiMessage);
+        }
+    }
+
+    /// <summary>
+    /// Sends the restored channel state as ChannelMessages.
+    /// </summary>
+    /// <remarks>
+    /// Every channel is sent a reset all controllers message first, and
+    /// the program and the controllers the reset leaves alone are sent
+    /// their defaults when the state does not hold them, so nothing sent
+    /// after the position is left behind by a seek backwards.
+    /// </remarks>
+    /// <param name="sink">
+    /// The IMidiSink to send the messages to.
+    /// </param>
+    /// <param name="microseconds">
+    /// The time in microseconds to send the messages with.
+    /// </param>
+    void ChaseIndexClass::Send(IMidiSink sink, long long microseconds)
+    {
+        for(int c = 0; c < ChannelCount; c++)
+        {
+            const ChannelState& state = channels[c];
+
+            // Reset the channel first, so that nothing the receiver was
+            // given after the position outlives the seek, and give the
+            // controllers the reset leaves alone their defaults when the
+            // state does not hold them.
+            Send(sink, microseconds, ChannelCommand::Controller, c,
+                (int)ControllerType::AllControllersOff, 0);
+
+            // Controllers go before the program change, so that the bank
+            // selects precede it.
+            for(int i = 0; i < (int)ControllerType::AllSoundOff; i++)
+            {
+                int value = state.controllers[i] != ChannelState::Unset ?
+                    state.controllers[i] : ChannelState::GetDefault(i);
+
+                if(value != ChannelState::Unset)
+                {
+                    Send(sink, microseconds, ChannelCommand::Controller, c, i, value);
+                }
+            }
+
+            // Each parameter value goes to the parameter it was given to,
+            // then the parameter selected at the position is selected
+            // again, or none is.
+            for(int i = 0; i < state.parameterCount; i++)
+            {
+                const ChannelState::Parameter& parameter = state.parameters[i];
+
+                SendSelect(sink, microseconds, c, parameter.number);
+
+                if(parameter.coarse != ChannelState::Unset)
+                {
+                    Send(sink, microseconds, ChannelCommand::Controller, c,
+                        (int)ControllerType::DataEntrySlider, parameter.coarse);
+                }
+
+                if(parameter.fine != ChannelState::Unset)
+                {
+                    Send(sink, microseconds, ChannelCommand::Controller, c,
+                        (int)ControllerType::DataEntrySliderFine, parameter.fine);
+                }
+            }
+
+            SendSelect(sink, microseconds, c, state.GetSelected());
+
+            Send(sink, microseconds, ChannelCommand::ProgramChange, c,
+                state.program != ChannelState::Unset ? state.program : 0, 0);
+
+            if(state.pitchBend != ChannelState::Unset)
+            {
+                Send(sink, microseconds, ChannelCommand::PitchWheel, c,
+                    state.pitchBend & 0x7F, state.pitchBend >> 7);
+            }
+
+            if(state.pressure != ChannelState::Unset)
+            {
+                Send(sink, microseconds, ChannelCommand::ChannelPressure, c, state.pressure, 0);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Gets the restored state of the specified channel.
+    /// </summary>
+    const ChannelState& ChaseIndexClass::operator [](int channel)
+    {
+        REGION(Require)
+
+        if(channel < 0 || channel >= ChannelCount)
+        {
+            throw new ArgumentOutOfRangeException("channel", channel,
+                "MIDI channel out of range.");
+        }
+
+        ENDREGION()
+
+        return channels[channel];
+    }
+
+    void ChaseIndexClass::AddSnapshot(int ticks, MergeQueue queue, ChannelState* state)
+    {
+        Snapshot snapshot;
+
+        snapshot.ticks = ticks;
+
+        for(int i = 0; i < ChannelCount; i++)
+        {
+            snapshot.channels[i] = state[i];
+        }
+
+        snapshots.Add(snapshot);
+
+        queue.CopyCursorsTo(cursors);
+    }
+
+    int ChaseIndexClass::FindSnapshot(int position)
+    {
+        int low = 0;
+        int high = snapshots.Count - 1;
+        int result = -1;
+
+        while(low <= high)
+        {
+            int mid = (low + high) / 2;
+
+            if(snapshots[mid].ticks <= position)
+            {
+                result = mid;
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid - 1;
+            }
+        }
+
+        return result;
+    }
+
+    void ChaseIndexClass::Process(ChannelState* state, IMidiMessage message)
+    {
+        if(message.MessageType == MessageType::Channel)
+        {
+            int packed = ((ChannelMessage)message).Message;
+
+            state[ChannelMessageClass::UnpackMidiChannel(packed)].Process(packed);
+        }
+    }
+
+    void ChaseIndexClass::Send(IMidiSink sink, long long microseconds, ChannelCommand command,
+        int channel, int data1, int data2)
+    {
+        builder.Command = command;
+        builder.MidiChannel = channel;
+        builder.Data1 = data1;
+        builder.Data2 = data2;
+        builder.Build();
+
+        sink.Send(builder.Result, microseconds);
+    }
+
+    // Sends the parameter selects for the specified parameter number,
+    // which carries RegisteredFlag for a registered parameter. The null
+    // parameter is selected as the null registered parameter.
+    void ChaseIndexClass::SendSelect(IMidiSink sink, long long microseconds, int channel, int number)
+    {
+        bool registered = number == ChannelState::NullParameter ||
+            (number & ChannelState::RegisteredFlag) != 0;
+
+        number &= ChannelState::NullParameter;
+
+        Send(sink, microseconds, ChannelCommand::Controller, channel, registered ?
+            (int)ControllerType::RegisteredParameterCoarse :
+            (int)ControllerType::NonRegisteredParameterCoarse, number >> 7);
+
+        Send(sink, microseconds, ChannelCommand::Controller, channel, registered ?
+            (int)ControllerType::RegisteredParameterFine :
+            (int)ControllerType::NonRegisteredParameterFine, number & 0x7F);
+    }
+
+    void ChaseIndexClass::Detach()
+    {
+        if(sequence == nullptr)
+        {
+            return;
+        }
+
+        List<Track>::iterator it = sequence->GetIterator();
+        for(it = it.begin(); it != it.end(); it++)
+        {
+            ((Track)it).Detach(*this);
+        }
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets or sets the number of ticks between snapshots.
+    /// </summary>
+    int ChaseIndexClass::get_Interval()
+    {
+        return interval;
+    }
+    void ChaseIndexClass::set_Interval(int value)
+    {
+        REGION(Require)
+
+        if(value <= 0)
+        {
+            throw new ArgumentOutOfRangeException("Interval", value,
+                "Snapshot interval out of range.");
+        }
+
+        ENDREGION()
+
+        interval = value;
+        valid = false;
+    }
+
+    /// <summary>
+    /// Gets the number of snapshots.
+    /// </summary>
+    int ChaseIndexClass::get_Count()
+    {
+        return snapshots.Count;
+    }
+
+    /// <summary>
+    /// Gets a value indicating whether the snapshots match the
+    /// Sequence.
+    /// </summary>
+    bool ChaseIndexClass::get_IsValid()
+    {
+        return valid;
+    }
+
+    ENDREGION()
+
+    REGION(ITrackObserver Members)
+
+    // Any edit can leave a saved cursor on a removed MidiEvent or skip a
+    // new one, so the snapshots are simply rebuilt on the next seek.
+
+    void ChaseIndexClass::MidiEventInserted(Track track, MidiEvent e)
+    {
+        valid = false;
+    }
+
+    void ChaseIndexClass::MidiEventRemoved(Track track, MidiEvent e)
+    {
+        valid = false;
+    }
+
+    void ChaseIndexClass::MidiEventMoved(Track track, MidiEvent e, int oldPosition)
+    {
+        valid = false;
+    }
+
+    void ChaseIndexClass::TrackCleared(Track track)
+    {
+        valid = false;
+    }
+
+    ENDREGION()
+
+}}}
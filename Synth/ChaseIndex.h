@@ -0,0 +1,230 @@
+#ifndef CHASEINDEX_H
+#define CHASEINDEX_H
+
+#include "Types.h"
+#include "ArrayList.h"
+#include "Track.h"
+#include "ChannelState.h"
+#include "ChannelMessageBuilder.h"
+#include "MergeQueue.h"
+#include "IMidiSink.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    class SequenceClass;
+    typedef SequenceClass& Sequence;
+
+    class SequenceSnapshotClass;
+    typedef SequenceSnapshotClass& SequenceSnapshot;
+
+    class ChaseIndexClass;
+    typedef ChaseIndexClass& ChaseIndex;
+
+    /// <summary>
+    /// Restores the channel state of a Sequence at any position without
+    /// replaying every ChannelMessage from the beginning.
+    /// </summary>
+    /// <remarks>
+    /// The ChaseIndex stores a snapshot of the state of every MIDI channel
+    /// once per interval, together with the MidiEvent each Track had
+    /// reached. Seeking restores the nearest snapshot before the position
+    /// and replays only the MidiEvents between the two. Edits made to the
+    /// Sequence's Tracks invalidate the snapshots, which are rebuilt on the
+    /// next seek. A ChaseIndex built from a SequenceSnapshot is never
+    /// invalidated, since a SequenceSnapshot is never edited.
+    /// </remarks>
+    class ChaseIndexClass : public ITrackObserverIf
+    {
+        REGION(ChaseIndex Members)
+
+        REGION(Constants)
+
+    public:
+
+        /// <summary>
+        /// The number of MIDI channels.
+        /// </summary>
+        static const int ChannelCount = ChannelMessageClass::MidiChannelMaxValue + 1;
+
+        ENDREGION()
+
+        REGION(Fields)
+
+    private:
+
+        struct Snapshot
+        {
+            // The position the snapshot was taken at. The state includes
+            // every MidiEvent before this position.
+            int ticks;
+
+            // The state of every channel.
+            ChannelState channels[ChannelCount];
+        };
+
+        // The Sequence or the SequenceSnapshot the snapshots were taken
+        // from. Only one is set.
+        SequenceClass* sequence;
+
+        SequenceSnapshotClass* snapshot;
+
+        // The number of ticks between snapshots.
+        int interval;
+
+        // The snapshots sorted by position.
+        ArrayList<Snapshot> snapshots;
+
+        // The MidiEvent each Track had reached at each snapshot, stored
+        // as trackCount entries per snapshot.
+        ArrayList<MidiEventClass*> cursors;
+
+        // The number of Tracks in the Sequence when the snapshots were
+        // taken.
+        int trackCount;
+
+        // The restored state of every channel.
+        ChannelState channels[ChannelCount];
+
+        // Builds the messages that send the restored state.
+        ChannelMessageBuilderClass builder;
+
+        // Indicates whether the snapshots match the Sequence.
+        bool valid;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the ChaseIndex class with the
+        /// specified snapshot interval.
+        /// </summary>
+        /// <param name="interval">
+        /// The number of ticks between snapshots.
+        /// </param>
+        ChaseIndexClass(int interval);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Takes the snapshots of the specified Sequence.
+        /// </summary>
+        void Build(Sequence sequence);
+
+        /// <summary>
+        /// Takes the snapshots of the specified SequenceSnapshot.
+        /// </summary>
+        void Build(SequenceSnapshot snapshot);
+
+        /// <summary>
+        /// Restores the channel state at the specified position and
+        /// positions the MergeQueue at the first MidiEvent at or after it.
+        /// </summary>
+        /// <param name="position">
+        /// The position in absolute ticks to seek to.
+        /// </param>
+        /// <param name="queue">
+        /// The MergeQueue to position.
+        /// </param>
+        void Seek(int position, MergeQueue queue);
+
+        /// <summary>
+        /// Sends the restored channel state as ChannelMessages.
+        /// </summary>
+        /// <remarks>
+        /// Every channel is sent a reset all controllers message first, and
+        /// the program and the controllers the reset leaves alone are sent
+        /// their defaults when the state does not hold them, so nothing sent
+        /// after the position is left behind by a seek backwards.
+        /// </remarks>
+        /// <param name="sink">
+        /// The IMidiSink to send the messages to.
+        /// </param>
+        /// <param name="microseconds">
+        /// The time in microseconds to send the messages with.
+        /// </param>
+        void Send(IMidiSink sink, long long microseconds);
+
+        /// <summary>
+        /// Gets the restored state of the specified channel.
+        /// </summary>
+        const ChannelState& operator[](int channel);
+
+    private:
+
+        // Takes the snapshots of the MidiEvents the MergeQueue holds.
+        void Build(MergeQueue queue);
+
+        void AddSnapshot(int ticks, MergeQueue queue, ChannelState* state);
+
+        // Returns the index of the last snapshot at or before the specified
+        // position, or -1 if there is none.
+        int FindSnapshot(int position);
+
+        void Process(ChannelState* state, IMidiMessage message);
+
+        void Send(IMidiSink sink, long long microseconds, ChannelCommand command,
+            int channel, int data1, int data2);
+
+        void SendSelect(IMidiSink sink, long long microseconds, int channel, int number);
+
+        void Detach();
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets or sets the number of ticks between snapshots.
+        /// </summary>
+        Property<int> Interval;
+
+        /// <summary>
+        /// Gets the number of snapshots.
+        /// </summary>
+        ReadOnlyProperty<int> Count;
+
+        /// <summary>
+        /// Gets a value indicating whether the snapshots match the
+        /// Sequence.
+        /// </summary>
+        ReadOnlyProperty<bool> IsValid;
+
+        ENDREGION()
+
+        ENDREGION()
+
+        REGION(ITrackObserver Members)
+
+    public:
+
+        void MidiEventInserted(Track track, MidiEvent e);
+
+        void MidiEventRemoved(Track track, MidiEvent e);
+
+        void MidiEventMoved(Track track, MidiEvent e, int oldPosition);
+
+        void TrackCleared(Track track);
+
+        ENDREGION()
+
+    private:
+        void init();
+        int get_Interval();
+        void set_Interval(int value);
+        int get_Count();
+        bool get_IsValid();
+
+    };
+
+}}}
+
+#endif
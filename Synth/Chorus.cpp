@@ -0,0 +1,322 @@
+#include <math.h>
+#include <malloc.h>
+#include "Chorus.h"
+#include "SimdVector.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef ChorusClass cls;
+
+    static const double Pi = 3.14159265358979323846;
+
+    // The number of samples the delays ramp linearly over between
+    // evaluations of the LFO.
+    static const int ChunkSize = 64;
+
+    // The delay in seconds the taps sweep around, the most the Depth can
+    // sweep them by in milliseconds, and the fastest Rate.
+    static const double CentreDelay = 0.012;
+    static const float MaxDepth = 10.0f;
+    static const float MaxRate = 20.0f;
+
+    void cls::init()
+    {
+        this->Rate = Functor::New(this, &cls::get_Rate, &cls::set_Rate);
+        this->Depth = Functor::New(this, &cls::get_Depth, &cls::set_Depth);
+        this->InstructionSet = Functor::New(this, &cls::get_InstructionSet, &cls::set_InstructionSet);
+        this->buffer = nullptr;
+        this->mask = 0;
+        this->position = 0;
+        this->phase = 0.0;
+        this->leftDelay = 0.0f;
+        this->rightDelay = 0.0f;
+        this->leftSlope = 0.0f;
+        this->rightSlope = 0.0f;
+        this->chunkPhase = 0;
+        this->indices = nullptr;
+        this->nextIndices = nullptr;
+        this->fractions = nullptr;
+        this->sampleRate = 0;
+        this->rate = 0.4f;
+        this->depth = 3.0f;
+        this->instructionSet = OscillatorBankClass::DetectInstructionSet();
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the Chorus class with the specified
+    /// sample rate.
+    /// </summary>
+    ChorusClass::ChorusClass(int sampleRate)
+    {
+        init();
+
+        REGION(Require)
+
+        if(sampleRate <= 0)
+        {
+            throw new ArgumentOutOfRangeException("sampleRate", sampleRate,
+                "Sample rate out of range.");
+        }
+
+        ENDREGION()
+
+        this->sampleRate = sampleRate;
+
+        // Room for the longest delay and a chunk written ahead of it.
+        int longest = (int)((CentreDelay + MaxDepth / 1000.0) * sampleRate) + ChunkSize + 2;
+        int size = 1;
+
+        while(size < longest)
+        {
+            size *= 2;
+        }
+
+        mask = size - 1;
+        buffer = new float[size];
+        indices = (int*)_aligned_malloc(ChunkSize * sizeof(int), 32);
+        nextIndices = (int*)_aligned_malloc(ChunkSize * sizeof(int), 32);
+        fractions = (float*)_aligned_malloc(ChunkSize * sizeof(float), 32);
+
+        Clear();
+    }
+
+    ChorusClass::~ChorusClass()
+    {
+        delete[] buffer;
+        _aligned_free(indices);
+        _aligned_free(nextIndices);
+        _aligned_free(fractions);
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Choruses a send and adds the result to the buffers.
+    /// </summary>
+    /// <param name="input">
+    /// The send.
+    /// </param>
+    /// <param name="left">
+    /// The buffer the left channel is added to.
+    /// </param>
+    /// <param name="right">
+    /// The buffer the right channel is added to.
+    /// </param>
+    /// <param name="count">
+    /// The number of samples.
+    /// </param>
+    void ChorusClass::Process(const float* input, float* left, float* right, int count)
+    {
+        REGION(Require)
+
+        if(input == nullptr)
+        {
+            throw new ArgumentNullException("input");
+        }
+        else if(left == nullptr)
+        {
+            throw new ArgumentNullException("left");
+        }
+        else if(right == nullptr)
+        {
+            throw new ArgumentNullException("right");
+        }
+
+        ENDREGION()
+
+        switch(instructionSet)
+        {
+            case InstructionSet::Avx2:
+                ProcessWith<Avx2Vector>(input, left, right, count);
+                break;
+
+            case InstructionSet::Sse2:
+                ProcessWith<Sse2Vector>(input, left, right, count);
+                break;
+
+            default:
+                ProcessWith<ScalarVector>(input, left, right, count);
+                break;
+        }
+    }
+
+    /// <summary>
+    /// Silences the delay line.
+    /// </summary>
+    void ChorusClass::Clear()
+    {
+        for(int i = 0; i <= mask; i++)
+        {
+            buffer[i] = 0.0f;
+        }
+    }
+
+    template<typename V>
+    void ChorusClass::ProcessWith(const float* input, float* left, float* right, int count)
+    {
+        for(int offset = 0; offset < count; )
+        {
+            if(chunkPhase == 0)
+            {
+                double next = phase + (double)rate * ChunkSize / sampleRate;
+
+                leftDelay = GetDelay(phase);
+                rightDelay = GetDelay(phase + 0.25);
+                leftSlope = (GetDelay(next) - leftDelay) / ChunkSize;
+                rightSlope = (GetDelay(next + 0.25) - rightDelay) / ChunkSize;
+                phase = next - floor(next);
+            }
+
+            int n = ChunkSize - chunkPhase;
+
+            if(n > count - offset)
+            {
+                n = count - offset;
+            }
+
+            for(int i = 0; i < n; i++)
+            {
+                buffer[(position + i) & mask] = input[offset + i];
+            }
+
+            ReadTap<V>(position, leftDelay, leftSlope, chunkPhase, left + offset, n);
+            ReadTap<V>(position, rightDelay, rightSlope, chunkPhase, right + offset, n);
+
+            offset += n;
+            position = (position + n) & mask;
+            chunkPhase = (chunkPhase + n) % ChunkSize;
+        }
+
+        V::End();
+    }
+
+    template<typename V>
+    void ChorusClass::ReadTap(int first, float delay, float slope, int offset, float* output,
+        int count)
+    {
+        typedef typename V::Type Vector;
+
+        int padded = (count + V::Width - 1) / V::Width * V::Width;
+
+        // Lanes past the count read frame zero, which is always there.
+        for(int i = 0; i < padded; i++)
+        {
+            if(i < count)
+            {
+                float x = (float)(first + i) - (delay + slope * (offset + i));
+                float whole = floorf(x);
+
+                indices[i] = (int)whole & mask;
+                nextIndices[i] = ((int)whole + 1) & mask;
+                fractions[i] = x - whole;
+            }
+            else
+            {
+                indices[i] = 0;
+                nextIndices[i] = 0;
+                fractions[i] = 0.0f;
+            }
+        }
+
+        for(int i = 0; i < padded; i += V::Width)
+        {
+            Vector a = V::Gather(buffer, indices + i);
+            Vector b = V::Gather(buffer, nextIndices + i);
+            Vector f = V::Load(fractions + i);
+
+            // The results go back over the fractions, which are aligned,
+            // before they are added to the output, which may not be.
+            V::Store(fractions + i, V::Add(a, V::Mul(f, V::Sub(b, a))));
+        }
+
+        for(int i = 0; i < count; i++)
+        {
+            output[i] += fractions[i];
+        }
+    }
+
+    float ChorusClass::GetDelay(double phase)
+    {
+        return (float)((CentreDelay + depth / 1000.0 * sin(2.0 * Pi * phase)) * sampleRate);
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets or sets the rate of the LFO in cycles per second.
+    /// </summary>
+    float ChorusClass::get_Rate()
+    {
+        return rate;
+    }
+    void ChorusClass::set_Rate(float value)
+    {
+        REGION(Require)
+
+        if(!(value >= 0.0f && value <= MaxRate))
+        {
+            throw new ArgumentOutOfRangeException("Rate", (int)value,
+                "Chorus rate out of range.");
+        }
+
+        ENDREGION()
+
+        rate = value;
+    }
+
+    /// <summary>
+    /// Gets or sets how far the LFO sweeps the delays either side of their
+    /// centre, in milliseconds.
+    /// </summary>
+    float ChorusClass::get_Depth()
+    {
+        return depth;
+    }
+    void ChorusClass::set_Depth(float value)
+    {
+        REGION(Require)
+
+        if(!(value >= 0.0f && value <= MaxDepth))
+        {
+            throw new ArgumentOutOfRangeException("Depth", (int)value,
+                "Chorus depth out of range.");
+        }
+
+        ENDREGION()
+
+        depth = value;
+    }
+
+    /// <summary>
+    /// Gets or sets the instruction set used for processing. It can be
+    /// lowered for testing but not raised above what the processor
+    /// supports.
+    /// </summary>
+    Midi::InstructionSet ChorusClass::get_InstructionSet()
+    {
+        return instructionSet;
+    }
+    void ChorusClass::set_InstructionSet(Midi::InstructionSet value)
+    {
+        REGION(Require)
+
+        if(value > OscillatorBankClass::DetectInstructionSet())
+        {
+            throw new ArgumentException("Instruction set not supported.", "InstructionSet");
+        }
+
+        ENDREGION()
+
+        instructionSet = value;
+    }
+
+    ENDREGION()
+
+}}}
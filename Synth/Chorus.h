@@ -0,0 +1,176 @@
+#ifndef CHORUS_H
+#define CHORUS_H
+
+#include "Types.h"
+#include "OscillatorBank.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    class ChorusClass;
+    typedef ChorusClass& Chorus;
+
+    /// <summary>
+    /// Adds a stereo chorus of a mono send to a pair of buffers.
+    /// </summary>
+    /// <remarks>
+    /// The send is written to a delay line and read back by two taps, one
+    /// per output, whose delays are swept by a sine LFO a quarter cycle
+    /// apart. The LFO is evaluated at the ends of each chunk of samples
+    /// and the delays ramp linearly between, so the taps are read with
+    /// SIMD instructions across samples, interpolating linearly between
+    /// the two frames around each position.
+    ///
+    /// Like a Reverb, the chorus costs the same however many voices feed
+    /// it, so a Synthesizer runs one on the summed sends of its voices.
+    /// </remarks>
+    class ChorusClass
+    {
+        REGION(Chorus Members)
+
+        REGION(Fields)
+
+    private:
+
+        // The delay line, its size minus one, a power of two, and the
+        // position written next.
+        float* buffer;
+
+        int mask;
+
+        int position;
+
+        // The phase of the LFO in cycles at the end of the current chunk.
+        double phase;
+
+        // The delays of the taps at the start of the current chunk and
+        // how much they change per sample across it, and how far into it
+        // processing has got. The chunks are counted from the first
+        // sample processed, so the output does not depend on how it is
+        // divided into calls.
+        float leftDelay;
+
+        float rightDelay;
+
+        float leftSlope;
+
+        float rightSlope;
+
+        int chunkPhase;
+
+        // The frame positions and fractions of a chunk of reads.
+        int* indices;
+
+        int* nextIndices;
+
+        float* fractions;
+
+        int sampleRate;
+
+        float rate;
+
+        float depth;
+
+        Midi::InstructionSet instructionSet;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the Chorus class with the
+        /// specified sample rate.
+        /// </summary>
+        ChorusClass(int sampleRate);
+
+        ~ChorusClass();
+
+    private:
+
+        ChorusClass(const ChorusClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Choruses a send and adds the result to the buffers.
+        /// </summary>
+        /// <param name="input">
+        /// The send.
+        /// </param>
+        /// <param name="left">
+        /// The buffer the left channel is added to.
+        /// </param>
+        /// <param name="right">
+        /// The buffer the right channel is added to.
+        /// </param>
+        /// <param name="count">
+        /// The number of samples.
+        /// </param>
+        void Process(const float* input, float* left, float* right, int count);
+
+        /// <summary>
+        /// Silences the delay line.
+        /// </summary>
+        void Clear();
+
+    private:
+
+        template<typename V>
+        void ProcessWith(const float* input, float* left, float* right, int count);
+
+        // Reads a tap whose delay ramps linearly from a chunk's start and
+        // adds it to the output, starting offset samples into the chunk.
+        template<typename V>
+        void ReadTap(int first, float delay, float slope, int offset, float* output,
+            int count);
+
+        // Gets the delay in samples of a tap at an LFO phase.
+        float GetDelay(double phase);
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets or sets the rate of the LFO in cycles per second.
+        /// </summary>
+        Property<float> Rate;
+
+        /// <summary>
+        /// Gets or sets how far the LFO sweeps the delays either side of
+        /// their centre, in milliseconds.
+        /// </summary>
+        Property<float> Depth;
+
+        /// <summary>
+        /// Gets or sets the instruction set used for processing. It can be
+        /// lowered for testing but not raised above what the processor
+        /// supports.
+        /// </summary>
+        Property<Midi::InstructionSet> InstructionSet;
+
+        ENDREGION()
+
+        ENDREGION()
+
+    private:
+        void init();
+        float get_Rate();
+        void set_Rate(float value);
+        float get_Depth();
+        void set_Depth(float value);
+        Midi::InstructionSet get_InstructionSet();
+        void set_InstructionSet(Midi::InstructionSet value);
+
+    };
+
+}}}
+
+#endif
@@ -0,0 +1,317 @@
+#include <malloc.h>
+#include "EnvelopeBank.h"
+#include "SimdVector.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef EnvelopeBankClass cls;
+
+    // The rate of a stage with no duration, fast enough to finish it in
+    // any control period.
+    static const float Instant = 1.0e9f;
+
+    static float* AllocateFloats(int count, float value)
+    {
+        float* result = (float*)_aligned_malloc(count * sizeof(float), 32);
+
+        for(int i = 0; i < count; i++)
+        {
+            result[i] = value;
+        }
+
+        return result;
+    }
+
+    static float GetRate(float change, float seconds)
+    {
+        return seconds > 0.0f ? change / seconds : Instant;
+    }
+
+    void cls::init()
+    {
+        this->Capacity = Functor::New(this, &cls::get_Capacity);
+        this->InstructionSet = Functor::New(this, &cls::get_InstructionSet, &cls::set_InstructionSet);
+        this->levels = nullptr;
+        this->stages = nullptr;
+        this->attackRates = nullptr;
+        this->decayRates = nullptr;
+        this->sustains = nullptr;
+        this->releaseRates = nullptr;
+        this->capacity = 0;
+        this->instructionSet = OscillatorBankClass::DetectInstructionSet();
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the EnvelopeBank class with the
+    /// specified number of slots.
+    /// </summary>
+    EnvelopeBankClass::EnvelopeBankClass(int capacity)
+    {
+        init();
+
+        REGION(Require)
+
+        if(capacity <= 0)
+        {
+            throw new ArgumentOutOfRangeException("capacity", capacity,
+                "Envelope count out of range.");
+        }
+
+        ENDREGION()
+
+        const int groupSize = OscillatorBankClass::GroupSize;
+
+        this->capacity = (capacity + groupSize - 1) / groupSize * groupSize;
+
+        levels = AllocateFloats(this->capacity, 0.0f);
+        stages = AllocateFloats(this->capacity, (float)StageIdle);
+        attackRates = AllocateFloats(this->capacity, 0.0f);
+        decayRates = AllocateFloats(this->capacity, 0.0f);
+        sustains = AllocateFloats(this->capacity, 0.0f);
+        releaseRates = AllocateFloats(this->capacity, 0.0f);
+    }
+
+    EnvelopeBankClass::~EnvelopeBankClass()
+    {
+        _aligned_free(levels);
+        _aligned_free(stages);
+        _aligned_free(attackRates);
+        _aligned_free(decayRates);
+        _aligned_free(sustains);
+        _aligned_free(releaseRates);
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Starts the attack of an envelope.
+    /// </summary>
+    /// <param name="slot">
+    /// The slot of the envelope.
+    /// </param>
+    /// <param name="envelope">
+    /// The envelope settings.
+    /// </param>
+    /// <param name="level">
+    /// The level to attack from, which is not zero when a voice is
+    /// retriggered.
+    /// </param>
+    void EnvelopeBankClass::Start(int slot, const Envelope& envelope, float level)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Envelope slot out of range.");
+        }
+
+        ENDREGION()
+
+        float sustain = envelope.sustain < 0.0f ? 0.0f :
+            envelope.sustain > 1.0f ? 1.0f : envelope.sustain;
+
+        levels[slot] = level < 0.0f ? 0.0f : level > 1.0f ? 1.0f : level;
+        stages[slot] = (float)StageAttack;
+        attackRates[slot] = GetRate(1.0f, envelope.attack);
+        decayRates[slot] = GetRate(1.0f - sustain, envelope.decay);
+        sustains[slot] = sustain;
+        releaseRates[slot] = GetRate(1.0f, envelope.release);
+    }
+
+    /// <summary>
+    /// Moves an envelope to its release stage.
+    /// </summary>
+    void EnvelopeBankClass::Release(int slot)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Envelope slot out of range.");
+        }
+
+        ENDREGION()
+
+        if(stages[slot] != (float)StageIdle)
+        {
+            stages[slot] = (float)StageRelease;
+        }
+    }
+
+    /// <summary>
+    /// Stops an envelope at silence.
+    /// </summary>
+    void EnvelopeBankClass::Stop(int slot)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Envelope slot out of range.");
+        }
+
+        ENDREGION()
+
+        levels[slot] = 0.0f;
+        stages[slot] = (float)StageIdle;
+    }
+
+    /// <summary>
+    /// Gets the level of an envelope.
+    /// </summary>
+    float EnvelopeBankClass::GetLevel(int slot)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Envelope slot out of range.");
+        }
+
+        ENDREGION()
+
+        return levels[slot];
+    }
+
+    /// <summary>
+    /// Advances every envelope by the specified number of seconds.
+    /// </summary>
+    void EnvelopeBankClass::Advance(float seconds)
+    {
+        switch(instructionSet)
+        {
+            case InstructionSet::Avx2:
+                for(int base = 0; base < capacity; base += Avx2Vector::Width)
+                {
+                    AdvanceLanes<Avx2Vector>(base, seconds);
+                }
+
+                Avx2Vector::End();
+                break;
+
+            case InstructionSet::Sse2:
+                for(int base = 0; base < capacity; base += Sse2Vector::Width)
+                {
+                    AdvanceLanes<Sse2Vector>(base, seconds);
+                }
+                break;
+
+            default:
+                for(int base = 0; base < capacity; base++)
+                {
+                    AdvanceLanes<ScalarVector>(base, seconds);
+                }
+                break;
+        }
+    }
+
+    /// <summary>
+    /// Advances one envelope by the specified number of seconds.
+    /// </summary>
+    void EnvelopeBankClass::Advance(int slot, float seconds)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Envelope slot out of range.");
+        }
+
+        ENDREGION()
+
+        AdvanceLanes<ScalarVector>(slot, seconds);
+    }
+
+    template<typename V>
+    void EnvelopeBankClass::AdvanceLanes(int base, float seconds)
+    {
+        typedef typename V::Type Vector;
+
+        Vector zero = V::Set(0.0f);
+        Vector one = V::Set(1.0f);
+        Vector time = V::Set(seconds);
+        Vector level = V::Load(levels + base);
+        Vector stage = V::Load(stages + base);
+        Vector sustain = V::Load(sustains + base);
+
+        Vector attacking = V::Equal(stage, V::Set((float)StageAttack));
+        Vector decaying = V::Equal(stage, V::Set((float)StageDecay));
+        Vector releasing = V::Equal(stage, V::Set((float)StageRelease));
+
+        // Sustaining and idle lanes do not move.
+        Vector rise = V::Mul(V::Load(attackRates + base), time);
+        Vector fall = V::Select(decaying, V::Load(decayRates + base),
+            V::And(releasing, V::Load(releaseRates + base)));
+
+        level = V::Sub(V::Add(level, V::And(attacking, rise)), V::Mul(fall, time));
+
+        // The attack ends at full and moves on to the decay.
+        Vector peaked = V::And(attacking, V::GreaterEqual(level, one));
+
+        level = V::Select(peaked, one, level);
+        stage = V::Select(peaked, V::Set((float)StageDecay), stage);
+
+        // The decay ends at the sustain level.
+        Vector settled = V::And(decaying, V::GreaterEqual(sustain, level));
+
+        level = V::Select(settled, sustain, level);
+        stage = V::Select(settled, V::Set((float)StageSustain), stage);
+
+        // The release ends at silence.
+        Vector silent = V::And(releasing, V::GreaterEqual(zero, level));
+
+        level = V::Select(silent, zero, level);
+        stage = V::Select(silent, V::Set((float)StageIdle), stage);
+
+        V::Store(levels + base, level);
+        V::Store(stages + base, stage);
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets the number of slots.
+    /// </summary>
+    int EnvelopeBankClass::get_Capacity()
+    {
+        return capacity;
+    }
+
+    /// <summary>
+    /// Gets or sets the instruction set used to advance the envelopes. It
+    /// can be lowered for testing but not raised above what the processor
+    /// supports.
+    /// </summary>
+    Midi::InstructionSet EnvelopeBankClass::get_InstructionSet()
+    {
+        return instructionSet;
+    }
+    void EnvelopeBankClass::set_InstructionSet(Midi::InstructionSet value)
+    {
+        REGION(Require)
+
+        if(value > OscillatorBankClass::DetectInstructionSet())
+        {
+            throw new ArgumentException("Instruction set not supported.", "InstructionSet");
+        }
+
+        ENDREGION()
+
+        instructionSet = value;
+    }
+
+    ENDREGION()
+
+}}}
@@ -0,0 +1,190 @@
+#ifndef ENVELOPEBANK_H
+#define ENVELOPEBANK_H
+
+#include "Types.h"
+#include "OscillatorBank.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    /// <summary>
+    /// Represents the settings of an attack, decay, sustain and release
+    /// envelope.
+    /// </summary>
+    struct Envelope
+    {
+        // The time in seconds the level takes to rise from silence to full.
+        float attack;
+
+        // The time in seconds the level takes to fall from full to the
+        // sustain level.
+        float decay;
+
+        // The level held while the note is down, from zero to one.
+        float sustain;
+
+        // The time in seconds the level takes to fall from full to silence
+        // once the note is released.
+        float release;
+    };
+
+    class EnvelopeBankClass;
+    typedef EnvelopeBankClass& EnvelopeBank;
+
+    /// <summary>
+    /// Runs many envelopes at once at control rate.
+    /// </summary>
+    /// <remarks>
+    /// An envelope does not need to be evaluated every sample. The bank
+    /// advances every envelope by a control period at a time, with SIMD
+    /// instructions across slots, and the level it reaches is the target
+    /// the oscillator or sampler of the slot ramps to linearly over the
+    /// period. Each stage moves the level in a straight line: the attack
+    /// up to full, the decay down to the sustain level, and the release
+    /// down to silence, after which the slot is idle. Stage changes are
+    /// computed with comparisons and selects, so the slots of a vector
+    /// need not be in the same stage.
+    ///
+    /// Slots are numbered like those of an OscillatorBank, and a
+    /// Synthesizer uses the slot of each voice as its index in the voice
+    /// pool.
+    /// </remarks>
+    class EnvelopeBankClass
+    {
+        REGION(EnvelopeBank Members)
+
+        REGION(Fields)
+
+    private:
+
+        // The stages as floats so they can be compared in SIMD registers.
+        enum Stage
+        {
+            StageAttack,
+            StageDecay,
+            StageSustain,
+            StageRelease,
+            StageIdle
+        };
+
+        // The envelope state, one entry per slot. The rates are changes in
+        // level per second. The arrays are aligned for the widest
+        // instruction set.
+        float* levels;
+
+        float* stages;
+
+        float* attackRates;
+
+        float* decayRates;
+
+        float* sustains;
+
+        float* releaseRates;
+
+        // The number of slots, rounded up to a whole number of groups.
+        int capacity;
+
+        Midi::InstructionSet instructionSet;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the EnvelopeBank class with the
+        /// specified number of slots.
+        /// </summary>
+        EnvelopeBankClass(int capacity);
+
+        ~EnvelopeBankClass();
+
+    private:
+
+        EnvelopeBankClass(const EnvelopeBankClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Starts the attack of an envelope.
+        /// </summary>
+        /// <param name="slot">
+        /// The slot of the envelope.
+        /// </param>
+        /// <param name="envelope">
+        /// The envelope settings.
+        /// </param>
+        /// <param name="level">
+        /// The level to attack from, which is not zero when a voice is
+        /// retriggered.
+        /// </param>
+        void Start(int slot, const Envelope& envelope, float level);
+
+        /// <summary>
+        /// Moves an envelope to its release stage.
+        /// </summary>
+        void Release(int slot);
+
+        /// <summary>
+        /// Stops an envelope at silence.
+        /// </summary>
+        void Stop(int slot);
+
+        /// <summary>
+        /// Gets the level of an envelope.
+        /// </summary>
+        float GetLevel(int slot);
+
+        /// <summary>
+        /// Advances every envelope by the specified number of seconds.
+        /// </summary>
+        void Advance(float seconds);
+
+        /// <summary>
+        /// Advances one envelope by the specified number of seconds.
+        /// </summary>
+        void Advance(int slot, float seconds);
+
+    private:
+
+        template<typename V>
+        void AdvanceLanes(int base, float seconds);
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets the number of slots.
+        /// </summary>
+        ReadOnlyProperty<int> Capacity;
+
+        /// <summary>
+        /// Gets or sets the instruction set used to advance the envelopes.
+        /// It can be lowered for testing but not raised above what the
+        /// processor supports.
+        /// </summary>
+        Property<Midi::InstructionSet> InstructionSet;
+
+        ENDREGION()
+
+        ENDREGION()
+
+    private:
+        void init();
+        int get_Capacity();
+        Midi::InstructionSet get_InstructionSet();
+        void set_InstructionSet(Midi::InstructionSet value);
+
+    };
+
+}}}
+
+#endif
@@ -0,0 +1,309 @@
+#include "EventPostings.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef EventPostingsClass cls;
+
+    static MidiEventClass* Next(MidiEventClass* e)
+    {
+        MidiEvent next = e->Next;
+
+        return next != MidiEventClass::null ? &next : nullptr;
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the EventPostings class with the
+    /// MidiEvents of the specified Track and follows further edits made to
+    /// it.
+    /// </summary>
+    EventPostingsClass::EventPostingsClass(Track track)
+    {
+        this->track = &track;
+
+        // The MidiEvents come in Track order, so each one goes at the end
+        // of its lists.
+        MidiEventClass* current = track.Count > 1 ? &track.GetMidiEvent(0) : nullptr;
+
+        for( ; current != nullptr; current = Next(current))
+        {
+            IMidiMessage message = current->MidiMessage;
+
+            if(message.MessageType == MessageType::Channel)
+            {
+                int packed = ((ChannelMessage)message).Message;
+                int channel = ChannelMessageClass::UnpackMidiChannel(packed);
+                int command = GetCommandIndex(ChannelMessageClass::UnpackCommand(packed));
+
+                channels[channel].Add(current);
+                commands[command].Add(current);
+                pairs[command * ChannelCount + channel].Add(current);
+            }
+            else if(message.MessageType == MessageType::Meta)
+            {
+                metaTypes[((MetaMessage)message).MetaType].Add(current);
+            }
+        }
+
+        track.Attach(*this);
+    }
+
+    EventPostingsClass::~EventPostingsClass()
+    {
+        track->Detach(*this);
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Gets the MidiEvents holding ChannelMessages on the specified
+    /// channel, in Track order.
+    /// </summary>
+    const ArrayList<MidiEventClass*>& EventPostingsClass::GetChannel(int channel)
+    {
+        REGION(Require)
+
+        if(channel < 0 || channel >= ChannelCount)
+        {
+            throw new ArgumentOutOfRangeException("channel", channel,
+                "MIDI channel out of range.");
+        }
+
+        ENDREGION()
+
+        return channels[channel];
+    }
+
+    /// <summary>
+    /// Gets the MidiEvents holding ChannelMessages with the specified
+    /// command, in Track order.
+    /// </summary>
+    const ArrayList<MidiEventClass*>& EventPostingsClass::GetCommand(ChannelCommand command)
+    {
+        return commands[GetCommandIndex(command)];
+    }
+
+    /// <summary>
+    /// Gets the MidiEvents holding ChannelMessages with the specified
+    /// command on the specified channel, in Track order.
+    /// </summary>
+    const ArrayList<MidiEventClass*>& EventPostingsClass::Get(ChannelCommand command, int channel)
+    {
+        REGION(Require)
+
+        if(channel < 0 || channel >= ChannelCount)
+        {
+            throw new ArgumentOutOfRangeException("channel", channel,
+                "MIDI channel out of range.");
+        }
+
+        ENDREGION()
+
+        return pairs[GetCommandIndex(command) * ChannelCount + channel];
+    }
+
+    /// <summary>
+    /// Gets the MidiEvents holding MetaMessages of the specified type, in
+    /// Track order.
+    /// </summary>
+    const ArrayList<MidiEventClass*>& EventPostingsClass::GetMeta(MetaType type)
+    {
+        REGION(Require)
+
+        if(type < 0 || type >= MetaTypeCount)
+        {
+            throw new ArgumentOutOfRangeException("type", type,
+                "Meta type out of range.");
+        }
+
+        ENDREGION()
+
+        return metaTypes[type];
+    }
+
+    void EventPostingsClass::Add(MidiEventClass* e)
+    {
+        IMidiMessage message = e->MidiMessage;
+
+        if(message.MessageType == MessageType::Channel)
+        {
+            int packed = ((ChannelMessage)message).Message;
+            int channel = ChannelMessageClass::UnpackMidiChannel(packed);
+            int command = GetCommandIndex(ChannelMessageClass::UnpackCommand(packed));
+
+            Insert(channels[channel], e);
+            Insert(commands[command], e);
+            Insert(pairs[command * ChannelCount + channel], e);
+        }
+        else if(message.MessageType == MessageType::Meta)
+        {
+            Insert(metaTypes[((MetaMessage)message).MetaType], e);
+        }
+    }
+
+    void EventPostingsClass::Remove(MidiEventClass* e, int ticks)
+    {
+        IMidiMessage message = e->MidiMessage;
+
+        if(message.MessageType == MessageType::Channel)
+        {
+            int packed = ((ChannelMessage)message).Message;
+            int channel = ChannelMessageClass::UnpackMidiChannel(packed);
+            int command = GetCommandIndex(ChannelMessageClass::UnpackCommand(packed));
+
+            Remove(channels[channel], e, ticks);
+            Remove(commands[command], e, ticks);
+            Remove(pairs[command * ChannelCount + channel], e, ticks);
+        }
+        else if(message.MessageType == MessageType::Meta)
+        {
+            Remove(metaTypes[((MetaMessage)message).MetaType], e, ticks);
+        }
+    }
+
+    void EventPostingsClass::Clear()
+    {
+        for(int i = 0; i < ChannelCount; i++)
+        {
+            channels[i].Clear();
+        }
+
+        for(int i = 0; i < CommandCount; i++)
+        {
+            commands[i].Clear();
+        }
+
+        for(int i = 0; i < CommandCount * ChannelCount; i++)
+        {
+            pairs[i].Clear();
+        }
+
+        for(int i = 0; i < MetaTypeCount; i++)
+        {
+            metaTypes[i].Clear();
+        }
+    }
+
+    void EventPostingsClass::Insert(ArrayList<MidiEventClass*>& list, MidiEventClass* e)
+    {
+        int ticks = e->AbsoluteTicks;
+        int low = FindFirst(list, ticks);
+        int high = low;
+
+        while(high < list.Count && list[high]->AbsoluteTicks == ticks)
+        {
+            high++;
+        }
+
+        // Among MidiEvents at the same position the list follows the
+        // Track, so the MidiEvent goes before the first of them that comes
+        // after it there. Appended MidiEvents have none.
+        int index = high;
+
+        for(MidiEventClass* next = Next(e);
+            index == high && next != nullptr && next->AbsoluteTicks == ticks; next = Next(next))
+        {
+            for(int i = low; i < index; i++)
+            {
+                if(list[i] == next)
+                {
+                    index = i;
+                    break;
+                }
+            }
+        }
+
+        list.Insert(index, e);
+    }
+
+    void EventPostingsClass::Remove(ArrayList<MidiEventClass*>& list, MidiEventClass* e, int ticks)
+    {
+        // A moved MidiEvent already has its new position, so it is
+        // searched for at the old one.
+        int low = 0;
+        int high = list.Count;
+
+        while(low < high)
+        {
+            int mid = (low + high) / 2;
+            int position = list[mid] == e ? ticks : list[mid]->AbsoluteTicks;
+
+            if(position < ticks)
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+
+        for(int i = low; i < list.Count; i++)
+        {
+            if(list[i] == e)
+            {
+                list.RemoveAt(i);
+                return;
+            }
+        }
+    }
+
+    int EventPostingsClass::FindFirst(const ArrayList<MidiEventClass*>& list, int ticks)
+    {
+        int low = 0;
+        int high = list.Count;
+
+        while(low < high)
+        {
+            int mid = (low + high) / 2;
+
+            if(list[mid]->AbsoluteTicks < ticks)
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+
+        return low;
+    }
+
+    int EventPostingsClass::GetCommandIndex(ChannelCommand command)
+    {
+        return ((int)command >> 4) - ((int)ChannelCommand::NoteOff >> 4);
+    }
+
+    ENDREGION()
+
+    REGION(ITrackObserver Members)
+
+    void EventPostingsClass::MidiEventInserted(Track track, MidiEvent e)
+    {
+        Add(&e);
+    }
+
+    void EventPostingsClass::MidiEventRemoved(Track track, MidiEvent e)
+    {
+        Remove(&e, e.AbsoluteTicks);
+    }
+
+    void EventPostingsClass::MidiEventMoved(Track track, MidiEvent e, int oldPosition)
+    {
+        Remove(&e, oldPosition);
+        Add(&e);
+    }
+
+    void EventPostingsClass::TrackCleared(Track track)
+    {
+        Clear();
+    }
+
+    ENDREGION()
+
+}}}
@@ -0,0 +1,161 @@
+#ifndef EVENTPOSTINGS_H
+#define EVENTPOSTINGS_H
+
+#include "Types.h"
+#include "ArrayList.h"
+#include "Track.h"
+#include "ChannelMessage.h"
+#include "MetaMessage.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    /// <summary>
+    /// Keeps lists of the MidiEvents of a Track by MIDI channel,
+    /// ChannelCommand and MetaType, so filtering the Track costs in
+    /// proportion to the MidiEvents that match.
+    /// </summary>
+    /// <remarks>
+    /// There is one list per channel, one per ChannelCommand, one per
+    /// ChannelCommand and channel pair, and one per MetaType. Each list
+    /// holds its MidiEvents in Track order, so any of the filters reads a
+    /// single list and none has to unpack a status byte.
+    ///
+    /// A Track creates its EventPostings when PostingsEnabled is set. The
+    /// EventPostings takes the MidiEvents already in the Track in one pass
+    /// and then follows every edit, finding the place of an inserted or
+    /// moved MidiEvent with a binary search by position. Enabling postings
+    /// before a Track is read builds them during the parse, where every
+    /// MidiEvent is appended.
+    /// </remarks>
+    class EventPostingsClass : public ITrackObserverIf
+    {
+        REGION(EventPostings Members)
+
+        REGION(Constants)
+
+    public:
+
+        /// <summary>
+        /// The number of MIDI channels.
+        /// </summary>
+        static const int ChannelCount = ChannelMessageClass::MidiChannelMaxValue + 1;
+
+        /// <summary>
+        /// The number of ChannelCommands.
+        /// </summary>
+        static const int CommandCount = 7;
+
+        /// <summary>
+        /// The number of MetaTypes.
+        /// </summary>
+        static const int MetaTypeCount = 128;
+
+        ENDREGION()
+
+        REGION(Fields)
+
+    private:
+
+        // The Track the lists are kept for.
+        TrackClass* track;
+
+        ArrayList<MidiEventClass*> channels[ChannelCount];
+
+        ArrayList<MidiEventClass*> commands[CommandCount];
+
+        ArrayList<MidiEventClass*> pairs[CommandCount * ChannelCount];
+
+        ArrayList<MidiEventClass*> metaTypes[MetaTypeCount];
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the EventPostings class with the
+        /// MidiEvents of the specified Track and follows further edits made
+        /// to it.
+        /// </summary>
+        EventPostingsClass(Track track);
+
+        ~EventPostingsClass();
+
+    private:
+
+        EventPostingsClass(const EventPostingsClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Gets the MidiEvents holding ChannelMessages on the specified
+        /// channel, in Track order.
+        /// </summary>
+        const ArrayList<MidiEventClass*>& GetChannel(int channel);
+
+        /// <summary>
+        /// Gets the MidiEvents holding ChannelMessages with the specified
+        /// command, in Track order.
+        /// </summary>
+        const ArrayList<MidiEventClass*>& GetCommand(ChannelCommand command);
+
+        /// <summary>
+        /// Gets the MidiEvents holding ChannelMessages with the specified
+        /// command on the specified channel, in Track order.
+        /// </summary>
+        const ArrayList<MidiEventClass*>& Get(ChannelCommand command, int channel);
+
+        /// <summary>
+        /// Gets the MidiEvents holding MetaMessages of the specified type,
+        /// in Track order.
+        /// </summary>
+        const ArrayList<MidiEventClass*>& GetMeta(MetaType type);
+
+    private:
+
+        void Add(MidiEventClass* e);
+
+        void Remove(MidiEventClass* e, int ticks);
+
+        void Clear();
+
+        // Inserts a MidiEvent at its place in Track order.
+        static void Insert(ArrayList<MidiEventClass*>& list, MidiEventClass* e);
+
+        // Removes a MidiEvent, which was at the specified position.
+        static void Remove(ArrayList<MidiEventClass*>& list, MidiEventClass* e, int ticks);
+
+        // Returns the index of the first MidiEvent at or after the
+        // specified position.
+        static int FindFirst(const ArrayList<MidiEventClass*>& list, int ticks);
+
+        static int GetCommandIndex(ChannelCommand command);
+
+        ENDREGION()
+
+        ENDREGION()
+
+        REGION(ITrackObserver Members)
+
+    public:
+
+        void MidiEventInserted(Track track, MidiEvent e);
+
+        void MidiEventRemoved(Track track, MidiEvent e);
+
+        void MidiEventMoved(Track track, MidiEvent e, int oldPosition);
+
+        void TrackCleared(Track track);
+
+        ENDREGION()
+
+    };
+
+}}}
+
+#endif
@@ -0,0 +1,179 @@
+#include "EventRange.h"
+#include "Sequence.h"
+#include "ChannelMessage.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef EventRangeClass cls;
+
+    void cls::init()
+    {
+        this->Current = Functor::New(this, &cls::get_Current);
+        this->CurrentTrack = Functor::New(this, &cls::get_CurrentTrack);
+        this->Types = Functor::New(this, &cls::get_Types, &cls::set_Types);
+        this->Channels = Functor::New(this, &cls::get_Channels, &cls::set_Channels);
+        this->end = 0;
+        this->types = AllTypes;
+        this->channels = AllChannels;
+        this->current = nullptr;
+        this->currentTrack = -1;
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the EventRange class.
+    /// </summary>
+    EventRangeClass::EventRangeClass()
+    {
+        init();
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Positions the EventRange before the first MidiEvent of the
+    /// specified Sequence in the specified range.
+    /// </summary>
+    /// <param name="sequence">
+    /// The Sequence to enumerate.
+    /// </param>
+    /// <param name="start">
+    /// The position in absolute ticks of the start of the range.
+    /// </param>
+    /// <param name="end">
+    /// The position in absolute ticks of the end of the range, which is
+    /// not part of it.
+    /// </param>
+    void EventRangeClass::Reset(Sequence sequence, int start, int end)
+    {
+        REGION(Require)
+
+        if(start < 0)
+        {
+            throw new ArgumentOutOfRangeException("start", start,
+                "Position out of range.");
+        }
+        else if(end < start)
+        {
+            throw new ArgumentException("The end of the range is before its start.", "end");
+        }
+
+        ENDREGION()
+
+        queue.Reset(sequence, start);
+
+        this->end = end;
+        this->current = nullptr;
+        this->currentTrack = -1;
+    }
+
+    /// <summary>
+    /// Advances to the next MidiEvent in the range that passes the
+    /// filters.
+    /// </summary>
+    /// <returns>
+    /// <b>true</b> if there was a MidiEvent to advance to; otherwise,
+    /// <b>false</b>.
+    /// </returns>
+    bool EventRangeClass::MoveNext()
+    {
+        while(!queue.IsEmpty && queue.NextPosition < end)
+        {
+            MidiEvent e = queue.Dequeue();
+
+            if(Accepts(e.MidiMessage))
+            {
+                current = &e;
+                currentTrack = queue.CurrentTrack;
+
+                return true;
+            }
+        }
+
+        current = nullptr;
+        currentTrack = -1;
+
+        return false;
+    }
+
+    bool EventRangeClass::Accepts(IMidiMessage message)
+    {
+        Midi::MessageType type = message.MessageType;
+
+        if((types & (1 << type)) == 0)
+        {
+            return false;
+        }
+        else if(type == MessageType::Channel && channels != AllChannels)
+        {
+            int packed = ((ChannelMessage)message).Message;
+
+            return (channels & (1 << ChannelMessageClass::UnpackMidiChannel(packed))) != 0;
+        }
+
+        return true;
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets the current MidiEvent.
+    /// </summary>
+    MidiEvent EventRangeClass::get_Current()
+    {
+        REGION(Require)
+
+        if(current == nullptr)
+        {
+            throw new InvalidOperationException("The EventRange is not on a MidiEvent.");
+        }
+
+        ENDREGION()
+
+        return *current;
+    }
+
+    /// <summary>
+    /// Gets the index of the Track the current MidiEvent belongs to.
+    /// </summary>
+    int EventRangeClass::get_CurrentTrack()
+    {
+        return currentTrack;
+    }
+
+    /// <summary>
+    /// Gets or sets the message types included in the range, as a mask
+    /// with the bit 1 &lt;&lt; MessageType set for each one.
+    /// </summary>
+    int EventRangeClass::get_Types()
+    {
+        return types;
+    }
+    void EventRangeClass::set_Types(int value)
+    {
+        types = value & AllTypes;
+    }
+
+    /// <summary>
+    /// Gets or sets the MIDI channels whose ChannelMessages are included in
+    /// the range, as a mask with the bit 1 &lt;&lt; channel set for each
+    /// one.
+    /// </summary>
+    int EventRangeClass::get_Channels()
+    {
+        return channels;
+    }
+    void EventRangeClass::set_Channels(int value)
+    {
+        channels = value & AllChannels;
+    }
+
+    ENDREGION()
+
+}}}
@@ -0,0 +1,168 @@
+#ifndef EVENTRANGE_H
+#define EVENTRANGE_H
+
+#include "Types.h"
+#include "Track.h"
+#include "MergeQueue.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    class SequenceClass;
+    typedef SequenceClass& Sequence;
+
+    class EventRangeClass;
+    typedef EventRangeClass& EventRange;
+
+    /// <summary>
+    /// Enumerates the MidiEvents of every Track of a Sequence within a
+    /// range of positions, in position order.
+    /// </summary>
+    /// <remarks>
+    /// Each Track is positioned at the start of the range with a binary
+    /// search of its tick index, and the Tracks are merged by a MergeQueue
+    /// one MidiEvent at a time as the range is enumerated, so MidiEvents
+    /// outside the range are never visited. MidiEvents at the same
+    /// position are taken in Track order.
+    ///
+    /// The range can be filtered by message type and by MIDI channel. The
+    /// channel filter applies only to ChannelMessages.
+    /// </remarks>
+    class EventRangeClass
+    {
+        REGION(EventRange Members)
+
+        REGION(Constants)
+
+    public:
+
+        /// <summary>
+        /// The message type filter that includes every message type.
+        /// </summary>
+        static const int AllTypes = (1 << (MessageType::Meta + 1)) - 1;
+
+        /// <summary>
+        /// The channel filter that includes every MIDI channel.
+        /// </summary>
+        static const int AllChannels = 0xFFFF;
+
+        ENDREGION()
+
+        REGION(Fields)
+
+    private:
+
+        MergeQueueClass queue;
+
+        // The position the range ends before.
+        int end;
+
+        // The filters as masks with one bit per MessageType and per MIDI
+        // channel.
+        int types;
+
+        int channels;
+
+        // The current MidiEvent and the index of its Track, or nullptr and
+        // -1 before the first MidiEvent and after the last one.
+        MidiEventClass* current;
+
+        int currentTrack;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the EventRange class.
+        /// </summary>
+        EventRangeClass();
+
+    private:
+
+        EventRangeClass(const EventRangeClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Positions the EventRange before the first MidiEvent of the
+        /// specified Sequence in the specified range.
+        /// </summary>
+        /// <param name="sequence">
+        /// The Sequence to enumerate.
+        /// </param>
+        /// <param name="start">
+        /// The position in absolute ticks of the start of the range.
+        /// </param>
+        /// <param name="end">
+        /// The position in absolute ticks of the end of the range, which is
+        /// not part of it.
+        /// </param>
+        void Reset(Sequence sequence, int start, int end);
+
+        /// <summary>
+        /// Advances to the next MidiEvent in the range that passes the
+        /// filters.
+        /// </summary>
+        /// <returns>
+        /// <b>true</b> if there was a MidiEvent to advance to; otherwise,
+        /// <b>false</b>.
+        /// </returns>
+        bool MoveNext();
+
+    private:
+
+        bool Accepts(IMidiMessage message);
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets the current MidiEvent.
+        /// </summary>
+        ReadOnlyProperty<MidiEvent> Current;
+
+        /// <summary>
+        /// Gets the index of the Track the current MidiEvent belongs to.
+        /// </summary>
+        ReadOnlyProperty<int> CurrentTrack;
+
+        /// <summary>
+        /// Gets or sets the message types included in the range, as a mask
+        /// with the bit 1 &lt;&lt; MessageType set for each one.
+        /// </summary>
+        Property<int> Types;
+
+        /// <summary>
+        /// Gets or sets the MIDI channels whose ChannelMessages are
+        /// included in the range, as a mask with the bit 1 &lt;&lt; channel
+        /// set for each one.
+        /// </summary>
+        Property<int> Channels;
+
+        ENDREGION()
+
+        ENDREGION()
+
+    private:
+        void init();
+        MidiEvent get_Current();
+        int get_CurrentTrack();
+        int get_Types();
+        void set_Types(int value);
+        int get_Channels();
+        void set_Channels(int value);
+
+    };
+
+}}}
+
+#endif
@@ -44,6 +44,14 @@ public:
     }
 };
 
+class OutOfMemoryException
+{
+public:
+    OutOfMemoryException(string message)
+    {
+    }
+};
+
 class ObjectDisposedException
 {
 public:
@@ -68,4 +76,12 @@ public:
 	}
 };
 
+class SoundFontException
+{
+public:
+	SoundFontException(string message)
+	{
+	}
+};
+
 #endif
\ No newline at end of file
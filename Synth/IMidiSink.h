@@ -0,0 +1,35 @@
+#ifndef IMIDISINK_H
+#define IMIDISINK_H
+
+#include "Types.h"
+#include "IMidiMessage.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    class IMidiSinkIf;
+    typedef IMidiSinkIf& IMidiSink;
+
+    /// <summary>
+    /// Represents functionality for receiving the MIDI messages played by a
+    /// Sequencer.
+    /// </summary>
+    class IMidiSinkIf
+    {
+    public:
+
+        /// <summary>
+        /// Sends a MIDI message.
+        /// </summary>
+        /// <param name="message">
+        /// The MIDI message to send.
+        /// </param>
+        /// <param name="microseconds">
+        /// The time in microseconds at which the message is due.
+        /// </param>
+        virtual void Send(IMidiMessage message, long long microseconds) = 0;
+
+    };
+
+}}}
+
+#endif
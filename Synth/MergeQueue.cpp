@@ -0,0 +1,330 @@
+#include "MergeQueue.h"
+#include "Sequence.h"
+#include "SequenceSnapshot.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef MergeQueueClass cls;
+
+    void cls::init()
+    {
+        this->IsEmpty = Functor::New(this, &cls::get_IsEmpty);
+        this->NextPosition = Functor::New(this, &cls::get_NextPosition);
+        this->CurrentTrack = Functor::New(this, &cls::get_CurrentTrack);
+        this->currentTrack = -1;
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the MergeQueue class.
+    /// </summary>
+    MergeQueueClass::MergeQueueClass()
+    {
+        init();
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Positions a cursor on every Track of the Sequence.
+    /// </summary>
+    /// <param name="sequence">
+    /// The Sequence to merge.
+    /// </param>
+    /// <param name="position">
+    /// The position in absolute ticks of the first MidiEvent to take.
+    /// </param>
+    void MergeQueueClass::Reset(Sequence sequence, int position)
+    {
+        Clear();
+
+        cursors.EnsureCapacity(sequence.Count);
+        heap.EnsureCapacity(sequence.Count);
+
+        List<Track>::iterator it = sequence.GetIterator();
+        for(it = it.begin(); it != it.end(); it++)
+        {
+            Add((Track)it, position);
+        }
+    }
+
+    /// <summary>
+    /// Positions a cursor on every Track of the SequenceSnapshot.
+    /// </summary>
+    /// <param name="snapshot">
+    /// The SequenceSnapshot to merge.
+    /// </param>
+    /// <param name="position">
+    /// The position in absolute ticks of the first MidiEvent to take.
+    /// </param>
+    void MergeQueueClass::Reset(SequenceSnapshot snapshot, int position)
+    {
+        Clear();
+
+        cursors.EnsureCapacity(snapshot.Count);
+        heap.EnsureCapacity(snapshot.Count);
+
+        for(int i = 0; i < snapshot.Count; i++)
+        {
+            Add(snapshot[i], position);
+        }
+    }
+
+    /// <summary>
+    /// Adds a cursor for the specified Track.
+    /// </summary>
+    /// <param name="track">
+    /// The Track to merge.
+    /// </param>
+    /// <param name="position">
+    /// The position in absolute ticks of the first MidiEvent to take.
+    /// </param>
+    void MergeQueueClass::Add(Track track, int position)
+    {
+        REGION(Require)
+
+        if(position < 0)
+        {
+            throw new ArgumentOutOfRangeException("position", position,
+                "Position out of range.");
+        }
+
+        ENDREGION()
+
+        cursors.Add(Seek(track, position));
+
+        Push(cursors.Count - 1);
+    }
+
+    /// <summary>
+    /// Positions the cursors at MidiEvents saved with CopyCursorsTo.
+    /// </summary>
+    /// <param name="saved">
+    /// The saved cursors.
+    /// </param>
+    /// <param name="index">
+    /// The index of the first saved cursor.
+    /// </param>
+    /// <param name="count">
+    /// The number of saved cursors.
+    /// </param>
+    void MergeQueueClass::Reset(const ArrayList<MidiEventClass*>& saved, int index, int count)
+    {
+        Clear();
+
+        for(int i = 0; i < count; i++)
+        {
+            cursors.Add(saved[index + i]);
+
+            Push(i);
+        }
+    }
+
+    /// <summary>
+    /// Appends the current cursors to the specified list so that
+    /// merging can later resume from the same MidiEvents.
+    /// </summary>
+    void MergeQueueClass::CopyCursorsTo(ArrayList<MidiEventClass*>& destination)
+    {
+        for(int i = 0; i < cursors.Count; i++)
+        {
+            destination.Add(cursors[i]);
+        }
+    }
+
+    /// <summary>
+    /// Removes all of the cursors.
+    /// </summary>
+    void MergeQueueClass::Clear()
+    {
+        cursors.Clear();
+        heap.Clear();
+        currentTrack = -1;
+    }
+
+    /// <summary>
+    /// Gets the next MidiEvent without removing it.
+    /// </summary>
+    MidiEvent MergeQueueClass::Peek()
+    {
+        REGION(Require)
+
+        if(heap.Count == 0)
+        {
+            throw new InvalidOperationException("The MergeQueue is empty.");
+        }
+
+        ENDREGION()
+
+        return *cursors[heap[0].track];
+    }
+
+    /// <summary>
+    /// Removes and returns the next MidiEvent.
+    /// </summary>
+    MidiEvent MergeQueueClass::Dequeue()
+    {
+        REGION(Require)
+
+        if(heap.Count == 0)
+        {
+            throw new InvalidOperationException("The MergeQueue is empty.");
+        }
+
+        ENDREGION()
+
+        currentTrack = heap[0].track;
+
+        MidiEventClass* result = cursors[currentTrack];
+        MidiEvent next = result->Next;
+
+        if(next != MidiEventClass::null)
+        {
+            // The Track stays in the heap with a later key, so it can only
+            // move down.
+            cursors[currentTrack] = &next;
+            heap[0].ticks = next.AbsoluteTicks;
+        }
+        else
+        {
+            cursors[currentTrack] = nullptr;
+            heap[0] = heap[heap.Count - 1];
+            heap.RemoveAt(heap.Count - 1);
+        }
+
+        if(heap.Count > 0)
+        {
+            SiftDown(0);
+        }
+
+        return *result;
+    }
+
+    MidiEventClass* MergeQueueClass::Seek(Track track, int position)
+    {
+        // The Track's index finds the MidiEvent with a binary search
+        // instead of a walk from the head.
+        int index = track.FindIndex(position);
+
+        return index < track.Count - 1 ? &track.GetMidiEvent(index) : nullptr;
+    }
+
+    void MergeQueueClass::Push(int track)
+    {
+        if(cursors[track] == nullptr)
+        {
+            return;
+        }
+
+        HeapEntry entry;
+
+        entry.ticks = cursors[track]->AbsoluteTicks;
+        entry.track = track;
+
+        heap.Add(entry);
+
+        SiftUp(heap.Count - 1);
+    }
+
+    void MergeQueueClass::SiftUp(int index)
+    {
+        HeapEntry entry = heap[index];
+
+        while(index > 0)
+        {
+            int parent = (index - 1) / 2;
+
+            if(!Less(entry, heap[parent]))
+            {
+                break;
+            }
+
+            heap[index] = heap[parent];
+            index = parent;
+        }
+
+        heap[index] = entry;
+    }
+
+    void MergeQueueClass::SiftDown(int index)
+    {
+        HeapEntry entry = heap[index];
+        int count = heap.Count;
+
+        while(true)
+        {
+            int child = index * 2 + 1;
+
+            if(child >= count)
+            {
+                break;
+            }
+
+            if(child + 1 < count && Less(heap[child + 1], heap[child]))
+            {
+                child++;
+            }
+
+            if(!Less(heap[child], entry))
+            {
+                break;
+            }
+
+            heap[index] = heap[child];
+            index = child;
+        }
+
+        heap[index] = entry;
+    }
+
+    bool MergeQueueClass::Less(const HeapEntry& a, const HeapEntry& b)
+    {
+        return a.ticks < b.ticks || (a.ticks == b.ticks && a.track < b.track);
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets a value indicating whether all of the MidiEvents have been
+    /// taken.
+    /// </summary>
+    bool MergeQueueClass::get_IsEmpty()
+    {
+        return heap.Count == 0;
+    }
+
+    /// <summary>
+    /// Gets the position in absolute ticks of the next MidiEvent.
+    /// </summary>
+    int MergeQueueClass::get_NextPosition()
+    {
+        REGION(Require)
+
+        if(heap.Count == 0)
+        {
+            throw new InvalidOperationException("The MergeQueue is empty.");
+        }
+
+        ENDREGION()
+
+        return heap[0].ticks;
+    }
+
+    /// <summary>
+    /// Gets the index of the Track the last dequeued MidiEvent
+    /// belongs to.
+    /// </summary>
+    int MergeQueueClass::get_CurrentTrack()
+    {
+        return currentTrack;
+    }
+
+    ENDREGION()
+
+}}}
@@ -0,0 +1,192 @@
+#ifndef MERGEQUEUE_H
+#define MERGEQUEUE_H
+
+#include "Types.h"
+#include "ArrayList.h"
+#include "Track.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    class SequenceClass;
+    typedef SequenceClass& Sequence;
+
+    class SequenceSnapshotClass;
+    typedef SequenceSnapshotClass& SequenceSnapshot;
+
+    class MergeQueueClass;
+    typedef MergeQueueClass& MergeQueue;
+
+    /// <summary>
+    /// Merges the MidiEvents of several Tracks into a single stream ordered
+    /// by position.
+    /// </summary>
+    /// <remarks>
+    /// The MergeQueue keeps one cursor per Track and a binary min-heap of
+    /// the cursors keyed by the position of their current MidiEvent, so
+    /// taking the next MidiEvent costs O(log n) in the number of Tracks
+    /// and the Tracks are never copied into a merged Track. MidiEvents at
+    /// the same position are taken in Track order.
+    /// </remarks>
+    class MergeQueueClass
+    {
+        REGION(MergeQueue Members)
+
+        REGION(Fields)
+
+    private:
+
+        struct HeapEntry
+        {
+            // The position of the cursor's current MidiEvent.
+            int ticks;
+
+            // The index of the cursor.
+            int track;
+        };
+
+        // The current MidiEvent of each Track, or nullptr once the Track
+        // has been played to its end.
+        ArrayList<MidiEventClass*> cursors;
+
+        // The cursors that still have MidiEvents, ordered as a min-heap.
+        ArrayList<HeapEntry> heap;
+
+        // The index of the Track the last dequeued MidiEvent belongs to.
+        int currentTrack;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the MergeQueue class.
+        /// </summary>
+        MergeQueueClass();
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Positions a cursor on every Track of the Sequence.
+        /// </summary>
+        /// <param name="sequence">
+        /// The Sequence to merge.
+        /// </param>
+        /// <param name="position">
+        /// The position in absolute ticks of the first MidiEvent to take.
+        /// </param>
+        void Reset(Sequence sequence, int position);
+
+        /// <summary>
+        /// Positions a cursor on every Track of the SequenceSnapshot.
+        /// </summary>
+        /// <param name="snapshot">
+        /// The SequenceSnapshot to merge.
+        /// </param>
+        /// <param name="position">
+        /// The position in absolute ticks of the first MidiEvent to take.
+        /// </param>
+        void Reset(SequenceSnapshot snapshot, int position);
+
+        /// <summary>
+        /// Adds a cursor for the specified Track.
+        /// </summary>
+        /// <param name="track">
+        /// The Track to merge.
+        /// </param>
+        /// <param name="position">
+        /// The position in absolute ticks of the first MidiEvent to take.
+        /// </param>
+        void Add(Track track, int position);
+
+        /// <summary>
+        /// Positions the cursors at MidiEvents saved with CopyCursorsTo.
+        /// </summary>
+        /// <param name="saved">
+        /// The saved cursors.
+        /// </param>
+        /// <param name="index">
+        /// The index of the first saved cursor.
+        /// </param>
+        /// <param name="count">
+        /// The number of saved cursors.
+        /// </param>
+        void Reset(const ArrayList<MidiEventClass*>& saved, int index, int count);
+
+        /// <summary>
+        /// Appends the current cursors to the specified list so that
+        /// merging can later resume from the same MidiEvents.
+        /// </summary>
+        void CopyCursorsTo(ArrayList<MidiEventClass*>& destination);
+
+        /// <summary>
+        /// Removes all of the cursors.
+        /// </summary>
+        void Clear();
+
+        /// <summary>
+        /// Gets the next MidiEvent without removing it.
+        /// </summary>
+        MidiEvent Peek();
+
+        /// <summary>
+        /// Removes and returns the next MidiEvent.
+        /// </summary>
+        MidiEvent Dequeue();
+
+    private:
+
+        // Returns the first MidiEvent at or after the specified position.
+        static MidiEventClass* Seek(Track track, int position);
+
+        void Push(int track);
+
+        void SiftUp(int index);
+
+        void SiftDown(int index);
+
+        static bool Less(const HeapEntry& a, const HeapEntry& b);
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets a value indicating whether all of the MidiEvents have been
+        /// taken.
+        /// </summary>
+        ReadOnlyProperty<bool> IsEmpty;
+
+        /// <summary>
+        /// Gets the position in absolute ticks of the next MidiEvent.
+        /// </summary>
+        ReadOnlyProperty<int> NextPosition;
+
+        /// <summary>
+        /// Gets the index of the Track the last dequeued MidiEvent
+        /// belongs to.
+        /// </summary>
+        ReadOnlyProperty<int> CurrentTrack;
+
+        ENDREGION()
+
+        ENDREGION()
+
+    private:
+        void init();
+        bool get_IsEmpty();
+        int get_NextPosition();
+        int get_CurrentTrack();
+
+    };
+
+}}}
+
+#endif
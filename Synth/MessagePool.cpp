@@ -0,0 +1,521 @@
+#include <windows.h>
+#include "MessagePool.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef MessagePoolClass cls;
+
+    MessagePool cls::Shared = *new MessagePoolClass();
+
+    // The kind given to SysExMessages, above every MetaType.
+    static const int SysExKind = 0x100;
+
+    static const int InitialBucketCount = 256;
+
+    // Hashes the kind and the bytes of a payload with FNV-1a. Works on
+    // anything with a byte indexer, so a payload hashes the same as a
+    // bytebuffer and as the message made from it.
+    template<typename T>
+    static int HashBytes(int kind, T& bytes, int length)
+    {
+        unsigned int hash = 2166136261u;
+
+        hash = (hash ^ (unsigned int)kind) * 16777619u;
+
+        for(int i = 0; i < length; i++)
+        {
+            hash = (hash ^ (unsigned char)bytes[i]) * 16777619u;
+        }
+
+        return (int)hash;
+    }
+
+    template<typename T>
+    static bool SameBytes(T& bytes, int length, bytebuffer data)
+    {
+        if(length != data.Length)
+        {
+            return false;
+        }
+
+        for(int i = 0; i < length; i++)
+        {
+            if(bytes[i] != data[i])
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    static MidiEventClass* Next(MidiEventClass* e)
+    {
+        MidiEvent next = e->Next;
+
+        return next != MidiEventClass::null ? &next : nullptr;
+    }
+
+    // Hashes the payload of a pooled kind of message the way Find hashes
+    // the data it was made from.
+    static int HashMessage(int kind, IMidiMessage message)
+    {
+        if(kind == SysExKind)
+        {
+            SysExMessage sysEx = (SysExMessage)message;
+
+            return HashBytes(kind, sysEx, sysEx.Length);
+        }
+
+        MetaMessage meta = (MetaMessage)message;
+
+        return HashBytes(kind, meta, meta.Length);
+    }
+
+    void cls::init()
+    {
+        this->Count = Functor::New(this, &cls::get_Count);
+        this->Size = Functor::New(this, &cls::get_Size);
+        this->Hits = Functor::New(this, &cls::get_Hits);
+        this->Misses = Functor::New(this, &cls::get_Misses);
+        this->freeEntry = -1;
+        this->count = 0;
+        this->size = 0;
+        this->hits = 0;
+        this->misses = 0;
+        this->lock = nullptr;
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the MessagePool class.
+    /// </summary>
+    MessagePoolClass::MessagePoolClass()
+    {
+        init();
+
+        InitializeSRWLock((PSRWLOCK)&lock);
+
+        buckets.EnsureCapacity(InitialBucketCount);
+
+        for(int i = 0; i < InitialBucketCount; i++)
+        {
+            buckets.Add(-1);
+        }
+    }
+
+    MessagePoolClass::~MessagePoolClass()
+    {
+        for(int i = 0; i < entries.Count; i++)
+        {
+            if(entries[i].message != nullptr)
+            {
+                Delete(entries[i].message, entries[i].kind);
+            }
+        }
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Gets the pooled MetaMessage with the specified type and data, making
+    /// it if there is none.
+    /// </summary>
+    /// <param name="type">
+    /// The type of MetaMessage.
+    /// </param>
+    /// <param name="data">
+    /// The MetaMessage data.
+    /// </param>
+    /// <returns>
+    /// The pooled MetaMessage, which must be released once it is no longer
+    /// used.
+    /// </returns>
+    MetaMessage MessagePoolClass::Intern(MetaType type, bytebuffer data)
+    {
+        REGION(Require)
+
+        if(data == bytebufferclass::null)
+        {
+            throw new ArgumentNullException("data");
+        }
+
+        ENDREGION()
+
+        return *(MetaMessageClass*)Find(type, data);
+    }
+
+    /// <summary>
+    /// Gets the pooled SysExMessage with the specified data, making it if
+    /// there is none.
+    /// </summary>
+    /// <param name="data">
+    /// The system exclusive data, including the status byte.
+    /// </param>
+    /// <returns>
+    /// The pooled SysExMessage, which must be released once it is no longer
+    /// used.
+    /// </returns>
+    SysExMessage MessagePoolClass::Intern(bytebuffer data)
+    {
+        REGION(Require)
+
+        if(data == bytebufferclass::null)
+        {
+            throw new ArgumentNullException("data");
+        }
+
+        ENDREGION()
+
+        return *(SysExMessageClass*)Find(SysExKind, data);
+    }
+
+    /// <summary>
+    /// Releases a message handed out by the pool.
+    /// </summary>
+    /// <param name="message">
+    /// The message to release.
+    /// </param>
+    /// <returns>
+    /// <b>true</b> if the message came from the pool; otherwise,
+    /// <b>false</b>.
+    /// </returns>
+    bool MessagePoolClass::Release(IMidiMessage message)
+    {
+        int kind = GetKind(message);
+
+        REGION(Guard)
+
+        if(kind < 0)
+        {
+            return false;
+        }
+
+        ENDREGION()
+
+        int hash = HashMessage(kind, message);
+        int previous;
+
+        AcquireSRWLockExclusive((PSRWLOCK)&lock);
+
+        int index = Locate(message, hash, previous);
+
+        if(index >= 0 && --entries[index].references == 0)
+        {
+            PoolEntry& entry = entries[index];
+
+            if(previous < 0)
+            {
+                buckets[hash & (buckets.Count - 1)] = entry.next;
+            }
+            else
+            {
+                entries[previous].next = entry.next;
+            }
+
+            Delete(entry.message, entry.kind);
+
+            count--;
+            size -= entry.length;
+
+            entry.message = nullptr;
+            entry.next = freeEntry;
+            freeEntry = index;
+        }
+
+        ReleaseSRWLockExclusive((PSRWLOCK)&lock);
+
+        return index >= 0;
+    }
+
+    /// <summary>
+    /// Releases every message of the specified Track that came from the
+    /// pool.
+    /// </summary>
+    /// <param name="track">
+    /// The Track, which is no longer used.
+    /// </param>
+    void MessagePoolClass::Release(Track track)
+    {
+        MidiEventClass* current = track.Count > 1 ? &track.GetMidiEvent(0) : nullptr;
+
+        for(; current != nullptr; current = Next(current))
+        {
+            Release(current->MidiMessage);
+        }
+    }
+
+    /// <summary>
+    /// Takes another reference to a message handed out by the pool.
+    /// </summary>
+    /// <param name="message">
+    /// The message to reference.
+    /// </param>
+    /// <returns>
+    /// <b>true</b> if the message came from the pool; otherwise,
+    /// <b>false</b>.
+    /// </returns>
+    bool MessagePoolClass::AddReference(IMidiMessage message)
+    {
+        int kind = GetKind(message);
+
+        REGION(Guard)
+
+        if(kind < 0)
+        {
+            return false;
+        }
+
+        ENDREGION()
+
+        int hash = HashMessage(kind, message);
+        int previous;
+
+        AcquireSRWLockExclusive((PSRWLOCK)&lock);
+
+        int index = Locate(message, hash, previous);
+
+        if(index >= 0)
+        {
+            entries[index].references++;
+        }
+
+        ReleaseSRWLockExclusive((PSRWLOCK)&lock);
+
+        return index >= 0;
+    }
+
+    IMidiMessageIf* MessagePoolClass::Find(int kind, bytebuffer data)
+    {
+        int hash = HashBytes(kind, data, data.Length);
+
+        AcquireSRWLockExclusive((PSRWLOCK)&lock);
+
+        int index = Search(kind, hash, data);
+
+        if(index >= 0)
+        {
+            IMidiMessageIf* message = entries[index].message;
+
+            entries[index].references++;
+            hits++;
+
+            ReleaseSRWLockExclusive((PSRWLOCK)&lock);
+
+            return message;
+        }
+
+        ReleaseSRWLockExclusive((PSRWLOCK)&lock);
+
+        // The message is made outside the lock, as its constructor checks
+        // the payload and may throw, so another thread may have added the
+        // same payload meanwhile.
+        IMidiMessageIf* made;
+
+        if(kind == SysExKind)
+        {
+            made = new SysExMessageClass(data);
+        }
+        else
+        {
+            made = new MetaMessageClass((MetaType)kind, data);
+        }
+
+        AcquireSRWLockExclusive((PSRWLOCK)&lock);
+
+        index = Search(kind, hash, data);
+
+        if(index >= 0)
+        {
+            IMidiMessageIf* message = entries[index].message;
+
+            entries[index].references++;
+            hits++;
+
+            ReleaseSRWLockExclusive((PSRWLOCK)&lock);
+
+            Delete(made, kind);
+
+            return message;
+        }
+
+        if(count >= buckets.Count)
+        {
+            Grow();
+        }
+
+        PoolEntry entry;
+
+        entry.message = made;
+        entry.kind = kind;
+        entry.hash = hash;
+        entry.length = data.Length;
+        entry.references = 1;
+        entry.next = buckets[hash & (buckets.Count - 1)];
+
+        if(freeEntry >= 0)
+        {
+            index = freeEntry;
+            freeEntry = entries[index].next;
+            entries[index] = entry;
+        }
+        else
+        {
+            index = entries.Count;
+            entries.Add(entry);
+        }
+
+        buckets[hash & (buckets.Count - 1)] = index;
+
+        count++;
+        size += data.Length;
+        misses++;
+
+        ReleaseSRWLockExclusive((PSRWLOCK)&lock);
+
+        return made;
+    }
+
+    int MessagePoolClass::Search(int kind, int hash, bytebuffer data)
+    {
+        for(int i = buckets[hash & (buckets.Count - 1)]; i >= 0; i = entries[i].next)
+        {
+            const PoolEntry& entry = entries[i];
+
+            if(entry.hash != hash || entry.kind != kind)
+            {
+                continue;
+            }
+            else if(kind == SysExKind)
+            {
+                SysExMessage message = *(SysExMessageClass*)entry.message;
+
+                if(SameBytes(message, message.Length, data))
+                {
+                    return i;
+                }
+            }
+            else
+            {
+                MetaMessage message = *(MetaMessageClass*)entry.message;
+
+                if(SameBytes(message, message.Length, data))
+                {
+                    return i;
+                }
+            }
+        }
+
+        return -1;
+    }
+
+    int MessagePoolClass::Locate(IMidiMessage message, int hash, int& previous)
+    {
+        previous = -1;
+
+        for(int i = buckets[hash & (buckets.Count - 1)]; i >= 0; previous = i, i = entries[i].next)
+        {
+            if(entries[i].message == &message)
+            {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    void MessagePoolClass::Grow()
+    {
+        int bucketCount = buckets.Count * 2;
+
+        buckets.Clear();
+        buckets.EnsureCapacity(bucketCount);
+
+        for(int i = 0; i < bucketCount; i++)
+        {
+            buckets.Add(-1);
+        }
+
+        for(int i = 0; i < entries.Count; i++)
+        {
+            PoolEntry& entry = entries[i];
+
+            if(entry.message != nullptr)
+            {
+                int bucket = entry.hash & (bucketCount - 1);
+
+                entry.next = buckets[bucket];
+                buckets[bucket] = i;
+            }
+        }
+    }
+
+    void MessagePoolClass::Delete(IMidiMessageIf* message, int kind)
+    {
+        if(kind == SysExKind)
+        {
+            delete (SysExMessageClass*)message;
+        }
+        else
+        {
+            delete (MetaMessageClass*)message;
+        }
+    }
+
+    int MessagePoolClass::GetKind(IMidiMessage message)
+    {
+        if(message.MessageType == MessageType::Meta)
+        {
+            return ((MetaMessage)message).MetaType;
+        }
+        else if(message.MessageType == MessageType::SystemExclusive)
+        {
+            return SysExKind;
+        }
+
+        return -1;
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets the number of messages in the pool.
+    /// </summary>
+    int MessagePoolClass::get_Count()
+    {
+        return count;
+    }
+
+    /// <summary>
+    /// Gets the number of payload bytes held by the messages in the pool.
+    /// </summary>
+    long long MessagePoolClass::get_Size()
+    {
+        return size;
+    }
+
+    /// <summary>
+    /// Gets the number of times a message was found in the pool.
+    /// </summary>
+    long long MessagePoolClass::get_Hits()
+    {
+        return hits;
+    }
+
+    /// <summary>
+    /// Gets the number of times a message had to be made.
+    /// </summary>
+    long long MessagePoolClass::get_Misses()
+    {
+        return misses;
+    }
+
+    ENDREGION()
+
+}}}
@@ -0,0 +1,243 @@
+#ifndef MESSAGEPOOL_H
+#define MESSAGEPOOL_H
+
+#include "Types.h"
+#include "ArrayList.h"
+#include "MetaMessage.h"
+#include "SysExMessage.h"
+#include "Track.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    class MessagePoolClass;
+    typedef MessagePoolClass& MessagePool;
+
+    /// <summary>
+    /// Shares one MetaMessage or SysExMessage between every use of the same
+    /// payload.
+    /// </summary>
+    /// <remarks>
+    /// MetaMessages and SysExMessages cannot be changed once made, so a
+    /// single message can stand for every occurrence of its payload, such
+    /// as the same copyright text or GM reset in many files. The pool
+    /// finds a message by a hash of its type and bytes, comparing the
+    /// bytes of the messages with the same hash, and makes one only when
+    /// there is none.
+    ///
+    /// Each message counts its references: one for every time it was
+    /// handed out and one for every AddReference. Releasing it takes one
+    /// away, and the pool deletes the message when none are left. A Track
+    /// does not know whether its messages came from a pool, so whoever
+    /// drops a Track loaded with interning releases its messages, which
+    /// Release does for a whole Track. The copies that outlive the Track
+    /// they were made from, SequenceSnapshots, TrackVersions and
+    /// TrackDiffs, take references of their own in the shared pool and
+    /// release them when they are deleted.
+    ///
+    /// The pool can be used from several threads at once. Shared is the
+    /// pool used by TrackReaders when interning is enabled.
+    /// </remarks>
+    class MessagePoolClass
+    {
+        REGION(MessagePool Members)
+
+        REGION(Class Fields)
+
+    public:
+
+        /// <summary>
+        /// The pool shared by the whole process.
+        /// </summary>
+        static MessagePool Shared;
+
+        ENDREGION()
+
+        REGION(Fields)
+
+    private:
+
+        // A pooled message with its kind, hash and length, how many times
+        // it has been handed out, and the next entry in its bucket or in
+        // the free list.
+        struct PoolEntry
+        {
+            IMidiMessageIf* message;
+            int kind;
+            int hash;
+            int length;
+            int references;
+            int next;
+        };
+
+        ArrayList<PoolEntry> entries;
+
+        // The first entry of each bucket, or -1. The number of buckets is a
+        // power of two.
+        ArrayList<int> buckets;
+
+        // The first unused entry, or -1.
+        int freeEntry;
+
+        int count;
+
+        long long size;
+
+        long long hits;
+
+        long long misses;
+
+        // Guards the fields above.
+        void* lock;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the MessagePool class.
+        /// </summary>
+        MessagePoolClass();
+
+        ~MessagePoolClass();
+
+    private:
+
+        MessagePoolClass(const MessagePoolClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Gets the pooled MetaMessage with the specified type and data,
+        /// making it if there is none.
+        /// </summary>
+        /// <param name="type">
+        /// The type of MetaMessage.
+        /// </param>
+        /// <param name="data">
+        /// The MetaMessage data.
+        /// </param>
+        /// <returns>
+        /// The pooled MetaMessage, which must be released once it is no
+        /// longer used.
+        /// </returns>
+        MetaMessage Intern(MetaType type, bytebuffer data);
+
+        /// <summary>
+        /// Gets the pooled SysExMessage with the specified data, making it
+        /// if there is none.
+        /// </summary>
+        /// <param name="data">
+        /// The system exclusive data, including the status byte.
+        /// </param>
+        /// <returns>
+        /// The pooled SysExMessage, which must be released once it is no
+        /// longer used.
+        /// </returns>
+        SysExMessage Intern(bytebuffer data);
+
+        /// <summary>
+        /// Releases a message handed out by the pool.
+        /// </summary>
+        /// <param name="message">
+        /// The message to release.
+        /// </param>
+        /// <returns>
+        /// <b>true</b> if the message came from the pool; otherwise,
+        /// <b>false</b>.
+        /// </returns>
+        bool Release(IMidiMessage message);
+
+        /// <summary>
+        /// Releases every message of the specified Track that came from
+        /// the pool.
+        /// </summary>
+        /// <param name="track">
+        /// The Track, which is no longer used.
+        /// </param>
+        void Release(Track track);
+
+        /// <summary>
+        /// Takes another reference to a message handed out by the pool.
+        /// </summary>
+        /// <param name="message">
+        /// The message to reference.
+        /// </param>
+        /// <returns>
+        /// <b>true</b> if the message came from the pool; otherwise,
+        /// <b>false</b>.
+        /// </returns>
+        bool AddReference(IMidiMessage message);
+
+    private:
+
+        // Hands out the message for a payload of the specified kind,
+        // making it if the pool does not have it.
+        IMidiMessageIf* Find(int kind, bytebuffer data);
+
+        // Returns the index of the entry for a payload, or -1.
+        int Search(int kind, int hash, bytebuffer data);
+
+        // Returns the index of the entry holding the message, and that of
+        // the entry before it in its bucket, or -1. Called with the lock
+        // held.
+        int Locate(IMidiMessage message, int hash, int& previous);
+
+        // Doubles the number of buckets and redistributes the entries.
+        void Grow();
+
+        static void Delete(IMidiMessageIf* message, int kind);
+
+        // Gets the MetaType of a MetaMessage, a value above every MetaType
+        // for a SysExMessage and -1 for other messages, which are never
+        // pooled.
+        static int GetKind(IMidiMessage message);
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets the number of messages in the pool.
+        /// </summary>
+        ReadOnlyProperty<int> Count;
+
+        /// <summary>
+        /// Gets the number of payload bytes held by the messages in the
+        /// pool.
+        /// </summary>
+        ReadOnlyProperty<long long> Size;
+
+        /// <summary>
+        /// Gets the number of times a message was found in the pool.
+        /// </summary>
+        ReadOnlyProperty<long long> Hits;
+
+        /// <summary>
+        /// Gets the number of times a message had to be made.
+        /// </summary>
+        ReadOnlyProperty<long long> Misses;
+
+        ENDREGION()
+
+        ENDREGION()
+
+    private:
+        void init();
+        int get_Count();
+        long long get_Size();
+        long long get_Hits();
+        long long get_Misses();
+
+    };
+
+}}}
+
+#endif
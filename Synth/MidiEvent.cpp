@@ -120,6 +120,20 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         this->absoluteTicks = absoluteTicks;
     }
 
+    void MidiEventClass::SetMidiMessage(IMidiMessage message)
+    {
+        REGION(Require)
+
+        if(message == NullMessageClass::null)
+        {
+            throw new ArgumentNullException("message");
+        }
+
+        ENDREGION()
+
+        this->message = message;
+    }
+
     object MidiEventClass::get_Owner()
     {
         return owner;
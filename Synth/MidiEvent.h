@@ -64,6 +64,8 @@ namespace Sanford { namespace Multimedia { namespace Midi {
 
         void SetAbsoluteTicks(int absoluteTicks);
 
+        void SetMidiMessage(IMidiMessage message);
+
         ReadOnlyProperty<object> Owner;
 
         ReadOnlyProperty<int> AbsoluteTicks;
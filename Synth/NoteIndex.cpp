@@ -0,0 +1,602 @@
+#include "NoteIndex.h"
+#include "Sequence.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef NoteIndexClass cls;
+
+    // Orders spans by start, keeping spans that start together in the
+    // order they were built in.
+    struct StartOrder
+    {
+        bool operator()(const NoteSpan& a, const NoteSpan& b) const
+        {
+            return a.start < b.start;
+        }
+    };
+
+    // Orders indices into a list of spans by end, latest first.
+    struct EndOrder
+    {
+        const ArrayList<NoteSpan>* spans;
+
+        bool operator()(int a, int b) const
+        {
+            return (*spans)[a].end > (*spans)[b].end;
+        }
+    };
+
+    // A stable bottom-up merge sort. Tracks can hold hundreds of
+    // thousands of notes, which rules out the insertion sorts used
+    // elsewhere.
+    template<typename T, typename Order>
+    static void MergeSort(T* items, T* scratch, int count, Order before)
+    {
+        T* source = items;
+        T* destination = scratch;
+
+        for(int width = 1; width < count; width *= 2)
+        {
+            for(int low = 0; low < count; low += 2 * width)
+            {
+                int middle = low + width < count ? low + width : count;
+                int high = low + 2 * width < count ? low + 2 * width : count;
+                int a = low;
+                int b = middle;
+
+                for(int i = low; i < high; i++)
+                {
+                    if(a < middle && (b >= high || !before(source[b], source[a])))
+                    {
+                        destination[i] = source[a++];
+                    }
+                    else
+                    {
+                        destination[i] = source[b++];
+                    }
+                }
+            }
+
+            T* swap = source;
+
+            source = destination;
+            destination = swap;
+        }
+
+        if(source != items)
+        {
+            for(int i = 0; i < count; i++)
+            {
+                items[i] = source[i];
+            }
+        }
+    }
+
+    static MidiEventClass* Next(MidiEventClass* e)
+    {
+        MidiEvent next = e->Next;
+
+        return next != MidiEventClass::null ? &next : nullptr;
+    }
+
+    void cls::init()
+    {
+        this->Count = Functor::New(this, &cls::get_Count);
+        this->IsValid = Functor::New(this, &cls::get_IsValid);
+        this->sequence = nullptr;
+        this->root = -1;
+        this->openEnded = false;
+        this->valid = false;
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the NoteIndex class.
+    /// </summary>
+    NoteIndexClass::NoteIndexClass()
+    {
+        init();
+    }
+
+    NoteIndexClass::~NoteIndexClass()
+    {
+        Detach();
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Builds the spans of the notes in every Track of the specified
+    /// Sequence.
+    /// </summary>
+    void NoteIndexClass::Build(Sequence sequence)
+    {
+        Detach();
+
+        this->sequence = &sequence;
+
+        List<Track>::iterator it = sequence.GetIterator();
+        for(it = it.begin(); it != it.end(); it++)
+        {
+            Track track = (Track)it;
+
+            tracks.Add(&track);
+            track.Attach(*this);
+        }
+
+        Rebuild();
+    }
+
+    /// <summary>
+    /// Builds the spans of the notes in the specified Track.
+    /// </summary>
+    void NoteIndexClass::Build(Track track)
+    {
+        Detach();
+
+        tracks.Add(&track);
+        track.Attach(*this);
+
+        Rebuild();
+    }
+
+    /// <summary>
+    /// Finds the notes sounding at the specified position.
+    /// </summary>
+    /// <param name="position">
+    /// The position in absolute ticks.
+    /// </param>
+    /// <param name="result">
+    /// The list the spans are added to, in no particular order.
+    /// </param>
+    void NoteIndexClass::FindSounding(int position, ArrayList<NoteSpan>& result)
+    {
+        Validate();
+
+        int node = root;
+
+        while(node >= 0)
+        {
+            const Node& current = nodes[node];
+
+            // Every span of the node contains the centre, so before it the
+            // spans that have started sound, and after it those that have
+            // not ended.
+            if(position < current.centre)
+            {
+                for(int i = current.first; i < current.first + current.count; i++)
+                {
+                    const NoteSpan& span = spans[byStart[i]];
+
+                    if(span.start > position)
+                    {
+                        break;
+                    }
+
+                    result.Add(span);
+                }
+
+                node = current.left;
+            }
+            else
+            {
+                for(int i = current.first; i < current.first + current.count; i++)
+                {
+                    const NoteSpan& span = spans[byEnd[i]];
+
+                    if(span.end <= position)
+                    {
+                        break;
+                    }
+
+                    result.Add(span);
+                }
+
+                node = position > current.centre ? current.right : -1;
+            }
+        }
+    }
+
+    /// <summary>
+    /// Finds the notes that sound at any point of the specified range,
+    /// and the zero-length notes that start in it.
+    /// </summary>
+    /// <param name="start">
+    /// The position in absolute ticks of the start of the range.
+    /// </param>
+    /// <param name="end">
+    /// The position in absolute ticks of the end of the range, which is
+    /// not part of it.
+    /// </param>
+    /// <param name="result">
+    /// The list the spans are added to, in no particular order.
+    /// </param>
+    void NoteIndexClass::FindOverlapping(int start, int end, ArrayList<NoteSpan>& result)
+    {
+        REGION(Require)
+
+        if(end < start)
+        {
+            throw new ArgumentException("The end of the range is before its start.", "end");
+        }
+
+        ENDREGION()
+
+        if(start == end)
+        {
+            return;
+        }
+
+        FindSounding(start, result);
+
+        // The rest of the range holds the spans starting after its start,
+        // and the zero-length spans starting at it, which never sound.
+        int low = 0;
+        int high = spans.Count;
+
+        while(low < high)
+        {
+            int mid = (low + high) / 2;
+
+            if(spans[mid].start < start)
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+
+        for(int i = low; i < spans.Count && spans[i].start < end; i++)
+        {
+            if(spans[i].start > start || spans[i].end == start)
+            {
+                result.Add(spans[i]);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Gets the span at the specified index. The spans are sorted by
+    /// start.
+    /// </summary>
+    const NoteSpan& NoteIndexClass::operator [](int index)
+    {
+        Validate();
+
+        REGION(Require)
+
+        if(index < 0 || index >= spans.Count)
+        {
+            throw new ArgumentOutOfRangeException("index", index,
+                "Note span index out of range.");
+        }
+
+        ENDREGION()
+
+        return spans[index];
+    }
+
+    void NoteIndexClass::Rebuild()
+    {
+        spans.Clear();
+        nodes.Clear();
+        byStart.Clear();
+        byEnd.Clear();
+        root = -1;
+        openEnded = false;
+
+        for(int i = 0; i < tracks.Count; i++)
+        {
+            AddSpans(*tracks[i], i);
+        }
+
+        if(spans.Count > 0)
+        {
+            NoteSpan* scratch = new NoteSpan[spans.Count];
+
+            MergeSort(&spans[0], scratch, spans.Count, StartOrder());
+
+            delete[] scratch;
+        }
+
+        // Notes on and off at the same position never sound, so only the
+        // range queries find them.
+        int* items = new int[spans.Count + 1];
+        int* scratch = new int[spans.Count + 1];
+        int count = 0;
+
+        for(int i = 0; i < spans.Count; i++)
+        {
+            if(spans[i].end > spans[i].start)
+            {
+                items[count++] = i;
+            }
+        }
+
+        root = BuildNode(items, scratch, count);
+
+        delete[] items;
+        delete[] scratch;
+
+        valid = true;
+    }
+
+    void NoteIndexClass::AddSpans(Track track, int index)
+    {
+        // The spans still waiting for a NoteOff, queued per channel and
+        // pitch through next.
+        int first[KeyCount];
+        int last[KeyCount];
+        ArrayList<int> next;
+        int base = spans.Count;
+
+        for(int i = 0; i < KeyCount; i++)
+        {
+            first[i] = -1;
+        }
+
+        MidiEventClass* current = track.Count > 1 ? &track.GetMidiEvent(0) : nullptr;
+
+        for( ; current != nullptr; current = Next(current))
+        {
+            MidiEvent e = *current;
+            IMidiMessage message = e.MidiMessage;
+
+            if(message.MessageType != MessageType::Channel)
+            {
+                continue;
+            }
+
+            int packed = ((ChannelMessage)message).Message;
+            ChannelCommand command = ChannelMessageClass::UnpackCommand(packed);
+            int channel = ChannelMessageClass::UnpackMidiChannel(packed);
+            int pitch = ChannelMessageClass::UnpackData1(packed);
+            int velocity = ChannelMessageClass::UnpackData2(packed);
+            int key = channel * (ChannelMessageClass::DataMaxValue + 1) + pitch;
+
+            if(command == ChannelCommand::NoteOn && velocity > 0)
+            {
+                NoteSpan span;
+
+                span.start = e.AbsoluteTicks;
+                span.end = -1;
+                span.track = index;
+                span.channel = channel;
+                span.pitch = pitch;
+                span.velocity = velocity;
+
+                if(first[key] < 0)
+                {
+                    first[key] = spans.Count;
+                }
+                else
+                {
+                    next[last[key] - base] = spans.Count;
+                }
+
+                last[key] = spans.Count;
+                next.Add(-1);
+                spans.Add(span);
+            }
+            else if(command == ChannelCommand::NoteOff || command == ChannelCommand::NoteOn)
+            {
+                // A NoteOff without a NoteOn is ignored.
+                if(first[key] >= 0)
+                {
+                    spans[first[key]].end = e.AbsoluteTicks;
+                    first[key] = next[first[key] - base];
+                }
+            }
+        }
+
+        for(int i = base; i < spans.Count; i++)
+        {
+            if(spans[i].end < 0)
+            {
+                spans[i].end = track.Length;
+                openEnded = true;
+            }
+        }
+    }
+
+    int NoteIndexClass::BuildNode(int* items, int* scratch, int count)
+    {
+        if(count == 0)
+        {
+            return -1;
+        }
+
+        // The median start puts at most half of the spans on either side.
+        // The span it comes from has a length, so the node is never empty.
+        int centre = spans[items[count / 2]].start;
+        int leftCount = 0;
+        int middleCount = 0;
+        int n = 0;
+
+        for(int i = 0; i < count; i++)
+        {
+            if(spans[items[i]].end <= centre)
+            {
+                scratch[n++] = items[i];
+            }
+        }
+
+        leftCount = n;
+
+        for(int i = 0; i < count; i++)
+        {
+            if(spans[items[i]].start <= centre && spans[items[i]].end > centre)
+            {
+                scratch[n++] = items[i];
+            }
+        }
+
+        middleCount = n - leftCount;
+
+        for(int i = 0; i < count; i++)
+        {
+            if(spans[items[i]].start > centre)
+            {
+                scratch[n++] = items[i];
+            }
+        }
+
+        for(int i = 0; i < count; i++)
+        {
+            items[i] = scratch[i];
+        }
+
+        Node node;
+
+        node.centre = centre;
+        node.left = -1;
+        node.right = -1;
+        node.first = byStart.Count;
+        node.count = middleCount;
+
+        // The items are indices into spans, which are sorted by start, so
+        // they are already in start order.
+        for(int i = leftCount; i < leftCount + middleCount; i++)
+        {
+            byStart.Add(items[i]);
+            byEnd.Add(items[i]);
+        }
+
+        EndOrder order;
+
+        order.spans = &spans;
+
+        MergeSort(&byEnd[node.first], scratch, middleCount, order);
+
+        int index = nodes.Count;
+
+        nodes.Add(node);
+
+        int left = BuildNode(items, scratch, leftCount);
+        int right = BuildNode(items + leftCount + middleCount, scratch,
+            count - leftCount - middleCount);
+
+        nodes[index].left = left;
+        nodes[index].right = right;
+
+        return index;
+    }
+
+    void NoteIndexClass::Validate()
+    {
+        REGION(Require)
+
+        if(tracks.Count == 0 && sequence == nullptr)
+        {
+            throw new InvalidOperationException("The NoteIndex has not been built.");
+        }
+
+        ENDREGION()
+
+        if(sequence != nullptr && tracks.Count != sequence->Count)
+        {
+            Build(*sequence);
+        }
+        else if(!valid)
+        {
+            Rebuild();
+        }
+    }
+
+    void NoteIndexClass::Detach()
+    {
+        for(int i = 0; i < tracks.Count; i++)
+        {
+            tracks[i]->Detach(*this);
+        }
+
+        tracks.Clear();
+        sequence = nullptr;
+        valid = false;
+    }
+
+    bool NoteIndexClass::Affects(MidiEvent e)
+    {
+        IMidiMessage message = e.MidiMessage;
+
+        if(openEnded)
+        {
+            return true;
+        }
+        else if(message.MessageType != MessageType::Channel)
+        {
+            return false;
+        }
+
+        ChannelCommand command = ((ChannelMessage)message).Command;
+
+        return command == ChannelCommand::NoteOn || command == ChannelCommand::NoteOff;
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets the number of spans.
+    /// </summary>
+    int NoteIndexClass::get_Count()
+    {
+        Validate();
+
+        return spans.Count;
+    }
+
+    /// <summary>
+    /// Gets a value indicating whether the spans match the Tracks.
+    /// </summary>
+    bool NoteIndexClass::get_IsValid()
+    {
+        return valid;
+    }
+
+    ENDREGION()
+
+    REGION(ITrackObserver Members)
+
+    // Only edits to notes change the spans, unless a note ends with its
+    // Track, which any edit can lengthen or shorten.
+
+    void NoteIndexClass::MidiEventInserted(Track track, MidiEvent e)
+    {
+        if(Affects(e))
+        {
+            valid = false;
+        }
+    }
+
+    void NoteIndexClass::MidiEventRemoved(Track track, MidiEvent e)
+    {
+        if(Affects(e))
+        {
+            valid = false;
+        }
+    }
+
+    void NoteIndexClass::MidiEventMoved(Track track, MidiEvent e, int oldPosition)
+    {
+        if(Affects(e))
+        {
+            valid = false;
+        }
+    }
+
+    void NoteIndexClass::TrackCleared(Track track)
+    {
+        valid = false;
+    }
+
+    ENDREGION()
+
+}}}
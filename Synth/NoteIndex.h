@@ -0,0 +1,258 @@
+#ifndef NOTEINDEX_H
+#define NOTEINDEX_H
+
+#include "Types.h"
+#include "ArrayList.h"
+#include "Track.h"
+#include "ChannelMessage.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    class SequenceClass;
+    typedef SequenceClass& Sequence;
+
+    /// <summary>
+    /// Represents a note as the span of ticks between its NoteOn and
+    /// NoteOff messages.
+    /// </summary>
+    struct NoteSpan
+    {
+        // The position in absolute ticks of the NoteOn message.
+        int start;
+
+        // The position in absolute ticks of the NoteOff message, or the
+        // length of the Track for a note that is never turned off. The
+        // note sounds up to but not including this position.
+        int end;
+
+        // The index of the Track the note was taken from.
+        int track;
+
+        int channel;
+
+        int pitch;
+
+        // The velocity of the NoteOn message.
+        int velocity;
+    };
+
+    class NoteIndexClass;
+    typedef NoteIndexClass& NoteIndex;
+
+    /// <summary>
+    /// Pairs the NoteOn and NoteOff messages of a Sequence or Track into
+    /// NoteSpans and finds the notes sounding at a position or overlapping
+    /// a range of positions.
+    /// </summary>
+    /// <remarks>
+    /// The spans are built in one pass over each Track. A NoteOn with a
+    /// velocity of zero turns a note off, and when several notes of the
+    /// same channel and pitch overlap, each NoteOff ends the earliest one
+    /// still sounding.
+    ///
+    /// The spans are kept in a centred interval tree. Each node holds the
+    /// spans that contain its centre, sorted both by start and by end, and
+    /// the spans wholly before or after the centre go to its children, so
+    /// finding the k notes sounding at a position costs O(log n + k). The
+    /// spans are also sorted by start, which finds the notes starting in a
+    /// range with a binary search; a range query is the notes sounding at
+    /// its start plus those starting after it, and the zero-length notes
+    /// starting at it, and costs the same.
+    ///
+    /// The NoteIndex observes the Tracks it was built from. Edits that
+    /// could change a span mark the index invalid, and it is rebuilt on
+    /// the next query.
+    /// </remarks>
+    class NoteIndexClass : public ITrackObserverIf
+    {
+        REGION(NoteIndex Members)
+
+        REGION(Constants)
+
+    private:
+
+        // The number of channel and pitch pairs notes are matched by.
+        static const int KeyCount = (ChannelMessageClass::MidiChannelMaxValue + 1) *
+            (ChannelMessageClass::DataMaxValue + 1);
+
+        ENDREGION()
+
+        REGION(Fields)
+
+    private:
+
+        struct Node
+        {
+            // The position the node's spans contain.
+            int centre;
+
+            // The nodes of the spans ending at or before the centre and of
+            // those starting after it, or -1 if there are none.
+            int left;
+
+            int right;
+
+            // The index in byStart and byEnd of the node's spans, and their
+            // number.
+            int first;
+
+            int count;
+        };
+
+        // The Sequence the spans were taken from, or nullptr if they were
+        // taken from a single Track.
+        SequenceClass* sequence;
+
+        // The Tracks the spans were taken from.
+        ArrayList<TrackClass*> tracks;
+
+        // The spans sorted by start.
+        ArrayList<NoteSpan> spans;
+
+        // The interval tree and its root, or -1 if it is empty.
+        ArrayList<Node> nodes;
+
+        int root;
+
+        // The indices into spans of the spans held by each node, sorted by
+        // start and by end, latest first.
+        ArrayList<int> byStart;
+
+        ArrayList<int> byEnd;
+
+        // Indicates whether any note is never turned off, in which case it
+        // ends with the Track and any edit can move its end.
+        bool openEnded;
+
+        // Indicates whether the spans match the Tracks.
+        bool valid;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the NoteIndex class.
+        /// </summary>
+        NoteIndexClass();
+
+        ~NoteIndexClass();
+
+    private:
+
+        NoteIndexClass(const NoteIndexClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Builds the spans of the notes in every Track of the specified
+        /// Sequence.
+        /// </summary>
+        void Build(Sequence sequence);
+
+        /// <summary>
+        /// Builds the spans of the notes in the specified Track.
+        /// </summary>
+        void Build(Track track);
+
+        /// <summary>
+        /// Finds the notes sounding at the specified position.
+        /// </summary>
+        /// <param name="position">
+        /// The position in absolute ticks.
+        /// </param>
+        /// <param name="result">
+        /// The list the spans are added to, in no particular order.
+        /// </param>
+        void FindSounding(int position, ArrayList<NoteSpan>& result);
+
+        /// <summary>
+        /// Finds the notes that sound at any point of the specified range,
+        /// and the zero-length notes that start in it.
+        /// </summary>
+        /// <param name="start">
+        /// The position in absolute ticks of the start of the range.
+        /// </param>
+        /// <param name="end">
+        /// The position in absolute ticks of the end of the range, which is
+        /// not part of it.
+        /// </param>
+        /// <param name="result">
+        /// The list the spans are added to, in no particular order.
+        /// </param>
+        void FindOverlapping(int start, int end, ArrayList<NoteSpan>& result);
+
+        /// <summary>
+        /// Gets the span at the specified index. The spans are sorted by
+        /// start.
+        /// </summary>
+        const NoteSpan& operator[](int index);
+
+    private:
+
+        void Rebuild();
+
+        void AddSpans(Track track, int index);
+
+        // Builds the node for the specified spans, which are sorted by
+        // start, and returns its index.
+        int BuildNode(int* items, int* scratch, int count);
+
+        void Validate();
+
+        void Detach();
+
+        // Determines whether an edit made to the specified MidiEvent can
+        // change the spans.
+        bool Affects(MidiEvent e);
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets the number of spans.
+        /// </summary>
+        ReadOnlyProperty<int> Count;
+
+        /// <summary>
+        /// Gets a value indicating whether the spans match the Tracks.
+        /// </summary>
+        ReadOnlyProperty<bool> IsValid;
+
+        ENDREGION()
+
+        ENDREGION()
+
+        REGION(ITrackObserver Members)
+
+    public:
+
+        void MidiEventInserted(Track track, MidiEvent e);
+
+        void MidiEventRemoved(Track track, MidiEvent e);
+
+        void MidiEventMoved(Track track, MidiEvent e, int oldPosition);
+
+        void TrackCleared(Track track);
+
+        ENDREGION()
+
+    private:
+        void init();
+        int get_Count();
+        bool get_IsValid();
+
+    };
+
+}}}
+
+#endif
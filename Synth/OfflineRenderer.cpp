@@ -0,0 +1,429 @@
+#include <windows.h>
+#include "OfflineRenderer.h"
+#include "MergeQueue.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef OfflineRendererClass cls;
+
+    // Determines whether the specified ChannelMessage starts a note. A
+    // NoteOn with zero velocity is a NoteOff.
+    static bool IsNoteOn(int message)
+    {
+        return ChannelMessageClass::UnpackCommand(message) == ChannelCommand::NoteOn &&
+            ShortMessageClass::UnpackData2(message) > 0;
+    }
+
+    void cls::init()
+    {
+        this->BlockSize = Functor::New(this, &cls::get_BlockSize, &cls::set_BlockSize);
+        this->Tail = Functor::New(this, &cls::get_Tail, &cls::set_Tail);
+        this->Workers = Functor::New(this, &cls::get_Workers, &cls::set_Workers);
+        this->Frames = Functor::New(this, &cls::get_Frames);
+        this->RenderTime = Functor::New(this, &cls::get_RenderTime);
+        this->RealtimeFactor = Functor::New(this, &cls::get_RealtimeFactor);
+        this->synthesizer = nullptr;
+        this->blockSize = DefaultBlockSize;
+        this->tail = 2.0f;
+        this->frames = 0;
+        this->renderTime = 0.0;
+        this->workers = 0;
+        this->segmentPosition = 0;
+        this->segmentLength = 0;
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the OfflineRenderer class with the
+    /// specified Synthesizer.
+    /// </summary>
+    OfflineRendererClass::OfflineRendererClass(Synthesizer synthesizer)
+    {
+        init();
+
+        this->synthesizer = &synthesizer;
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Renders the specified Sequence to a WAV file.
+    /// </summary>
+    void OfflineRendererClass::Render(Sequence sequence, string fileName)
+    {
+        REGION(Require)
+
+        if(fileName == nullptr)
+        {
+            throw new ArgumentNullException("fileName");
+        }
+
+        ENDREGION()
+
+        FileStream stream = FileStreamClass(fileName, FileMode::ModeCreate,
+            FileAccess::AccessWrite, FileShare::ShareNone);
+
+        {
+            _using u = _using(stream);
+
+            Render(sequence, stream);
+        }
+    }
+
+    /// <summary>
+    /// Renders the specified Sequence to a Stream in WAV format.
+    /// </summary>
+    void OfflineRendererClass::Render(Sequence sequence, Stream stream)
+    {
+        int sampleRate = synthesizer->SampleRate;
+        TempoMap tempoMap = sequence.TempoMap;
+        long long total = TicksToFrame(tempoMap, sequence.GetLength()) +
+            (long long)(tail * sampleRate);
+
+        WaveWriterClass writer(stream, sampleRate, WaveWriterClass::DefaultBufferSize);
+        double start = GetSeconds();
+
+        writer.WriteHeader(total);
+
+        Split(sequence);
+        RenderParts(writer, total);
+        DeleteParts();
+
+        writer.Flush();
+
+        renderTime = GetSeconds() - start;
+        frames = total;
+    }
+
+    void OfflineRendererClass::Split(Sequence sequence)
+    {
+        TempoMap tempoMap = sequence.TempoMap;
+        MergeQueueClass queue;
+        int trackCount = sequence.Count;
+        ArrayList<int> partIndex;
+        ArrayList<int> channelParts[ChannelCount];
+        int lastTicks = -1;
+        long long frame = 0;
+
+        // The part of every Track and channel, found by a first pass over
+        // the NoteOns and numbered in Track and channel order.
+        for(int i = 0; i < trackCount * ChannelCount; i++)
+        {
+            partIndex.Add(-1);
+        }
+
+        queue.Reset(sequence, 0);
+
+        while(!queue.IsEmpty)
+        {
+            IMidiMessage message = queue.Dequeue().MidiMessage;
+
+            if(message.MessageType == MessageType::Channel && IsNoteOn(((ChannelMessage)message).Message))
+            {
+                int channel = ChannelMessageClass::UnpackMidiChannel(((ChannelMessage)message).Message);
+
+                partIndex[queue.CurrentTrack * ChannelCount + channel] = 0;
+            }
+        }
+
+        for(int i = 0; i < trackCount * ChannelCount; i++)
+        {
+            if(partIndex[i] < 0)
+            {
+                continue;
+            }
+
+            Part* part = new Part();
+
+            part->synthesizer = nullptr;
+            part->cursor = 0;
+            part->left = new float[SegmentSize];
+            part->right = new float[SegmentSize];
+            part->reverb = new float[SegmentSize];
+            part->chorus = new float[SegmentSize];
+
+            partIndex[i] = parts.Count;
+            channelParts[i % ChannelCount].Add(parts.Count);
+            parts.Add(part);
+        }
+
+        // The voices are shared out so the parts together take about as
+        // much memory as the Synthesizer. Streamed samples are waited for
+        // and the interpolation is kept fixed, so the file depends on
+        // neither the speed of the disk nor that of the processor.
+        int voices = parts.Count > 0 ? synthesizer->VoiceCount / parts.Count : 0;
+
+        if(voices < MinimumPartVoices)
+        {
+            voices = MinimumPartVoices;
+        }
+
+        for(int i = 0; i < parts.Count; i++)
+        {
+            SynthesizerClass* copy = new SynthesizerClass(synthesizer->SampleRate, voices);
+
+            copy->CopySettings(*synthesizer);
+            copy->WaitForData = true;
+            copy->AdaptiveQuality = false;
+            parts[i]->synthesizer = copy;
+        }
+
+        // A NoteOn goes to the part of its Track; every other message goes
+        // to all the parts of its channel.
+        queue.Reset(sequence, 0);
+
+        while(!queue.IsEmpty)
+        {
+            int ticks = queue.NextPosition;
+            IMidiMessage message = queue.Dequeue().MidiMessage;
+
+            if(message.MessageType != MessageType::Channel)
+            {
+                continue;
+            }
+
+            if(ticks != lastTicks)
+            {
+                frame = TicksToFrame(tempoMap, ticks);
+                lastTicks = ticks;
+            }
+
+            TimestampedMessage e;
+
+            e.timestamp = frame;
+            e.message = ((ChannelMessage)message).Message;
+
+            int channel = ChannelMessageClass::UnpackMidiChannel(e.message);
+
+            if(IsNoteOn(e.message))
+            {
+                parts[partIndex[queue.CurrentTrack * ChannelCount + channel]]->events.Add(e);
+            }
+            else
+            {
+                for(int i = 0; i < channelParts[channel].Count; i++)
+                {
+                    parts[channelParts[channel][i]]->events.Add(e);
+                }
+            }
+        }
+    }
+
+    void OfflineRendererClass::RenderParts(WaveWriter writer, long long total)
+    {
+        WorkerPoolClass pool(workers > 0 ? workers : 1);
+        float* left = new float[SegmentSize];
+        float* right = new float[SegmentSize];
+        float* reverb = new float[SegmentSize];
+        float* chorus = new float[SegmentSize];
+
+        // Only the Synthesizer's effects are used, and they start silent.
+        synthesizer->Reset();
+
+        for(segmentPosition = 0; segmentPosition < total; segmentPosition += segmentLength)
+        {
+            segmentLength = total - segmentPosition < SegmentSize ?
+                (int)(total - segmentPosition) : SegmentSize;
+
+            pool.For(*this, parts.Count);
+
+            // Sum in part order so the result does not depend on which
+            // thread finished first.
+            for(int i = 0; i < segmentLength; i++)
+            {
+                left[i] = 0.0f;
+                right[i] = 0.0f;
+                reverb[i] = 0.0f;
+                chorus[i] = 0.0f;
+            }
+
+            for(int p = 0; p < parts.Count; p++)
+            {
+                const Part& part = *parts[p];
+
+                for(int i = 0; i < segmentLength; i++)
+                {
+                    left[i] += part.left[i];
+                    right[i] += part.right[i];
+                    reverb[i] += part.reverb[i];
+                    chorus[i] += part.chorus[i];
+                }
+            }
+
+            synthesizer->ProcessEffects(reverb, chorus, left, right, segmentLength);
+
+            writer.Write(left, right, segmentLength);
+        }
+
+        delete[] left;
+        delete[] right;
+        delete[] reverb;
+        delete[] chorus;
+    }
+
+    void OfflineRendererClass::DeleteParts()
+    {
+        for(int i = 0; i < parts.Count; i++)
+        {
+            Part* part = parts[i];
+
+            delete part->synthesizer;
+            delete[] part->left;
+            delete[] part->right;
+            delete[] part->reverb;
+            delete[] part->chorus;
+            delete part;
+        }
+
+        parts.Clear();
+    }
+
+    long long OfflineRendererClass::TicksToFrame(TempoMap tempoMap, int ticks)
+    {
+        return tempoMap.TicksToMicroseconds(ticks) * synthesizer->SampleRate / 1000000;
+    }
+
+    double OfflineRendererClass::GetSeconds()
+    {
+        LARGE_INTEGER counter;
+        LARGE_INTEGER frequency;
+
+        QueryPerformanceCounter(&counter);
+        QueryPerformanceFrequency(&frequency);
+
+        return (double)counter.QuadPart / frequency.QuadPart;
+    }
+
+    ENDREGION()
+
+    REGION(IParallelTask Members)
+
+    /// <summary>
+    /// Renders the current segment of the specified part.
+    /// </summary>
+    void OfflineRendererClass::Execute(int index)
+    {
+        Part& part = *parts[index];
+        const ArrayList<TimestampedMessage>& events = part.events;
+
+        for(int offset = 0; offset < segmentLength; offset += blockSize)
+        {
+            int length = segmentLength - offset < blockSize ? segmentLength - offset : blockSize;
+            int cursor = part.cursor;
+
+            part.cursor += part.synthesizer->Render(part.left + offset, part.right + offset,
+                part.reverb + offset, part.chorus + offset, length,
+                cursor < events.Count ? &events[cursor] : nullptr, events.Count - cursor,
+                segmentPosition + offset);
+        }
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets or sets the number of samples rendered per block.
+    /// </summary>
+    int OfflineRendererClass::get_BlockSize()
+    {
+        return blockSize;
+    }
+    void OfflineRendererClass::set_BlockSize(int value)
+    {
+        REGION(Require)
+
+        if(value <= 0)
+        {
+            throw new ArgumentOutOfRangeException("BlockSize", value,
+                "Block size out of range.");
+        }
+
+        ENDREGION()
+
+        blockSize = value;
+    }
+
+    /// <summary>
+    /// Gets or sets the time in seconds rendered after the end of the
+    /// Sequence.
+    /// </summary>
+    float OfflineRendererClass::get_Tail()
+    {
+        return tail;
+    }
+    void OfflineRendererClass::set_Tail(float value)
+    {
+        REGION(Require)
+
+        if(value < 0.0f)
+        {
+            throw new ArgumentOutOfRangeException("Tail", (int)value,
+                "Tail length out of range.");
+        }
+
+        ENDREGION()
+
+        tail = value;
+    }
+
+    /// <summary>
+    /// Gets or sets the number of worker threads. Zero renders on the
+    /// calling thread alone. The output is the same either way.
+    /// </summary>
+    int OfflineRendererClass::get_Workers()
+    {
+        return workers;
+    }
+    void OfflineRendererClass::set_Workers(int value)
+    {
+        REGION(Require)
+
+        if(value < 0)
+        {
+            throw new ArgumentOutOfRangeException("Workers", value,
+                "Worker count out of range.");
+        }
+
+        ENDREGION()
+
+        workers = value;
+    }
+
+    /// <summary>
+    /// Gets the number of frames rendered by the last render.
+    /// </summary>
+    long long OfflineRendererClass::get_Frames()
+    {
+        return frames;
+    }
+
+    /// <summary>
+    /// Gets the time in seconds the last render took.
+    /// </summary>
+    double OfflineRendererClass::get_RenderTime()
+    {
+        return renderTime;
+    }
+
+    /// <summary>
+    /// Gets the length of the audio rendered by the last render
+    /// divided by the time it took.
+    /// </summary>
+    double OfflineRendererClass::get_RealtimeFactor()
+    {
+        if(renderTime <= 0.0)
+        {
+            return 0.0;
+        }
+
+        return (double)frames / synthesizer->SampleRate / renderTime;
+    }
+
+    ENDREGION()
+
+}}}
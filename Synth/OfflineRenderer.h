@@ -0,0 +1,238 @@
+#ifndef OFFLINERENDERER_H
+#define OFFLINERENDERER_H
+
+#include "Types.h"
+#include "Sequence.h"
+#include "Synthesizer.h"
+#include "ShortMessageRing.h"
+#include "WaveWriter.h"
+#include "WorkerPool.h"
+#include "ArrayList.h"
+#include "Stream.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    class OfflineRendererClass;
+    typedef OfflineRendererClass& OfflineRenderer;
+
+    /// <summary>
+    /// Renders a Sequence through a Synthesizer to a WAV file as fast as
+    /// the processor allows.
+    /// </summary>
+    /// <remarks>
+    /// The Tracks are merged by a MergeQueue and the ChannelMessages due in
+    /// each block are handed to a Synthesizer with the sample their
+    /// TempoMap time falls on, so every message is played at its exact
+    /// sample whatever the BlockSize. The rendered audio is written through a WaveWriter, and the
+    /// time taken is measured so the realtime factor can be reported.
+    ///
+    /// The song is split into parts, one for every Track and channel a
+    /// NoteOn is played on, and every part is rendered by its own copy of
+    /// the Synthesizer with a share of its voices. A part gets the NoteOns
+    /// of its Track and every other ChannelMessage of its channel, so the
+    /// controllers reach the notes whichever Track they are on. The song
+    /// is rendered a segment at a time: the parts of a segment are shared
+    /// out among the worker threads, each into its own buffers, the dry
+    /// output and the effect sends of the parts are summed in part order,
+    /// and the Synthesizer's own reverb and chorus process the summed
+    /// sends once. The parts do not depend on the number of workers, so
+    /// neither does the output, and a song with many Tracks keeps more
+    /// workers busy than it has channels.
+    /// </remarks>
+    class OfflineRendererClass : public IParallelTaskIf
+    {
+        REGION(OfflineRenderer Members)
+
+        REGION(Constants)
+
+    public:
+
+        /// <summary>
+        /// The number of samples rendered per block when none is
+        /// specified.
+        /// </summary>
+        static const int DefaultBlockSize = 1024;
+
+        /// <summary>
+        /// The number of samples each part renders between mixdowns.
+        /// </summary>
+        static const int SegmentSize = 16384;
+
+        /// <summary>
+        /// The fewest voices a part is rendered with.
+        /// </summary>
+        static const int MinimumPartVoices = 16;
+
+    private:
+
+        static const int ChannelCount = SynthesizerClass::ChannelCount;
+
+        ENDREGION()
+
+        REGION(Fields)
+
+    private:
+
+        SynthesizerClass* synthesizer;
+
+        // The number of samples rendered per block.
+        int blockSize;
+
+        // The time in seconds rendered after the end of the Sequence so
+        // released notes can fade out.
+        float tail;
+
+        // The number of frames rendered by the last call to Render and
+        // the time in seconds it took.
+        long long frames;
+
+        double renderTime;
+
+        // The number of worker threads, or zero to render on the calling
+        // thread alone.
+        int workers;
+
+        // The notes one Track plays on one channel.
+        struct Part
+        {
+            // The Synthesizer playing the part.
+            SynthesizerClass* synthesizer;
+
+            // The part's messages with the frame they are due at, and the
+            // next one to play.
+            ArrayList<TimestampedMessage> events;
+
+            int cursor;
+
+            // The output and the effect sends of the segment being
+            // rendered, SegmentSize samples each.
+            float* left;
+
+            float* right;
+
+            float* reverb;
+
+            float* chorus;
+        };
+
+        // The parts of the song being rendered.
+        ArrayList<Part*> parts;
+
+        // The segment being rendered.
+        long long segmentPosition;
+
+        int segmentLength;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the OfflineRenderer class with the
+        /// specified Synthesizer.
+        /// </summary>
+        OfflineRendererClass(Synthesizer synthesizer);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Renders the specified Sequence to a WAV file.
+        /// </summary>
+        void Render(Sequence sequence, string fileName);
+
+        /// <summary>
+        /// Renders the specified Sequence to a Stream in WAV format.
+        /// </summary>
+        void Render(Sequence sequence, Stream stream);
+
+    private:
+
+        // Splits the ChannelMessages of the Sequence into parts.
+        void Split(Sequence sequence);
+
+        void RenderParts(WaveWriter writer, long long total);
+
+        void DeleteParts();
+
+        // Converts a position in ticks to a sample frame.
+        long long TicksToFrame(TempoMap tempoMap, int ticks);
+
+        static double GetSeconds();
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets or sets the number of samples rendered per block.
+        /// </summary>
+        Property<int> BlockSize;
+
+        /// <summary>
+        /// Gets or sets the time in seconds rendered after the end of the
+        /// Sequence.
+        /// </summary>
+        Property<float> Tail;
+
+        /// <summary>
+        /// Gets or sets the number of worker threads. Zero renders on the
+        /// calling thread alone. The output is the same either way.
+        /// </summary>
+        Property<int> Workers;
+
+        /// <summary>
+        /// Gets the number of frames rendered by the last render.
+        /// </summary>
+        ReadOnlyProperty<long long> Frames;
+
+        /// <summary>
+        /// Gets the time in seconds the last render took.
+        /// </summary>
+        ReadOnlyProperty<double> RenderTime;
+
+        /// <summary>
+        /// Gets the length of the audio rendered by the last render
+        /// divided by the time it took.
+        /// </summary>
+        ReadOnlyProperty<double> RealtimeFactor;
+
+        ENDREGION()
+
+        ENDREGION()
+
+        REGION(IParallelTask Members)
+
+    public:
+
+        /// <summary>
+        /// Renders the current segment of the specified part.
+        /// </summary>
+        void Execute(int index);
+
+        ENDREGION()
+
+    private:
+        void init();
+        int get_BlockSize();
+        void set_BlockSize(int value);
+        float get_Tail();
+        void set_Tail(float value);
+        int get_Workers();
+        void set_Workers(int value);
+        long long get_Frames();
+        double get_RenderTime();
+        double get_RealtimeFactor();
+
+    };
+
+}}}
+
+#endif
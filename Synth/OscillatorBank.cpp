@@ -0,0 +1,688 @@
+#include <malloc.h>
+#include <intrin.h>
+#include "OscillatorBank.h"
+#include "SimdVector.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef OscillatorBankClass cls;
+
+    REGION(Waveforms)
+
+    // Approximates sin(2 pi phase) with a parabola and one refinement
+    // step, which is accurate to about 0.1%.
+    template<typename V>
+    static typename V::Type SineOf(typename V::Type phase)
+    {
+        typename V::Type t = V::Sub(phase, V::Set(0.5f));
+        typename V::Type p = V::Mul(V::Set(8.0f),
+            V::Sub(t, V::Mul(V::Set(2.0f), V::Mul(t, V::Abs(t)))));
+
+        p = V::Add(V::Mul(V::Set(0.225f), V::Sub(V::Mul(p, V::Abs(p)), p)), p);
+
+        // Shifting by half a cycle flips the sign.
+        return V::Sub(V::Set(0.0f), p);
+    }
+
+    // The polynomial band-limited step correction for a discontinuity at
+    // phase zero.
+    template<typename V>
+    static typename V::Type Blep(typename V::Type phase, typename V::Type dt,
+        typename V::Type invDt)
+    {
+        typename V::Type one = V::Set(1.0f);
+        typename V::Type t1 = V::Mul(phase, invDt);
+        typename V::Type t2 = V::Mul(V::Sub(phase, one), invDt);
+        typename V::Type rising = V::Sub(V::Add(t1, t1), V::Add(V::Mul(t1, t1), one));
+        typename V::Type falling = V::Add(V::Add(V::Mul(t2, t2), V::Add(t2, t2)), one);
+
+        return V::Select(V::Less(phase, dt), rising,
+            V::And(V::GreaterEqual(phase, V::Sub(one, dt)), falling));
+    }
+
+    ENDREGION()
+
+    static float* AllocateFloats(int count)
+    {
+        float* result = (float*)_aligned_malloc(count * sizeof(float), 32);
+
+        for(int i = 0; i < count; i++)
+        {
+            result[i] = 0.0f;
+        }
+
+        return result;
+    }
+
+    void cls::init()
+    {
+        this->Capacity = Functor::New(this, &cls::get_Capacity);
+        this->InstructionSet = Functor::New(this, &cls::get_InstructionSet, &cls::set_InstructionSet);
+        this->phases = nullptr;
+        this->increments = nullptr;
+        this->levels = nullptr;
+        this->steps = nullptr;
+        this->leftGains = nullptr;
+        this->rightGains = nullptr;
+        this->leftGainSteps = nullptr;
+        this->rightGainSteps = nullptr;
+        this->reverbGains = nullptr;
+        this->chorusGains = nullptr;
+        this->reverbGainSteps = nullptr;
+        this->chorusGainSteps = nullptr;
+        this->waveforms = nullptr;
+        this->tables = nullptr;
+        this->tableMasks = nullptr;
+        this->active = nullptr;
+        this->groupCounts = nullptr;
+        this->leftScratch = nullptr;
+        this->rightScratch = nullptr;
+        this->reverbScratch = nullptr;
+        this->chorusScratch = nullptr;
+        this->capacity = 0;
+        this->instructionSet = DetectInstructionSet();
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the OscillatorBank class with the
+    /// specified number of slots.
+    /// </summary>
+    OscillatorBankClass::OscillatorBankClass(int capacity)
+    {
+        init();
+
+        REGION(Require)
+
+        if(capacity <= 0)
+        {
+            throw new ArgumentOutOfRangeException("capacity", capacity,
+                "Oscillator count out of range.");
+        }
+
+        ENDREGION()
+
+        int groups = (capacity + GroupSize - 1) / GroupSize;
+
+        this->capacity = groups * GroupSize;
+
+        phases = AllocateFloats(this->capacity);
+        increments = AllocateFloats(this->capacity);
+        levels = AllocateFloats(this->capacity);
+        steps = AllocateFloats(this->capacity);
+        leftGains = AllocateFloats(this->capacity);
+        rightGains = AllocateFloats(this->capacity);
+        leftGainSteps = AllocateFloats(this->capacity);
+        rightGainSteps = AllocateFloats(this->capacity);
+        reverbGains = AllocateFloats(this->capacity);
+        chorusGains = AllocateFloats(this->capacity);
+        reverbGainSteps = AllocateFloats(this->capacity);
+        chorusGainSteps = AllocateFloats(this->capacity);
+        waveforms = AllocateFloats(this->capacity);
+        leftScratch = AllocateFloats(MaxBlockSize * GroupSize);
+        rightScratch = AllocateFloats(MaxBlockSize * GroupSize);
+        reverbScratch = AllocateFloats(MaxBlockSize * GroupSize);
+        chorusScratch = AllocateFloats(MaxBlockSize * GroupSize);
+        tables = new const float*[this->capacity];
+        tableMasks = new int[this->capacity];
+        active = new bool[this->capacity];
+        groupCounts = new int[groups];
+
+        for(int i = 0; i < this->capacity; i++)
+        {
+            tables[i] = nullptr;
+            tableMasks[i] = 0;
+            active[i] = false;
+        }
+
+        for(int i = 0; i < groups; i++)
+        {
+            groupCounts[i] = 0;
+        }
+    }
+
+    OscillatorBankClass::~OscillatorBankClass()
+    {
+        _aligned_free(phases);
+        _aligned_free(increments);
+        _aligned_free(levels);
+        _aligned_free(steps);
+        _aligned_free(leftGains);
+        _aligned_free(rightGains);
+        _aligned_free(leftGainSteps);
+        _aligned_free(rightGainSteps);
+        _aligned_free(reverbGains);
+        _aligned_free(chorusGains);
+        _aligned_free(reverbGainSteps);
+        _aligned_free(chorusGainSteps);
+        _aligned_free(waveforms);
+        _aligned_free(leftScratch);
+        _aligned_free(rightScratch);
+        _aligned_free(reverbScratch);
+        _aligned_free(chorusScratch);
+        delete[] tables;
+        delete[] tableMasks;
+        delete[] active;
+        delete[] groupCounts;
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Starts an oscillator at phase zero.
+    /// </summary>
+    /// <param name="slot">
+    /// The slot of the oscillator.
+    /// </param>
+    /// <param name="waveform">
+    /// The waveform to play.
+    /// </param>
+    /// <param name="increment">
+    /// The phase increment per sample in cycles.
+    /// </param>
+    /// <param name="table">
+    /// The wavetable, or nullptr for the other waveforms.
+    /// </param>
+    /// <param name="tableSize">
+    /// The number of samples in the wavetable, not counting the guard
+    /// sample.
+    /// </param>
+    void OscillatorBankClass::Start(int slot, Midi::Waveform waveform, float increment,
+        const float* table, int tableSize)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Oscillator slot out of range.");
+        }
+        else if(waveform == Waveform::Wavetable && table == nullptr)
+        {
+            throw new ArgumentNullException("table");
+        }
+        else if(waveform == Waveform::Wavetable &&
+            (tableSize <= 0 || (tableSize & (tableSize - 1)) != 0))
+        {
+            throw new ArgumentOutOfRangeException("tableSize", tableSize,
+                "Wavetable size must be a power of two.");
+        }
+
+        ENDREGION()
+
+        if(!active[slot])
+        {
+            active[slot] = true;
+            groupCounts[slot / GroupSize]++;
+        }
+
+        phases[slot] = 0.0f;
+        increments[slot] = increment;
+        waveforms[slot] = (float)waveform;
+
+        if(waveform == Waveform::Wavetable)
+        {
+            tables[slot] = table;
+            tableMasks[slot] = tableSize - 1;
+        }
+        else
+        {
+            tables[slot] = nullptr;
+            tableMasks[slot] = 0;
+        }
+    }
+
+    /// <summary>
+    /// Stops an oscillator.
+    /// </summary>
+    void OscillatorBankClass::Stop(int slot)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Oscillator slot out of range.");
+        }
+
+        ENDREGION()
+
+        if(active[slot])
+        {
+            active[slot] = false;
+            groupCounts[slot / GroupSize]--;
+        }
+
+        // Idle lanes of a playing group are still computed, so they must
+        // produce silence.
+        increments[slot] = 0.0f;
+        levels[slot] = 0.0f;
+        steps[slot] = 0.0f;
+        leftGains[slot] = 0.0f;
+        rightGains[slot] = 0.0f;
+        leftGainSteps[slot] = 0.0f;
+        rightGainSteps[slot] = 0.0f;
+        reverbGains[slot] = 0.0f;
+        chorusGains[slot] = 0.0f;
+        reverbGainSteps[slot] = 0.0f;
+        chorusGainSteps[slot] = 0.0f;
+        tables[slot] = nullptr;
+    }
+
+    /// <summary>
+    /// Sets the phase increment per sample of an oscillator.
+    /// </summary>
+    void OscillatorBankClass::SetIncrement(int slot, float increment)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Oscillator slot out of range.");
+        }
+
+        ENDREGION()
+
+        increments[slot] = increment;
+    }
+
+    /// <summary>
+    /// Sets the left and right gains of an oscillator and their change per
+    /// sample.
+    /// </summary>
+    void OscillatorBankClass::SetGain(int slot, float left, float right, float leftStep,
+        float rightStep)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Oscillator slot out of range.");
+        }
+
+        ENDREGION()
+
+        leftGains[slot] = left;
+        rightGains[slot] = right;
+        leftGainSteps[slot] = leftStep;
+        rightGainSteps[slot] = rightStep;
+    }
+
+    /// <summary>
+    /// Sets the reverb and chorus send gains of an oscillator and their
+    /// change per sample.
+    /// </summary>
+    void OscillatorBankClass::SetSend(int slot, float reverb, float chorus, float reverbStep,
+        float chorusStep)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Oscillator slot out of range.");
+        }
+
+        ENDREGION()
+
+        reverbGains[slot] = reverb;
+        chorusGains[slot] = chorus;
+        reverbGainSteps[slot] = reverbStep;
+        chorusGainSteps[slot] = chorusStep;
+    }
+
+    /// <summary>
+    /// Sets the level of an oscillator and its change per sample.
+    /// </summary>
+    void OscillatorBankClass::SetLevel(int slot, float level, float step)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Oscillator slot out of range.");
+        }
+
+        ENDREGION()
+
+        levels[slot] = level;
+        steps[slot] = step;
+    }
+
+    /// <summary>
+    /// Gets the level of an oscillator.
+    /// </summary>
+    float OscillatorBankClass::GetLevel(int slot)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Oscillator slot out of range.");
+        }
+
+        ENDREGION()
+
+        return levels[slot];
+    }
+
+    /// <summary>
+    /// Renders the playing oscillators and adds them to the buffers.
+    /// </summary>
+    /// <param name="left">
+    /// The buffer the left channel is added to.
+    /// </param>
+    /// <param name="right">
+    /// The buffer the right channel is added to.
+    /// </param>
+    /// <param name="reverb">
+    /// The buffer the reverb send is added to.
+    /// </param>
+    /// <param name="chorus">
+    /// The buffer the chorus send is added to.
+    /// </param>
+    /// <param name="count">
+    /// The number of samples to render.
+    /// </param>
+    void OscillatorBankClass::Render(float* left, float* right, float* reverb, float* chorus,
+        int count)
+    {
+        while(count > 0)
+        {
+            int length = count < MaxBlockSize ? count : MaxBlockSize;
+
+            switch(instructionSet)
+            {
+                case InstructionSet::Avx2:
+                    RenderGroups<Avx2Vector>(left, right, reverb, chorus, length);
+                    break;
+
+                case InstructionSet::Sse2:
+                    RenderGroups<Sse2Vector>(left, right, reverb, chorus, length);
+                    break;
+
+                default:
+                    RenderGroups<ScalarVector>(left, right, reverb, chorus, length);
+                    break;
+            }
+
+            left += length;
+            right += length;
+            reverb += length;
+            chorus += length;
+            count -= length;
+        }
+    }
+
+    /// <summary>
+    /// Gets the widest instruction set the processor supports.
+    /// </summary>
+    Midi::InstructionSet OscillatorBankClass::DetectInstructionSet()
+    {
+        int info[4];
+
+        __cpuid(info, 0);
+
+        int leaves = info[0];
+
+        __cpuid(info, 1);
+
+        bool sse2 = (info[3] & (1 << 26)) != 0;
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+
+        // AVX2 also needs the operating system to save the upper halves of
+        // the registers.
+        if(leaves >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6)
+        {
+            __cpuidex(info, 7, 0);
+
+            if((info[1] & (1 << 5)) != 0)
+            {
+                return InstructionSet::Avx2;
+            }
+        }
+
+        return sse2 ? InstructionSet::Sse2 : InstructionSet::Scalar;
+    }
+
+    template<typename V>
+    void OscillatorBankClass::RenderGroups(float* left, float* right, float* reverb,
+        float* chorus, int count)
+    {
+        const int width = V::Width;
+
+        for(int i = 0; i < count * width; i++)
+        {
+            leftScratch[i] = 0.0f;
+            rightScratch[i] = 0.0f;
+            reverbScratch[i] = 0.0f;
+            chorusScratch[i] = 0.0f;
+        }
+
+        for(int group = 0; group < capacity / GroupSize; group++)
+        {
+            if(groupCounts[group] == 0)
+            {
+                continue;
+            }
+
+            for(int base = group * GroupSize; base < (group + 1) * GroupSize; base += width)
+            {
+                RenderGroup<V>(base, count);
+            }
+        }
+
+        // One horizontal sum per sample for the whole bank.
+        for(int i = 0; i < count; i++)
+        {
+            float l = 0.0f;
+            float r = 0.0f;
+            float rv = 0.0f;
+            float ch = 0.0f;
+
+            for(int lane = 0; lane < width; lane++)
+            {
+                l += leftScratch[i * width + lane];
+                r += rightScratch[i * width + lane];
+                rv += reverbScratch[i * width + lane];
+                ch += chorusScratch[i * width + lane];
+            }
+
+            left[i] += l;
+            right[i] += r;
+            reverb[i] += rv;
+            chorus[i] += ch;
+        }
+
+        V::End();
+    }
+
+    template<typename V>
+    void OscillatorBankClass::RenderGroup(int base, int count)
+    {
+        typedef typename V::Type Vector;
+
+        const int width = V::Width;
+        const int sineFlag = 1 << Waveform::Sine;
+        const int sawtoothFlag = 1 << Waveform::Sawtooth;
+        const int squareFlag = 1 << Waveform::Square;
+        const int wavetableFlag = 1 << Waveform::Wavetable;
+
+        int flags = 0;
+
+        for(int lane = 0; lane < width; lane++)
+        {
+            if(active[base + lane])
+            {
+                flags |= 1 << (int)waveforms[base + lane];
+            }
+        }
+
+        if(flags == 0)
+        {
+            return;
+        }
+
+        __declspec(align(32)) float lanes[GroupSize];
+
+        Vector zero = V::Set(0.0f);
+        Vector half = V::Set(0.5f);
+        Vector one = V::Set(1.0f);
+        Vector phase = V::Load(phases + base);
+        Vector increment = V::Load(increments + base);
+        Vector level = V::Load(levels + base);
+        Vector step = V::Load(steps + base);
+        Vector leftGain = V::Load(leftGains + base);
+        Vector rightGain = V::Load(rightGains + base);
+        Vector leftGainStep = V::Load(leftGainSteps + base);
+        Vector rightGainStep = V::Load(rightGainSteps + base);
+        Vector reverbGain = V::Load(reverbGains + base);
+        Vector chorusGain = V::Load(chorusGains + base);
+        Vector reverbGainStep = V::Load(reverbGainSteps + base);
+        Vector chorusGainStep = V::Load(chorusGainSteps + base);
+        Vector waveform = V::Load(waveforms + base);
+
+        // Idle lanes have no increment; keep the step correction finite.
+        Vector dt = V::Max(increment, V::Set(1.0e-6f));
+        Vector invDt = V::Div(one, dt);
+
+        for(int i = 0; i < count; i++)
+        {
+            Vector sample = zero;
+
+            // A group playing a single waveform skips the selects.
+            if((flags & sineFlag) != 0)
+            {
+                Vector s = SineOf<V>(phase);
+
+                sample = flags == sineFlag ? s :
+                    V::Select(V::Equal(waveform, V::Set((float)Waveform::Sine)), s, sample);
+            }
+
+            if((flags & sawtoothFlag) != 0)
+            {
+                Vector s = V::Sub(V::Sub(V::Add(phase, phase), one), Blep<V>(phase, dt, invDt));
+
+                sample = flags == sawtoothFlag ? s :
+                    V::Select(V::Equal(waveform, V::Set((float)Waveform::Sawtooth)), s, sample);
+            }
+
+            if((flags & squareFlag) != 0)
+            {
+                Vector shifted = V::Add(phase, half);
+
+                shifted = V::Sub(shifted, V::And(V::GreaterEqual(shifted, one), one));
+
+                Vector s = V::Select(V::Less(phase, half), one, V::Sub(zero, one));
+
+                s = V::Sub(V::Add(s, Blep<V>(phase, dt, invDt)), Blep<V>(shifted, dt, invDt));
+
+                sample = flags == squareFlag ? s :
+                    V::Select(V::Equal(waveform, V::Set((float)Waveform::Square)), s, sample);
+            }
+
+            if((flags & wavetableFlag) != 0)
+            {
+                // Every lane may read a different table, so the lookups
+                // are done one lane at a time.
+                V::Store(lanes, phase);
+
+                for(int lane = 0; lane < width; lane++)
+                {
+                    const float* table = tables[base + lane];
+
+                    if(table == nullptr)
+                    {
+                        lanes[lane] = 0.0f;
+                        continue;
+                    }
+
+                    float x = lanes[lane] * (tableMasks[base + lane] + 1);
+                    int index = (int)x;
+                    float fraction = x - index;
+
+                    lanes[lane] = table[index] + fraction * (table[index + 1] - table[index]);
+                }
+
+                Vector s = V::Load(lanes);
+
+                sample = flags == wavetableFlag ? s :
+                    V::Select(V::Equal(waveform, V::Set((float)Waveform::Wavetable)), s, sample);
+            }
+
+            sample = V::Mul(sample, level);
+
+            float* l = leftScratch + i * width;
+            float* r = rightScratch + i * width;
+            float* rv = reverbScratch + i * width;
+            float* ch = chorusScratch + i * width;
+
+            V::Store(l, V::Add(V::Load(l), V::Mul(sample, leftGain)));
+            V::Store(r, V::Add(V::Load(r), V::Mul(sample, rightGain)));
+            V::Store(rv, V::Add(V::Load(rv), V::Mul(sample, reverbGain)));
+            V::Store(ch, V::Add(V::Load(ch), V::Mul(sample, chorusGain)));
+
+            phase = V::Add(phase, increment);
+            phase = V::Sub(phase, V::And(V::GreaterEqual(phase, one), one));
+            level = V::Min(V::Max(V::Add(level, step), zero), one);
+            leftGain = V::Add(leftGain, leftGainStep);
+            rightGain = V::Add(rightGain, rightGainStep);
+            reverbGain = V::Add(reverbGain, reverbGainStep);
+            chorusGain = V::Add(chorusGain, chorusGainStep);
+        }
+
+        V::Store(phases + base, phase);
+        V::Store(levels + base, level);
+        V::Store(leftGains + base, leftGain);
+        V::Store(rightGains + base, rightGain);
+        V::Store(reverbGains + base, reverbGain);
+        V::Store(chorusGains + base, chorusGain);
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets the number of slots.
+    /// </summary>
+    int OscillatorBankClass::get_Capacity()
+    {
+        return capacity;
+    }
+
+    /// <summary>
+    /// Gets or sets the instruction set used for rendering. It can be
+    /// lowered for testing but not raised above what the processor
+    /// supports.
+    /// </summary>
+    Midi::InstructionSet OscillatorBankClass::get_InstructionSet()
+    {
+        return instructionSet;
+    }
+    void OscillatorBankClass::set_InstructionSet(Midi::InstructionSet value)
+    {
+        REGION(Require)
+
+        if(value > DetectInstructionSet())
+        {
+            throw new ArgumentException("Instruction set not supported.", "InstructionSet");
+        }
+
+        ENDREGION()
+
+        instructionSet = value;
+    }
+
+    ENDREGION()
+
+}}}
@@ -0,0 +1,277 @@
+#ifndef OSCILLATORBANK_H
+#define OSCILLATORBANK_H
+
+#include "Types.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    /// <summary>
+    /// Defines constants representing oscillator waveforms.
+    /// </summary>
+    enum Waveform
+    {
+        Sine,
+        Sawtooth,
+        Square,
+        Wavetable
+    };
+
+    /// <summary>
+    /// Defines constants representing the instruction sets an
+    /// OscillatorBank can render with.
+    /// </summary>
+    enum InstructionSet
+    {
+        Scalar,
+        Sse2,
+        Avx2
+    };
+
+    class OscillatorBankClass;
+    typedef OscillatorBankClass& OscillatorBank;
+
+    /// <summary>
+    /// Renders many oscillators at once with SIMD instructions.
+    /// </summary>
+    /// <remarks>
+    /// The state of every oscillator is kept in structure of arrays form,
+    /// so one instruction advances four oscillators with SSE2 or eight with
+    /// AVX2. The widest instruction set the processor supports is chosen
+    /// when the bank is created. Each oscillator has a level that ramps
+    /// linearly by a step every sample, clamped between zero and one, and
+    /// left and right gains that ramp the same way, so parameters set at
+    /// control rate change smoothly without a branch per sample. Reverb
+    /// and chorus send gains ramp alike and feed two mono send outputs,
+    /// so the effects can be run once on the sum of all oscillators.
+    /// Sawtooth and square waves are band-limited
+    /// with polynomial band-limited steps. Wavetables hold a power of two
+    /// number of samples plus one guard sample equal to the first.
+    ///
+    /// Oscillators are addressed by slot. A Synthesizer uses the slot of
+    /// each voice as its index in the voice pool.
+    /// </remarks>
+    class OscillatorBankClass
+    {
+        REGION(OscillatorBank Members)
+
+        REGION(Constants)
+
+    public:
+
+        /// <summary>
+        /// The number of oscillators rendered by the widest instruction.
+        /// </summary>
+        static const int GroupSize = 8;
+
+        /// <summary>
+        /// The largest number of samples rendered in one pass. Longer
+        /// blocks are rendered in several passes.
+        /// </summary>
+        static const int MaxBlockSize = 1024;
+
+        ENDREGION()
+
+        REGION(Fields)
+
+    private:
+
+        // The oscillator state, one entry per slot. The arrays are aligned
+        // for the widest instruction set.
+        float* phases;
+
+        float* increments;
+
+        float* levels;
+
+        float* steps;
+
+        float* leftGains;
+
+        float* rightGains;
+
+        float* leftGainSteps;
+
+        float* rightGainSteps;
+
+        float* reverbGains;
+
+        float* chorusGains;
+
+        float* reverbGainSteps;
+
+        float* chorusGainSteps;
+
+        // The waveform of each slot as a float so it can be compared in
+        // SIMD registers.
+        float* waveforms;
+
+        // The wavetable of each slot and its length minus one.
+        const float** tables;
+
+        int* tableMasks;
+
+        // Indicates whether each slot is playing, and the number of playing
+        // slots in each group.
+        bool* active;
+
+        int* groupCounts;
+
+        // Per sample accumulators holding one lane per oscillator of a
+        // group, summed once every group has been rendered.
+        float* leftScratch;
+
+        float* rightScratch;
+
+        float* reverbScratch;
+
+        float* chorusScratch;
+
+        // The number of slots, rounded up to a whole number of groups.
+        int capacity;
+
+        Midi::InstructionSet instructionSet;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the OscillatorBank class with the
+        /// specified number of slots.
+        /// </summary>
+        OscillatorBankClass(int capacity);
+
+        ~OscillatorBankClass();
+
+    private:
+
+        OscillatorBankClass(const OscillatorBankClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Starts an oscillator at phase zero.
+        /// </summary>
+        /// <param name="slot">
+        /// The slot of the oscillator.
+        /// </param>
+        /// <param name="waveform">
+        /// The waveform to play.
+        /// </param>
+        /// <param name="increment">
+        /// The phase increment per sample in cycles.
+        /// </param>
+        /// <param name="table">
+        /// The wavetable, or nullptr for the other waveforms.
+        /// </param>
+        /// <param name="tableSize">
+        /// The number of samples in the wavetable, not counting the guard
+        /// sample.
+        /// </param>
+        void Start(int slot, Midi::Waveform waveform, float increment,
+            const float* table, int tableSize);
+
+        /// <summary>
+        /// Stops an oscillator.
+        /// </summary>
+        void Stop(int slot);
+
+        /// <summary>
+        /// Sets the phase increment per sample of an oscillator.
+        /// </summary>
+        void SetIncrement(int slot, float increment);
+
+        /// <summary>
+        /// Sets the left and right gains of an oscillator and their change
+        /// per sample.
+        /// </summary>
+        void SetGain(int slot, float left, float right, float leftStep, float rightStep);
+
+        /// <summary>
+        /// Sets the reverb and chorus send gains of an oscillator and their
+        /// change per sample.
+        /// </summary>
+        void SetSend(int slot, float reverb, float chorus, float reverbStep, float chorusStep);
+
+        /// <summary>
+        /// Sets the level of an oscillator and its change per sample.
+        /// </summary>
+        void SetLevel(int slot, float level, float step);
+
+        /// <summary>
+        /// Gets the level of an oscillator.
+        /// </summary>
+        float GetLevel(int slot);
+
+        /// <summary>
+        /// Renders the playing oscillators and adds them to the buffers.
+        /// </summary>
+        /// <param name="left">
+        /// The buffer the left channel is added to.
+        /// </param>
+        /// <param name="right">
+        /// The buffer the right channel is added to.
+        /// </param>
+        /// <param name="reverb">
+        /// The buffer the reverb send is added to.
+        /// </param>
+        /// <param name="chorus">
+        /// The buffer the chorus send is added to.
+        /// </param>
+        /// <param name="count">
+        /// The number of samples to render.
+        /// </param>
+        void Render(float* left, float* right, float* reverb, float* chorus, int count);
+
+        /// <summary>
+        /// Gets the widest instruction set the processor supports.
+        /// </summary>
+        static Midi::InstructionSet DetectInstructionSet();
+
+    private:
+
+        template<typename V>
+        void RenderGroups(float* left, float* right, float* reverb, float* chorus, int count);
+
+        template<typename V>
+        void RenderGroup(int base, int count);
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets the number of slots.
+        /// </summary>
+        ReadOnlyProperty<int> Capacity;
+
+        /// <summary>
+        /// Gets or sets the instruction set used for rendering. It can be
+        /// lowered for testing but not raised above what the processor
+        /// supports.
+        /// </summary>
+        Property<Midi::InstructionSet> InstructionSet;
+
+        ENDREGION()
+
+        ENDREGION()
+
+    private:
+        void init();
+        int get_Capacity();
+        Midi::InstructionSet get_InstructionSet();
+        void set_InstructionSet(Midi::InstructionSet value);
+
+    };
+
+}}}
+
+#endif
@@ -0,0 +1,1097 @@
+#include "PersistentTrack.h"
+#include "NullMessage.h"
+#include "MessagePool.h"
+#include "Exception.h"
+
+#include <windows.h>
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    // The most messages a leaf holds.
+    static const int LeafCapacity = 64;
+
+    // The most children a branch holds.
+    static const int BranchCapacity = 32;
+
+    // A node of the tree. Once made and filled, a node is never changed,
+    // so any number of versions and threads can share it.
+    struct PersistentNode
+    {
+        volatile long references;
+
+        // The number of messages under the node.
+        int count;
+
+        // The number of items, messages or children, in the node.
+        int size;
+
+        // The position of the last message under the node.
+        int lastTicks;
+
+        bool leaf;
+    };
+
+    template<typename T, int Capacity, bool Leaf>
+    struct PersistentChunk : PersistentNode
+    {
+        typedef T Item;
+
+        static const int ItemCapacity = Capacity;
+
+        static const bool IsLeaf = Leaf;
+
+        T items[Capacity];
+    };
+
+    typedef PersistentChunk<TrackEntry, LeafCapacity, true> PersistentLeaf;
+    typedef PersistentChunk<PersistentNode*, BranchCapacity, false> PersistentBranch;
+
+    static void AddRef(PersistentNode* node)
+    {
+        InterlockedIncrement(&node->references);
+    }
+
+    static void Release(PersistentNode* node)
+    {
+        if(InterlockedDecrement(&node->references) == 0)
+        {
+            if(node->leaf)
+            {
+                PersistentLeaf* leaf = static_cast<PersistentLeaf*>(node);
+
+                for(int i = 0; i < leaf->size; i++)
+                {
+                    MessagePoolClass::Shared.Release(*leaf->items[i].message);
+                }
+
+                delete leaf;
+            }
+            else
+            {
+                PersistentBranch* branch = static_cast<PersistentBranch*>(node);
+
+                for(int i = 0; i < branch->size; i++)
+                {
+                    Release(branch->items[i]);
+                }
+
+                delete branch;
+            }
+        }
+    }
+
+    // Items are held by a node they are put in: pooled messages gain a
+    // reference in the shared pool, children gain a reference.
+    static void Retain(const TrackEntry& entry)
+    {
+        MessagePoolClass::Shared.AddReference(*entry.message);
+    }
+
+    static void Retain(PersistentNode* child)
+    {
+        AddRef(child);
+    }
+
+    static int CountOf(const TrackEntry&)
+    {
+        return 1;
+    }
+
+    static int CountOf(PersistentNode* child)
+    {
+        return child->count;
+    }
+
+    static int LastTicksOf(const TrackEntry& entry)
+    {
+        return entry.ticks;
+    }
+
+    static int LastTicksOf(PersistentNode* child)
+    {
+        return child->lastTicks;
+    }
+
+    // Makes a node of the specified items, holding each of them.
+    template<typename Chunk>
+    static PersistentNode* Make(const typename Chunk::Item* items, int size)
+    {
+        Chunk* chunk = new Chunk();
+
+        chunk->references = 1;
+        chunk->count = 0;
+        chunk->size = size;
+        chunk->leaf = Chunk::IsLeaf;
+
+        for(int i = 0; i < size; i++)
+        {
+            chunk->items[i] = items[i];
+            chunk->count += CountOf(items[i]);
+
+            Retain(items[i]);
+        }
+
+        chunk->lastTicks = size > 0 ? LastTicksOf(items[size - 1]) : 0;
+
+        return chunk;
+    }
+
+    // Makes one node of the specified items, or two sharing them evenly if
+    // they do not fit in one.
+    template<typename Chunk>
+    static void Divide(const typename Chunk::Item* items, int size,
+        PersistentNode** first, PersistentNode** second)
+    {
+        if(size <= Chunk::ItemCapacity)
+        {
+            *first = Make<Chunk>(items, size);
+            *second = nullptr;
+        }
+        else
+        {
+            *first = Make<Chunk>(items, size / 2);
+            *second = Make<Chunk>(items + size / 2, size - size / 2);
+        }
+    }
+
+    // Makes a copy of a node with a run of its items replaced by others,
+    // split in two if they no longer fit in one.
+    template<typename Chunk>
+    static void Splice(Chunk* chunk, int slot, int removed,
+        const typename Chunk::Item* added, int addedCount,
+        PersistentNode** first, PersistentNode** second)
+    {
+        typename Chunk::Item items[Chunk::ItemCapacity + 1];
+        int size = 0;
+
+        for(int i = 0; i < slot; i++)
+        {
+            items[size++] = chunk->items[i];
+        }
+
+        for(int i = 0; i < addedCount; i++)
+        {
+            items[size++] = added[i];
+        }
+
+        for(int i = slot + removed; i < chunk->size; i++)
+        {
+            items[size++] = chunk->items[i];
+        }
+
+        Divide<Chunk>(items, size, first, second);
+    }
+
+    // Makes one node of the items of two neighbours, or two sharing them
+    // evenly if they do not fit in one.
+    template<typename Chunk>
+    static void Join(Chunk* left, Chunk* right, PersistentNode** first, PersistentNode** second)
+    {
+        typename Chunk::Item items[Chunk::ItemCapacity * 2];
+        int size = 0;
+
+        for(int i = 0; i < left->size; i++)
+        {
+            items[size++] = left->items[i];
+        }
+
+        for(int i = 0; i < right->size; i++)
+        {
+            items[size++] = right->items[i];
+        }
+
+        Divide<Chunk>(items, size, first, second);
+    }
+
+    static PersistentNode* NewEmptyNode()
+    {
+        return Make<PersistentLeaf>(nullptr, 0);
+    }
+
+    // Inserts a message at the specified index under a node, giving the
+    // copy of the node, and the node split off from it if it overflowed.
+    static void InsertAt(PersistentNode* node, int index, const TrackEntry& entry,
+        PersistentNode** first, PersistentNode** second)
+    {
+        if(node->leaf)
+        {
+            Splice(static_cast<PersistentLeaf*>(node), index, 0, &entry, 1, first, second);
+
+            return;
+        }
+
+        PersistentBranch* branch = static_cast<PersistentBranch*>(node);
+        int slot = 0;
+
+        while(slot < branch->size - 1 && index > branch->items[slot]->count)
+        {
+            index -= branch->items[slot]->count;
+            slot++;
+        }
+
+        PersistentNode* children[2];
+
+        InsertAt(branch->items[slot], index, entry, &children[0], &children[1]);
+
+        Splice(branch, slot, 1, children, children[1] != nullptr ? 2 : 1, first, second);
+
+        Release(children[0]);
+
+        if(children[1] != nullptr)
+        {
+            Release(children[1]);
+        }
+    }
+
+    // Removes the message at the specified index under a node, giving the
+    // copy of the node, which may be left with too few items.
+    static PersistentNode* RemoveFrom(PersistentNode* node, int index)
+    {
+        PersistentNode* result;
+        PersistentNode* unused;
+
+        if(node->leaf)
+        {
+            Splice(static_cast<PersistentLeaf*>(node), index, 1, nullptr, 0, &result, &unused);
+
+            return result;
+        }
+
+        PersistentBranch* branch = static_cast<PersistentBranch*>(node);
+        int slot = 0;
+
+        while(index >= branch->items[slot]->count)
+        {
+            index -= branch->items[slot]->count;
+            slot++;
+        }
+
+        PersistentNode* child = RemoveFrom(branch->items[slot], index);
+        int minimum = child->leaf ? LeafCapacity / 2 : BranchCapacity / 2;
+
+        if(child->size >= minimum)
+        {
+            Splice(branch, slot, 1, &child, 1, &result, &unused);
+        }
+        else
+        {
+            // Merges the child with a neighbour, or takes items from it.
+            int left = slot + 1 < branch->size ? slot : slot - 1;
+            PersistentNode* leftNode = left == slot ? child : branch->items[left];
+            PersistentNode* rightNode = left == slot ? branch->items[left + 1] : child;
+            PersistentNode* joined[2];
+
+            if(child->leaf)
+            {
+                Join(static_cast<PersistentLeaf*>(leftNode), static_cast<PersistentLeaf*>(rightNode),
+                    &joined[0], &joined[1]);
+            }
+            else
+            {
+                Join(static_cast<PersistentBranch*>(leftNode), static_cast<PersistentBranch*>(rightNode),
+                    &joined[0], &joined[1]);
+            }
+
+            Splice(branch, left, 2, joined, joined[1] != nullptr ? 2 : 1, &result, &unused);
+
+            Release(joined[0]);
+
+            if(joined[1] != nullptr)
+            {
+                Release(joined[1]);
+            }
+        }
+
+        Release(child);
+
+        return result;
+    }
+
+    // Builds a level of the tree over the specified items, spreading them
+    // evenly over as few nodes as will hold them. Returns the number of
+    // nodes.
+    template<typename Chunk>
+    static int BuildLevel(const typename Chunk::Item* items, int size, PersistentNode** nodes)
+    {
+        int nodeCount = (size + Chunk::ItemCapacity - 1) / Chunk::ItemCapacity;
+
+        for(int i = 0; i < nodeCount; i++)
+        {
+            int start = (int)((long long)size * i / nodeCount);
+            int end = (int)((long long)size * (i + 1) / nodeCount);
+
+            nodes[i] = Make<Chunk>(items + start, end - start);
+        }
+
+        return nodeCount;
+    }
+
+    // Builds a tree over messages in order.
+    static PersistentNode* Build(const TrackEntry* entries, int size)
+    {
+        if(size == 0)
+        {
+            return NewEmptyNode();
+        }
+
+        int nodeCount = (size + LeafCapacity - 1) / LeafCapacity;
+        PersistentNode** nodes = new PersistentNode*[nodeCount];
+        PersistentNode** parents = new PersistentNode*[nodeCount];
+
+        nodeCount = BuildLevel<PersistentLeaf>(entries, size, nodes);
+
+        while(nodeCount > 1)
+        {
+            int parentCount = BuildLevel<PersistentBranch>(nodes, nodeCount, parents);
+
+            for(int i = 0; i < nodeCount; i++)
+            {
+                Release(nodes[i]);
+            }
+
+            PersistentNode** swap = nodes;
+
+            nodes = parents;
+            parents = swap;
+            nodeCount = parentCount;
+        }
+
+        PersistentNode* root = nodes[0];
+
+        delete[] nodes;
+        delete[] parents;
+
+        return root;
+    }
+
+    // Gives a root with a single child over to the child.
+    static PersistentNode* Collapse(PersistentNode* root)
+    {
+        while(!root->leaf && root->size == 1)
+        {
+            PersistentNode* child = static_cast<PersistentBranch*>(root)->items[0];
+
+            AddRef(child);
+            Release(root);
+
+            root = child;
+        }
+
+        return root;
+    }
+
+    static const TrackEntry& Locate(PersistentNode* node, int index)
+    {
+        while(!node->leaf)
+        {
+            PersistentBranch* branch = static_cast<PersistentBranch*>(node);
+            int slot = 0;
+
+            while(index >= branch->items[slot]->count)
+            {
+                index -= branch->items[slot]->count;
+                slot++;
+            }
+
+            node = branch->items[slot];
+        }
+
+        return static_cast<PersistentLeaf*>(node)->items[index];
+    }
+
+    // Counts the messages before the specified position, or at or before
+    // it if inclusive.
+    static int CountBefore(PersistentNode* node, int position, bool inclusive)
+    {
+        int index = 0;
+
+        while(!node->leaf)
+        {
+            PersistentBranch* branch = static_cast<PersistentBranch*>(node);
+            int slot = 0;
+
+            while(slot < branch->size - 1 &&
+                (branch->items[slot]->lastTicks < position ||
+                (inclusive && branch->items[slot]->lastTicks == position)))
+            {
+                index += branch->items[slot]->count;
+                slot++;
+            }
+
+            node = branch->items[slot];
+        }
+
+        PersistentLeaf* leaf = static_cast<PersistentLeaf*>(node);
+        int low = 0;
+        int high = leaf->size;
+
+        while(low < high)
+        {
+            int middle = (low + high) / 2;
+            int ticks = leaf->items[middle].ticks;
+
+            if(ticks < position || (inclusive && ticks == position))
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+
+        return index + low;
+    }
+
+    static int CopyEntries(PersistentNode* node, int index, TrackEntry* entries, int count)
+    {
+        if(node->leaf)
+        {
+            PersistentLeaf* leaf = static_cast<PersistentLeaf*>(node);
+            int copied = leaf->size - index < count ? leaf->size - index : count;
+
+            for(int i = 0; i < copied; i++)
+            {
+                entries[i] = leaf->items[index + i];
+            }
+
+            return copied;
+        }
+
+        PersistentBranch* branch = static_cast<PersistentBranch*>(node);
+        int copied = 0;
+
+        for(int slot = 0; slot < branch->size && copied < count; slot++)
+        {
+            PersistentNode* child = branch->items[slot];
+
+            if(index >= child->count)
+            {
+                index -= child->count;
+            }
+            else
+            {
+                copied += CopyEntries(child, index, entries + copied, count - copied);
+                index = 0;
+            }
+        }
+
+        return copied;
+    }
+
+    static MidiEventClass* Next(MidiEventClass* e)
+    {
+        MidiEvent next = e->Next;
+
+        return next != MidiEventClass::null ? &next : nullptr;
+    }
+
+    static int GetLength(PersistentNode* root, int endOfTrackOffset)
+    {
+        return (root->count > 0 ? root->lastTicks : 0) + endOfTrackOffset + 1;
+    }
+
+    static void RequireIndex(PersistentNode* root, int index)
+    {
+        if(index < 0 || index >= root->count)
+        {
+            throw new ArgumentOutOfRangeException("index", index,
+                "Message index out of range.");
+        }
+    }
+
+    REGION(TrackVersion)
+
+    void TrackVersionClass::init()
+    {
+        this->Count = Functor::New(this, &TrackVersionClass::get_Count);
+        this->Length = Functor::New(this, &TrackVersionClass::get_Length);
+        this->EndOfTrackOffset = Functor::New(this, &TrackVersionClass::get_EndOfTrackOffset);
+        this->root = NewEmptyNode();
+        this->endOfTrackOffset = 0;
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the TrackVersion class holding an
+    /// empty version.
+    /// </summary>
+    TrackVersionClass::TrackVersionClass()
+    {
+        init();
+    }
+
+    TrackVersionClass::~TrackVersionClass()
+    {
+        Release(root);
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Gets the position in absolute ticks of the message at the specified
+    /// index.
+    /// </summary>
+    int TrackVersionClass::GetPosition(int index)
+    {
+        REGION(Require)
+
+        RequireIndex(root, index);
+
+        ENDREGION()
+
+        return Locate(root, index).ticks;
+    }
+
+    /// <summary>
+    /// Gets the message at the specified index.
+    /// </summary>
+    IMidiMessage TrackVersionClass::GetMessage(int index)
+    {
+        REGION(Require)
+
+        RequireIndex(root, index);
+
+        ENDREGION()
+
+        return *Locate(root, index).message;
+    }
+
+    /// <summary>
+    /// Copies a run of the messages and their positions.
+    /// </summary>
+    /// <param name="index">
+    /// The index of the first message to copy.
+    /// </param>
+    /// <param name="entries">
+    /// The array the messages are copied to.
+    /// </param>
+    /// <param name="count">
+    /// The most messages to copy.
+    /// </param>
+    /// <returns>
+    /// The number of messages copied, which is less than count only at the
+    /// end of the version.
+    /// </returns>
+    int TrackVersionClass::GetEntries(int index, TrackEntry* entries, int count)
+    {
+        REGION(Require)
+
+        if(index < 0 || index > root->count)
+        {
+            throw new ArgumentOutOfRangeException("index", index,
+                "Message index out of range.");
+        }
+        else if(count < 0)
+        {
+            throw new ArgumentOutOfRangeException("count", count,
+                "Message count out of range.");
+        }
+        else if(entries == nullptr && count > 0)
+        {
+            throw new ArgumentNullException("entries");
+        }
+
+        ENDREGION()
+
+        return CopyEntries(root, index, entries, count);
+    }
+
+    /// <summary>
+    /// Finds the first message at or after the specified position.
+    /// </summary>
+    /// <param name="position">
+    /// The position in absolute ticks.
+    /// </param>
+    /// <returns>
+    /// The index of the message, or Count if every message is before the
+    /// position.
+    /// </returns>
+    int TrackVersionClass::FindIndex(int position)
+    {
+        return CountBefore(root, position, false);
+    }
+
+    /// <summary>
+    /// Replaces the MidiEvents of the specified Track with the messages of
+    /// the version.
+    /// </summary>
+    void TrackVersionClass::CopyTo(Track track)
+    {
+        TrackEntry entries[LeafCapacity];
+
+        track.Clear();
+
+        // Each message is at or after the last one, so it is appended.
+        for(int index = 0; index < root->count; )
+        {
+            int copied = CopyEntries(root, index, entries, LeafCapacity);
+
+            for(int i = 0; i < copied; i++)
+            {
+                track.Insert(entries[i].ticks, *entries[i].message);
+            }
+
+            index += copied;
+        }
+
+        track.EndOfTrackOffset = endOfTrackOffset;
+    }
+
+    // Holds on to the specified version instead of the current one.
+    void TrackVersionClass::Set(PersistentNode* root, int endOfTrackOffset)
+    {
+        AddRef(root);
+        Release(this->root);
+
+        this->root = root;
+        this->endOfTrackOffset = endOfTrackOffset;
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets the number of messages in the version.
+    /// </summary>
+    int TrackVersionClass::get_Count()
+    {
+        return root->count;
+    }
+
+    /// <summary>
+    /// Gets the length in ticks of the version, measured as the length of a
+    /// Track.
+    /// </summary>
+    int TrackVersionClass::get_Length()
+    {
+        return GetLength(root, endOfTrackOffset);
+    }
+
+    /// <summary>
+    /// Gets the end of track offset of the version.
+    /// </summary>
+    int TrackVersionClass::get_EndOfTrackOffset()
+    {
+        return endOfTrackOffset;
+    }
+
+    ENDREGION()
+
+    ENDREGION()
+
+    REGION(PersistentTrack)
+
+    typedef PersistentTrackClass cls;
+
+    void cls::init()
+    {
+        this->Count = Functor::New(this, &cls::get_Count);
+        this->Length = Functor::New(this, &cls::get_Length);
+        this->EndOfTrackOffset = Functor::New(this, &cls::get_EndOfTrackOffset, &cls::set_EndOfTrackOffset);
+        this->CanUndo = Functor::New(this, &cls::get_CanUndo);
+        this->CanRedo = Functor::New(this, &cls::get_CanRedo);
+        this->UndoLimit = Functor::New(this, &cls::get_UndoLimit, &cls::set_UndoLimit);
+        this->current = 0;
+        this->undoLimit = 0;
+
+        Version version;
+
+        version.root = NewEmptyNode();
+        version.endOfTrackOffset = 0;
+
+        history.Add(version);
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the PersistentTrack class with an empty
+    /// Track as its only version.
+    /// </summary>
+    PersistentTrackClass::PersistentTrackClass()
+    {
+        init();
+    }
+
+    PersistentTrackClass::~PersistentTrackClass()
+    {
+        ClearHistory();
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Replaces the whole history with a version holding the MidiEvents of
+    /// the specified Track.
+    /// </summary>
+    void PersistentTrackClass::Load(Track track)
+    {
+        ArrayList<TrackEntry> entries;
+
+        entries.EnsureCapacity(track.Count - 1);
+
+        MidiEventClass* e = track.Count > 1 ? &track.GetMidiEvent(0) : nullptr;
+
+        for(; e != nullptr; e = Next(e))
+        {
+            TrackEntry entry;
+
+            IMidiMessage message = e->MidiMessage;
+
+            entry.ticks = e->AbsoluteTicks;
+            entry.message = &message;
+
+            entries.Add(entry);
+        }
+
+        ClearHistory();
+
+        Version version;
+
+        version.root = Build(entries.Count > 0 ? &entries[0] : nullptr, entries.Count);
+        version.endOfTrackOffset = track.EndOfTrackOffset;
+
+        history.Add(version);
+        current = 0;
+    }
+
+    /// <summary>
+    /// Inserts an IMidiMessage at the specified position in absolute ticks,
+    /// after the messages already there.
+    /// </summary>
+    void PersistentTrackClass::Insert(int position, IMidiMessage message)
+    {
+        REGION(Require)
+
+        if(position < 0)
+        {
+            throw new ArgumentOutOfRangeException("position", position,
+                "IMidiMessage position out of range.");
+        }
+        else if(message == NullMessageClass::null)
+        {
+            throw new ArgumentNullException("message");
+        }
+
+        ENDREGION()
+
+        PersistentNode* root = history[current].root;
+        TrackEntry entry;
+
+        entry.ticks = position;
+        entry.message = &message;
+
+        PersistentNode* nodes[2];
+
+        InsertAt(root, CountBefore(root, position, true), entry, &nodes[0], &nodes[1]);
+
+        if(nodes[1] != nullptr)
+        {
+            root = Make<PersistentBranch>(nodes, 2);
+
+            Release(nodes[0]);
+            Release(nodes[1]);
+        }
+        else
+        {
+            root = nodes[0];
+        }
+
+        Commit(root, history[current].endOfTrackOffset);
+    }
+
+    /// <summary>
+    /// Removes the message at the specified index.
+    /// </summary>
+    void PersistentTrackClass::RemoveAt(int index)
+    {
+        REGION(Require)
+
+        RequireIndex(history[current].root, index);
+
+        ENDREGION()
+
+        PersistentNode* root = Collapse(RemoveFrom(history[current].root, index));
+
+        Commit(root, history[current].endOfTrackOffset);
+    }
+
+    /// <summary>
+    /// Moves the message at the specified index to another position, as a
+    /// single edit.
+    /// </summary>
+    void PersistentTrackClass::Move(int index, int newPosition)
+    {
+        REGION(Require)
+
+        RequireIndex(history[current].root, index);
+
+        if(newPosition < 0)
+        {
+            throw new ArgumentOutOfRangeException("newPosition", newPosition,
+                "IMidiMessage position out of range.");
+        }
+
+        ENDREGION()
+
+        TrackEntry entry = Locate(history[current].root, index);
+
+        entry.ticks = newPosition;
+
+        PersistentNode* removed = Collapse(RemoveFrom(history[current].root, index));
+        PersistentNode* nodes[2];
+        PersistentNode* root;
+
+        InsertAt(removed, CountBefore(removed, newPosition, true), entry, &nodes[0], &nodes[1]);
+
+        if(nodes[1] != nullptr)
+        {
+            root = Make<PersistentBranch>(nodes, 2);
+
+            Release(nodes[0]);
+            Release(nodes[1]);
+        }
+        else
+        {
+            root = nodes[0];
+        }
+
+        Release(removed);
+
+        Commit(root, history[current].endOfTrackOffset);
+    }
+
+    /// <summary>
+    /// Goes back to the version before the last edit.
+    /// </summary>
+    /// <returns>
+    /// <b>true</b> if there was an edit to undo; otherwise, <b>false</b>.
+    /// </returns>
+    bool PersistentTrackClass::Undo()
+    {
+        if(current == 0)
+        {
+            return false;
+        }
+
+        current--;
+
+        return true;
+    }
+
+    /// <summary>
+    /// Goes forward to the version of the last edit undone.
+    /// </summary>
+    /// <returns>
+    /// <b>true</b> if there was an edit to redo; otherwise, <b>false</b>.
+    /// </returns>
+    bool PersistentTrackClass::Redo()
+    {
+        if(current == history.Count - 1)
+        {
+            return false;
+        }
+
+        current++;
+
+        return true;
+    }
+
+    /// <summary>
+    /// Points the specified TrackVersion at the current version.
+    /// </summary>
+    void PersistentTrackClass::GetVersion(TrackVersion version)
+    {
+        version.Set(history[current].root, history[current].endOfTrackOffset);
+    }
+
+    /// <summary>
+    /// Gets the position in absolute ticks of the message at the specified
+    /// index in the current version.
+    /// </summary>
+    int PersistentTrackClass::GetPosition(int index)
+    {
+        REGION(Require)
+
+        RequireIndex(history[current].root, index);
+
+        ENDREGION()
+
+        return Locate(history[current].root, index).ticks;
+    }
+
+    /// <summary>
+    /// Gets the message at the specified index in the current version.
+    /// </summary>
+    IMidiMessage PersistentTrackClass::GetMessage(int index)
+    {
+        REGION(Require)
+
+        RequireIndex(history[current].root, index);
+
+        ENDREGION()
+
+        return *Locate(history[current].root, index).message;
+    }
+
+    /// <summary>
+    /// Finds the first message of the current version at or after the
+    /// specified position.
+    /// </summary>
+    int PersistentTrackClass::FindIndex(int position)
+    {
+        return CountBefore(history[current].root, position, false);
+    }
+
+    // Makes the specified tree the current version, dropping the versions
+    // that could have been redone.
+    void PersistentTrackClass::Commit(PersistentNode* root, int endOfTrackOffset)
+    {
+        while(history.Count > current + 1)
+        {
+            Release(history[history.Count - 1].root);
+
+            history.RemoveAt(history.Count - 1);
+        }
+
+        Version version;
+
+        version.root = root;
+        version.endOfTrackOffset = endOfTrackOffset;
+
+        history.Add(version);
+        current++;
+
+        if(undoLimit > 0 && current > undoLimit)
+        {
+            Release(history[0].root);
+
+            history.RemoveAt(0);
+            current--;
+        }
+    }
+
+    void PersistentTrackClass::ClearHistory()
+    {
+        for(int i = 0; i < history.Count; i++)
+        {
+            Release(history[i].root);
+        }
+
+        history.Clear();
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets the number of messages in the current version.
+    /// </summary>
+    int PersistentTrackClass::get_Count()
+    {
+        return history[current].root->count;
+    }
+
+    /// <summary>
+    /// Gets the length in ticks of the current version.
+    /// </summary>
+    int PersistentTrackClass::get_Length()
+    {
+        return GetLength(history[current].root, history[current].endOfTrackOffset);
+    }
+
+    /// <summary>
+    /// Gets or sets the end of track offset. Setting it to another value is
+    /// an edit.
+    /// </summary>
+    int PersistentTrackClass::get_EndOfTrackOffset()
+    {
+        return history[current].endOfTrackOffset;
+    }
+
+    void PersistentTrackClass::set_EndOfTrackOffset(int value)
+    {
+        REGION(Require)
+
+        if(value < 0)
+        {
+            throw new ArgumentOutOfRangeException("EndOfTrackOffset", value,
+                "End of track offset out of range.");
+        }
+
+        ENDREGION()
+
+        if(value != history[current].endOfTrackOffset)
+        {
+            PersistentNode* root = history[current].root;
+
+            AddRef(root);
+
+            Commit(root, value);
+        }
+    }
+
+    /// <summary>
+    /// Gets a value indicating whether there is an edit to undo.
+    /// </summary>
+    bool PersistentTrackClass::get_CanUndo()
+    {
+        return current > 0;
+    }
+
+    /// <summary>
+    /// Gets a value indicating whether there is an edit to redo.
+    /// </summary>
+    bool PersistentTrackClass::get_CanRedo()
+    {
+        return current < history.Count - 1;
+    }
+
+    /// <summary>
+    /// Gets or sets the most edits kept for undoing, or 0 to keep them all.
+    /// </summary>
+    int PersistentTrackClass::get_UndoLimit()
+    {
+        return undoLimit;
+    }
+
+    void PersistentTrackClass::set_UndoLimit(int value)
+    {
+        REGION(Require)
+
+        if(value < 0)
+        {
+            throw new ArgumentOutOfRangeException("UndoLimit", value,
+                "Undo limit out of range.");
+        }
+
+        ENDREGION()
+
+        undoLimit = value;
+
+        // Drops the oldest versions beyond the new limit.
+        int dropped = undoLimit > 0 && current > undoLimit ? current - undoLimit : 0;
+
+        for(int i = 0; i < dropped; i++)
+        {
+            Release(history[0].root);
+
+            history.RemoveAt(0);
+        }
+
+        current -= dropped;
+    }
+
+    ENDREGION()
+
+    ENDREGION()
+
+}}}
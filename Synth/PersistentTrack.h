@@ -0,0 +1,362 @@
+#ifndef PERSISTENTTRACK_H
+#define PERSISTENTTRACK_H
+
+#include "Types.h"
+#include "ArrayList.h"
+#include "Track.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    /// <summary>
+    /// Represents a message and its position in a version of a
+    /// PersistentTrack.
+    /// </summary>
+    struct TrackEntry
+    {
+        // The position in absolute ticks.
+        int ticks;
+
+        IMidiMessageIf* message;
+    };
+
+    // A node of the tree a version is kept in, defined where it is used.
+    struct PersistentNode;
+
+    class TrackVersionClass;
+    typedef TrackVersionClass& TrackVersion;
+
+    class PersistentTrackClass;
+    typedef PersistentTrackClass& PersistentTrack;
+
+    /// <summary>
+    /// Represents one version of a PersistentTrack, which never changes.
+    /// </summary>
+    /// <remarks>
+    /// A TrackVersion holds on to the chunks of the version, so it can be
+    /// read, for instance by playback, from another thread while the
+    /// PersistentTrack goes on being edited. A TrackVersion itself is used
+    /// by one thread at a time.
+    /// </remarks>
+    class TrackVersionClass
+    {
+        REGION(TrackVersion Members)
+
+        REGION(Fields)
+
+    private:
+
+        PersistentNode* root;
+
+        int endOfTrackOffset;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the TrackVersion class holding an
+        /// empty version.
+        /// </summary>
+        TrackVersionClass();
+
+        ~TrackVersionClass();
+
+    private:
+
+        TrackVersionClass(const TrackVersionClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Gets the position in absolute ticks of the message at the
+        /// specified index.
+        /// </summary>
+        int GetPosition(int index);
+
+        /// <summary>
+        /// Gets the message at the specified index.
+        /// </summary>
+        IMidiMessage GetMessage(int index);
+
+        /// <summary>
+        /// Copies a run of the messages and their positions.
+        /// </summary>
+        /// <param name="index">
+        /// The index of the first message to copy.
+        /// </param>
+        /// <param name="entries">
+        /// The array the messages are copied to.
+        /// </param>
+        /// <param name="count">
+        /// The most messages to copy.
+        /// </param>
+        /// <returns>
+        /// The number of messages copied, which is less than count only at
+        /// the end of the version.
+        /// </returns>
+        int GetEntries(int index, TrackEntry* entries, int count);
+
+        /// <summary>
+        /// Finds the first message at or after the specified position.
+        /// </summary>
+        /// <param name="position">
+        /// The position in absolute ticks.
+        /// </param>
+        /// <returns>
+        /// The index of the message, or Count if every message is before
+        /// the position.
+        /// </returns>
+        int FindIndex(int position);
+
+        /// <summary>
+        /// Replaces the MidiEvents of the specified Track with the messages
+        /// of the version.
+        /// </summary>
+        void CopyTo(Track track);
+
+    private:
+
+        // Holds on to the specified version instead of the current one.
+        void Set(PersistentNode* root, int endOfTrackOffset);
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets the number of messages in the version.
+        /// </summary>
+        ReadOnlyProperty<int> Count;
+
+        /// <summary>
+        /// Gets the length in ticks of the version, measured as the length
+        /// of a Track.
+        /// </summary>
+        ReadOnlyProperty<int> Length;
+
+        /// <summary>
+        /// Gets the end of track offset of the version.
+        /// </summary>
+        ReadOnlyProperty<int> EndOfTrackOffset;
+
+        ENDREGION()
+
+        ENDREGION()
+
+    private:
+        void init();
+        int get_Count();
+        int get_Length();
+        int get_EndOfTrackOffset();
+
+        friend class PersistentTrackClass;
+
+    };
+
+    /// <summary>
+    /// Represents a Track whose every edit makes a new version, sharing
+    /// what the edit left untouched with the version before it, so that
+    /// the edits can be undone and redone and any version can be kept.
+    /// </summary>
+    /// <remarks>
+    /// The messages of a version are kept in a B-tree ordered by position.
+    /// Its leaves are chunks of up to 64 messages, and each node knows how
+    /// many messages it holds and the position of its last one, so finding
+    /// a message by index or by position costs O(log n). Nodes are never
+    /// changed once made: an edit copies the chunk it changes and the
+    /// nodes on the way down to it, and the new version shares every other
+    /// node with the old one. An edit therefore costs O(log n) in time and
+    /// in memory, and keeping a version, undoing or redoing costs nothing
+    /// more. Nodes count their references and are deleted when no version
+    /// holds them any longer. Each leaf holds a reference in the shared
+    /// MessagePool to every pooled message in it, so a version keeps its
+    /// messages alive after the Track it was loaded from is released.
+    ///
+    /// A message inserted at a position goes after the messages already
+    /// there, as when recording. Every edit, including one to the end of
+    /// track offset, is one step of the history. The history is unlimited
+    /// unless an UndoLimit is set, and making an edit after undoing drops
+    /// the versions that could have been redone.
+    /// </remarks>
+    class PersistentTrackClass
+    {
+        REGION(PersistentTrack Members)
+
+        REGION(Fields)
+
+    private:
+
+        // A version of the history.
+        struct Version
+        {
+            PersistentNode* root;
+
+            int endOfTrackOffset;
+        };
+
+        ArrayList<Version> history;
+
+        // The index in the history of the current version.
+        int current;
+
+        int undoLimit;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the PersistentTrack class with an
+        /// empty Track as its only version.
+        /// </summary>
+        PersistentTrackClass();
+
+        ~PersistentTrackClass();
+
+    private:
+
+        PersistentTrackClass(const PersistentTrackClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Replaces the whole history with a version holding the MidiEvents
+        /// of the specified Track.
+        /// </summary>
+        void Load(Track track);
+
+        /// <summary>
+        /// Inserts an IMidiMessage at the specified position in absolute
+        /// ticks, after the messages already there.
+        /// </summary>
+        void Insert(int position, IMidiMessage message);
+
+        /// <summary>
+        /// Removes the message at the specified index.
+        /// </summary>
+        void RemoveAt(int index);
+
+        /// <summary>
+        /// Moves the message at the specified index to another position, as
+        /// a single edit.
+        /// </summary>
+        void Move(int index, int newPosition);
+
+        /// <summary>
+        /// Goes back to the version before the last edit.
+        /// </summary>
+        /// <returns>
+        /// <b>true</b> if there was an edit to undo; otherwise, <b>false</b>.
+        /// </returns>
+        bool Undo();
+
+        /// <summary>
+        /// Goes forward to the version of the last edit undone.
+        /// </summary>
+        /// <returns>
+        /// <b>true</b> if there was an edit to redo; otherwise, <b>false</b>.
+        /// </returns>
+        bool Redo();
+
+        /// <summary>
+        /// Points the specified TrackVersion at the current version.
+        /// </summary>
+        void GetVersion(TrackVersion version);
+
+        /// <summary>
+        /// Gets the position in absolute ticks of the message at the
+        /// specified index in the current version.
+        /// </summary>
+        int GetPosition(int index);
+
+        /// <summary>
+        /// Gets the message at the specified index in the current version.
+        /// </summary>
+        IMidiMessage GetMessage(int index);
+
+        /// <summary>
+        /// Finds the first message of the current version at or after the
+        /// specified position.
+        /// </summary>
+        int FindIndex(int position);
+
+    private:
+
+        // Makes the specified tree the current version, dropping the
+        // versions that could have been redone.
+        void Commit(PersistentNode* root, int endOfTrackOffset);
+
+        void ClearHistory();
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets the number of messages in the current version.
+        /// </summary>
+        ReadOnlyProperty<int> Count;
+
+        /// <summary>
+        /// Gets the length in ticks of the current version.
+        /// </summary>
+        ReadOnlyProperty<int> Length;
+
+        /// <summary>
+        /// Gets or sets the end of track offset. Setting it to another value
+        /// is an edit.
+        /// </summary>
+        Property<int> EndOfTrackOffset;
+
+        /// <summary>
+        /// Gets a value indicating whether there is an edit to undo.
+        /// </summary>
+        ReadOnlyProperty<bool> CanUndo;
+
+        /// <summary>
+        /// Gets a value indicating whether there is an edit to redo.
+        /// </summary>
+        ReadOnlyProperty<bool> CanRedo;
+
+        /// <summary>
+        /// Gets or sets the most edits kept for undoing, or 0 to keep them
+        /// all.
+        /// </summary>
+        Property<int> UndoLimit;
+
+        ENDREGION()
+
+        ENDREGION()
+
+    private:
+        void init();
+        int get_Count();
+        int get_Length();
+        int get_EndOfTrackOffset();
+        void set_EndOfTrackOffset(int value);
+        bool get_CanUndo();
+        bool get_CanRedo();
+        int get_UndoLimit();
+        void set_UndoLimit(int value);
+
+    };
+
+}}}
+
+#endif
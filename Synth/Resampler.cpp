@@ -0,0 +1,322 @@
+#include <math.h>
+#include <malloc.h>
+#include "Resampler.h"
+#include "SimdVector.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef ResamplerClass cls;
+
+    static const double Pi = 3.14159265358979323846;
+
+    // One frame in 32.32 fixed point.
+    static const double FixedOne = 4294967296.0;
+
+    static const float FractionScale = 1.0f / 4294967296.0f;
+
+    static const float PhaseScale = 1.0f / 16777216.0f;
+
+    // The cutoff of the sinc kernel as a fraction of the input rate, a
+    // little under half so the window's transition band stays below
+    // Nyquist.
+    static const double SincCutoff = 0.45;
+
+    void cls::init()
+    {
+        this->InstructionSet = Functor::New(this, &cls::get_InstructionSet, &cls::set_InstructionSet);
+        this->sincTable = nullptr;
+        this->sincDeltas = nullptr;
+        this->instructionSet = OscillatorBankClass::DetectInstructionSet();
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the Resampler class.
+    /// </summary>
+    ResamplerClass::ResamplerClass()
+    {
+        init();
+
+        // One row more than there are phases, so the last phase has a
+        // next one to interpolate towards: the first phase one frame on.
+        int rows = SincPhases + 1;
+
+        sincTable = (float*)_aligned_malloc(rows * SincTaps * sizeof(float), 32);
+        sincDeltas = (float*)_aligned_malloc(SincPhases * SincTaps * sizeof(float), 32);
+
+        for(int phase = 0; phase < rows; phase++)
+        {
+            float* row = sincTable + phase * SincTaps;
+            double fraction = (double)phase / SincPhases;
+            double sum = 0.0;
+
+            for(int tap = 0; tap < SincTaps; tap++)
+            {
+                double x = tap - Before - fraction;
+                double t = 2.0 * SincCutoff * x;
+                double h = x == 0.0 ? 2.0 * SincCutoff : sin(Pi * t) / (Pi * x);
+
+                // A Blackman window over the width of the kernel.
+                double w = x / (SincTaps / 2);
+                double window = fabs(w) >= 1.0 ? 0.0 :
+                    0.42 + 0.5 * cos(Pi * w) + 0.08 * cos(2.0 * Pi * w);
+
+                row[tap] = (float)(h * window);
+                sum += h * window;
+            }
+
+            // Every phase passes a constant signal unchanged.
+            for(int tap = 0; tap < SincTaps; tap++)
+            {
+                row[tap] = (float)(row[tap] / sum);
+            }
+        }
+
+        for(int i = 0; i < SincPhases * SincTaps; i++)
+        {
+            sincDeltas[i] = sincTable[i + SincTaps] - sincTable[i];
+        }
+    }
+
+    ResamplerClass::~ResamplerClass()
+    {
+        _aligned_free(sincTable);
+        _aligned_free(sincDeltas);
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Reads the input at evenly spaced positions.
+    /// </summary>
+    /// <param name="quality">
+    /// The kernel to use.
+    /// </param>
+    /// <param name="input">
+    /// The input frames. The kernels read from Before frames ahead of the
+    /// first position to After frames past the last.
+    /// </param>
+    /// <param name="position">
+    /// The position of the first output in frames.
+    /// </param>
+    /// <param name="increment">
+    /// The distance in frames between outputs.
+    /// </param>
+    /// <param name="output">
+    /// The buffer that receives the outputs, aligned for the widest
+    /// instruction set and with room for the count rounded up to a multiple
+    /// of eight.
+    /// </param>
+    /// <param name="count">
+    /// The number of outputs.
+    /// </param>
+    void ResamplerClass::Process(ResamplerQuality quality, const float* input, double position,
+        double increment, float* output, int count)
+    {
+        REGION(Require)
+
+        if(input == nullptr)
+        {
+            throw new ArgumentNullException("input");
+        }
+        else if(output == nullptr)
+        {
+            throw new ArgumentNullException("output");
+        }
+        else if(position < 0.0)
+        {
+            throw new ArgumentOutOfRangeException("position", (int)position,
+                "Position out of range.");
+        }
+
+        ENDREGION()
+
+        unsigned long long fixedPosition = (unsigned long long)(position * FixedOne);
+        unsigned long long fixedIncrement = (unsigned long long)(increment * FixedOne);
+
+        switch(instructionSet)
+        {
+            case InstructionSet::Avx2:
+                ProcessWith<Avx2Vector>(quality, input, fixedPosition, fixedIncrement,
+                    output, count);
+                break;
+
+            case InstructionSet::Sse2:
+                ProcessWith<Sse2Vector>(quality, input, fixedPosition, fixedIncrement,
+                    output, count);
+                break;
+
+            default:
+                ProcessWith<ScalarVector>(quality, input, fixedPosition, fixedIncrement,
+                    output, count);
+                break;
+        }
+    }
+
+    template<typename V>
+    void ResamplerClass::ProcessWith(ResamplerQuality quality, const float* input,
+        unsigned long long position, unsigned long long increment, float* output, int count)
+    {
+        switch(quality)
+        {
+            case ResamplerQuality::Linear:
+                ProcessLinear<V>(input, position, increment, output, count);
+                break;
+
+            case ResamplerQuality::Cubic:
+                ProcessCubic<V>(input, position, increment, output, count);
+                break;
+
+            default:
+                ProcessSinc<V>(input, position, increment, output, count);
+                break;
+        }
+
+        V::End();
+    }
+
+    // Works out the frame and fraction of the next vector of outputs. The
+    // lanes past the end repeat the last output so they only read frames
+    // the real outputs read.
+    template<typename V>
+    static void Step(unsigned long long& position, unsigned long long increment, int remaining,
+        int* indices, float* fractions)
+    {
+        int lanes = remaining < V::Width ? remaining : V::Width;
+
+        for(int lane = 0; lane < V::Width; lane++)
+        {
+            indices[lane] = (int)(position >> 32);
+            fractions[lane] = (float)(unsigned int)position * FractionScale;
+
+            if(lane + 1 < lanes)
+            {
+                position += increment;
+            }
+        }
+
+        position += increment;
+    }
+
+    template<typename V>
+    void ResamplerClass::ProcessLinear(const float* input, unsigned long long position,
+        unsigned long long increment, float* output, int count)
+    {
+        typedef typename V::Type Vector;
+
+        __declspec(align(32)) int indices[8];
+        __declspec(align(32)) float fractions[8];
+
+        for(int i = 0; i < count; i += V::Width)
+        {
+            Step<V>(position, increment, count - i, indices, fractions);
+
+            Vector a = V::Gather(input, indices);
+            Vector b = V::Gather(input + 1, indices);
+            Vector f = V::Load(fractions);
+
+            V::Store(output + i, V::Add(a, V::Mul(f, V::Sub(b, a))));
+        }
+    }
+
+    template<typename V>
+    void ResamplerClass::ProcessCubic(const float* input, unsigned long long position,
+        unsigned long long increment, float* output, int count)
+    {
+        typedef typename V::Type Vector;
+
+        __declspec(align(32)) int indices[8];
+        __declspec(align(32)) float fractions[8];
+
+        Vector half = V::Set(0.5f);
+        Vector oneHalf = V::Set(1.5f);
+        Vector two = V::Set(2.0f);
+        Vector twoHalf = V::Set(2.5f);
+
+        for(int i = 0; i < count; i += V::Width)
+        {
+            Step<V>(position, increment, count - i, indices, fractions);
+
+            Vector x0 = V::Gather(input - 1, indices);
+            Vector x1 = V::Gather(input, indices);
+            Vector x2 = V::Gather(input + 1, indices);
+            Vector x3 = V::Gather(input + 2, indices);
+            Vector f = V::Load(fractions);
+
+            // The Catmull-Rom form of the Hermite spline.
+            Vector c1 = V::Mul(half, V::Sub(x2, x0));
+            Vector c2 = V::Sub(V::Add(V::Sub(x0, V::Mul(twoHalf, x1)), V::Mul(two, x2)),
+                V::Mul(half, x3));
+            Vector c3 = V::Add(V::Mul(half, V::Sub(x3, x0)), V::Mul(oneHalf, V::Sub(x1, x2)));
+            Vector y = V::Add(V::Mul(V::Add(V::Mul(V::Add(V::Mul(c3, f), c2), f), c1), f), x1);
+
+            V::Store(output + i, y);
+        }
+    }
+
+    template<typename V>
+    void ResamplerClass::ProcessSinc(const float* input, unsigned long long position,
+        unsigned long long increment, float* output, int count)
+    {
+        typedef typename V::Type Vector;
+
+        for(int i = 0; i < count; i++)
+        {
+            // The top eight bits of the fraction pick the phase and the rest
+            // blend it with the next.
+            int index = (int)(position >> 32);
+            unsigned int fraction = (unsigned int)position;
+            int row = (int)(fraction >> 24);
+            Vector blend = V::Set((float)(fraction & 0xFFFFFF) * PhaseScale);
+            const float* frames = input + index - Before;
+            const float* coefficients = sincTable + row * SincTaps;
+            const float* deltas = sincDeltas + row * SincTaps;
+            Vector sum = V::Set(0.0f);
+
+            for(int tap = 0; tap < SincTaps; tap += V::Width)
+            {
+                Vector c = V::Add(V::Load(coefficients + tap),
+                    V::Mul(blend, V::Load(deltas + tap)));
+
+                sum = V::Add(sum, V::Mul(V::LoadUnaligned(frames + tap), c));
+            }
+
+            output[i] = V::Sum(sum);
+            position += increment;
+        }
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets or sets the instruction set used for resampling. It can be
+    /// lowered for testing but not raised above what the processor
+    /// supports.
+    /// </summary>
+    Midi::InstructionSet ResamplerClass::get_InstructionSet()
+    {
+        return instructionSet;
+    }
+    void ResamplerClass::set_InstructionSet(Midi::InstructionSet value)
+    {
+        REGION(Require)
+
+        if(value > OscillatorBankClass::DetectInstructionSet())
+        {
+            throw new ArgumentException("Instruction set not supported.", "InstructionSet");
+        }
+
+        ENDREGION()
+
+        instructionSet = value;
+    }
+
+    ENDREGION()
+
+}}}
@@ -0,0 +1,191 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include "Types.h"
+#include "OscillatorBank.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    /// <summary>
+    /// Defines constants representing the interpolation a Resampler uses,
+    /// from the cheapest to the best sounding.
+    /// </summary>
+    enum ResamplerQuality
+    {
+        /// <summary>
+        /// Interpolate linearly between two frames.
+        /// </summary>
+        Linear,
+
+        /// <summary>
+        /// Interpolate with a cubic Hermite spline through four frames.
+        /// </summary>
+        Cubic,
+
+        /// <summary>
+        /// Filter with a windowed sinc kernel over sixteen frames.
+        /// </summary>
+        Sinc
+    };
+
+    class ResamplerClass;
+    typedef ResamplerClass& Resampler;
+
+    /// <summary>
+    /// Reads a mono float signal at fractional positions.
+    /// </summary>
+    /// <remarks>
+    /// The linear and cubic kernels are vectorized across output samples:
+    /// the positions of four or eight outputs are worked out, the frames
+    /// around them gathered into registers, and the outputs interpolated
+    /// together. The sinc kernel is vectorized across its taps, with the
+    /// coefficients taken from a polyphase table computed once by the
+    /// constructor and interpolated between neighbouring phases. The
+    /// kernel is not widened when the signal is read faster than its rate,
+    /// so large upward transpositions alias as they do with the other
+    /// kernels.
+    ///
+    /// Positions are tracked in 32.32 fixed point so they do not drift
+    /// over a long block. The widest instruction set the processor
+    /// supports is chosen when the resampler is created.
+    /// </remarks>
+    class ResamplerClass
+    {
+        REGION(Resampler Members)
+
+        REGION(Constants)
+
+    public:
+
+        /// <summary>
+        /// The number of frames the sinc kernel reads for each output.
+        /// </summary>
+        static const int SincTaps = 16;
+
+        /// <summary>
+        /// The number of phases in the sinc table.
+        /// </summary>
+        static const int SincPhases = 256;
+
+        /// <summary>
+        /// The number of frames before the frame at a position that a
+        /// kernel may read.
+        /// </summary>
+        static const int Before = SincTaps / 2 - 1;
+
+        /// <summary>
+        /// The number of frames after the frame at a position that a
+        /// kernel may read.
+        /// </summary>
+        static const int After = SincTaps / 2;
+
+        ENDREGION()
+
+        REGION(Fields)
+
+    private:
+
+        // The coefficients of each phase, and the difference to the next
+        // phase, SincTaps to a row.
+        float* sincTable;
+
+        float* sincDeltas;
+
+        Midi::InstructionSet instructionSet;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the Resampler class.
+        /// </summary>
+        ResamplerClass();
+
+        ~ResamplerClass();
+
+    private:
+
+        ResamplerClass(const ResamplerClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Reads the input at evenly spaced positions.
+        /// </summary>
+        /// <param name="quality">
+        /// The kernel to use.
+        /// </param>
+        /// <param name="input">
+        /// The input frames. The kernels read from Before frames ahead of
+        /// the first position to After frames past the last.
+        /// </param>
+        /// <param name="position">
+        /// The position of the first output in frames.
+        /// </param>
+        /// <param name="increment">
+        /// The distance in frames between outputs.
+        /// </param>
+        /// <param name="output">
+        /// The buffer that receives the outputs, aligned for the widest
+        /// instruction set and with room for the count rounded up to a
+        /// multiple of eight.
+        /// </param>
+        /// <param name="count">
+        /// The number of outputs.
+        /// </param>
+        void Process(ResamplerQuality quality, const float* input, double position,
+            double increment, float* output, int count);
+
+    private:
+
+        template<typename V>
+        void ProcessWith(ResamplerQuality quality, const float* input,
+            unsigned long long position, unsigned long long increment, float* output,
+            int count);
+
+        template<typename V>
+        void ProcessLinear(const float* input, unsigned long long position,
+            unsigned long long increment, float* output, int count);
+
+        template<typename V>
+        void ProcessCubic(const float* input, unsigned long long position,
+            unsigned long long increment, float* output, int count);
+
+        template<typename V>
+        void ProcessSinc(const float* input, unsigned long long position,
+            unsigned long long increment, float* output, int count);
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets or sets the instruction set used for resampling. It can be
+        /// lowered for testing but not raised above what the processor
+        /// supports.
+        /// </summary>
+        Property<Midi::InstructionSet> InstructionSet;
+
+        ENDREGION()
+
+        ENDREGION()
+
+    private:
+        void init();
+        Midi::InstructionSet get_InstructionSet();
+        void set_InstructionSet(Midi::InstructionSet value);
+
+    };
+
+}}}
+
+#endif
@@ -0,0 +1,350 @@
+#include <math.h>
+#include <malloc.h>
+#include "Reverb.h"
+#include "SimdVector.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef ReverbClass cls;
+
+    // The line lengths in samples at 44.1 kHz, primes between 25 and 37
+    // milliseconds.
+    static const int BaseLengths[ReverbClass::LineCount] =
+    {
+        1109, 1187, 1277, 1361, 1423, 1493, 1559, 1619
+    };
+
+    static const int BaseRate = 44100;
+
+    // The gain of the input into the lines and of the lines into each
+    // output.
+    static const float InputGain = 0.35f;
+    static const float OutputGain = 0.5f;
+
+    // Added to every write so the tail settles on a tiny constant instead
+    // of decaying into the slow denormal range.
+    static const float Antidenormal = 1.0e-20f;
+
+    static float* AllocateFloats(int count)
+    {
+        float* result = (float*)_aligned_malloc(count * sizeof(float), 32);
+
+        for(int i = 0; i < count; i++)
+        {
+            result[i] = 0.0f;
+        }
+
+        return result;
+    }
+
+    void cls::init()
+    {
+        this->Time = Functor::New(this, &cls::get_Time, &cls::set_Time);
+        this->Damping = Functor::New(this, &cls::get_Damping, &cls::set_Damping);
+        this->InstructionSet = Functor::New(this, &cls::get_InstructionSet, &cls::set_InstructionSet);
+        this->buffer = nullptr;
+        this->mask = 0;
+        this->position = 0;
+        this->gains = nullptr;
+        this->lows = nullptr;
+        this->inputTaps = nullptr;
+        this->leftTaps = nullptr;
+        this->rightTaps = nullptr;
+        this->sampleRate = 0;
+        this->time = 2.0f;
+        this->damping = 0.3f;
+        this->instructionSet = OscillatorBankClass::DetectInstructionSet();
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the Reverb class with the specified
+    /// sample rate.
+    /// </summary>
+    ReverbClass::ReverbClass(int sampleRate)
+    {
+        init();
+
+        REGION(Require)
+
+        if(sampleRate <= 0)
+        {
+            throw new ArgumentOutOfRangeException("sampleRate", sampleRate,
+                "Sample rate out of range.");
+        }
+
+        ENDREGION()
+
+        this->sampleRate = sampleRate;
+
+        int longest = 0;
+
+        for(int i = 0; i < LineCount; i++)
+        {
+            lengths[i] = (int)((long long)BaseLengths[i] * sampleRate / BaseRate);
+
+            if(lengths[i] < 1)
+            {
+                lengths[i] = 1;
+            }
+
+            if(lengths[i] > longest)
+            {
+                longest = lengths[i];
+            }
+        }
+
+        int size = 1;
+
+        while(size <= longest)
+        {
+            size *= 2;
+        }
+
+        mask = size - 1;
+        buffer = AllocateFloats(size * LineCount);
+        gains = AllocateFloats(LineCount);
+        lows = AllocateFloats(LineCount);
+        inputTaps = AllocateFloats(LineCount);
+        leftTaps = AllocateFloats(LineCount);
+        rightTaps = AllocateFloats(LineCount);
+
+        // The input goes into every line with alternating signs; the even
+        // lines make the left output and the odd ones the right, so the
+        // two are decorrelated.
+        for(int i = 0; i < LineCount; i++)
+        {
+            float sign = (i / 2) % 2 == 0 ? 1.0f : -1.0f;
+
+            inputTaps[i] = i % 2 == 0 ? InputGain : -InputGain;
+            leftTaps[i] = i % 2 == 0 ? sign * OutputGain : 0.0f;
+            rightTaps[i] = i % 2 == 1 ? sign * OutputGain : 0.0f;
+        }
+
+        UpdateGains();
+    }
+
+    ReverbClass::~ReverbClass()
+    {
+        _aligned_free(buffer);
+        _aligned_free(gains);
+        _aligned_free(lows);
+        _aligned_free(inputTaps);
+        _aligned_free(leftTaps);
+        _aligned_free(rightTaps);
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Reverberates a send and adds the result to the buffers.
+    /// </summary>
+    /// <param name="input">
+    /// The send.
+    /// </param>
+    /// <param name="left">
+    /// The buffer the left channel is added to.
+    /// </param>
+    /// <param name="right">
+    /// The buffer the right channel is added to.
+    /// </param>
+    /// <param name="count">
+    /// The number of samples.
+    /// </param>
+    void ReverbClass::Process(const float* input, float* left, float* right, int count)
+    {
+        REGION(Require)
+
+        if(input == nullptr)
+        {
+            throw new ArgumentNullException("input");
+        }
+        else if(left == nullptr)
+        {
+            throw new ArgumentNullException("left");
+        }
+        else if(right == nullptr)
+        {
+            throw new ArgumentNullException("right");
+        }
+
+        ENDREGION()
+
+        switch(instructionSet)
+        {
+            case InstructionSet::Avx2:
+                ProcessWith<Avx2Vector>(input, left, right, count);
+                break;
+
+            case InstructionSet::Sse2:
+                ProcessWith<Sse2Vector>(input, left, right, count);
+                break;
+
+            default:
+                ProcessWith<ScalarVector>(input, left, right, count);
+                break;
+        }
+    }
+
+    /// <summary>
+    /// Silences the delay lines.
+    /// </summary>
+    void ReverbClass::Clear()
+    {
+        for(int i = 0; i < (mask + 1) * LineCount; i++)
+        {
+            buffer[i] = 0.0f;
+        }
+
+        for(int i = 0; i < LineCount; i++)
+        {
+            lows[i] = 0.0f;
+        }
+    }
+
+    template<typename V>
+    void ReverbClass::ProcessWith(const float* input, float* left, float* right, int count)
+    {
+        typedef typename V::Type Vector;
+
+        __declspec(align(32)) int indices[LineCount];
+
+        Vector damp = V::Set(damping);
+        Vector bias = V::Set(Antidenormal);
+
+        for(int i = 0; i < count; i++)
+        {
+            for(int line = 0; line < LineCount; line++)
+            {
+                indices[line] = ((position - lengths[line]) & mask) * LineCount + line;
+            }
+
+            float sum = 0.0f;
+            float l = 0.0f;
+            float r = 0.0f;
+
+            for(int line = 0; line < LineCount; line += V::Width)
+            {
+                Vector y = V::Gather(buffer, indices + line);
+                Vector low = V::Add(y, V::Mul(damp, V::Sub(V::Load(lows + line), y)));
+
+                V::Store(lows + line, low);
+
+                sum += V::Sum(low);
+                l += V::Sum(V::Mul(low, V::Load(leftTaps + line)));
+                r += V::Sum(V::Mul(low, V::Load(rightTaps + line)));
+            }
+
+            // The Householder matrix subtracts twice the mean from every
+            // line.
+            Vector mean = V::Set(sum * (2.0f / LineCount));
+            Vector x = V::Set(input[i]);
+            float* write = buffer + position * LineCount;
+
+            for(int line = 0; line < LineCount; line += V::Width)
+            {
+                Vector mixed = V::Sub(V::Load(lows + line), mean);
+                Vector value = V::Add(V::Mul(x, V::Load(inputTaps + line)),
+                    V::Mul(V::Load(gains + line), mixed));
+
+                V::Store(write + line, V::Add(value, bias));
+            }
+
+            left[i] += l;
+            right[i] += r;
+            position = (position + 1) & mask;
+        }
+
+        V::End();
+    }
+
+    void ReverbClass::UpdateGains()
+    {
+        for(int i = 0; i < LineCount; i++)
+        {
+            gains[i] = (float)pow(10.0, -3.0 * lengths[i] / (time * sampleRate));
+        }
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets or sets the time in seconds the reverberation takes to fall by
+    /// 60 dB.
+    /// </summary>
+    float ReverbClass::get_Time()
+    {
+        return time;
+    }
+    void ReverbClass::set_Time(float value)
+    {
+        REGION(Require)
+
+        if(!(value > 0.0f))
+        {
+            throw new ArgumentOutOfRangeException("Time", (int)value,
+                "Reverberation time out of range.");
+        }
+
+        ENDREGION()
+
+        time = value;
+
+        UpdateGains();
+    }
+
+    /// <summary>
+    /// Gets or sets how strongly high frequencies are damped, from zero for
+    /// not at all to just under one.
+    /// </summary>
+    float ReverbClass::get_Damping()
+    {
+        return damping;
+    }
+    void ReverbClass::set_Damping(float value)
+    {
+        REGION(Require)
+
+        if(!(value >= 0.0f && value < 1.0f))
+        {
+            throw new ArgumentOutOfRangeException("Damping", (int)value,
+                "Damping out of range.");
+        }
+
+        ENDREGION()
+
+        damping = value;
+    }
+
+    /// <summary>
+    /// Gets or sets the instruction set used for processing. It can be
+    /// lowered for testing but not raised above what the processor
+    /// supports.
+    /// </summary>
+    Midi::InstructionSet ReverbClass::get_InstructionSet()
+    {
+        return instructionSet;
+    }
+    void ReverbClass::set_InstructionSet(Midi::InstructionSet value)
+    {
+        REGION(Require)
+
+        if(value > OscillatorBankClass::DetectInstructionSet())
+        {
+            throw new ArgumentException("Instruction set not supported.", "InstructionSet");
+        }
+
+        ENDREGION()
+
+        instructionSet = value;
+    }
+
+    ENDREGION()
+
+}}}
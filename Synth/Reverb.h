@@ -0,0 +1,177 @@
+#ifndef REVERB_H
+#define REVERB_H
+
+#include "Types.h"
+#include "OscillatorBank.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    class ReverbClass;
+    typedef ReverbClass& Reverb;
+
+    /// <summary>
+    /// Adds a stereo reverberation of a mono send to a pair of buffers.
+    /// </summary>
+    /// <remarks>
+    /// The reverb is a feedback delay network of eight delay lines of
+    /// mutually prime lengths. Every sample the outputs of the lines are
+    /// damped by a one pole low-pass filter, mixed by a Householder matrix,
+    /// which is lossless and costs a single sum, scaled by the gain that
+    /// makes each line fall 60 dB in the reverberation time, and written
+    /// back together with the input. The lines are interleaved in one
+    /// buffer, so the eight writes of a sample are one store and the reads
+    /// one gather, and the lines are processed together with SIMD
+    /// instructions: eight at once with AVX2 or four with SSE2.
+    ///
+    /// The cost depends only on the number of samples processed, so a
+    /// Synthesizer sums the sends of all its voices and runs a single
+    /// reverb on the sum.
+    /// </remarks>
+    class ReverbClass
+    {
+        REGION(Reverb Members)
+
+        REGION(Constants)
+
+    public:
+
+        /// <summary>
+        /// The number of delay lines.
+        /// </summary>
+        static const int LineCount = 8;
+
+        ENDREGION()
+
+        REGION(Fields)
+
+    private:
+
+        // The lines, interleaved so the samples of every line for one
+        // position are together, the number of positions minus one, and
+        // the position written next.
+        float* buffer;
+
+        int mask;
+
+        int position;
+
+        // The length of each line in samples.
+        int lengths[LineCount];
+
+        // The feedback gain and filter state of each line, and the signs
+        // the input is written and the outputs read with. The arrays are
+        // aligned for the widest instruction set.
+        float* gains;
+
+        float* lows;
+
+        float* inputTaps;
+
+        float* leftTaps;
+
+        float* rightTaps;
+
+        int sampleRate;
+
+        float time;
+
+        float damping;
+
+        Midi::InstructionSet instructionSet;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the Reverb class with the
+        /// specified sample rate.
+        /// </summary>
+        ReverbClass(int sampleRate);
+
+        ~ReverbClass();
+
+    private:
+
+        ReverbClass(const ReverbClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Reverberates a send and adds the result to the buffers.
+        /// </summary>
+        /// <param name="input">
+        /// The send.
+        /// </param>
+        /// <param name="left">
+        /// The buffer the left channel is added to.
+        /// </param>
+        /// <param name="right">
+        /// The buffer the right channel is added to.
+        /// </param>
+        /// <param name="count">
+        /// The number of samples.
+        /// </param>
+        void Process(const float* input, float* left, float* right, int count);
+
+        /// <summary>
+        /// Silences the delay lines.
+        /// </summary>
+        void Clear();
+
+    private:
+
+        template<typename V>
+        void ProcessWith(const float* input, float* left, float* right, int count);
+
+        void UpdateGains();
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets or sets the time in seconds the reverberation takes to fall
+        /// by 60 dB.
+        /// </summary>
+        Property<float> Time;
+
+        /// <summary>
+        /// Gets or sets how strongly high frequencies are damped, from zero
+        /// for not at all to just under one.
+        /// </summary>
+        Property<float> Damping;
+
+        /// <summary>
+        /// Gets or sets the instruction set used for processing. It can be
+        /// lowered for testing but not raised above what the processor
+        /// supports.
+        /// </summary>
+        Property<Midi::InstructionSet> InstructionSet;
+
+        ENDREGION()
+
+        ENDREGION()
+
+    private:
+        void init();
+        float get_Time();
+        void set_Time(float value);
+        float get_Damping();
+        void set_Damping(float value);
+        Midi::InstructionSet get_InstructionSet();
+        void set_InstructionSet(Midi::InstructionSet value);
+
+    };
+
+}}}
+
+#endif
@@ -0,0 +1,615 @@
+#include <malloc.h>
+#include "SampleBank.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef SampleBankClass cls;
+
+    // Scales 16-bit samples to the range -1 to 1.
+    static const float SampleScale = 1.0f / 32768.0f;
+
+    void cls::init()
+    {
+        this->Capacity = Functor::New(this, &cls::get_Capacity);
+        this->slots = nullptr;
+        this->capacity = 0;
+        this->resampler = nullptr;
+        this->streamer = nullptr;
+        this->stage = nullptr;
+        this->mono = nullptr;
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the SampleBank class with the
+    /// specified number of slots.
+    /// </summary>
+    SampleBankClass::SampleBankClass(int capacity)
+    {
+        init();
+
+        REGION(Require)
+
+        if(capacity <= 0)
+        {
+            throw new ArgumentOutOfRangeException("capacity", capacity,
+                "Sample slot count out of range.");
+        }
+
+        ENDREGION()
+
+        this->capacity = capacity;
+        this->slots = new Slot[capacity];
+        this->resampler = new ResamplerClass();
+        this->stage = (float*)_aligned_malloc(StageSize * sizeof(float), 32);
+        this->mono = (float*)_aligned_malloc((ChunkSize + 8) * sizeof(float), 32);
+
+        for(int i = 0; i < capacity; i++)
+        {
+            slots[i].data = nullptr;
+            slots[i].end = 0;
+            slots[i].resident = 0;
+            slots[i].active = false;
+            Stop(i);
+        }
+    }
+
+    SampleBankClass::~SampleBankClass()
+    {
+        delete[] slots;
+        delete resampler;
+        _aligned_free(stage);
+        _aligned_free(mono);
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Starts playing a sample.
+    /// </summary>
+    /// <param name="slot">
+    /// The slot to play in.
+    /// </param>
+    /// <param name="data">
+    /// The sample data.
+    /// </param>
+    /// <param name="start">
+    /// The first frame to play.
+    /// </param>
+    /// <param name="end">
+    /// One past the last frame to play.
+    /// </param>
+    /// <param name="loopStart">
+    /// The first frame of the loop.
+    /// </param>
+    /// <param name="loopEnd">
+    /// One past the last frame of the loop.
+    /// </param>
+    /// <param name="looping">
+    /// Indicates whether the loop is played.
+    /// </param>
+    /// <param name="increment">
+    /// The number of frames advanced per output sample.
+    /// </param>
+    /// <param name="quality">
+    /// The interpolation used to read the sample.
+    /// </param>
+    void SampleBankClass::Start(int slot, const short* data, int start, int end, int loopStart,
+        int loopEnd, bool looping, float increment, ResamplerQuality quality)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Sample slot out of range.");
+        }
+        else if(data == nullptr)
+        {
+            throw new ArgumentNullException("data");
+        }
+        else if(start < 0 || end < start)
+        {
+            throw new ArgumentOutOfRangeException("end", end,
+                "Sample end out of range.");
+        }
+        else if(looping && (loopStart < start || loopEnd > end || loopEnd <= loopStart))
+        {
+            throw new ArgumentOutOfRangeException("loopEnd", loopEnd,
+                "Sample loop out of range.");
+        }
+
+        ENDREGION()
+
+        Slot& s = slots[slot];
+
+        if(s.resident < s.end && streamer != nullptr)
+        {
+            streamer->Stop(slot);
+        }
+
+        s.data = data;
+        s.start = start;
+        s.end = end;
+        s.resident = end;
+        s.loopStart = loopStart;
+        s.loopEnd = loopEnd;
+        s.looping = looping;
+        s.position = start;
+        s.fraction = 0.0;
+        s.increment = increment;
+        s.quality = quality;
+        s.active = start < end;
+    }
+
+    /// <summary>
+    /// Stops a slot.
+    /// </summary>
+    void SampleBankClass::Stop(int slot)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Sample slot out of range.");
+        }
+
+        ENDREGION()
+
+        Slot& s = slots[slot];
+
+        if(s.resident < s.end && streamer != nullptr)
+        {
+            streamer->Stop(slot);
+        }
+
+        s.active = false;
+        s.looping = false;
+        s.start = 0;
+        s.end = 0;
+        s.resident = 0;
+        s.position = 0;
+        s.fraction = 0.0;
+        s.increment = 0.0f;
+        s.quality = ResamplerQuality::Linear;
+        s.level = 0.0f;
+        s.step = 0.0f;
+        s.leftGain = 0.0f;
+        s.rightGain = 0.0f;
+        s.leftGainStep = 0.0f;
+        s.rightGainStep = 0.0f;
+        s.reverbGain = 0.0f;
+        s.chorusGain = 0.0f;
+        s.reverbGainStep = 0.0f;
+        s.chorusGainStep = 0.0f;
+    }
+
+    /// <summary>
+    /// Stops looping, so the sample plays on to its end.
+    /// </summary>
+    void SampleBankClass::EndLoop(int slot)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Sample slot out of range.");
+        }
+
+        ENDREGION()
+
+        slots[slot].looping = false;
+    }
+
+    /// <summary>
+    /// Sets the number of frames a slot advances per output sample.
+    /// </summary>
+    void SampleBankClass::SetIncrement(int slot, float increment)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Sample slot out of range.");
+        }
+
+        ENDREGION()
+
+        slots[slot].increment = increment;
+    }
+
+    /// <summary>
+    /// Sets the interpolation a slot is read with.
+    /// </summary>
+    void SampleBankClass::SetQuality(int slot, ResamplerQuality quality)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Sample slot out of range.");
+        }
+
+        ENDREGION()
+
+        slots[slot].quality = quality;
+    }
+
+    /// <summary>
+    /// Streams the frames of a started slot past those in its data.
+    /// </summary>
+    /// <param name="slot">
+    /// The slot.
+    /// </param>
+    /// <param name="frame">
+    /// The frame in the SoundFont's sample data of the slot's frame zero.
+    /// </param>
+    /// <param name="resident">
+    /// The number of frames in the slot's data.
+    /// </param>
+    void SampleBankClass::Stream(int slot, int frame, int resident)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Sample slot out of range.");
+        }
+        else if(streamer == nullptr)
+        {
+            throw new InvalidOperationException("The SampleBank has no SampleStreamer.");
+        }
+
+        ENDREGION()
+
+        Slot& s = slots[slot];
+
+        if(resident < s.start || resident >= s.end)
+        {
+            return;
+        }
+
+        s.resident = resident;
+
+        streamer->Start(slot, frame, resident, s.end, s.loopStart, s.loopEnd, s.looping);
+    }
+
+    /// <summary>
+    /// Sets the SampleStreamer that streaming slots read from, or nullptr.
+    /// Streaming slots are stopped.
+    /// </summary>
+    void SampleBankClass::SetStreamer(SampleStreamerClass* streamer)
+    {
+        for(int i = 0; i < capacity; i++)
+        {
+            if(slots[i].resident < slots[i].end)
+            {
+                Stop(i);
+            }
+        }
+
+        this->streamer = streamer;
+    }
+
+    /// <summary>
+    /// Sets the left and right gains of a slot and their change per sample.
+    /// </summary>
+    void SampleBankClass::SetGain(int slot, float left, float right, float leftStep,
+        float rightStep)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Sample slot out of range.");
+        }
+
+        ENDREGION()
+
+        slots[slot].leftGain = left;
+        slots[slot].rightGain = right;
+        slots[slot].leftGainStep = leftStep;
+        slots[slot].rightGainStep = rightStep;
+    }
+
+    /// <summary>
+    /// Sets the reverb and chorus send gains of a slot and their change per
+    /// sample.
+    /// </summary>
+    void SampleBankClass::SetSend(int slot, float reverb, float chorus, float reverbStep,
+        float chorusStep)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Sample slot out of range.");
+        }
+
+        ENDREGION()
+
+        slots[slot].reverbGain = reverb;
+        slots[slot].chorusGain = chorus;
+        slots[slot].reverbGainStep = reverbStep;
+        slots[slot].chorusGainStep = chorusStep;
+    }
+
+    /// <summary>
+    /// Sets the level of a slot and its change per sample.
+    /// </summary>
+    void SampleBankClass::SetLevel(int slot, float level, float step)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Sample slot out of range.");
+        }
+
+        ENDREGION()
+
+        slots[slot].level = level;
+        slots[slot].step = step;
+    }
+
+    /// <summary>
+    /// Gets the level of a slot.
+    /// </summary>
+    float SampleBankClass::GetLevel(int slot)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Sample slot out of range.");
+        }
+
+        ENDREGION()
+
+        return slots[slot].level;
+    }
+
+    /// <summary>
+    /// Indicates whether a slot is still playing; a slot that is not
+    /// looping stops by itself at the end of its sample.
+    /// </summary>
+    bool SampleBankClass::IsPlaying(int slot)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= capacity)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Sample slot out of range.");
+        }
+
+        ENDREGION()
+
+        return slots[slot].active;
+    }
+
+    /// <summary>
+    /// Renders the playing slots and adds them to the buffers.
+    /// </summary>
+    /// <param name="left">
+    /// The buffer the left channel is added to.
+    /// </param>
+    /// <param name="right">
+    /// The buffer the right channel is added to.
+    /// </param>
+    /// <param name="reverb">
+    /// The buffer the reverb send is added to.
+    /// </param>
+    /// <param name="chorus">
+    /// The buffer the chorus send is added to.
+    /// </param>
+    /// <param name="count">
+    /// The number of samples to render.
+    /// </param>
+    void SampleBankClass::Render(float* left, float* right, float* reverb, float* chorus,
+        int count)
+    {
+        for(int i = 0; i < capacity; i++)
+        {
+            if(slots[i].active)
+            {
+                RenderSlot(i, left, right, reverb, chorus, count);
+            }
+        }
+    }
+
+    void SampleBankClass::RenderSlot(int index, float* left, float* right, float* reverb,
+        float* chorus, int count)
+    {
+        Slot& slot = slots[index];
+        float increment = slot.increment;
+        float level = slot.level;
+        float leftGain = slot.leftGain;
+        float rightGain = slot.rightGain;
+        float reverbGain = slot.reverbGain;
+        float chorusGain = slot.chorusGain;
+
+        if(increment > MaxIncrement)
+        {
+            increment = (float)MaxIncrement;
+        }
+        else if(increment < 0.0f)
+        {
+            increment = 0.0f;
+        }
+
+        for(int offset = 0; offset < count && slot.active; offset += ChunkSize)
+        {
+            int n = count - offset < ChunkSize ? count - offset : ChunkSize;
+
+            // Past the end of a sample that does not loop there is nothing
+            // left to play.
+            if(!slot.looping && increment > 0.0f)
+            {
+                double remaining = (slot.end - slot.position - slot.fraction) / increment;
+
+                if(remaining < n)
+                {
+                    n = (int)remaining + (remaining > (int)remaining ? 1 : 0);
+                }
+            }
+
+            if(n <= 0)
+            {
+                slot.active = false;
+                break;
+            }
+
+            int span = (int)(slot.fraction + (double)(n - 1) * increment) + 1;
+
+            if(slot.resident < slot.end)
+            {
+                streamer->SetPosition(index, slot.position, slot.looping);
+            }
+
+            StageFrames(index, slot.position - ResamplerClass::Before,
+                ResamplerClass::Before + span + ResamplerClass::After);
+
+            resampler->Process(slot.quality, stage + ResamplerClass::Before, slot.fraction,
+                increment, mono, n);
+
+            float* l = left + offset;
+            float* r = right + offset;
+            float* rv = reverb + offset;
+            float* ch = chorus + offset;
+
+            for(int i = 0; i < n; i++)
+            {
+                float sample = mono[i] * level;
+
+                l[i] += sample * leftGain;
+                r[i] += sample * rightGain;
+                rv[i] += sample * reverbGain;
+                ch[i] += sample * chorusGain;
+
+                level += slot.step;
+                level = level < 0.0f ? 0.0f : level > 1.0f ? 1.0f : level;
+                leftGain += slot.leftGainStep;
+                rightGain += slot.rightGainStep;
+                reverbGain += slot.reverbGainStep;
+                chorusGain += slot.chorusGainStep;
+            }
+
+            double advance = slot.fraction + (double)n * increment;
+            int whole = (int)advance;
+
+            slot.position += whole;
+            slot.fraction = advance - whole;
+
+            if(slot.looping)
+            {
+                while(slot.position >= slot.loopEnd)
+                {
+                    slot.position -= slot.loopEnd - slot.loopStart;
+                }
+            }
+            else if(slot.position >= slot.end)
+            {
+                slot.active = false;
+            }
+        }
+
+        slot.level = level;
+        slot.leftGain = leftGain;
+        slot.rightGain = rightGain;
+        slot.reverbGain = reverbGain;
+        slot.chorusGain = chorusGain;
+    }
+
+    // Converts count frames from first on into the staging buffer, a run
+    // at a time. The frame after the last of the loop is the first of the
+    // loop, and outside the sample there is silence.
+    void SampleBankClass::StageFrames(int index, int first, int count)
+    {
+        const Slot& slot = slots[index];
+        int loopLength = slot.loopEnd - slot.loopStart;
+
+        for(int i = 0; i < count; )
+        {
+            int frame = first + i;
+            int run = count - i;
+            float* output = stage + i;
+
+            if(slot.looping && frame >= slot.loopEnd)
+            {
+                frame = slot.loopStart + (frame - slot.loopStart) % loopLength;
+            }
+
+            if(frame < slot.start || frame >= slot.end)
+            {
+                if(frame < slot.start && slot.start - frame < run)
+                {
+                    run = slot.start - frame;
+                }
+
+                for(int j = 0; j < run; j++)
+                {
+                    output[j] = 0.0f;
+                }
+            }
+            else
+            {
+                int limit = slot.looping ? slot.loopEnd : slot.end;
+
+                if(frame < slot.resident && slot.resident < limit)
+                {
+                    limit = slot.resident;
+                }
+
+                if(limit - frame < run)
+                {
+                    run = limit - frame;
+                }
+
+                if(frame < slot.resident)
+                {
+                    const short* data = slot.data + frame;
+
+                    for(int j = 0; j < run; j++)
+                    {
+                        output[j] = data[j] * SampleScale;
+                    }
+                }
+                else
+                {
+                    streamer->Read(index, frame, output, run);
+                }
+            }
+
+            i += run;
+        }
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets the number of slots.
+    /// </summary>
+    int SampleBankClass::get_Capacity()
+    {
+        return capacity;
+    }
+
+    ENDREGION()
+
+}}}
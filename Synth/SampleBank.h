@@ -0,0 +1,304 @@
+#ifndef SAMPLEBANK_H
+#define SAMPLEBANK_H
+
+#include "Types.h"
+#include "Resampler.h"
+#include "SampleStreamer.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    class SampleBankClass;
+    typedef SampleBankClass& SampleBank;
+
+    /// <summary>
+    /// Plays many 16-bit samples at once at arbitrary pitches.
+    /// </summary>
+    /// <remarks>
+    /// The counterpart of an OscillatorBank for sampled voices, with the
+    /// same slots, levels, gains and sends. Each slot reads its sample straight
+    /// from the memory it was given, typically a memory-mapped SoundFont,
+    /// so a sample is only brought into memory once a note plays it. The
+    /// position advances by the increment every output sample. A slot
+    /// either plays once and stops at the end of its sample, or loops; a
+    /// loop can be ended so the sample plays on to the end after the note
+    /// is released.
+    ///
+    /// Slots are rendered a chunk at a time: the frames a chunk reads are
+    /// converted to float into a staging buffer, with the loop unrolled and
+    /// silence past either end, and a Resampler reads them with the slot's
+    /// quality. Increments are limited to MaxIncrement, four octaves up.
+    ///
+    /// A slot can hold just the head of its sample and stream the rest.
+    /// Frames past the head are then copied from a SampleStreamer, which
+    /// the slot keeps informed of its position.
+    /// </remarks>
+    class SampleBankClass
+    {
+        REGION(SampleBank Members)
+
+        REGION(Constants)
+
+    public:
+
+        /// <summary>
+        /// The largest increment a slot plays at.
+        /// </summary>
+        static const int MaxIncrement = 16;
+
+    private:
+
+        // The number of outputs rendered from one staging of a slot.
+        static const int ChunkSize = 256;
+
+        static const int StageSize = ChunkSize * MaxIncrement +
+            ResamplerClass::Before + ResamplerClass::After + 2;
+
+        ENDREGION()
+
+        REGION(Fields)
+
+    private:
+
+        struct Slot
+        {
+            // The sample data, in frames from the start of data.
+            const short* data;
+
+            int start;
+
+            int end;
+
+            // The first frame not in data, which is streamed; end unless
+            // the slot streams.
+            int resident;
+
+            int loopStart;
+
+            int loopEnd;
+
+            // Indicates whether the slot wraps at loopEnd.
+            bool looping;
+
+            // The whole and fractional position, and the increment per
+            // output sample.
+            int position;
+
+            double fraction;
+
+            float increment;
+
+            ResamplerQuality quality;
+
+            float level;
+
+            float step;
+
+            float leftGain;
+
+            float rightGain;
+
+            float leftGainStep;
+
+            float rightGainStep;
+
+            float reverbGain;
+
+            float chorusGain;
+
+            float reverbGainStep;
+
+            float chorusGainStep;
+
+            bool active;
+        };
+
+        Slot* slots;
+
+        int capacity;
+
+        ResamplerClass* resampler;
+
+        SampleStreamerClass* streamer;
+
+        // The staged frames and the resampled output of a chunk.
+        float* stage;
+
+        float* mono;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the SampleBank class with the
+        /// specified number of slots.
+        /// </summary>
+        SampleBankClass(int capacity);
+
+        ~SampleBankClass();
+
+    private:
+
+        SampleBankClass(const SampleBankClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Starts playing a sample.
+        /// </summary>
+        /// <param name="slot">
+        /// The slot to play in.
+        /// </param>
+        /// <param name="data">
+        /// The sample data.
+        /// </param>
+        /// <param name="start">
+        /// The first frame to play.
+        /// </param>
+        /// <param name="end">
+        /// One past the last frame to play.
+        /// </param>
+        /// <param name="loopStart">
+        /// The first frame of the loop.
+        /// </param>
+        /// <param name="loopEnd">
+        /// One past the last frame of the loop.
+        /// </param>
+        /// <param name="looping">
+        /// Indicates whether the loop is played.
+        /// </param>
+        /// <param name="increment">
+        /// The number of frames advanced per output sample.
+        /// </param>
+        /// <param name="quality">
+        /// The interpolation used to read the sample.
+        /// </param>
+        void Start(int slot, const short* data, int start, int end, int loopStart,
+            int loopEnd, bool looping, float increment, ResamplerQuality quality);
+
+        /// <summary>
+        /// Stops a slot.
+        /// </summary>
+        void Stop(int slot);
+
+        /// <summary>
+        /// Stops looping, so the sample plays on to its end.
+        /// </summary>
+        void EndLoop(int slot);
+
+        /// <summary>
+        /// Sets the number of frames a slot advances per output sample.
+        /// </summary>
+        void SetIncrement(int slot, float increment);
+
+        /// <summary>
+        /// Sets the interpolation a slot is read with.
+        /// </summary>
+        void SetQuality(int slot, ResamplerQuality quality);
+
+        /// <summary>
+        /// Streams the frames of a started slot past those in its data.
+        /// </summary>
+        /// <param name="slot">
+        /// The slot.
+        /// </param>
+        /// <param name="frame">
+        /// The frame in the SoundFont's sample data of the slot's frame
+        /// zero.
+        /// </param>
+        /// <param name="resident">
+        /// The number of frames in the slot's data.
+        /// </param>
+        void Stream(int slot, int frame, int resident);
+
+        /// <summary>
+        /// Sets the SampleStreamer that streaming slots read from, or
+        /// nullptr. Streaming slots are stopped.
+        /// </summary>
+        void SetStreamer(SampleStreamerClass* streamer);
+
+        /// <summary>
+        /// Sets the left and right gains of a slot and their change per
+        /// sample.
+        /// </summary>
+        void SetGain(int slot, float left, float right, float leftStep, float rightStep);
+
+        /// <summary>
+        /// Sets the reverb and chorus send gains of a slot and their change
+        /// per sample.
+        /// </summary>
+        void SetSend(int slot, float reverb, float chorus, float reverbStep, float chorusStep);
+
+        /// <summary>
+        /// Sets the level of a slot and its change per sample.
+        /// </summary>
+        void SetLevel(int slot, float level, float step);
+
+        /// <summary>
+        /// Gets the level of a slot.
+        /// </summary>
+        float GetLevel(int slot);
+
+        /// <summary>
+        /// Indicates whether a slot is still playing; a slot that is not
+        /// looping stops by itself at the end of its sample.
+        /// </summary>
+        bool IsPlaying(int slot);
+
+        /// <summary>
+        /// Renders the playing slots and adds them to the buffers.
+        /// </summary>
+        /// <param name="left">
+        /// The buffer the left channel is added to.
+        /// </param>
+        /// <param name="right">
+        /// The buffer the right channel is added to.
+        /// </param>
+        /// <param name="reverb">
+        /// The buffer the reverb send is added to.
+        /// </param>
+        /// <param name="chorus">
+        /// The buffer the chorus send is added to.
+        /// </param>
+        /// <param name="count">
+        /// The number of samples to render.
+        /// </param>
+        void Render(float* left, float* right, float* reverb, float* chorus, int count);
+
+    private:
+
+        void RenderSlot(int index, float* left, float* right, float* reverb, float* chorus,
+            int count);
+
+        void StageFrames(int index, int first, int count);
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets the number of slots.
+        /// </summary>
+        ReadOnlyProperty<int> Capacity;
+
+        ENDREGION()
+
+        ENDREGION()
+
+    private:
+        void init();
+        int get_Capacity();
+
+    };
+
+}}}
+
+#endif
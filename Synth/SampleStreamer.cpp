@@ -0,0 +1,524 @@
+#include <windows.h>
+#include <process.h>
+#include "SampleStreamer.h"
+#include "Resampler.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef SampleStreamerClass cls;
+
+    // Scales 16-bit samples to the range -1 to 1.
+    static const float SampleScale = 1.0f / 32768.0f;
+
+    // How often the prefetch thread looks at the slots when nothing wakes
+    // it, and how long a blocking read waits for a block before giving up.
+    static const int PollMilliseconds = 10;
+    static const int WaitMilliseconds = 5000;
+
+    // The blocks of each slot read in the first pass over the slots, so
+    // every voice gets the block it needs next before any reads further
+    // ahead.
+    static const int UrgentBlocks = 2;
+
+    // A tag holds the low bits of the generation above the block number.
+    static const int BlockBits = 20;
+    static const long GenerationMask = 0x7FF;
+
+    static long MakeTag(long generation, int block)
+    {
+        return ((generation & GenerationMask) << BlockBits) | block;
+    }
+
+    void cls::init()
+    {
+        this->Underruns = Functor::New(this, &cls::get_Underruns);
+        this->Blocking = Functor::New(this, &cls::get_Blocking, &cls::set_Blocking);
+        this->soundFont = nullptr;
+        this->streams = nullptr;
+        this->slotCount = 0;
+        this->thread = nullptr;
+        this->wakeEvent = nullptr;
+        this->filledEvent = nullptr;
+        this->stopping = false;
+        this->underruns = 0;
+        this->blocking = false;
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the SampleStreamer class with the
+    /// specified SoundFont and number of slots.
+    /// </summary>
+    SampleStreamerClass::SampleStreamerClass(Midi::SoundFont soundFont, int slotCount)
+    {
+        init();
+
+        REGION(Require)
+
+        if(slotCount <= 0)
+        {
+            throw new ArgumentOutOfRangeException("slotCount", slotCount,
+                "Stream slot count out of range.");
+        }
+
+        ENDREGION()
+
+        this->soundFont = &soundFont;
+        this->slotCount = slotCount;
+        this->streams = new Stream[slotCount];
+
+        for(int i = 0; i < slotCount; i++)
+        {
+            Stream& stream = streams[i];
+
+            stream.generation = 0;
+            stream.active = 0;
+            stream.base = 0;
+            stream.resident = 0;
+            stream.end = 0;
+            stream.loopStart = 0;
+            stream.loopEnd = 0;
+            stream.position = 0;
+            stream.looping = 0;
+            stream.lastBlock = 0;
+            stream.data = new short[BlockCount * BlockFrames];
+            stream.underruns = 0;
+
+            for(int k = 0; k < BlockCount; k++)
+            {
+                stream.tags[k] = -1;
+            }
+        }
+
+        this->wakeEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        this->filledEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        this->thread = (void*)_beginthreadex(nullptr, 0, &ThreadProc, this, 0, nullptr);
+    }
+
+    SampleStreamerClass::~SampleStreamerClass()
+    {
+        stopping = true;
+
+        SetEvent(wakeEvent);
+        WaitForSingleObject(thread, INFINITE);
+
+        CloseHandle(thread);
+        CloseHandle(wakeEvent);
+        CloseHandle(filledEvent);
+
+        for(int i = 0; i < slotCount; i++)
+        {
+            delete[] streams[i].data;
+        }
+
+        delete[] streams;
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Starts streaming a sample into a slot and wakes the prefetch
+    /// thread.
+    /// </summary>
+    /// <param name="slot">
+    /// The slot to stream into.
+    /// </param>
+    /// <param name="frame">
+    /// The frame in the sample data of the slot's first frame. The other
+    /// frames are relative to it.
+    /// </param>
+    /// <param name="resident">
+    /// The first frame not held in memory by the caller.
+    /// </param>
+    /// <param name="end">
+    /// One past the last frame.
+    /// </param>
+    /// <param name="loopStart">
+    /// The first frame of the loop.
+    /// </param>
+    /// <param name="loopEnd">
+    /// One past the last frame of the loop.
+    /// </param>
+    /// <param name="looping">
+    /// Indicates whether the loop is played.
+    /// </param>
+    void SampleStreamerClass::Start(int slot, int frame, int resident, int end, int loopStart,
+        int loopEnd, bool looping)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= slotCount)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Stream slot out of range.");
+        }
+        else if(frame < 0 || end < 0 || frame > soundFont->SampleCount - end)
+        {
+            throw new ArgumentOutOfRangeException("end", end,
+                "Stream end out of range.");
+        }
+
+        ENDREGION()
+
+        Stream& stream = streams[slot];
+
+        // The prefetch thread skips the slot while it is inactive, and the
+        // new generation tells it that anything it was reading is stale.
+        InterlockedExchange(&stream.active, 0);
+        InterlockedIncrement(&stream.generation);
+
+        stream.base = frame;
+        stream.resident = resident;
+        stream.end = end;
+        stream.loopStart = loopStart;
+        stream.loopEnd = loopEnd;
+        stream.position = 0;
+        stream.looping = looping ? 1 : 0;
+        stream.lastBlock = 0;
+
+        InterlockedExchange(&stream.active, 1);
+
+        SetEvent(wakeEvent);
+    }
+
+    /// <summary>
+    /// Stops streaming into a slot.
+    /// </summary>
+    void SampleStreamerClass::Stop(int slot)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= slotCount)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Stream slot out of range.");
+        }
+
+        ENDREGION()
+
+        InterlockedExchange(&streams[slot].active, 0);
+    }
+
+    /// <summary>
+    /// Publishes the play position of a slot.
+    /// </summary>
+    void SampleStreamerClass::SetPosition(int slot, int position, bool looping)
+    {
+        Stream& stream = streams[slot];
+        int block = position / BlockFrames;
+
+        stream.position = position;
+        stream.looping = looping ? 1 : 0;
+
+        // Moving into another block frees one for the thread to read.
+        if(block != stream.lastBlock)
+        {
+            stream.lastBlock = block;
+
+            SetEvent(wakeEvent);
+        }
+    }
+
+    /// <summary>
+    /// Copies frames of a slot from the cache as floats from -1 to 1.
+    /// </summary>
+    /// <returns>
+    /// true if every frame was in the cache; otherwise, false, and the
+    /// missing frames are zero.
+    /// </returns>
+    bool SampleStreamerClass::Read(int slot, int frame, float* output, int count)
+    {
+        Stream& stream = streams[slot];
+        long generation = stream.generation;
+        bool complete = true;
+
+        while(count > 0)
+        {
+            int block = frame / BlockFrames;
+            int offset = frame - block * BlockFrames;
+            int run = BlockFrames - offset < count ? BlockFrames - offset : count;
+            long tag = MakeTag(generation, block);
+            int index = Find(stream, tag);
+
+            if(index < 0 && blocking)
+            {
+                index = WaitFor(stream, tag);
+            }
+
+            if(index >= 0)
+            {
+                const short* data = stream.data + index * BlockFrames + offset;
+
+                for(int i = 0; i < run; i++)
+                {
+                    output[i] = data[i] * SampleScale;
+                }
+
+                // The block may have been taken for another while it was
+                // copied.
+                MemoryBarrier();
+
+                if(stream.tags[index] != tag)
+                {
+                    index = -1;
+                }
+            }
+
+            if(index < 0)
+            {
+                for(int i = 0; i < run; i++)
+                {
+                    output[i] = 0.0f;
+                }
+
+                complete = false;
+            }
+
+            frame += run;
+            output += run;
+            count -= run;
+        }
+
+        if(!complete)
+        {
+            stream.underruns++;
+            InterlockedIncrement(&underruns);
+
+            SetEvent(wakeEvent);
+        }
+
+        return complete;
+    }
+
+    /// <summary>
+    /// Gets the number of underruns of a slot.
+    /// </summary>
+    int SampleStreamerClass::GetUnderruns(int slot)
+    {
+        REGION(Require)
+
+        if(slot < 0 || slot >= slotCount)
+        {
+            throw new ArgumentOutOfRangeException("slot", slot,
+                "Stream slot out of range.");
+        }
+
+        ENDREGION()
+
+        return streams[slot].underruns;
+    }
+
+    void SampleStreamerClass::Fill(int slot, int limit)
+    {
+        Stream& stream = streams[slot];
+        long generation = stream.generation;
+
+        if(stream.active == 0)
+        {
+            return;
+        }
+
+        int resident = stream.resident;
+        int end = stream.end;
+        int loopStart = stream.loopStart;
+        int loopEnd = stream.loopEnd;
+        int position = stream.position;
+        bool looping = stream.looping != 0;
+
+        // A Start between reading the generation and the fields would
+        // leave them mixed.
+        MemoryBarrier();
+
+        if(stream.generation != generation)
+        {
+            return;
+        }
+
+        // Work out the blocks the voice will read next, in the order it
+        // reads them, from just behind the position where the resampler
+        // still looks.
+        long wanted[BlockCount];
+        int wantedCount = 0;
+        int frame = position - ResamplerClass::Before;
+
+        if(frame < resident)
+        {
+            frame = resident;
+        }
+
+        for(int step = 0; step < 2 * BlockCount && wantedCount < BlockCount; step++)
+        {
+            if(looping && frame >= loopEnd)
+            {
+                frame = loopStart > resident ? loopStart : resident;
+
+                if(frame >= loopEnd)
+                {
+                    break;
+                }
+            }
+
+            if(frame >= end)
+            {
+                break;
+            }
+
+            int block = frame / BlockFrames;
+            long tag = MakeTag(generation, block);
+            bool seen = false;
+
+            for(int i = 0; i < wantedCount; i++)
+            {
+                seen = seen || wanted[i] == tag;
+            }
+
+            if(!seen)
+            {
+                wanted[wantedCount++] = tag;
+            }
+
+            frame = (block + 1) * BlockFrames;
+        }
+
+        // Only the nearest blocks are read, but every wanted block is kept.
+        for(int w = 0; w < wantedCount && w < limit; w++)
+        {
+            if(Find(stream, wanted[w]) >= 0)
+            {
+                continue;
+            }
+
+            // Reuse a block the voice no longer wants.
+            int victim = -1;
+
+            for(int k = 0; k < BlockCount && victim < 0; k++)
+            {
+                bool keep = false;
+
+                for(int i = 0; i < wantedCount; i++)
+                {
+                    keep = keep || stream.tags[k] == wanted[i];
+                }
+
+                if(!keep)
+                {
+                    victim = k;
+                }
+            }
+
+            if(victim < 0)
+            {
+                break;
+            }
+
+            int block = wanted[w] & ((1 << BlockBits) - 1);
+            int first = block * BlockFrames;
+            int frames = end - first < BlockFrames ? end - first : BlockFrames;
+            short* data = stream.data + victim * BlockFrames;
+
+            InterlockedExchange(&stream.tags[victim], -1);
+
+            // A block that cannot be read plays as silence rather than
+            // leaving a blocking voice waiting for it.
+            if(!soundFont->ReadSamples(stream.base + first, data, frames))
+            {
+                for(int i = 0; i < frames; i++)
+                {
+                    data[i] = 0;
+                }
+            }
+
+            if(stream.generation != generation)
+            {
+                return;
+            }
+
+            InterlockedExchange(&stream.tags[victim], wanted[w]);
+
+            SetEvent(filledEvent);
+        }
+    }
+
+    int SampleStreamerClass::Find(const Stream& stream, long tag)
+    {
+        for(int k = 0; k < BlockCount; k++)
+        {
+            if(stream.tags[k] == tag)
+            {
+                return k;
+            }
+        }
+
+        return -1;
+    }
+
+    int SampleStreamerClass::WaitFor(const Stream& stream, long tag)
+    {
+        DWORD started = GetTickCount();
+        int index = -1;
+
+        while(index < 0 && GetTickCount() - started < (DWORD)WaitMilliseconds)
+        {
+            SetEvent(wakeEvent);
+            WaitForSingleObject(filledEvent, PollMilliseconds);
+
+            index = Find(stream, tag);
+        }
+
+        return index;
+    }
+
+    unsigned int __stdcall SampleStreamerClass::ThreadProc(void* argument)
+    {
+        SampleStreamerClass* streamer = (SampleStreamerClass*)argument;
+
+        while(!streamer->stopping)
+        {
+            WaitForSingleObject(streamer->wakeEvent, PollMilliseconds);
+
+            for(int i = 0; i < streamer->slotCount && !streamer->stopping; i++)
+            {
+                streamer->Fill(i, UrgentBlocks);
+            }
+
+            for(int i = 0; i < streamer->slotCount && !streamer->stopping; i++)
+            {
+                streamer->Fill(i, BlockCount);
+            }
+        }
+
+        return 0;
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets the number of reads that found a block missing.
+    /// </summary>
+    int SampleStreamerClass::get_Underruns()
+    {
+        return underruns;
+    }
+
+    /// <summary>
+    /// Gets or sets a value indicating whether Read waits for missing blocks
+    /// instead of returning silence.
+    /// </summary>
+    bool SampleStreamerClass::get_Blocking()
+    {
+        return blocking;
+    }
+    void SampleStreamerClass::set_Blocking(bool value)
+    {
+        blocking = value;
+    }
+
+    ENDREGION()
+
+}}}
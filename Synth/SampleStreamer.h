@@ -0,0 +1,236 @@
+#ifndef SAMPLESTREAMER_H
+#define SAMPLESTREAMER_H
+
+#include "Types.h"
+#include "SoundFont.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    class SampleStreamerClass;
+    typedef SampleStreamerClass& SampleStreamer;
+
+    /// <summary>
+    /// Reads the samples of a streamed SoundFont ahead of the voices
+    /// playing them.
+    /// </summary>
+    /// <remarks>
+    /// Each slot, one per voice, has a small cache of fixed size blocks of
+    /// sample data. When a slot starts, normally as a NoteOn starts a
+    /// voice on the head of a sample, a background thread is woken to read
+    /// the blocks past the head. From then on the voice publishes its
+    /// position as it plays, and the thread keeps the blocks ahead of it
+    /// read, following the loop if the voice is looping, while the blocks
+    /// the voice has left behind are reused.
+    ///
+    /// The voice reads the cache without locking. Each block carries a tag
+    /// naming the block and the note it was read for; the thread clears
+    /// the tag before it overwrites a block, and the voice checks the tag
+    /// before and after copying. A block that is missing or was overwritten
+    /// while it was copied is an underrun: the voice plays silence for it
+    /// and the underrun is counted. With Blocking set, the voice waits for
+    /// the block instead, which offline rendering uses so its output does
+    /// not depend on the speed of the disk.
+    /// </remarks>
+    class SampleStreamerClass
+    {
+        REGION(SampleStreamer Members)
+
+        REGION(Constants)
+
+    public:
+
+        /// <summary>
+        /// The number of frames in a block.
+        /// </summary>
+        static const int BlockFrames = 4096;
+
+        /// <summary>
+        /// The number of blocks cached for each slot.
+        /// </summary>
+        static const int BlockCount = 8;
+
+        ENDREGION()
+
+        REGION(Fields)
+
+    private:
+
+        struct Stream
+        {
+            // The generation of the note playing, incremented by every
+            // Start so blocks read for an earlier note are not used.
+            volatile long generation;
+
+            volatile long active;
+
+            // The sample data frame of the slot's first frame, the first
+            // frame not in the head, the end and the loop.
+            int base;
+
+            int resident;
+
+            int end;
+
+            int loopStart;
+
+            int loopEnd;
+
+            // The play position and loop state published by the voice.
+            volatile long position;
+
+            volatile long looping;
+
+            // The block the position was in when last published.
+            int lastBlock;
+
+            // The tag of each cached block, or -1 for none, and the data.
+            volatile long tags[BlockCount];
+
+            short* data;
+
+            int underruns;
+        };
+
+        SoundFontClass* soundFont;
+
+        Stream* streams;
+
+        int slotCount;
+
+        // The prefetch thread, the event that wakes it and the event it
+        // sets after reading a block.
+        void* thread;
+
+        void* wakeEvent;
+
+        void* filledEvent;
+
+        volatile bool stopping;
+
+        volatile long underruns;
+
+        bool blocking;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the SampleStreamer class with the
+        /// specified SoundFont and number of slots.
+        /// </summary>
+        SampleStreamerClass(Midi::SoundFont soundFont, int slotCount);
+
+        ~SampleStreamerClass();
+
+    private:
+
+        SampleStreamerClass(const SampleStreamerClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Starts streaming a sample into a slot and wakes the prefetch
+        /// thread.
+        /// </summary>
+        /// <param name="slot">
+        /// The slot to stream into.
+        /// </param>
+        /// <param name="frame">
+        /// The frame in the sample data of the slot's first frame. The
+        /// other frames are relative to it.
+        /// </param>
+        /// <param name="resident">
+        /// The first frame not held in memory by the caller.
+        /// </param>
+        /// <param name="end">
+        /// One past the last frame.
+        /// </param>
+        /// <param name="loopStart">
+        /// The first frame of the loop.
+        /// </param>
+        /// <param name="loopEnd">
+        /// One past the last frame of the loop.
+        /// </param>
+        /// <param name="looping">
+        /// Indicates whether the loop is played.
+        /// </param>
+        void Start(int slot, int frame, int resident, int end, int loopStart, int loopEnd,
+            bool looping);
+
+        /// <summary>
+        /// Stops streaming into a slot.
+        /// </summary>
+        void Stop(int slot);
+
+        /// <summary>
+        /// Publishes the play position of a slot.
+        /// </summary>
+        void SetPosition(int slot, int position, bool looping);
+
+        /// <summary>
+        /// Copies frames of a slot from the cache as floats from -1 to 1.
+        /// </summary>
+        /// <returns>
+        /// true if every frame was in the cache; otherwise, false, and the
+        /// missing frames are zero.
+        /// </returns>
+        bool Read(int slot, int frame, float* output, int count);
+
+        /// <summary>
+        /// Gets the number of underruns of a slot.
+        /// </summary>
+        int GetUnderruns(int slot);
+
+    private:
+
+        // Reads the missing blocks of a slot among the specified number
+        // nearest its position.
+        void Fill(int slot, int limit);
+
+        // Finds the cached block with a tag, or returns -1.
+        int Find(const Stream& stream, long tag);
+
+        // Waits for the prefetch thread to read a block.
+        int WaitFor(const Stream& stream, long tag);
+
+        static unsigned int __stdcall ThreadProc(void* argument);
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets the number of reads that found a block missing.
+        /// </summary>
+        ReadOnlyProperty<int> Underruns;
+
+        /// <summary>
+        /// Gets or sets a value indicating whether Read waits for missing
+        /// blocks instead of returning silence.
+        /// </summary>
+        Property<bool> Blocking;
+
+        ENDREGION()
+
+        ENDREGION()
+
+    private:
+        void init();
+        int get_Underruns();
+        bool get_Blocking();
+        void set_Blocking(bool value);
+
+    };
+
+}}}
+
+#endif
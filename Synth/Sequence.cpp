@@ -36,6 +36,7 @@
 #include "Exception.h"
 #include "Stream.h"
 #include "TrackReader.h" 
+#include "PpqnClock.h"
 
 namespace Sanford { namespace Multimedia { namespace Midi {
     
@@ -43,7 +44,12 @@ namespace Sanford { namespace Multimedia { namespace Midi {
     void cls::init() 
     {
         this->tracks = List<Track>();
+        this->TempoMap = Functor::New(this, &cls::get_TempoMap);
+        this->PostingsEnabled = Functor::New(this, &cls::get_PostingsEnabled, &cls::set_PostingsEnabled);
+        this->InterningEnabled = Functor::New(this, &cls::get_InterningEnabled, &cls::set_InterningEnabled);
 		this->disposed = false;
+        this->postingsEnabled = false;
+        this->interningEnabled = false;
 	}
 
     REGION(Construction)
@@ -52,7 +58,8 @@ namespace Sanford { namespace Multimedia { namespace Midi {
     /// Initializes a new instance of the Sequence class.
     /// </summary>
     SequenceClass::SequenceClass() :
-		properties(MidiFilePropertiesClass()), loadWorker(BackgroundWorkerClass()), saveWorker(BackgroundWorkerClass()), site(objectClass())
+		properties(MidiFilePropertiesClass()), loadWorker(BackgroundWorkerClass()), saveWorker(BackgroundWorkerClass()), site(objectClass()),
+		tempoMap(PpqnClockClass::PpqnMinValue)
     {
 		init();
         InitializeBackgroundWorkers();
@@ -65,11 +72,13 @@ namespace Sanford { namespace Multimedia { namespace Midi {
     /// The Sequence's division value.
     /// </param>
     SequenceClass::SequenceClass(int division) :
-		properties(MidiFilePropertiesClass()), loadWorker(BackgroundWorkerClass()), saveWorker(BackgroundWorkerClass()), site(objectClass())
+		properties(MidiFilePropertiesClass()), loadWorker(BackgroundWorkerClass()), saveWorker(BackgroundWorkerClass()), site(objectClass()),
+		tempoMap(PpqnClockClass::PpqnMinValue)
     {
 		init();
         properties.Division = division;
         properties.Format = 1;
+        tempoMap.Division = division;
 
         InitializeBackgroundWorkers();
     }
@@ -82,7 +91,8 @@ namespace Sanford { namespace Multimedia { namespace Midi {
     /// The name of the MIDI file to load.
     /// </param>
     SequenceClass::SequenceClass(string fileName) :
-		properties(MidiFilePropertiesClass()), loadWorker(BackgroundWorkerClass()), saveWorker(BackgroundWorkerClass()), site(objectClass())
+		properties(MidiFilePropertiesClass()), loadWorker(BackgroundWorkerClass()), saveWorker(BackgroundWorkerClass()), site(objectClass()),
+		tempoMap(PpqnClockClass::PpqnMinValue)
     {
 		init();
         InitializeBackgroundWorkers();
@@ -90,6 +100,13 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         Load(fileName);
     }
 
+    SequenceClass::~SequenceClass()
+    {
+        // The Tracks may outlive the Sequence, so they must not be left
+        // notifying its TempoMap and SequenceLength.
+        DetachTracks();
+    }
+
     void SequenceClass::InitializeBackgroundWorkers()
     {
         loadWorker.DoWork += DoWorkEventHandler(EventFunctor::New(this, &cls::LoadDoWork));
@@ -103,6 +120,12 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         saveWorker.WorkerReportsProgress = true;
     }        
 
+    void SequenceClass::DetachTracks()
+    {
+        tempoMap.Clear();
+        sequenceLength.Clear();
+    }
+
     ENDREGION()
 
     REGION(Methods)
@@ -142,6 +165,9 @@ namespace Sanford { namespace Multimedia { namespace Midi {
             TrackReader reader = TrackReaderClass();
             List<Track> newTracks = List<Track>();
 
+            reader.PostingsEnabled = postingsEnabled;
+            reader.InterningEnabled = interningEnabled;
+
             newProperties.Read(stream);
 
             for(int i = 0; i < newProperties.TrackCount; i++)
@@ -150,8 +176,13 @@ namespace Sanford { namespace Multimedia { namespace Midi {
                 newTracks.Add(reader.Track);
             }
 
+            DetachTracks();
+
             properties = newProperties;
             tracks = newTracks;
+
+            tempoMap.Build(*this);
+            sequenceLength.Build(*this);
         }
 
         REGION(Ensure)
@@ -283,7 +314,8 @@ namespace Sanford { namespace Multimedia { namespace Midi {
     /// </returns>
     /// <remarks>
     /// The length in ticks of the Sequence is represented by the Track 
-    /// with the longest length.
+    /// with the longest length. It is kept as the Tracks are edited, so
+    /// getting it does not visit every Track.
     /// </remarks>
     int SequenceClass::GetLength()
     {
@@ -296,19 +328,55 @@ namespace Sanford { namespace Multimedia { namespace Midi {
 
         ENDREGION()
 
-        int length = 0;
+        return sequenceLength.Length;
+    }
 
-		List<Track>::iterator it = this->GetIterator();
-        for(it = it.begin(); it != it.end(); it++)
+    /// <summary>
+    /// Gets the length in seconds of the Sequence.
+    /// </summary>
+    /// <returns>
+    /// The length in seconds of the Sequence, converted with the TempoMap.
+    /// </returns>
+    double SequenceClass::GetLengthInSeconds()
+    {
+        REGION(Require)
+
+        if(disposed)
         {
-			Track t = (Track)it;
-            if(t.Length > length)
-            {
-                length = t.Length;
-            }
+            throw new ObjectDisposedException("Sequence");
         }
 
-        return length;
+        ENDREGION()
+
+        return tempoMap.TicksToSeconds(sequenceLength.Length);
+    }
+
+    /// <summary>
+    /// Positions an EventRange on the MidiEvents of every Track within the
+    /// specified range.
+    /// </summary>
+    /// <param name="start">
+    /// The position in absolute ticks of the start of the range.
+    /// </param>
+    /// <param name="end">
+    /// The position in absolute ticks of the end of the range, which is not
+    /// part of it.
+    /// </param>
+    /// <param name="range">
+    /// The EventRange to position. Its filters are kept.
+    /// </param>
+    void SequenceClass::GetRange(int start, int end, EventRange range)
+    {
+        REGION(Require)
+
+        if(disposed)
+        {
+            throw new ObjectDisposedException("Sequence");
+        }
+
+        ENDREGION()
+
+        range.Reset(*this, start, end);
     }
 
     void SequenceClass::OnLoadCompleted(object sender, RunWorkerCompletedEventArgs e)
@@ -345,6 +413,9 @@ namespace Sanford { namespace Multimedia { namespace Midi {
             TrackReader reader = TrackReaderClass();
             List<Track> newTracks = List<Track>();
 
+            reader.PostingsEnabled = postingsEnabled;
+            reader.InterningEnabled = interningEnabled;
+
             newProperties.Read(stream);
 
             float percentage;
@@ -365,8 +436,13 @@ namespace Sanford { namespace Multimedia { namespace Midi {
             }
             else
             {
+                DetachTracks();
+
                 properties = newProperties;
                 tracks = newTracks;
+
+                tempoMap.Build(*this);
+                sequenceLength.Build(*this);
             }
         }            
     }
@@ -525,11 +601,62 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         return properties.SequenceType;
     }
 
+    /// <summary>
+    /// Gets the TempoMap built from the Sequence's tempo changes.
+    /// </summary>
+    TempoMap SequenceClass::get_TempoMap()
+    {
+        REGION(Require)
+
+        if(disposed)
+        {
+            throw new ObjectDisposedException("Sequence");
+        }
+
+        ENDREGION()
+
+        return tempoMap;
+    }
+
 	bool SequenceClass::get_IsBusy()
     {
         return loadWorker.IsBusy || saveWorker.IsBusy;
     }
 
+    /// <summary>
+    /// Gets or sets a value indicating whether the Tracks keep lists of
+    /// their MidiEvents by channel and message type. When set before
+    /// loading, the lists are built while the Tracks are parsed.
+    /// </summary>
+    bool SequenceClass::get_PostingsEnabled()
+    {
+        return postingsEnabled;
+    }
+    void SequenceClass::set_PostingsEnabled(bool value)
+    {
+        postingsEnabled = value;
+
+		List<Track>::iterator it = this->GetIterator();
+        for(it = it.begin(); it != it.end(); it++)
+        {
+            ((Track)it).PostingsEnabled = value;
+        }
+    }
+
+    /// <summary>
+    /// Gets or sets a value indicating whether loading takes the
+    /// MetaMessages and SysExMessages from the shared MessagePool, so that
+    /// equal payloads across Sequences share one message.
+    /// </summary>
+    bool SequenceClass::get_InterningEnabled()
+    {
+        return interningEnabled;
+    }
+    void SequenceClass::set_InterningEnabled(bool value)
+    {
+        interningEnabled = value;
+    }
+
     ENDREGION()
 
     ENDREGION()
@@ -552,6 +679,13 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         ENDREGION()
 
         tracks.Add(item);
+        tempoMap.AddTrack(item);
+        sequenceLength.AddTrack(item);
+
+        if(postingsEnabled)
+        {
+            item.PostingsEnabled = true;
+        }
 
         properties.TrackCount = tracks.Count;
     }
@@ -567,6 +701,7 @@ namespace Sanford { namespace Multimedia { namespace Midi {
 
         ENDREGION()
 
+        DetachTracks();
         tracks.Clear();
 
         properties.TrackCount = tracks.Count;
@@ -643,6 +778,8 @@ namespace Sanford { namespace Multimedia { namespace Midi {
 
         if(result)
         {
+            tempoMap.RemoveTrack(item);
+            sequenceLength.RemoveTrack(item);
             properties.TrackCount = tracks.Count;
         }
 
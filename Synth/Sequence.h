@@ -37,6 +37,9 @@
 
 #include "Types.h"
 #include "Track.h"
+#include "TempoMap.h"
+#include "SequenceLength.h"
+#include "EventRange.h"
 #include "MidiFileProperties.h"
 #include "List.h"
 #include "Event.h"
@@ -68,6 +71,12 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         // The Sequence's MIDI file properties.
         MidiFileProperties properties;
 
+        // The tick to time conversions for the Sequence's tempo changes.
+        TempoMapClass tempoMap;
+
+        // The length of the longest Track, kept as the Tracks are edited.
+        SequenceLengthClass sequenceLength;
+
         BackgroundWorker loadWorker;
 
         BackgroundWorker saveWorker;
@@ -76,6 +85,13 @@ namespace Sanford { namespace Multimedia { namespace Midi {
 
         bool disposed;
 
+        // Indicates whether the Tracks keep EventPostings.
+        bool postingsEnabled;
+
+        // Indicates whether loading takes MetaMessages and SysExMessages
+        // from the shared MessagePool.
+        bool interningEnabled;
+
         ENDREGION()
 
         REGION(Events)
@@ -118,10 +134,16 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         /// </param>
         SequenceClass(string fileName);
 
+        ~SequenceClass();
+
 	private:
 		
 		void InitializeBackgroundWorkers();
 
+        // Stops the TempoMap and the SequenceLength from following the
+        // current Tracks.
+        void DetachTracks();
+
         ENDREGION()
 
         REGION(Methods)
@@ -160,10 +182,36 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         /// </returns>
         /// <remarks>
         /// The length in ticks of the Sequence is represented by the Track 
-        /// with the longest length.
+        /// with the longest length. It is kept as the Tracks are edited, so
+        /// getting it does not visit every Track.
         /// </remarks>
         int GetLength();
 
+        /// <summary>
+        /// Gets the length in seconds of the Sequence.
+        /// </summary>
+        /// <returns>
+        /// The length in seconds of the Sequence, converted with the
+        /// TempoMap.
+        /// </returns>
+        double GetLengthInSeconds();
+
+        /// <summary>
+        /// Positions an EventRange on the MidiEvents of every Track within
+        /// the specified range.
+        /// </summary>
+        /// <param name="start">
+        /// The position in absolute ticks of the start of the range.
+        /// </param>
+        /// <param name="end">
+        /// The position in absolute ticks of the end of the range, which is
+        /// not part of it.
+        /// </param>
+        /// <param name="range">
+        /// The EventRange to position. Its filters are kept.
+        /// </param>
+        void GetRange(int start, int end, EventRange range);
+
 	private:
 
         void OnLoadCompleted(object sender, RunWorkerCompletedEventArgs e);
@@ -210,6 +258,25 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         /// </summary>
         ReadOnlyProperty<Midi::SequenceType> SequenceType;
 
+        /// <summary>
+        /// Gets the TempoMap built from the Sequence's tempo changes.
+        /// </summary>
+        ReadOnlyProperty<Midi::TempoMap> TempoMap;
+
+        /// <summary>
+        /// Gets or sets a value indicating whether the Tracks keep lists of
+        /// their MidiEvents by channel and message type. When set before
+        /// loading, the lists are built while the Tracks are parsed.
+        /// </summary>
+        Property<bool> PostingsEnabled;
+
+        /// <summary>
+        /// Gets or sets a value indicating whether loading takes the
+        /// MetaMessages and SysExMessages from the shared MessagePool, so
+        /// that equal payloads across Sequences share one message.
+        /// </summary>
+        Property<bool> InterningEnabled;
+
         ReadOnlyProperty<bool> IsBusy;
 
         ENDREGION()
@@ -269,14 +336,18 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         ENDREGION()
 
 	private:
-		~SequenceClass();
 		void init();
 		int get_Division();
 		void set_Division(int value);
         int get_Format();
         void set_Format(int value);
         Midi::SequenceType get_SequenceType();
+        Midi::TempoMap get_TempoMap();
         bool get_IsBusy();
+        bool get_PostingsEnabled();
+        void set_PostingsEnabled(bool value);
+        bool get_InterningEnabled();
+        void set_InterningEnabled(bool value);
 		int get_Count();
         bool get_IsReadOnly();
 		ISite get_Site();
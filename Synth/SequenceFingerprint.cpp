@@ -0,0 +1,542 @@
+#include <windows.h>
+#include "SequenceFingerprint.h"
+#include "Sequence.h"
+#include "TempoMap.h"
+#include "PpqnClock.h"
+#include "MetaMessage.h"
+#include "SysExMessage.h"
+#include "SysCommonMessage.h"
+#include "SysRealtimeMessage.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef SequenceFingerprintClass cls;
+
+    // The value tempo changes are hashed with, above every channel
+    // message.
+    static const int TempoElement = 0x1000000;
+
+    // The splitmix64 finalizer, which spreads every bit of its input over
+    // the whole result.
+    static unsigned long long Mix(unsigned long long value)
+    {
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+
+        return value ^ (value >> 31);
+    }
+
+    static MidiEventClass* Next(MidiEventClass* e)
+    {
+        MidiEvent next = e->Next;
+
+        return next != MidiEventClass::null ? &next : nullptr;
+    }
+
+    static int ReadInt(const unsigned char* data, int size)
+    {
+        int result = 0;
+
+        for(int i = 0; i < size; i++)
+        {
+            result = (result << 8) | data[i];
+        }
+
+        return result;
+    }
+
+    static bool IsChunk(const unsigned char* data, const char* id)
+    {
+        return data[0] == id[0] && data[1] == id[1] && data[2] == id[2] && data[3] == id[3];
+    }
+
+    void cls::init()
+    {
+        this->division = PpqnClockClass::PpqnMinValue;
+        this->sum = 0;
+        this->count = 0;
+        this->fileData = nullptr;
+        this->fileCapacity = 0;
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the SequenceFingerprint class.
+    /// </summary>
+    SequenceFingerprintClass::SequenceFingerprintClass()
+    {
+        init();
+    }
+
+    SequenceFingerprintClass::~SequenceFingerprintClass()
+    {
+        delete[] fileData;
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Computes the fingerprint of the specified Sequence.
+    /// </summary>
+    /// <param name="sequence">
+    /// The Sequence to fingerprint.
+    /// </param>
+    /// <returns>
+    /// The fingerprint of the Sequence's musical content.
+    /// </returns>
+    long long SequenceFingerprintClass::Compute(Sequence sequence)
+    {
+        Begin(sequence.Division);
+
+        List<Track>::iterator it = sequence.GetIterator();
+        for(it = it.begin(); it != it.end(); it++)
+        {
+            Track track = (Track)it;
+
+            BeginTrack();
+
+            MidiEventClass* current = track.Count > 1 ? &track.GetMidiEvent(0) : nullptr;
+
+            for( ; current != nullptr; current = Next(current))
+            {
+                MidiEvent e = *current;
+                IMidiMessage message = e.MidiMessage;
+
+                if(message.MessageType == MessageType::Channel)
+                {
+                    int packed = ((ChannelMessage)message).Message;
+
+                    AddChannelMessage(e.AbsoluteTicks,
+                        ChannelMessageClass::UnpackStatus(packed),
+                        ChannelMessageClass::UnpackData1(packed),
+                        ChannelMessageClass::UnpackData2(packed));
+                }
+                else if(TempoMapClass::IsTempoMessage(message))
+                {
+                    AddTempo(e.AbsoluteTicks, TempoMapClass::UnpackTempo((MetaMessage)message));
+                }
+            }
+
+            EndTrack(track.Length);
+        }
+
+        return End();
+    }
+
+    /// <summary>
+    /// Computes the fingerprint of a MIDI file held in memory.
+    /// </summary>
+    /// <param name="data">
+    /// The bytes of the MIDI file.
+    /// </param>
+    /// <param name="length">
+    /// The number of bytes.
+    /// </param>
+    /// <returns>
+    /// The fingerprint of the file's musical content, the same as that of
+    /// the Sequence loaded from it.
+    /// </returns>
+    long long SequenceFingerprintClass::Compute(const unsigned char* data, int length)
+    {
+        REGION(Require)
+
+        if(data == nullptr)
+        {
+            throw new ArgumentNullException("data");
+        }
+        else if(length < 0)
+        {
+            throw new ArgumentOutOfRangeException("length", length,
+                "Length out of range.");
+        }
+
+        ENDREGION()
+
+        // The header is looked for the way MidiFileProperties does, so a
+        // file wrapped in another format is read the same.
+        int index = 0;
+
+        while(index + 14 <= length && !IsChunk(data + index, "MThd"))
+        {
+            index++;
+        }
+
+        if(index + 14 > length)
+        {
+            throw new MidiFileException("Unable to find MIDI file header.");
+        }
+
+        int headerLength = ReadInt(data + index + 4, 4);
+        int trackCount = ReadInt(data + index + 10, 2);
+
+        Begin(ReadInt(data + index + 12, 2));
+
+        if(headerLength < 6 || headerLength > length - index - 8)
+        {
+            throw new MidiFileException("Unable to find MIDI file header.");
+        }
+
+        index += 8 + headerLength;
+
+        // Chunks that are not tracks are skipped over by their length.
+        for(int i = 0; i < trackCount; )
+        {
+            if(index + 8 > length)
+            {
+                throw new MidiFileException("Unable to find track in MIDI file.");
+            }
+
+            int chunkLength = ReadInt(data + index + 4, 4);
+
+            if(chunkLength < 0 || chunkLength > length - index - 8)
+            {
+                throw new MidiFileException("End of MIDI file unexpectedly reached.");
+            }
+
+            if(IsChunk(data + index, "MTrk"))
+            {
+                AddTrackData(data + index + 8, chunkLength);
+                i++;
+            }
+
+            index += 8 + chunkLength;
+        }
+
+        return End();
+    }
+
+    /// <summary>
+    /// Computes the fingerprint of the specified MIDI file.
+    /// </summary>
+    /// <param name="fileName">
+    /// The name of the MIDI file.
+    /// </param>
+    /// <returns>
+    /// The fingerprint of the file's musical content, the same as that of
+    /// the Sequence loaded from it.
+    /// </returns>
+    long long SequenceFingerprintClass::ComputeFile(string fileName)
+    {
+        REGION(Require)
+
+        if(fileName == nullptr)
+        {
+            throw new ArgumentNullException("fileName");
+        }
+
+        ENDREGION()
+
+        HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+        if(file == INVALID_HANDLE_VALUE)
+        {
+            throw new MidiFileException("Unable to open MIDI file.");
+        }
+
+        LARGE_INTEGER size;
+
+        if(!GetFileSizeEx(file, &size) || size.QuadPart > 0x7FFFFFFF)
+        {
+            CloseHandle(file);
+
+            throw new MidiFileException("Unable to read MIDI file.");
+        }
+
+        int length = (int)size.QuadPart;
+
+        // MIDI files are small, so reading one whole is cheaper than
+        // mapping it.
+        if(fileData == nullptr || length > fileCapacity)
+        {
+            delete[] fileData;
+
+            fileData = new unsigned char[length];
+            fileCapacity = length;
+        }
+
+        DWORD read = 0;
+        bool succeeded = length == 0 ||
+            (ReadFile(file, fileData, (DWORD)length, &read, nullptr) && read == (DWORD)length);
+
+        CloseHandle(file);
+
+        if(!succeeded)
+        {
+            throw new MidiFileException("Unable to read MIDI file.");
+        }
+
+        return Compute(fileData, length);
+    }
+
+    void SequenceFingerprintClass::Begin(int division)
+    {
+        this->division = division;
+        sum = 0;
+        count = 0;
+    }
+
+    void SequenceFingerprintClass::BeginTrack()
+    {
+        for(int i = 0; i < KeyCount; i++)
+        {
+            first[i] = -1;
+        }
+
+        pending.Clear();
+    }
+
+    void SequenceFingerprintClass::AddChannelMessage(int ticks, int status, int data1, int data2)
+    {
+        ChannelCommand command = ChannelMessageClass::UnpackCommand(status);
+        int key = ChannelMessageClass::UnpackMidiChannel(status) *
+            (ChannelMessageClass::DataMaxValue + 1) + data1;
+
+        if(command == ChannelCommand::NoteOn && data2 > 0)
+        {
+            PendingNote note;
+
+            note.start = ticks;
+            note.velocity = data2;
+            note.next = -1;
+
+            if(first[key] < 0)
+            {
+                first[key] = pending.Count;
+            }
+            else
+            {
+                pending[last[key]].next = pending.Count;
+            }
+
+            last[key] = pending.Count;
+            pending.Add(note);
+        }
+        else if(command == ChannelCommand::NoteOff || command == ChannelCommand::NoteOn)
+        {
+            // Notes are matched first in, first out, as NoteIndex does. A
+            // NoteOff without a NoteOn is left out.
+            if(first[key] >= 0)
+            {
+                const PendingNote& note = pending[first[key]];
+
+                AddElement(note.start, ticks, (status | 0x10) << 16 | data1 << 8 | note.velocity);
+
+                first[key] = note.next;
+            }
+        }
+        else
+        {
+            // The builder keeps the second data byte of the previous
+            // message, so it is not part of one with a single data byte.
+            if(ChannelMessageClass::DataBytesPerType(command) == 1)
+            {
+                data2 = 0;
+            }
+
+            AddElement(ticks, ticks, status << 16 | data1 << 8 | data2);
+        }
+    }
+
+    void SequenceFingerprintClass::AddTempo(int ticks, int tempo)
+    {
+        AddElement(ticks, ticks, TempoElement | tempo);
+    }
+
+    void SequenceFingerprintClass::EndTrack(int ticks)
+    {
+        for(int key = 0; key < KeyCount; key++)
+        {
+            for(int i = first[key]; i >= 0; i = pending[i].next)
+            {
+                int status = (int)ChannelCommand::NoteOn |
+                    key / (ChannelMessageClass::DataMaxValue + 1);
+                int pitch = key % (ChannelMessageClass::DataMaxValue + 1);
+
+                AddElement(pending[i].start, ticks, status << 16 | pitch << 8 | pending[i].velocity);
+            }
+        }
+    }
+
+    long long SequenceFingerprintClass::End()
+    {
+        return (long long)Mix(sum ^ Mix((unsigned long long)count + 1));
+    }
+
+    void SequenceFingerprintClass::AddElement(int ticks, int endTicks, int value)
+    {
+        int start = Scale(ticks);
+        int length = Scale(endTicks) - start;
+        unsigned long long position = (unsigned long long)(unsigned int)start << 32 |
+            (unsigned int)length;
+
+        // Summing keeps the fingerprint the same whatever the order the
+        // elements are added in.
+        sum += Mix(position ^ Mix((unsigned long long)value));
+        count++;
+    }
+
+    void SequenceFingerprintClass::AddTrackData(const unsigned char* data, int length)
+    {
+        // The events are read as TrackReader reads them, without making
+        // any messages.
+        int index = 0;
+        int ticks = 0;
+        int runningStatus = 0;
+
+        // The Track read ends at its last event plus the offset of the
+        // EndOfTrack message, as TrackReader sets it.
+        int lastTicks = 0;
+        int endOffset = 0;
+
+        BeginTrack();
+
+        while(index < length)
+        {
+            int previousTicks = ticks;
+            int delta = 0;
+            int b;
+
+            do
+            {
+                if(index >= length)
+                {
+                    throw new MidiFileException("End of track unexpectedly reached.");
+                }
+
+                b = data[index++];
+                delta = (delta << 7) | (b & 0x7F);
+            }while((b & 0x80) == 0x80);
+
+            ticks += delta;
+
+            if(index >= length)
+            {
+                throw new MidiFileException("End of track unexpectedly reached.");
+            }
+
+            int status = runningStatus;
+
+            if((data[index] & 0x80) == 0x80)
+            {
+                status = data[index++];
+            }
+
+            if(status >= (int)ChannelCommand::NoteOff && status < 0xF0)
+            {
+                int bytes = ChannelMessageClass::DataBytesPerType(
+                    ChannelMessageClass::UnpackCommand(status));
+
+                if(index + bytes > length)
+                {
+                    throw new MidiFileException("End of track unexpectedly reached.");
+                }
+
+                AddChannelMessage(ticks, status, data[index] & 0x7F,
+                    bytes == 2 ? data[index + 1] & 0x7F : 0);
+
+                index += bytes;
+                runningStatus = status;
+                lastTicks = ticks;
+            }
+            else if(status == 0xFF || status == (int)SysExType::Start ||
+                status == (int)SysExType::Continuation)
+            {
+                int type = -1;
+
+                if(status == 0xFF)
+                {
+                    if(index + 1 >= length)
+                    {
+                        throw new MidiFileException("End of track unexpectedly reached.");
+                    }
+
+                    type = data[index++];
+                }
+                else
+                {
+                    // System exclusive cancels running status.
+                    runningStatus = 0;
+                }
+
+                int dataLength = 0;
+
+                do
+                {
+                    if(index >= length)
+                    {
+                        throw new MidiFileException("End of track unexpectedly reached.");
+                    }
+
+                    b = data[index++];
+                    dataLength = (dataLength << 7) | (b & 0x7F);
+                }while((b & 0x80) == 0x80);
+
+                if(dataLength > length - index)
+                {
+                    throw new MidiFileException("End of track unexpectedly reached.");
+                }
+
+                if(type == (int)MetaType::EndOfTrack)
+                {
+                    endOffset = ticks - previousTicks;
+                }
+                else
+                {
+                    if(type == (int)MetaType::Tempo && dataLength == MetaMessageClass::TempoLength)
+                    {
+                        AddTempo(ticks, ReadInt(data + index, 3));
+                    }
+
+                    lastTicks = ticks;
+                }
+
+                index += dataLength;
+            }
+            else if(status >= (int)SysCommonType::MidiTimeCode &&
+                status <= (int)SysCommonType::TuneRequest)
+            {
+                // System common cancels running status.
+                runningStatus = 0;
+
+                if(status == (int)SysCommonType::SongPositionPointer)
+                {
+                    index += 2;
+                }
+                else if(status == (int)SysCommonType::MidiTimeCode ||
+                    status == (int)SysCommonType::SongSelect)
+                {
+                    index++;
+                }
+
+                lastTicks = ticks;
+            }
+            else if(status >= (int)SysRealtimeType::Clock &&
+                status <= (int)SysRealtimeType::Reset)
+            {
+                lastTicks = ticks;
+            }
+        }
+
+        EndTrack(lastTicks + endOffset);
+    }
+
+    int SequenceFingerprintClass::Scale(int ticks)
+    {
+        // SMPTE divisions count time rather than beats, so their positions
+        // are kept as they are.
+        if(division <= 0 || (division & 0x8000) != 0)
+        {
+            return ticks;
+        }
+
+        return (int)((long long)ticks * CanonicalDivision / division);
+    }
+
+    ENDREGION()
+
+}}}
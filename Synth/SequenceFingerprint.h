@@ -0,0 +1,204 @@
+#ifndef SEQUENCEFINGERPRINT_H
+#define SEQUENCEFINGERPRINT_H
+
+#include "Types.h"
+#include "ArrayList.h"
+#include "ChannelMessage.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    class SequenceClass;
+    typedef SequenceClass& Sequence;
+
+    class SequenceFingerprintClass;
+    typedef SequenceFingerprintClass& SequenceFingerprint;
+
+    /// <summary>
+    /// Computes a fingerprint of the musical content of a Sequence or of a
+    /// MIDI file, for finding copies of the same song.
+    /// </summary>
+    /// <remarks>
+    /// The fingerprint covers the notes, as spans with a channel, pitch,
+    /// velocity, start and length, the other channel messages and the
+    /// tempo changes. Text, SysEx and every other MetaMessage are left
+    /// out, as is how the file encodes the content: running status, NoteOn
+    /// messages with a velocity of zero in place of NoteOffs, the order of
+    /// the chunks and how the messages are spread over Tracks, as long as
+    /// notes on the same channel and pitch do not overlap across Tracks,
+    /// where the NoteOffs could pair up differently once merged. Positions
+    /// are scaled to a common division, so a song saved at a different
+    /// resolution without losing any timing gets the same fingerprint.
+    ///
+    /// Each of those elements is hashed on its own and the hashes are
+    /// summed, so the fingerprint is computed in a single pass over the
+    /// messages in any order. Files can be fingerprinted straight from
+    /// their bytes, which never makes any Tracks, and gives the same
+    /// fingerprint as the Sequence loaded from them. The hash is fast but
+    /// not cryptographic, so it will not hold against a file made to
+    /// collide with another.
+    ///
+    /// A SequenceFingerprint keeps its working memory between uses, so
+    /// fingerprinting many files through one instance allocates nothing
+    /// once it has seen the largest of them. An instance is used by one
+    /// thread at a time.
+    /// </remarks>
+    class SequenceFingerprintClass
+    {
+        REGION(SequenceFingerprint Members)
+
+        REGION(Constants)
+
+    public:
+
+        /// <summary>
+        /// The division positions are scaled to.
+        /// </summary>
+        static const int CanonicalDivision = 960;
+
+    private:
+
+        // The number of channel and pitch pairs notes are matched by.
+        static const int KeyCount = (ChannelMessageClass::MidiChannelMaxValue + 1) *
+            (ChannelMessageClass::DataMaxValue + 1);
+
+        ENDREGION()
+
+        REGION(Fields)
+
+    private:
+
+        // A note still waiting for its NoteOff, with the next note queued
+        // on the same channel and pitch.
+        struct PendingNote
+        {
+            int start;
+            int velocity;
+            int next;
+        };
+
+        ArrayList<PendingNote> pending;
+
+        // The first and last pending notes of each channel and pitch, or
+        // -1 when none is waiting.
+        int first[KeyCount];
+
+        int last[KeyCount];
+
+        // The division of the Sequence or file being fingerprinted.
+        int division;
+
+        // The sum of the hashes of the elements, and how many there are.
+        unsigned long long sum;
+
+        int count;
+
+        // The bytes of the last file read.
+        unsigned char* fileData;
+
+        int fileCapacity;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the SequenceFingerprint class.
+        /// </summary>
+        SequenceFingerprintClass();
+
+        ~SequenceFingerprintClass();
+
+    private:
+
+        SequenceFingerprintClass(const SequenceFingerprintClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Computes the fingerprint of the specified Sequence.
+        /// </summary>
+        /// <param name="sequence">
+        /// The Sequence to fingerprint.
+        /// </param>
+        /// <returns>
+        /// The fingerprint of the Sequence's musical content.
+        /// </returns>
+        long long Compute(Sequence sequence);
+
+        /// <summary>
+        /// Computes the fingerprint of a MIDI file held in memory.
+        /// </summary>
+        /// <param name="data">
+        /// The bytes of the MIDI file.
+        /// </param>
+        /// <param name="length">
+        /// The number of bytes.
+        /// </param>
+        /// <returns>
+        /// The fingerprint of the file's musical content, the same as that
+        /// of the Sequence loaded from it.
+        /// </returns>
+        /// <exception cref="MidiFileException">
+        /// The file is not a valid MIDI file.
+        /// </exception>
+        long long Compute(const unsigned char* data, int length);
+
+        /// <summary>
+        /// Computes the fingerprint of the specified MIDI file.
+        /// </summary>
+        /// <param name="fileName">
+        /// The name of the MIDI file.
+        /// </param>
+        /// <returns>
+        /// The fingerprint of the file's musical content, the same as that
+        /// of the Sequence loaded from it.
+        /// </returns>
+        /// <exception cref="MidiFileException">
+        /// The file cannot be read or is not a valid MIDI file.
+        /// </exception>
+        long long ComputeFile(string fileName);
+
+    private:
+
+        // Starts a fingerprint of content with the specified division.
+        void Begin(int division);
+
+        void BeginTrack();
+
+        // Adds a channel message read at the specified position.
+        void AddChannelMessage(int ticks, int status, int data1, int data2);
+
+        void AddTempo(int ticks, int tempo);
+
+        // Ends the notes still sounding at the end of a Track.
+        void EndTrack(int ticks);
+
+        long long End();
+
+        // Adds an element lasting from one position to another.
+        void AddElement(int ticks, int endTicks, int value);
+
+        // Parses the events of a track chunk.
+        void AddTrackData(const unsigned char* data, int length);
+
+        // Scales a position to the canonical division.
+        int Scale(int ticks);
+
+        ENDREGION()
+
+        ENDREGION()
+
+    private:
+        void init();
+
+    };
+
+}}}
+
+#endif
@@ -0,0 +1,232 @@
+#include "SequenceLength.h"
+#include "Sequence.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef SequenceLengthClass cls;
+
+    void cls::init()
+    {
+        this->Length = Functor::New(this, &cls::get_Length);
+        this->length = 0;
+        this->stale = false;
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the SequenceLength class.
+    /// </summary>
+    SequenceLengthClass::SequenceLengthClass()
+    {
+        init();
+    }
+
+    SequenceLengthClass::~SequenceLengthClass()
+    {
+        Clear();
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Follows every Track of the specified Sequence instead of the Tracks
+    /// followed until now.
+    /// </summary>
+    void SequenceLengthClass::Build(Sequence sequence)
+    {
+        Clear();
+
+        List<Track>::iterator it = sequence.GetIterator();
+        for(it = it.begin(); it != it.end(); it++)
+        {
+            AddTrack((Track)it);
+        }
+    }
+
+    /// <summary>
+    /// Follows the specified Track.
+    /// </summary>
+    void SequenceLengthClass::AddTrack(Track track)
+    {
+        REGION(Guard)
+
+        if(IndexOf(&track) >= 0)
+        {
+            return;
+        }
+
+        ENDREGION()
+
+        TrackFollower* follower = new TrackFollower();
+
+        follower->owner = this;
+        follower->track = &track;
+        follower->index = followers.Count;
+
+        followers.Add(follower);
+        lengths.Add(0);
+
+        Update(follower->index);
+
+        track.Attach(*follower);
+    }
+
+    /// <summary>
+    /// Stops following the specified Track.
+    /// </summary>
+    void SequenceLengthClass::RemoveTrack(Track track)
+    {
+        int index = IndexOf(&track);
+
+        REGION(Guard)
+
+        if(index < 0)
+        {
+            return;
+        }
+
+        ENDREGION()
+
+        track.Detach(*followers[index]);
+
+        if(!stale && lengths[index] == length)
+        {
+            stale = true;
+        }
+
+        delete followers[index];
+
+        // The last Track takes the freed slot, so no other slot changes.
+        int last = followers.Count - 1;
+
+        if(index != last)
+        {
+            followers[index] = followers[last];
+            followers[index]->index = index;
+            lengths[index] = lengths[last];
+        }
+
+        followers.RemoveAt(last);
+        lengths.RemoveAt(last);
+    }
+
+    /// <summary>
+    /// Stops following every Track.
+    /// </summary>
+    void SequenceLengthClass::Clear()
+    {
+        for(int i = 0; i < followers.Count; i++)
+        {
+            followers[i]->track->Detach(*followers[i]);
+
+            delete followers[i];
+        }
+
+        followers.Clear();
+        lengths.Clear();
+
+        length = 0;
+        stale = false;
+    }
+
+    void SequenceLengthClass::Update(int index)
+    {
+        int oldLength = lengths[index];
+        int newLength = followers[index]->track->Length;
+
+        lengths[index] = newLength;
+
+        if(stale)
+        {
+            return;
+        }
+        else if(newLength >= length)
+        {
+            length = newLength;
+        }
+        else if(oldLength == length)
+        {
+            // The longest Track got shorter, so another one may now be
+            // the longest.
+            stale = true;
+        }
+    }
+
+    int SequenceLengthClass::IndexOf(TrackClass* track)
+    {
+        for(int i = 0; i < followers.Count; i++)
+        {
+            if(followers[i]->track == track)
+            {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets the length in ticks of the longest Track followed, or 0 if
+    /// there are none.
+    /// </summary>
+    int SequenceLengthClass::get_Length()
+    {
+        if(stale)
+        {
+            length = 0;
+
+            for(int i = 0; i < lengths.Count; i++)
+            {
+                if(lengths[i] > length)
+                {
+                    length = lengths[i];
+                }
+            }
+
+            stale = false;
+        }
+
+        return length;
+    }
+
+    ENDREGION()
+
+    REGION(ITrackObserver Members)
+
+    // Every notification updates the slot the follower was given.
+
+    void SequenceLengthClass::TrackFollower::MidiEventInserted(Track track, MidiEvent e)
+    {
+        owner->Update(index);
+    }
+
+    void SequenceLengthClass::TrackFollower::MidiEventRemoved(Track track, MidiEvent e)
+    {
+        owner->Update(index);
+    }
+
+    void SequenceLengthClass::TrackFollower::MidiEventMoved(Track track, MidiEvent e, int oldPosition)
+    {
+        owner->Update(index);
+    }
+
+    void SequenceLengthClass::TrackFollower::TrackCleared(Track track)
+    {
+        owner->Update(index);
+    }
+
+    void SequenceLengthClass::TrackFollower::LengthChanged(Track track)
+    {
+        owner->Update(index);
+    }
+
+    ENDREGION()
+
+}}}
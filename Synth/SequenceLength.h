@@ -0,0 +1,149 @@
+#ifndef SEQUENCELENGTH_H
+#define SEQUENCELENGTH_H
+
+#include "Types.h"
+#include "ArrayList.h"
+#include "Track.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    class SequenceClass;
+    typedef SequenceClass& Sequence;
+
+    class SequenceLengthClass;
+    typedef SequenceLengthClass& SequenceLength;
+
+    /// <summary>
+    /// Keeps the length of a Sequence, the length of its longest Track, as
+    /// the Tracks are edited.
+    /// </summary>
+    /// <remarks>
+    /// The SequenceLength observes the Tracks it was built from and keeps
+    /// the last length seen for each. Each Track is observed through its
+    /// own follower, which knows the Track's slot, so a notification finds
+    /// the length to update without searching the Tracks. An edit that lengthens a Track can
+    /// only raise the maximum, so it is updated on the spot. An edit that
+    /// shortens the longest Track marks the maximum as stale, and it is
+    /// found again from the kept lengths the next time it is asked for.
+    /// Reading the length is therefore constant time unless the longest
+    /// Track has been shortened since.
+    /// </remarks>
+    class SequenceLengthClass
+    {
+        REGION(SequenceLength Members)
+
+        REGION(Fields)
+
+    private:
+
+        // Observes one Track for the SequenceLength.
+        class TrackFollower : public ITrackObserverIf
+        {
+        public:
+
+            SequenceLengthClass* owner;
+
+            TrackClass* track;
+
+            // The slot of the Track in the SequenceLength.
+            int index;
+
+            void MidiEventInserted(Track track, MidiEvent e);
+
+            void MidiEventRemoved(Track track, MidiEvent e);
+
+            void MidiEventMoved(Track track, MidiEvent e, int oldPosition);
+
+            void TrackCleared(Track track);
+
+            void LengthChanged(Track track);
+        };
+
+        // The followers of the Tracks and the length of each Track when
+        // last seen, by slot.
+        ArrayList<TrackFollower*> followers;
+
+        ArrayList<int> lengths;
+
+        // The longest of the lengths, valid only while stale is not set.
+        int length;
+
+        bool stale;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the SequenceLength class.
+        /// </summary>
+        SequenceLengthClass();
+
+        ~SequenceLengthClass();
+
+    private:
+
+        SequenceLengthClass(const SequenceLengthClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Follows every Track of the specified Sequence instead of the
+        /// Tracks followed until now.
+        /// </summary>
+        void Build(Sequence sequence);
+
+        /// <summary>
+        /// Follows the specified Track.
+        /// </summary>
+        void AddTrack(Track track);
+
+        /// <summary>
+        /// Stops following the specified Track.
+        /// </summary>
+        void RemoveTrack(Track track);
+
+        /// <summary>
+        /// Stops following every Track.
+        /// </summary>
+        void Clear();
+
+    private:
+
+        // Takes the current length of the Track in the specified slot.
+        void Update(int index);
+
+        // Returns the slot of the Track, or -1 if it is not followed.
+        int IndexOf(TrackClass* track);
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets the length in ticks of the longest Track followed, or 0 if
+        /// there are none.
+        /// </summary>
+        ReadOnlyProperty<int> Length;
+
+        ENDREGION()
+
+        ENDREGION()
+
+    private:
+        void init();
+        int get_Length();
+
+    };
+
+}}}
+
+#endif
@@ -0,0 +1,249 @@
+#include "SequencePublisher.h"
+#include "Exception.h"
+
+#include <windows.h>
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef SequencePublisherClass cls;
+
+    void cls::init()
+    {
+        this->Version = Functor::New(this, &cls::get_Version);
+        this->RetiredCount = Functor::New(this, &cls::get_RetiredCount);
+        this->current = nullptr;
+        this->version = 0;
+
+        for(int i = 0; i < MaxReaders; i++)
+        {
+            registered[i] = 0;
+            announced[i] = 0;
+        }
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the SequencePublisher class.
+    /// </summary>
+    SequencePublisherClass::SequencePublisherClass()
+    {
+        init();
+    }
+
+    /// <summary>
+    /// Deletes every snapshot. No reader may be holding one.
+    /// </summary>
+    SequencePublisherClass::~SequencePublisherClass()
+    {
+        for(int i = 0; i < retired.Count; i++)
+        {
+            delete retired[i];
+        }
+
+        delete current;
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Publishes a copy of the specified Sequence as the current snapshot.
+    /// </summary>
+    /// <param name="sequence">
+    /// The Sequence to copy.
+    /// </param>
+    void SequencePublisherClass::Publish(Sequence sequence)
+    {
+        // The copy is made before anything is published, so readers only
+        // ever see a finished snapshot. It shares the copies of the Tracks
+        // not edited since the current one; only this thread counts the
+        // snapshots holding a copy.
+        SequenceSnapshotClass* snapshot = new SequenceSnapshotClass(sequence, current);
+
+        snapshot->version = version + 1;
+
+        // The snapshot is published before its version, so a reader that
+        // announces the new version is sure to find the new snapshot.
+        SequenceSnapshotClass* previous = (SequenceSnapshotClass*)
+            InterlockedExchangePointer((PVOID volatile*)&current, snapshot);
+
+        InterlockedExchange(&version, snapshot->version);
+
+        if(previous != nullptr)
+        {
+            retired.Add(previous);
+        }
+
+        Reclaim();
+    }
+
+    /// <summary>
+    /// Deletes the replaced snapshots that no reader can still hold.
+    /// </summary>
+    void SequencePublisherClass::Reclaim()
+    {
+        REGION(Guard)
+
+        if(retired.Count == 0)
+        {
+            return;
+        }
+
+        ENDREGION()
+
+        // Every snapshot older than the oldest announced version is out of
+        // the readers' reach, as is every replaced one if none announced.
+        long oldest = version + 1;
+
+        for(int i = 0; i < MaxReaders; i++)
+        {
+            long reading = announced[i];
+
+            if(reading != 0 && reading < oldest)
+            {
+                oldest = reading;
+            }
+        }
+
+        int kept = 0;
+
+        for(int i = 0; i < retired.Count; i++)
+        {
+            if(retired[i]->version < oldest)
+            {
+                delete retired[i];
+            }
+            else
+            {
+                retired[kept++] = retired[i];
+            }
+        }
+
+        retired.RemoveRange(kept, retired.Count - kept);
+    }
+
+    /// <summary>
+    /// Registers a reader.
+    /// </summary>
+    /// <returns>
+    /// The reader's number, which is passed to Acquire and Release.
+    /// </returns>
+    /// <exception cref="InvalidOperationException">
+    /// MaxReaders readers are already registered.
+    /// </exception>
+    int SequencePublisherClass::Register()
+    {
+        for(int i = 0; i < MaxReaders; i++)
+        {
+            if(InterlockedCompareExchange(&registered[i], 1, 0) == 0)
+            {
+                InterlockedExchange(&announced[i], 0);
+
+                return i;
+            }
+        }
+
+        throw new InvalidOperationException("Too many readers registered.");
+    }
+
+    /// <summary>
+    /// Releases the snapshot the specified reader holds and ends its
+    /// registration.
+    /// </summary>
+    void SequencePublisherClass::Unregister(int reader)
+    {
+        REGION(Require)
+
+        RequireReader(reader);
+
+        ENDREGION()
+
+        InterlockedExchange(&announced[reader], 0);
+        InterlockedExchange(&registered[reader], 0);
+    }
+
+    /// <summary>
+    /// Takes the current snapshot in place of the one the specified reader
+    /// held.
+    /// </summary>
+    /// <param name="reader">
+    /// The reader's number.
+    /// </param>
+    /// <returns>
+    /// The current snapshot, or nullptr if nothing has been published. The
+    /// snapshot the reader held before must no longer be used.
+    /// </returns>
+    SequenceSnapshotClass* SequencePublisherClass::Acquire(int reader)
+    {
+        REGION(Require)
+
+        RequireReader(reader);
+
+        ENDREGION()
+
+        long latest = version;
+
+        // Announces the version before looking at the snapshot. If Reclaim
+        // missed the announcement, the snapshot it replaced is already out
+        // of reach. Before the first Publish, the first version is
+        // announced, as it may be published in the meantime.
+        InterlockedExchange(&announced[reader], latest > 0 ? latest : 1);
+
+        SequenceSnapshotClass* snapshot = current;
+
+        // Narrows the announcement to the snapshot actually taken, which
+        // may be newer still.
+        InterlockedExchange(&announced[reader], snapshot != nullptr ? snapshot->version : 0);
+
+        return snapshot;
+    }
+
+    /// <summary>
+    /// Releases the snapshot the specified reader holds.
+    /// </summary>
+    void SequencePublisherClass::Release(int reader)
+    {
+        REGION(Require)
+
+        RequireReader(reader);
+
+        ENDREGION()
+
+        InterlockedExchange(&announced[reader], 0);
+    }
+
+    void SequencePublisherClass::RequireReader(int reader)
+    {
+        if(reader < 0 || reader >= MaxReaders || registered[reader] == 0)
+        {
+            throw new ArgumentOutOfRangeException("reader", reader,
+                "Reader not registered.");
+        }
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets the version of the current snapshot, or 0 if nothing has been
+    /// published.
+    /// </summary>
+    int SequencePublisherClass::get_Version()
+    {
+        return version;
+    }
+
+    /// <summary>
+    /// Gets the number of replaced snapshots not yet deleted.
+    /// </summary>
+    int SequencePublisherClass::get_RetiredCount()
+    {
+        return retired.Count;
+    }
+
+    ENDREGION()
+
+}}}
@@ -0,0 +1,179 @@
+#ifndef SEQUENCEPUBLISHER_H
+#define SEQUENCEPUBLISHER_H
+
+#include "Types.h"
+#include "ArrayList.h"
+#include "SequenceSnapshot.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    class SequencePublisherClass;
+    typedef SequencePublisherClass& SequencePublisher;
+
+    /// <summary>
+    /// Hands SequenceSnapshots from the thread editing a Sequence to the
+    /// threads playing it, without either ever waiting for the other.
+    /// </summary>
+    /// <remarks>
+    /// The editing thread calls Publish to replace the current snapshot
+    /// with a copy of the Sequence, which shares the copies of the Tracks
+    /// not edited since with the current snapshot. Each playing thread registers as a
+    /// reader and calls Acquire, typically once per block, when Version
+    /// shows a newer snapshot than the one it holds. Both take a few
+    /// interlocked operations and never take a lock.
+    ///
+    /// Replaced snapshots are deleted once no reader can still hold them.
+    /// Every snapshot is published with the next version, and each reader
+    /// announces the oldest version it may be reading: the current version
+    /// before it looks at the snapshot, then that of the snapshot it took.
+    /// A replaced snapshot whose version is older than every announcement
+    /// can no longer be reached by any reader. Publish deletes the
+    /// snapshots it can and keeps the rest for a later Publish or Reclaim.
+    ///
+    /// Publish and Reclaim are called by one thread at a time. Each reader
+    /// calls Acquire and Release from one thread at a time.
+    /// </remarks>
+    class SequencePublisherClass
+    {
+        REGION(SequencePublisher Members)
+
+        REGION(Constants)
+
+    public:
+
+        /// <summary>
+        /// The most readers registered at once.
+        /// </summary>
+        static const int MaxReaders = 8;
+
+        ENDREGION()
+
+        REGION(Fields)
+
+    private:
+
+        // The snapshot readers take, or nullptr before the first Publish.
+        SequenceSnapshotClass* volatile current;
+
+        // The version of the current snapshot.
+        volatile long version;
+
+        // Nonzero for each reader that is registered.
+        volatile long registered[MaxReaders];
+
+        // The oldest version each reader may be reading, or 0 for none.
+        volatile long announced[MaxReaders];
+
+        // The replaced snapshots not yet deleted.
+        ArrayList<SequenceSnapshotClass*> retired;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the SequencePublisher class.
+        /// </summary>
+        SequencePublisherClass();
+
+        /// <summary>
+        /// Deletes every snapshot. No reader may be holding one.
+        /// </summary>
+        ~SequencePublisherClass();
+
+    private:
+
+        SequencePublisherClass(const SequencePublisherClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Publishes a copy of the specified Sequence as the current
+        /// snapshot.
+        /// </summary>
+        /// <param name="sequence">
+        /// The Sequence to copy.
+        /// </param>
+        void Publish(Sequence sequence);
+
+        /// <summary>
+        /// Deletes the replaced snapshots that no reader can still hold.
+        /// </summary>
+        void Reclaim();
+
+        /// <summary>
+        /// Registers a reader.
+        /// </summary>
+        /// <returns>
+        /// The reader's number, which is passed to Acquire and Release.
+        /// </returns>
+        /// <exception cref="InvalidOperationException">
+        /// MaxReaders readers are already registered.
+        /// </exception>
+        int Register();
+
+        /// <summary>
+        /// Releases the snapshot the specified reader holds and ends its
+        /// registration.
+        /// </summary>
+        void Unregister(int reader);
+
+        /// <summary>
+        /// Takes the current snapshot in place of the one the specified
+        /// reader held.
+        /// </summary>
+        /// <param name="reader">
+        /// The reader's number.
+        /// </param>
+        /// <returns>
+        /// The current snapshot, or nullptr if nothing has been published.
+        /// The snapshot the reader held before must no longer be used.
+        /// </returns>
+        SequenceSnapshotClass* Acquire(int reader);
+
+        /// <summary>
+        /// Releases the snapshot the specified reader holds.
+        /// </summary>
+        void Release(int reader);
+
+    private:
+
+        void RequireReader(int reader);
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets the version of the current snapshot, or 0 if nothing has
+        /// been published.
+        /// </summary>
+        ReadOnlyProperty<int> Version;
+
+        /// <summary>
+        /// Gets the number of replaced snapshots not yet deleted.
+        /// </summary>
+        ReadOnlyProperty<int> RetiredCount;
+
+        ENDREGION()
+
+        ENDREGION()
+
+    private:
+        void init();
+        int get_Version();
+        int get_RetiredCount();
+
+    };
+
+}}}
+
+#endif
@@ -0,0 +1,226 @@
+#include "SequenceSnapshot.h"
+#include "Sequence.h"
+#include "MessagePool.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef SequenceSnapshotClass cls;
+
+    static MidiEventClass* Next(MidiEventClass* e)
+    {
+        MidiEvent next = e->Next;
+
+        return next != MidiEventClass::null ? &next : nullptr;
+    }
+
+    void cls::init()
+    {
+        this->Count = Functor::New(this, &cls::get_Count);
+        this->Division = Functor::New(this, &cls::get_Division);
+        this->Length = Functor::New(this, &cls::get_Length);
+        this->TempoMap = Functor::New(this, &cls::get_TempoMap);
+        this->Version = Functor::New(this, &cls::get_Version);
+        this->division = 0;
+        this->length = 0;
+        this->version = 0;
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the SequenceSnapshot class with a copy
+    /// of the specified Sequence.
+    /// </summary>
+    SequenceSnapshotClass::SequenceSnapshotClass(Sequence sequence) :
+        tempoMap(sequence.Division)
+    {
+        init();
+
+        Copy(sequence, nullptr);
+    }
+
+    /// <summary>
+    /// Initializes a new instance of the SequenceSnapshot class with a copy
+    /// of the specified Sequence, sharing the copies of the Tracks not
+    /// edited since the specified snapshot was made.
+    /// </summary>
+    /// <param name="sequence">
+    /// The Sequence to copy.
+    /// </param>
+    /// <param name="previous">
+    /// An earlier snapshot of the Sequence, or nullptr.
+    /// </param>
+    SequenceSnapshotClass::SequenceSnapshotClass(Sequence sequence, SequenceSnapshotClass* previous) :
+        tempoMap(sequence.Division)
+    {
+        init();
+
+        Copy(sequence, previous);
+    }
+
+    SequenceSnapshotClass::~SequenceSnapshotClass()
+    {
+        for(int i = 0; i < tracks.Count; i++)
+        {
+            SharedTrack* shared = tracks[i];
+
+            if(--shared->references == 0)
+            {
+                MessagePoolClass::Shared.Release(*shared->track);
+
+                delete shared->track;
+                delete shared;
+            }
+        }
+    }
+
+    void SequenceSnapshotClass::Copy(Sequence sequence, SequenceSnapshotClass* previous)
+    {
+        division = sequence.Division;
+        length = sequence.GetLength();
+
+        tempoMap.CopyFrom(sequence.TempoMap);
+
+        tracks.EnsureCapacity(sequence.Count);
+
+        List<Track>::iterator it = sequence.GetIterator();
+        for(it = it.begin(); it != it.end(); it++)
+        {
+            Track source = (Track)it;
+            SharedTrack* shared = previous != nullptr ?
+                previous->FindCopy(source, tracks.Count) : nullptr;
+
+            if(shared != nullptr)
+            {
+                shared->references++;
+            }
+            else
+            {
+                shared = CopyTrack(source);
+            }
+
+            tracks.Add(shared);
+        }
+    }
+
+    SequenceSnapshotClass::SharedTrack* SequenceSnapshotClass::FindCopy(Track source, int index)
+    {
+        long revision = source.Revision;
+
+        if(index < tracks.Count && tracks[index]->source == &source)
+        {
+            return tracks[index]->revision == revision ? tracks[index] : nullptr;
+        }
+
+        // The Tracks were added, removed or reordered.
+        for(int i = 0; i < tracks.Count; i++)
+        {
+            if(tracks[i]->source == &source)
+            {
+                return tracks[i]->revision == revision ? tracks[i] : nullptr;
+            }
+        }
+
+        return nullptr;
+    }
+
+    SequenceSnapshotClass::SharedTrack* SequenceSnapshotClass::CopyTrack(Track source)
+    {
+        SharedTrack* shared = new SharedTrack();
+        TrackClass* track = new TrackClass();
+
+        // Each MidiEvent is at or after the last one, so it is appended.
+        MidiEventClass* current = source.Count > 1 ? &source.GetMidiEvent(0) : nullptr;
+
+        for(; current != nullptr; current = Next(current))
+        {
+            IMidiMessage message = current->MidiMessage;
+
+            // The copy keeps a pooled message alive after the Track it
+            // was loaded into is released.
+            MessagePoolClass::Shared.AddReference(message);
+
+            track->Insert(current->AbsoluteTicks, message);
+        }
+
+        track->EndOfTrackOffset = source.EndOfTrackOffset;
+
+        // Builds the index now rather than on the first seek, which would
+        // write to the Track while it is being played.
+        track->FindIndex(0);
+
+        shared->track = track;
+        shared->source = &source;
+        shared->revision = source.Revision;
+        shared->references = 1;
+
+        return shared;
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets the Track at the specified index.
+    /// </summary>
+    const Track SequenceSnapshotClass::operator [](int index)
+    {
+        REGION(Require)
+
+        if(index < 0 || index >= tracks.Count)
+        {
+            throw new ArgumentOutOfRangeException("index", index,
+                "Sequence index out of range.");
+        }
+
+        ENDREGION()
+
+        return *tracks[index]->track;
+    }
+
+    /// <summary>
+    /// Gets the number of Tracks.
+    /// </summary>
+    int SequenceSnapshotClass::get_Count()
+    {
+        return tracks.Count;
+    }
+
+    /// <summary>
+    /// Gets the division value of the Sequence.
+    /// </summary>
+    int SequenceSnapshotClass::get_Division()
+    {
+        return division;
+    }
+
+    /// <summary>
+    /// Gets the length in ticks of the Sequence.
+    /// </summary>
+    int SequenceSnapshotClass::get_Length()
+    {
+        return length;
+    }
+
+    /// <summary>
+    /// Gets the TempoMap copied from the Sequence.
+    /// </summary>
+    TempoMap SequenceSnapshotClass::get_TempoMap()
+    {
+        return tempoMap;
+    }
+
+    /// <summary>
+    /// Gets the version of the snapshot, which grows with every snapshot a
+    /// SequencePublisher publishes.
+    /// </summary>
+    int SequenceSnapshotClass::get_Version()
+    {
+        return version;
+    }
+
+    ENDREGION()
+
+}}}
@@ -0,0 +1,163 @@
+#ifndef SEQUENCESNAPSHOT_H
+#define SEQUENCESNAPSHOT_H
+
+#include "Types.h"
+#include "ArrayList.h"
+#include "Track.h"
+#include "TempoMap.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    class SequenceSnapshotClass;
+    typedef SequenceSnapshotClass& SequenceSnapshot;
+
+    /// <summary>
+    /// Represents a copy of a Sequence that is never changed, for playing
+    /// while the Sequence goes on being edited.
+    /// </summary>
+    /// <remarks>
+    /// The Tracks are copied, sharing their messages with the Sequence,
+    /// and their indices are built while copying, so reading a snapshot
+    /// never writes to it and any number of threads can read it at once.
+    /// A snapshot made from the one before it copies only the Tracks
+    /// edited since, going by their Revision, and shares the copies of the
+    /// rest with it, so publishing an edit costs the size of the Tracks it
+    /// touched rather than that of the Sequence. The TempoMap is copied
+    /// from the Sequence's. Each copy holds a reference in the shared
+    /// MessagePool to every pooled message in it. Snapshots are made and
+    /// handed out by a SequencePublisher, whose thread alone makes and
+    /// deletes them.
+    /// </remarks>
+    class SequenceSnapshotClass
+    {
+        REGION(SequenceSnapshot Members)
+
+        REGION(Fields)
+
+    private:
+
+        // A copy of a Track, shared by the snapshots made while the Track
+        // was not edited.
+        struct SharedTrack
+        {
+            TrackClass* track;
+
+            // The Track copied, and its Revision when copied.
+            TrackClass* source;
+
+            long revision;
+
+            // The number of snapshots holding the copy. Only touched by
+            // the thread that makes and deletes snapshots.
+            int references;
+        };
+
+        ArrayList<SharedTrack*> tracks;
+
+        // The tick to time conversions for the copied tempo changes.
+        TempoMapClass tempoMap;
+
+        int division;
+
+        // The length of the longest Track.
+        int length;
+
+        // The version given by the SequencePublisher that published the
+        // snapshot.
+        int version;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the SequenceSnapshot class with a
+        /// copy of the specified Sequence.
+        /// </summary>
+        SequenceSnapshotClass(Sequence sequence);
+
+        /// <summary>
+        /// Initializes a new instance of the SequenceSnapshot class with a
+        /// copy of the specified Sequence, sharing the copies of the Tracks
+        /// not edited since the specified snapshot was made.
+        /// </summary>
+        /// <param name="sequence">
+        /// The Sequence to copy.
+        /// </param>
+        /// <param name="previous">
+        /// An earlier snapshot of the Sequence, or nullptr.
+        /// </param>
+        SequenceSnapshotClass(Sequence sequence, SequenceSnapshotClass* previous);
+
+        ~SequenceSnapshotClass();
+
+    private:
+
+        SequenceSnapshotClass(const SequenceSnapshotClass& other);
+
+        void Copy(Sequence sequence, SequenceSnapshotClass* previous);
+
+        // Finds the copy of the specified Track the snapshot holds, if it
+        // is still current, starting with the copy at the same index.
+        SharedTrack* FindCopy(Track source, int index);
+
+        static SharedTrack* CopyTrack(Track source);
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets the Track at the specified index.
+        /// </summary>
+        const Track operator[](int index);
+
+        /// <summary>
+        /// Gets the number of Tracks.
+        /// </summary>
+        ReadOnlyProperty<int> Count;
+
+        /// <summary>
+        /// Gets the division value of the Sequence.
+        /// </summary>
+        ReadOnlyProperty<int> Division;
+
+        /// <summary>
+        /// Gets the length in ticks of the Sequence.
+        /// </summary>
+        ReadOnlyProperty<int> Length;
+
+        /// <summary>
+        /// Gets the TempoMap copied from the Sequence.
+        /// </summary>
+        ReadOnlyProperty<Midi::TempoMap> TempoMap;
+
+        /// <summary>
+        /// Gets the version of the snapshot, which grows with every
+        /// snapshot a SequencePublisher publishes.
+        /// </summary>
+        ReadOnlyProperty<int> Version;
+
+        ENDREGION()
+
+        ENDREGION()
+
+    private:
+        void init();
+        int get_Count();
+        int get_Division();
+        int get_Length();
+        Midi::TempoMap get_TempoMap();
+        int get_Version();
+
+        friend class SequencePublisherClass;
+
+    };
+
+}}}
+
+#endif
@@ -0,0 +1,516 @@
+#include "Sequencer.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef SequencerClass cls;
+
+    void cls::init()
+    {
+        this->Sequence = Functor::New(this, &cls::get_Sequence, &cls::set_Sequence);
+        this->Sink = Functor::New(this, &cls::get_Sink, &cls::set_Sink);
+        this->ChaseIndex = Functor::New(this, &cls::get_ChaseIndex, &cls::set_ChaseIndex);
+        this->Publisher = Functor::New(this, &cls::get_Publisher, &cls::set_Publisher);
+        this->Position = Functor::New(this, &cls::get_Position, &cls::set_Position);
+        this->IsPlaying = Functor::New(this, &cls::get_IsPlaying);
+        this->IsFinished = Functor::New(this, &cls::get_IsFinished);
+        this->sequence = nullptr;
+        this->sink = nullptr;
+        this->chaseIndex = nullptr;
+        this->publisher = nullptr;
+        this->reader = -1;
+        this->snapshot = nullptr;
+        this->chasedVersion = 0;
+        this->startPosition = 0;
+        this->startMicroseconds = 0;
+        this->elapsed = 0;
+        this->playing = false;
+        this->dispatched = false;
+        this->disposed = false;
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the Sequencer class.
+    /// </summary>
+    SequencerClass::SequencerClass() :
+        snapshotChase(1)
+    {
+        init();
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Starts playing the Sequence from the beginning.
+    /// </summary>
+    void SequencerClass::Start()
+    {
+        Refresh();
+
+        REGION(Require)
+
+        if(disposed)
+        {
+            throw new ObjectDisposedException("Sequencer");
+        }
+        else if(sequence == nullptr && snapshot == nullptr)
+        {
+            throw new InvalidOperationException("No Sequence to play.");
+        }
+
+        ENDREGION()
+
+        elapsed = 0;
+        Seek(0, true);
+        playing = true;
+    }
+
+    /// <summary>
+    /// Continues playing the Sequence from the current position.
+    /// </summary>
+    void SequencerClass::Continue()
+    {
+        Refresh();
+
+        REGION(Require)
+
+        if(disposed)
+        {
+            throw new ObjectDisposedException("Sequencer");
+        }
+        else if(sequence == nullptr && snapshot == nullptr)
+        {
+            throw new InvalidOperationException("No Sequence to play.");
+        }
+
+        ENDREGION()
+
+        REGION(Guard)
+
+        if(playing)
+        {
+            return;
+        }
+
+        ENDREGION()
+
+        elapsed = 0;
+        Seek(startPosition, true);
+        playing = true;
+    }
+
+    /// <summary>
+    /// Stops playing the Sequence.
+    /// </summary>
+    void SequencerClass::Stop()
+    {
+        REGION(Require)
+
+        if(disposed)
+        {
+            throw new ObjectDisposedException("Sequencer");
+        }
+
+        ENDREGION()
+
+        REGION(Guard)
+
+        if(!playing)
+        {
+            return;
+        }
+
+        ENDREGION()
+
+        startPosition = Position;
+        playing = false;
+    }
+
+    /// <summary>
+    /// Sends every MIDI message that is due.
+    /// </summary>
+    /// <param name="elapsed">
+    /// The time in microseconds elapsed since playback started or
+    /// continued.
+    /// </param>
+    /// <returns>
+    /// The number of messages sent.
+    /// </returns>
+    int SequencerClass::Dispatch(long long elapsed)
+    {
+        REGION(Require)
+
+        if(disposed)
+        {
+            throw new ObjectDisposedException("Sequencer");
+        }
+
+        ENDREGION()
+
+        REGION(Guard)
+
+        if(!playing)
+        {
+            return 0;
+        }
+
+        ENDREGION()
+
+        // Snapshots are only swapped between blocks, never while a block
+        // is being sent.
+        Refresh();
+
+        this->elapsed = elapsed;
+        dispatched = true;
+
+        TempoMap tempoMap = GetTempoMap();
+        long long now = startMicroseconds + elapsed;
+        int lastTicks = -1;
+        long long deadline = 0;
+        int sent = 0;
+
+        while(!queue.IsEmpty)
+        {
+            int ticks = queue.NextPosition;
+
+            // Chords and controller bursts share a position, so only look
+            // the deadline up when the position changes.
+            if(ticks != lastTicks)
+            {
+                deadline = tempoMap.TicksToMicroseconds(ticks);
+                lastTicks = ticks;
+            }
+
+            if(deadline > now)
+            {
+                break;
+            }
+
+            MidiEvent e = queue.Dequeue();
+
+            if(sink != nullptr)
+            {
+                sink->Send(e.MidiMessage, deadline - startMicroseconds);
+            }
+
+            sent++;
+        }
+
+        return sent;
+    }
+
+    void SequencerClass::Seek(int position, bool chase)
+    {
+        ChaseIndexClass* chaser = nullptr;
+
+        if(chase && chaseIndex != nullptr)
+        {
+            chaser = chaseIndex;
+
+            // The ChaseIndex holds MidiEvents of the Sequence, not of the
+            // snapshot, so the snapshot gets its own.
+            if(snapshot != nullptr)
+            {
+                chaser = &snapshotChase;
+
+                if(snapshotChase.Interval != chaseIndex->Interval)
+                {
+                    snapshotChase.Interval = chaseIndex->Interval;
+                }
+
+                if(chasedVersion != snapshot->Version)
+                {
+                    snapshotChase.Build(*snapshot);
+                    chasedVersion = snapshot->Version;
+                }
+            }
+        }
+
+        if(chaser != nullptr)
+        {
+            chaser->Seek(position, queue);
+        }
+        else if(snapshot != nullptr)
+        {
+            queue.Reset(*snapshot, position);
+        }
+        else
+        {
+            queue.Reset(*sequence, position);
+        }
+
+        startPosition = position;
+        dispatched = false;
+
+        TempoMap tempoMap = GetTempoMap();
+
+        // Keep the caller's elapsed time continuous across a seek.
+        startMicroseconds = tempoMap.TicksToMicroseconds(position) - elapsed;
+
+        if(chaser != nullptr && sink != nullptr)
+        {
+            chaser->Send(*sink, elapsed);
+        }
+    }
+
+    // Takes the latest snapshot from the SequencePublisher if it is newer
+    // than the one being played.
+    void SequencerClass::Refresh()
+    {
+        REGION(Guard)
+
+        if(publisher == nullptr)
+        {
+            return;
+        }
+
+        int latest = publisher->Version;
+
+        if(latest == 0 || (snapshot != nullptr && snapshot->Version == latest))
+        {
+            return;
+        }
+
+        ENDREGION()
+
+        // Found with the tempo changes of the snapshot played so far.
+        int position = playing ? GetUnplayedPosition() : startPosition;
+
+        snapshot = publisher->Acquire(reader);
+
+        if(playing)
+        {
+            Seek(position, false);
+        }
+    }
+
+    // Returns the first position none of whose MidiEvents have been sent.
+    int SequencerClass::GetUnplayedPosition()
+    {
+        if(!dispatched)
+        {
+            return startPosition;
+        }
+
+        TempoMap tempoMap = GetTempoMap();
+        long long now = startMicroseconds + elapsed;
+        int position = tempoMap.MicrosecondsToTicks(now);
+
+        // Dispatch sent every MidiEvent due by now. The conversion rounds,
+        // so the position is moved to just past the last of them.
+        while(tempoMap.TicksToMicroseconds(position) <= now)
+        {
+            position++;
+        }
+
+        while(position > startPosition && tempoMap.TicksToMicroseconds(position - 1) > now)
+        {
+            position--;
+        }
+
+        return position;
+    }
+
+    TempoMap SequencerClass::GetTempoMap()
+    {
+        if(snapshot != nullptr)
+        {
+            return snapshot->TempoMap;
+        }
+
+        return sequence->TempoMap;
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets or sets the Sequence to play.
+    /// </summary>
+    Sequence SequencerClass::get_Sequence()
+    {
+        return *sequence;
+    }
+    void SequencerClass::set_Sequence(Midi::Sequence value)
+    {
+        REGION(Require)
+
+        if(disposed)
+        {
+            throw new ObjectDisposedException("Sequencer");
+        }
+
+        ENDREGION()
+
+        Stop();
+
+        sequence = &value;
+        startPosition = 0;
+        queue.Clear();
+    }
+
+    /// <summary>
+    /// Gets or sets the IMidiSink that receives the played messages.
+    /// </summary>
+    IMidiSink SequencerClass::get_Sink()
+    {
+        return *sink;
+    }
+    void SequencerClass::set_Sink(Midi::IMidiSink value)
+    {
+        sink = &value;
+    }
+
+    /// <summary>
+    /// Gets or sets the ChaseIndex used to restore the channel state
+    /// when seeking.
+    /// </summary>
+    ChaseIndex SequencerClass::get_ChaseIndex()
+    {
+        return *chaseIndex;
+    }
+    void SequencerClass::set_ChaseIndex(Midi::ChaseIndex value)
+    {
+        chaseIndex = &value;
+    }
+
+    /// <summary>
+    /// Gets or sets the SequencePublisher whose snapshots are played in
+    /// place of the Sequence once one has been published.
+    /// </summary>
+    SequencePublisher SequencerClass::get_Publisher()
+    {
+        return *publisher;
+    }
+    void SequencerClass::set_Publisher(Midi::SequencePublisher value)
+    {
+        REGION(Require)
+
+        if(disposed)
+        {
+            throw new ObjectDisposedException("Sequencer");
+        }
+
+        ENDREGION()
+
+        int registeredReader = value.Register();
+
+        Stop();
+
+        if(publisher != nullptr)
+        {
+            publisher->Unregister(reader);
+        }
+
+        publisher = &value;
+        reader = registeredReader;
+        snapshot = nullptr;
+        chasedVersion = 0;
+        startPosition = 0;
+        queue.Clear();
+    }
+
+    /// <summary>
+    /// Gets or sets the playback position in ticks.
+    /// </summary>
+    int SequencerClass::get_Position()
+    {
+        REGION(Require)
+
+        if(disposed)
+        {
+            throw new ObjectDisposedException("Sequencer");
+        }
+
+        ENDREGION()
+
+        if(!playing)
+        {
+            return startPosition;
+        }
+
+        TempoMap tempoMap = GetTempoMap();
+
+        return tempoMap.MicrosecondsToTicks(startMicroseconds + elapsed);
+    }
+    void SequencerClass::set_Position(int value)
+    {
+        REGION(Require)
+
+        if(disposed)
+        {
+            throw new ObjectDisposedException("Sequencer");
+        }
+        else if(value < 0)
+        {
+            throw new ArgumentOutOfRangeException("Position", value,
+                "Sequencer position out of range.");
+        }
+
+        ENDREGION()
+
+        if(playing)
+        {
+            Seek(value, true);
+        }
+        else
+        {
+            startPosition = value;
+        }
+    }
+
+    /// <summary>
+    /// Gets a value indicating whether the Sequencer is playing.
+    /// </summary>
+    bool SequencerClass::get_IsPlaying()
+    {
+        return playing;
+    }
+
+    /// <summary>
+    /// Gets a value indicating whether every MidiEvent of the Sequence
+    /// has been played.
+    /// </summary>
+    bool SequencerClass::get_IsFinished()
+    {
+        return playing && queue.IsEmpty;
+    }
+
+    ENDREGION()
+
+    REGION(IDisposable Members)
+
+    void SequencerClass::Dispose()
+    {
+        REGION(Guard)
+
+        if(disposed)
+        {
+            return;
+        }
+
+        ENDREGION()
+
+        Stop();
+
+        queue.Clear();
+
+        if(publisher != nullptr)
+        {
+            publisher->Unregister(reader);
+
+            publisher = nullptr;
+            snapshot = nullptr;
+        }
+
+        disposed = true;
+    }
+
+    ENDREGION()
+
+}}}
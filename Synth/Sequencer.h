@@ -0,0 +1,232 @@
+#ifndef SEQUENCER_H
+#define SEQUENCER_H
+
+#include "Types.h"
+#include "Sequence.h"
+#include "MergeQueue.h"
+#include "ChaseIndex.h"
+#include "SequencePublisher.h"
+#include "IMidiSink.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    class SequencerClass;
+    typedef SequencerClass& Sequencer;
+
+    /// <summary>
+    /// Plays a Sequence by sending its MIDI messages to an IMidiSink when
+    /// they are due.
+    /// </summary>
+    /// <remarks>
+    /// The Sequencer does not own a clock. Whoever drives playback calls
+    /// Dispatch with the time elapsed since Start or Continue, and every
+    /// MidiEvent whose deadline has passed is sent along with its deadline.
+    /// Deadlines come from the Sequence's TempoMap. The Tracks are merged
+    /// on the fly by a MergeQueue, so the cost per MidiEvent does not grow
+    /// with the number of Tracks in any meaningful way. When a ChaseIndex
+    /// is set, seeking first sends the channel state in effect at the new
+    /// position.
+    ///
+    /// When a SequencePublisher is set, the Sequencer plays its snapshots
+    /// instead, so the Sequence can be edited on another thread while it
+    /// plays. Dispatch picks up a newer snapshot when it is called, before
+    /// sending anything, and carries on from the first position it has not
+    /// played yet without chasing, as the receiver already holds the state
+    /// played so far. The ChaseIndex holds the MidiEvents of the Sequence,
+    /// so seeking in a snapshot chases with a second ChaseIndex built from
+    /// the snapshot, with the same Interval, on the first seek after a
+    /// newer snapshot is taken.
+    /// </remarks>
+    class SequencerClass
+    {
+        REGION(Sequencer Members)
+
+        REGION(Fields)
+
+    private:
+
+        // The Sequence being played.
+        SequenceClass* sequence;
+
+        // The source of the snapshots played in place of the Sequence, or
+        // nullptr to play the Sequence.
+        SequencePublisherClass* publisher;
+
+        // The number the Sequencer is registered under as a reader of the
+        // SequencePublisher.
+        int reader;
+
+        // The snapshot being played, or nullptr until one is published.
+        SequenceSnapshotClass* snapshot;
+
+        // The destination of the played messages.
+        IMidiSinkIf* sink;
+
+        // The Tracks of the Sequence merged by position.
+        MergeQueueClass queue;
+
+        // Restores the channel state when playback starts mid-Sequence,
+        // or nullptr to start without chasing.
+        ChaseIndexClass* chaseIndex;
+
+        // Restores the channel state in place of the ChaseIndex when a
+        // snapshot is played, and the version of the snapshot it was built
+        // from, or zero.
+        ChaseIndexClass snapshotChase;
+
+        int chasedVersion;
+
+        // The position in ticks at which playback started or continued.
+        int startPosition;
+
+        // The time in microseconds of the start position.
+        long long startMicroseconds;
+
+        // The elapsed time passed to the last call to Dispatch.
+        long long elapsed;
+
+        // Indicates whether the Sequencer is playing.
+        bool playing;
+
+        // Indicates whether Dispatch has run since the last seek.
+        bool dispatched;
+
+        bool disposed;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the Sequencer class.
+        /// </summary>
+        SequencerClass();
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Starts playing the Sequence from the beginning.
+        /// </summary>
+        void Start();
+
+        /// <summary>
+        /// Continues playing the Sequence from the current position.
+        /// </summary>
+        void Continue();
+
+        /// <summary>
+        /// Stops playing the Sequence.
+        /// </summary>
+        void Stop();
+
+        /// <summary>
+        /// Sends every MIDI message that is due.
+        /// </summary>
+        /// <param name="elapsed">
+        /// The time in microseconds elapsed since playback started or
+        /// continued.
+        /// </param>
+        /// <returns>
+        /// The number of messages sent.
+        /// </returns>
+        int Dispatch(long long elapsed);
+
+    private:
+
+        // Positions the MergeQueue and the start time at the specified
+        // position, restoring the channel state there if chase is true
+        // and a ChaseIndex is set.
+        void Seek(int position, bool chase);
+
+        // Takes the latest snapshot from the SequencePublisher if it is
+        // newer than the one being played.
+        void Refresh();
+
+        // Returns the first position none of whose MidiEvents have been
+        // sent.
+        int GetUnplayedPosition();
+
+        Midi::TempoMap GetTempoMap();
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets or sets the Sequence to play.
+        /// </summary>
+        Property<Midi::Sequence> Sequence;
+
+        /// <summary>
+        /// Gets or sets the IMidiSink that receives the played messages.
+        /// </summary>
+        Property<Midi::IMidiSink> Sink;
+
+        /// <summary>
+        /// Gets or sets the ChaseIndex used to restore the channel state
+        /// when seeking.
+        /// </summary>
+        Property<Midi::ChaseIndex> ChaseIndex;
+
+        /// <summary>
+        /// Gets or sets the SequencePublisher whose snapshots are played in
+        /// place of the Sequence once one has been published.
+        /// </summary>
+        Property<Midi::SequencePublisher> Publisher;
+
+        /// <summary>
+        /// Gets or sets the playback position in ticks.
+        /// </summary>
+        Property<int> Position;
+
+        /// <summary>
+        /// Gets a value indicating whether the Sequencer is playing.
+        /// </summary>
+        ReadOnlyProperty<bool> IsPlaying;
+
+        /// <summary>
+        /// Gets a value indicating whether every MidiEvent of the Sequence
+        /// has been played.
+        /// </summary>
+        ReadOnlyProperty<bool> IsFinished;
+
+        ENDREGION()
+
+        ENDREGION()
+
+        REGION(IDisposable Members)
+
+    public:
+
+        void Dispose();
+
+        ENDREGION()
+
+    private:
+        void init();
+        Midi::Sequence get_Sequence();
+        void set_Sequence(Midi::Sequence value);
+        Midi::IMidiSink get_Sink();
+        void set_Sink(Midi::IMidiSink value);
+        Midi::ChaseIndex get_ChaseIndex();
+        void set_ChaseIndex(Midi::ChaseIndex value);
+        Midi::SequencePublisher get_Publisher();
+        void set_Publisher(Midi::SequencePublisher value);
+        int get_Position();
+        void set_Position(int value);
+        bool get_IsPlaying();
+        bool get_IsFinished();
+
+    };
+
+}}}
+
+#endif
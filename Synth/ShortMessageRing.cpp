@@ -0,0 +1,296 @@
+#include <windows.h>
+#include "ShortMessageRing.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef ShortMessageRingClass cls;
+
+    void cls::init()
+    {
+        this->Capacity = Functor::New(this, &cls::get_Capacity);
+        this->Count = Functor::New(this, &cls::get_Count);
+        this->Dropped = Functor::New(this, &cls::get_Dropped);
+        this->records = nullptr;
+        this->capacity = 0;
+        this->mask = 0;
+        this->producer.head = 0;
+        this->producer.cachedTail = 0;
+        this->producer.dropped = 0;
+        this->consumer.tail = 0;
+        this->consumer.cachedHead = 0;
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the ShortMessageRing class with the
+    /// specified capacity.
+    /// </summary>
+    /// <param name="capacity">
+    /// The minimum number of messages the ring can hold. It is rounded
+    /// up to a power of two.
+    /// </param>
+    ShortMessageRingClass::ShortMessageRingClass(int capacity)
+    {
+        init();
+
+        REGION(Require)
+
+        if(capacity <= 0 || capacity > (1 << 30))
+        {
+            throw new ArgumentOutOfRangeException("capacity", capacity,
+                "Ring capacity out of range.");
+        }
+
+        ENDREGION()
+
+        this->capacity = 1;
+
+        while(this->capacity < (unsigned long)capacity)
+        {
+            this->capacity <<= 1;
+        }
+
+        mask = this->capacity - 1;
+        records = new TimestampedMessage[this->capacity];
+    }
+
+    ShortMessageRingClass::~ShortMessageRingClass()
+    {
+        delete[] records;
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Writes a message to the ring. Producer only.
+    /// </summary>
+    /// <returns>
+    /// <b>true</b> if the message was written; <b>false</b> if the ring
+    /// was full.
+    /// </returns>
+    bool ShortMessageRingClass::Push(long long timestamp, int message)
+    {
+        unsigned long head = producer.head;
+
+        if(FreeSpace(head, 1) == 0)
+        {
+            producer.dropped++;
+
+            return false;
+        }
+
+        TimestampedMessage& record = records[head & mask];
+
+        record.timestamp = timestamp;
+        record.message = message;
+
+        // The barrier makes the store a release: the record is written
+        // before the consumer can see it, on every processor.
+        MemoryBarrier();
+        producer.head = head + 1;
+
+        return true;
+    }
+
+    /// <summary>
+    /// Writes as many of the specified messages as fit. Producer only.
+    /// </summary>
+    /// <returns>
+    /// The number of messages written.
+    /// </returns>
+    int ShortMessageRingClass::Push(const TimestampedMessage* messages, int count)
+    {
+        unsigned long head = producer.head;
+        long free = FreeSpace(head, count);
+        int written = count < free ? count : (int)free;
+
+        for(int i = 0; i < written; i++)
+        {
+            records[(head + i) & mask] = messages[i];
+        }
+
+        producer.dropped += count - written;
+
+        // Publish the whole batch with a single release of the index.
+        MemoryBarrier();
+        producer.head = head + written;
+
+        return written;
+    }
+
+    /// <summary>
+    /// Reads a message from the ring. Consumer only.
+    /// </summary>
+    /// <returns>
+    /// <b>true</b> if a message was read; <b>false</b> if the ring was
+    /// empty.
+    /// </returns>
+    bool ShortMessageRingClass::Pop(TimestampedMessage& message)
+    {
+        unsigned long tail = consumer.tail;
+
+        if(Available(tail, 1) == 0)
+        {
+            return false;
+        }
+
+        message = records[tail & mask];
+
+        // The record must be read before the producer can overwrite it.
+        MemoryBarrier();
+        consumer.tail = tail + 1;
+
+        return true;
+    }
+
+    /// <summary>
+    /// Reads up to the specified number of messages. Consumer only.
+    /// </summary>
+    /// <returns>
+    /// The number of messages read.
+    /// </returns>
+    int ShortMessageRingClass::Pop(TimestampedMessage* messages, int count)
+    {
+        unsigned long tail = consumer.tail;
+        long available = Available(tail, count);
+        int read = count < available ? count : (int)available;
+
+        for(int i = 0; i < read; i++)
+        {
+            messages[i] = records[(tail + i) & mask];
+        }
+
+        MemoryBarrier();
+        consumer.tail = tail + read;
+
+        return read;
+    }
+
+    /// <summary>
+    /// Reads up to the specified number of messages that are due before
+    /// the specified time. Consumer only.
+    /// </summary>
+    /// <returns>
+    /// The number of messages read.
+    /// </returns>
+    int ShortMessageRingClass::PopBefore(long long timestamp, TimestampedMessage* messages, int count)
+    {
+        unsigned long tail = consumer.tail;
+        long available = Available(tail, count);
+        int read = 0;
+
+        while(read < count && read < available)
+        {
+            const TimestampedMessage& record = records[(tail + read) & mask];
+
+            if(record.timestamp >= timestamp)
+            {
+                break;
+            }
+
+            messages[read] = record;
+            read++;
+        }
+
+        MemoryBarrier();
+        consumer.tail = tail + read;
+
+        return read;
+    }
+
+    // The indices run freely and wrap, so they are unsigned and only
+    // their difference, at most the capacity, is ever used.
+    long ShortMessageRingClass::FreeSpace(unsigned long head, int needed)
+    {
+        long free = (long)(capacity - (head - producer.cachedTail));
+
+        // Only touch the consumer's cache line when the cached tail says
+        // there is less room than needed. The barrier makes the load an
+        // acquire: the records are not written until the consumer has
+        // read them.
+        if(free < needed)
+        {
+            producer.cachedTail = consumer.tail;
+            MemoryBarrier();
+            free = (long)(capacity - (head - producer.cachedTail));
+        }
+
+        return free;
+    }
+
+    long ShortMessageRingClass::Available(unsigned long tail, int wanted)
+    {
+        long available = (long)(consumer.cachedHead - tail);
+
+        // Only touch the producer's cache line when the cached head says
+        // fewer records are there than wanted. The barrier makes the load
+        // an acquire: the records are not read before the producer has
+        // written them.
+        if(available < wanted)
+        {
+            consumer.cachedHead = producer.head;
+            MemoryBarrier();
+            available = (long)(consumer.cachedHead - tail);
+        }
+
+        return available;
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets the number of messages the ring can hold.
+    /// </summary>
+    int ShortMessageRingClass::get_Capacity()
+    {
+        return (int)capacity;
+    }
+
+    /// <summary>
+    /// Gets the number of messages in the ring. The value is only
+    /// approximate while the other thread is running.
+    /// </summary>
+    int ShortMessageRingClass::get_Count()
+    {
+        return (int)(producer.head - consumer.tail);
+    }
+
+    /// <summary>
+    /// Gets the number of messages dropped because the ring was full.
+    /// </summary>
+    int ShortMessageRingClass::get_Dropped()
+    {
+        return producer.dropped;
+    }
+
+    ENDREGION()
+
+    REGION(IMidiSink Members)
+
+    /// <summary>
+    /// Writes a short message to the ring. Producer only.
+    /// </summary>
+    void ShortMessageRingClass::Send(IMidiMessage message, long long microseconds)
+    {
+        switch(message.MessageType)
+        {
+        case MessageType::Channel:
+        case MessageType::SystemCommon:
+        case MessageType::SystemRealtime:
+            Push(microseconds, ((ShortMessage)message).Message);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    ENDREGION()
+
+}}}
@@ -0,0 +1,231 @@
+#ifndef SHORTMESSAGERING_H
+#define SHORTMESSAGERING_H
+
+#include "Types.h"
+#include "ShortMessage.h"
+#include "IMidiSink.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    /// <summary>
+    /// Represents a short message as a packed integer together with the
+    /// time at which it is due.
+    /// </summary>
+    struct TimestampedMessage
+    {
+        // The time at which the message is due.
+        long long timestamp;
+
+        // The short message as a packed integer.
+        int message;
+    };
+
+    class ShortMessageRingClass;
+    typedef ShortMessageRingClass& ShortMessageRing;
+
+    /// <summary>
+    /// Passes timestamped short messages from one producer thread to one
+    /// consumer thread without locks or allocation.
+    /// </summary>
+    /// <remarks>
+    /// The ring is wait-free for exactly one producer and one consumer.
+    /// Each side owns one index and only reads the other's, and the two
+    /// indices live on separate cache lines so the threads do not contend
+    /// for the same line. Each side also keeps a cached copy of the other
+    /// index and only rereads the shared one when the cached copy shows
+    /// less room or fewer records than a call asks for. Storage is
+    /// allocated once, up front.
+    ///
+    /// Each side publishes its index with a release, a memory barrier
+    /// before the store, and reads the other's with an acquire, a memory
+    /// barrier after the load, so a record is never seen before it is
+    /// written or overwritten before it is read, whatever the processor
+    /// reorders.
+    ///
+    /// The ring is an IMidiSink, so a Sequencer playing on one thread can
+    /// send straight into it. Meta and system exclusive messages are not
+    /// short messages and are dropped.
+    /// </remarks>
+    class ShortMessageRingClass : public IMidiSinkIf
+    {
+        REGION(ShortMessageRing Members)
+
+        REGION(Constants)
+
+    public:
+
+        /// <summary>
+        /// The size in bytes of a cache line.
+        /// </summary>
+        static const int CacheLineSize = 64;
+
+        ENDREGION()
+
+        REGION(Fields)
+
+    private:
+
+        // Only written by the producer.
+        struct __declspec(align(64)) ProducerIndex
+        {
+            // The index of the next record to write.
+            volatile unsigned long head;
+
+            // The last value of tail the producer read.
+            unsigned long cachedTail;
+
+            // The number of messages dropped because the ring was full.
+            long dropped;
+        };
+
+        // Only written by the consumer.
+        struct __declspec(align(64)) ConsumerIndex
+        {
+            // The index of the next record to read.
+            volatile unsigned long tail;
+
+            // The last value of head the consumer read.
+            unsigned long cachedHead;
+        };
+
+        // The records. The capacity is a power of two so indices wrap with
+        // a mask, and the indices themselves run freely.
+        TimestampedMessage* records;
+
+        unsigned long capacity;
+
+        unsigned long mask;
+
+        ProducerIndex producer;
+
+        ConsumerIndex consumer;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the ShortMessageRing class with the
+        /// specified capacity.
+        /// </summary>
+        /// <param name="capacity">
+        /// The minimum number of messages the ring can hold. It is rounded
+        /// up to a power of two.
+        /// </param>
+        ShortMessageRingClass(int capacity);
+
+        ~ShortMessageRingClass();
+
+    private:
+
+        ShortMessageRingClass(const ShortMessageRingClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Writes a message to the ring. Producer only.
+        /// </summary>
+        /// <returns>
+        /// <b>true</b> if the message was written; <b>false</b> if the ring
+        /// was full.
+        /// </returns>
+        bool Push(long long timestamp, int message);
+
+        /// <summary>
+        /// Writes as many of the specified messages as fit. Producer only.
+        /// </summary>
+        /// <returns>
+        /// The number of messages written.
+        /// </returns>
+        int Push(const TimestampedMessage* messages, int count);
+
+        /// <summary>
+        /// Reads a message from the ring. Consumer only.
+        /// </summary>
+        /// <returns>
+        /// <b>true</b> if a message was read; <b>false</b> if the ring was
+        /// empty.
+        /// </returns>
+        bool Pop(TimestampedMessage& message);
+
+        /// <summary>
+        /// Reads up to the specified number of messages. Consumer only.
+        /// </summary>
+        /// <returns>
+        /// The number of messages read.
+        /// </returns>
+        int Pop(TimestampedMessage* messages, int count);
+
+        /// <summary>
+        /// Reads up to the specified number of messages that are due before
+        /// the specified time. Consumer only.
+        /// </summary>
+        /// <returns>
+        /// The number of messages read.
+        /// </returns>
+        int PopBefore(long long timestamp, TimestampedMessage* messages, int count);
+
+    private:
+
+        // Returns the number of records the producer can write, rereading
+        // the tail if fewer than the number needed are cached.
+        long FreeSpace(unsigned long head, int needed);
+
+        // Returns the number of records the consumer can read, rereading
+        // the head if fewer than the number wanted are cached.
+        long Available(unsigned long tail, int wanted);
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets the number of messages the ring can hold.
+        /// </summary>
+        ReadOnlyProperty<int> Capacity;
+
+        /// <summary>
+        /// Gets the number of messages in the ring. The value is only
+        /// approximate while the other thread is running.
+        /// </summary>
+        ReadOnlyProperty<int> Count;
+
+        /// <summary>
+        /// Gets the number of messages dropped because the ring was full.
+        /// </summary>
+        ReadOnlyProperty<int> Dropped;
+
+        ENDREGION()
+
+        ENDREGION()
+
+        REGION(IMidiSink Members)
+
+    public:
+
+        /// <summary>
+        /// Writes a short message to the ring. Producer only.
+        /// </summary>
+        void Send(IMidiMessage message, long long microseconds);
+
+        ENDREGION()
+
+    private:
+        void init();
+        int get_Capacity();
+        int get_Count();
+        int get_Dropped();
+
+    };
+
+}}}
+
+#endif
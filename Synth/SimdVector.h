@@ -0,0 +1,124 @@
+#ifndef SIMDVECTOR_H
+#define SIMDVECTOR_H
+
+#include <immintrin.h>
+#include "Types.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    REGION(Vector Operations)
+
+    // Each instruction set exposes the same operations so the voice
+    // kernels are written once as templates. Comparisons return masks that
+    // are only consumed by Select and And. Load and Store need addresses
+    // aligned to the width of the vector; LoadUnaligned does not. Gather
+    // reads one float per lane at the given indices, which must be aligned
+    // like a float vector.
+
+    struct ScalarVector
+    {
+        typedef float Type;
+
+        static const int Width = 1;
+
+        static Type Load(const float* p) { return *p; }
+        static Type LoadUnaligned(const float* p) { return *p; }
+        static void Store(float* p, Type a) { *p = a; }
+        static Type Gather(const float* p, const int* indices) { return p[indices[0]]; }
+        static Type Set(float a) { return a; }
+        static Type Add(Type a, Type b) { return a + b; }
+        static Type Sub(Type a, Type b) { return a - b; }
+        static Type Mul(Type a, Type b) { return a * b; }
+        static Type Div(Type a, Type b) { return a / b; }
+        static Type Min(Type a, Type b) { return a < b ? a : b; }
+        static Type Max(Type a, Type b) { return a > b ? a : b; }
+        static Type Abs(Type a) { return a < 0.0f ? -a : a; }
+        static Type Less(Type a, Type b) { return a < b ? 1.0f : 0.0f; }
+        static Type GreaterEqual(Type a, Type b) { return a >= b ? 1.0f : 0.0f; }
+        static Type Equal(Type a, Type b) { return a == b ? 1.0f : 0.0f; }
+        static Type And(Type mask, Type a) { return mask != 0.0f ? a : 0.0f; }
+        static Type Select(Type mask, Type a, Type b) { return mask != 0.0f ? a : b; }
+        static float Sum(Type a) { return a; }
+        static void End() { }
+    };
+
+    struct Sse2Vector
+    {
+        typedef __m128 Type;
+
+        static const int Width = 4;
+
+        static Type Load(const float* p) { return _mm_load_ps(p); }
+        static Type LoadUnaligned(const float* p) { return _mm_loadu_ps(p); }
+        static void Store(float* p, Type a) { _mm_store_ps(p, a); }
+        static Type Gather(const float* p, const int* indices)
+        {
+            return _mm_set_ps(p[indices[3]], p[indices[2]], p[indices[1]], p[indices[0]]);
+        }
+        static Type Set(float a) { return _mm_set1_ps(a); }
+        static Type Add(Type a, Type b) { return _mm_add_ps(a, b); }
+        static Type Sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+        static Type Mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+        static Type Div(Type a, Type b) { return _mm_div_ps(a, b); }
+        static Type Min(Type a, Type b) { return _mm_min_ps(a, b); }
+        static Type Max(Type a, Type b) { return _mm_max_ps(a, b); }
+        static Type Abs(Type a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+        static Type Less(Type a, Type b) { return _mm_cmplt_ps(a, b); }
+        static Type GreaterEqual(Type a, Type b) { return _mm_cmpge_ps(a, b); }
+        static Type Equal(Type a, Type b) { return _mm_cmpeq_ps(a, b); }
+        static Type And(Type mask, Type a) { return _mm_and_ps(mask, a); }
+        static Type Select(Type mask, Type a, Type b)
+        {
+            return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+        }
+        static float Sum(Type a)
+        {
+            a = _mm_add_ps(a, _mm_movehl_ps(a, a));
+            a = _mm_add_ss(a, _mm_shuffle_ps(a, a, 1));
+
+            return _mm_cvtss_f32(a);
+        }
+        static void End() { }
+    };
+
+    struct Avx2Vector
+    {
+        typedef __m256 Type;
+
+        static const int Width = 8;
+
+        static Type Load(const float* p) { return _mm256_load_ps(p); }
+        static Type LoadUnaligned(const float* p) { return _mm256_loadu_ps(p); }
+        static void Store(float* p, Type a) { _mm256_store_ps(p, a); }
+        static Type Gather(const float* p, const int* indices)
+        {
+            return _mm256_i32gather_ps(p, _mm256_load_si256((const __m256i*)indices), 4);
+        }
+        static Type Set(float a) { return _mm256_set1_ps(a); }
+        static Type Add(Type a, Type b) { return _mm256_add_ps(a, b); }
+        static Type Sub(Type a, Type b) { return _mm256_sub_ps(a, b); }
+        static Type Mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+        static Type Div(Type a, Type b) { return _mm256_div_ps(a, b); }
+        static Type Min(Type a, Type b) { return _mm256_min_ps(a, b); }
+        static Type Max(Type a, Type b) { return _mm256_max_ps(a, b); }
+        static Type Abs(Type a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+        static Type Less(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+        static Type GreaterEqual(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+        static Type Equal(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+        static Type And(Type mask, Type a) { return _mm256_and_ps(mask, a); }
+        static Type Select(Type mask, Type a, Type b) { return _mm256_blendv_ps(b, a, mask); }
+        static float Sum(Type a)
+        {
+            return Sse2Vector::Sum(_mm_add_ps(_mm256_castps256_ps128(a),
+                _mm256_extractf128_ps(a, 1)));
+        }
+
+        // Avoids the penalty for mixing VEX and legacy SSE code.
+        static void End() { _mm256_zeroupper(); }
+    };
+
+    ENDREGION()
+
+}}}
+
+#endif
@@ -0,0 +1,1079 @@
+#include <windows.h>
+#include <math.h>
+#include <string.h>
+#include "SoundFont.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef SoundFontClass cls;
+
+    // The generators a region is built from, by their SoundFont 2
+    // operator numbers.
+    enum Generator
+    {
+        StartAddrsOffset = 0,
+        EndAddrsOffset = 1,
+        StartloopAddrsOffset = 2,
+        EndloopAddrsOffset = 3,
+        StartAddrsCoarseOffset = 4,
+        EndAddrsCoarseOffset = 12,
+        PanGenerator = 17,
+        AttackVolEnv = 34,
+        DecayVolEnv = 36,
+        SustainVolEnv = 37,
+        ReleaseVolEnv = 38,
+        InstrumentGenerator = 41,
+        KeyRange = 43,
+        VelRange = 44,
+        StartloopAddrsCoarseOffset = 45,
+        InitialAttenuation = 48,
+        EndloopAddrsCoarseOffset = 50,
+        CoarseTune = 51,
+        FineTune = 52,
+        SampleId = 53,
+        SampleModes = 54,
+        ScaleTuning = 56,
+        OverridingRootKey = 58,
+        GeneratorCount = 61
+    };
+
+    // The sizes in bytes of the preset data records.
+    static const int PresetHeaderSize = 38;
+    static const int BagSize = 4;
+    static const int GeneratorSize = 4;
+    static const int InstrumentSize = 22;
+    static const int SampleHeaderSize = 46;
+
+    // The sample type flag marking samples held in ROM.
+    static const int RomSample = 0x8000;
+
+    // A key or velocity range covering every value, as stored.
+    static const int FullRange = 127 << 8;
+
+    // The largest sample data mapped as one view. A 32-bit process has
+    // 2 GB of address space, fragmented by everything else loaded, so
+    // larger banks are streamed there instead.
+    static const long long MaxMappedSampleBytes = sizeof(void*) < 8 ? 256LL << 20 : 1LL << 62;
+
+    struct SoundFontClass::PresetChunks
+    {
+        const unsigned char* phdr;
+        const unsigned char* pbag;
+        const unsigned char* pgen;
+        const unsigned char* inst;
+        const unsigned char* ibag;
+        const unsigned char* igen;
+        const unsigned char* shdr;
+
+        int phdrCount;
+        int pbagCount;
+        int pgenCount;
+        int instCount;
+        int ibagCount;
+        int igenCount;
+        int shdrCount;
+    };
+
+    static int ReadWord(const unsigned char* p)
+    {
+        return p[0] | (p[1] << 8);
+    }
+
+    static int ReadDword(const unsigned char* p)
+    {
+        return p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24);
+    }
+
+    static bool IsTag(const unsigned char* p, const char* tag)
+    {
+        return p[0] == tag[0] && p[1] == tag[1] && p[2] == tag[2] && p[3] == tag[3];
+    }
+
+    static int Clamp(int value, int low, int high)
+    {
+        return value < low ? low : value > high ? high : value;
+    }
+
+    // Gets the range of generators of a zone from its bag.
+    static void GetGenerators(const unsigned char* bags, int generatorCount, int bag,
+        int& first, int& last)
+    {
+        first = ReadWord(bags + bag * BagSize);
+        last = ReadWord(bags + (bag + 1) * BagSize);
+
+        if(last > generatorCount)
+        {
+            last = generatorCount;
+        }
+
+        if(first > last)
+        {
+            first = last;
+        }
+    }
+
+    // Stores the amounts of a zone's generators over the values already
+    // there.
+    static void ApplyGenerators(const unsigned char* generators, int first, int last,
+        int* values)
+    {
+        for(int i = first; i < last; i++)
+        {
+            const unsigned char* g = generators + i * GeneratorSize;
+            int oper = ReadWord(g);
+
+            if(oper >= GeneratorCount)
+            {
+                continue;
+            }
+
+            // Ranges are two bytes; every other amount is signed.
+            values[oper] = oper == KeyRange || oper == VelRange ?
+                ReadWord(g + 2) : (short)ReadWord(g + 2);
+        }
+    }
+
+    // Sets the values of a preset zone, which are added to those of the
+    // instrument, so all are zero but the ranges.
+    static void SetPresetDefaults(int* values)
+    {
+        for(int i = 0; i < GeneratorCount; i++)
+        {
+            values[i] = 0;
+        }
+
+        values[KeyRange] = FullRange;
+        values[VelRange] = FullRange;
+    }
+
+    static void SetInstrumentDefaults(int* values)
+    {
+        SetPresetDefaults(values);
+
+        values[AttackVolEnv] = -12000;
+        values[DecayVolEnv] = -12000;
+        values[ReleaseVolEnv] = -12000;
+        values[ScaleTuning] = 100;
+        values[OverridingRootKey] = -1;
+    }
+
+    static float TimecentsToSeconds(int timecents)
+    {
+        return (float)pow(2.0, timecents / 1200.0);
+    }
+
+    // Maps a view of part of the file, or returns nullptr if the address
+    // space has no room for it. A view starts on a multiple of the
+    // allocation granularity, so base, which is unmapped, may lie before
+    // the part asked for.
+    static const unsigned char* MapWindow(void* mapping, long long offset, long long size,
+        const unsigned char*& base)
+    {
+        SYSTEM_INFO info;
+
+        GetSystemInfo(&info);
+
+        long long start = offset - offset % info.dwAllocationGranularity;
+
+        base = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ,
+            (DWORD)(start >> 32), (DWORD)start, (SIZE_T)(offset - start + size));
+
+        return base != nullptr ? base + (offset - start) : nullptr;
+    }
+
+    void cls::init()
+    {
+        this->Samples = Functor::New(this, &cls::get_Samples);
+        this->SampleCount = Functor::New(this, &cls::get_SampleCount);
+        this->PresetCount = Functor::New(this, &cls::get_PresetCount);
+        this->Streaming = Functor::New(this, &cls::get_Streaming);
+        this->file = INVALID_HANDLE_VALUE;
+        this->mapping = nullptr;
+        this->view = nullptr;
+        this->length = 0;
+        this->samples = nullptr;
+        this->sampleCount = 0;
+        this->dataOffset = 0;
+        this->streaming = false;
+        this->residentMilliseconds = 0;
+        this->heads = nullptr;
+        this->disposed = false;
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the SoundFont class with the
+    /// specified file.
+    /// </summary>
+    SoundFontClass::SoundFontClass(string fileName)
+    {
+        init();
+
+        Open(fileName);
+    }
+
+    /// <summary>
+    /// Initializes a new instance of the SoundFont class that streams the
+    /// samples of the specified file.
+    /// </summary>
+    /// <param name="fileName">
+    /// The SoundFont file.
+    /// </param>
+    /// <param name="residentMilliseconds">
+    /// The length of the start of each sample kept in memory.
+    /// </param>
+    SoundFontClass::SoundFontClass(string fileName, int residentMilliseconds)
+    {
+        init();
+
+        REGION(Require)
+
+        if(residentMilliseconds < 0)
+        {
+            throw new ArgumentOutOfRangeException("residentMilliseconds",
+                residentMilliseconds, "Resident length out of range.");
+        }
+
+        ENDREGION()
+
+        this->streaming = true;
+        this->residentMilliseconds = residentMilliseconds;
+
+        Open(fileName);
+    }
+
+    SoundFontClass::~SoundFontClass()
+    {
+        Dispose();
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Finds the preset for the specified bank and program.
+    /// </summary>
+    /// <returns>
+    /// The preset, or nullptr if the bank has no such preset.
+    /// </returns>
+    const SoundFontPreset* SoundFontClass::FindPreset(int bank, int program)
+    {
+        int key = (bank << 7) | program;
+        int low = 0;
+        int high = presets.Count - 1;
+
+        while(low <= high)
+        {
+            int middle = (low + high) / 2;
+            const SoundFontPreset& preset = presets[middle];
+            int other = (preset.bank << 7) | preset.program;
+
+            if(other < key)
+            {
+                low = middle + 1;
+            }
+            else if(other > key)
+            {
+                high = middle - 1;
+            }
+            else
+            {
+                return &preset;
+            }
+        }
+
+        return nullptr;
+    }
+
+    /// <summary>
+    /// Gets the region at the specified index of the region list.
+    /// </summary>
+    const SoundFontRegion& SoundFontClass::GetRegion(int index)
+    {
+        REGION(Require)
+
+        if(index < 0 || index >= regions.Count)
+        {
+            throw new ArgumentOutOfRangeException("index", index,
+                "Region index out of range.");
+        }
+
+        ENDREGION()
+
+        return regions[index];
+    }
+
+    /// <summary>
+    /// Reads sample frames from the file.
+    /// </summary>
+    /// <param name="frame">
+    /// The first frame, from the start of the sample data.
+    /// </param>
+    /// <param name="buffer">
+    /// The buffer that receives the frames.
+    /// </param>
+    /// <param name="count">
+    /// The number of frames.
+    /// </param>
+    /// <returns>
+    /// true if the frames were read; otherwise, false.
+    /// </returns>
+    /// <remarks>
+    /// Each read is positioned independently, so threads can read at the
+    /// same time.
+    /// </remarks>
+    bool SoundFontClass::ReadSamples(int frame, short* buffer, int count)
+    {
+        REGION(Require)
+
+        if(buffer == nullptr)
+        {
+            throw new ArgumentNullException("buffer");
+        }
+        else if(frame < 0 || count < 0 || frame > sampleCount - count)
+        {
+            throw new ArgumentOutOfRangeException("frame", frame,
+                "Sample frame out of range.");
+        }
+
+        ENDREGION()
+
+        if(!streaming)
+        {
+            memcpy(buffer, samples + frame, count * sizeof(short));
+
+            return true;
+        }
+
+        // An offset in the OVERLAPPED structure makes a positioned read,
+        // which leaves the file pointer shared by other threads alone.
+        long long offset = dataOffset + (long long)frame * sizeof(short);
+        OVERLAPPED overlapped = { };
+        DWORD read = 0;
+
+        overlapped.Offset = (DWORD)offset;
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+        return ReadFile(file, buffer, count * sizeof(short), &read, &overlapped) &&
+            read == count * sizeof(short);
+    }
+
+    void SoundFontClass::Open(string fileName)
+    {
+        REGION(Require)
+
+        if(fileName == nullptr)
+        {
+            throw new ArgumentNullException("fileName");
+        }
+
+        ENDREGION()
+
+        // Random access keeps the system from reading ahead through sample
+        // data no note has asked for.
+        file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+
+        if(file == INVALID_HANDLE_VALUE)
+        {
+            throw new SoundFontException("Unable to open SoundFont file.");
+        }
+
+        LARGE_INTEGER size;
+
+        if(!GetFileSizeEx(file, &size))
+        {
+            Dispose();
+
+            throw new SoundFontException("Unable to read SoundFont file.");
+        }
+
+        length = size.QuadPart;
+
+        // Mapping the file takes no address space; only the views of the
+        // preset data and the sample data do, each mapped on its own.
+        if(!streaming)
+        {
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+            if(mapping == nullptr)
+            {
+                Dispose();
+
+                throw new SoundFontException("Unable to map SoundFont file.");
+            }
+        }
+
+        try
+        {
+            Parse();
+        }
+        catch(...)
+        {
+            Dispose();
+
+            throw;
+        }
+    }
+
+    void SoundFontClass::ReadAt(long long offset, void* buffer, int count)
+    {
+        if(offset < 0 || offset + count > length)
+        {
+            throw new SoundFontException("End of SoundFont file unexpectedly reached.");
+        }
+
+        OVERLAPPED overlapped = { };
+        DWORD read = 0;
+
+        overlapped.Offset = (DWORD)offset;
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+        if(!ReadFile(file, buffer, count, &read, &overlapped) || read != (DWORD)count)
+        {
+            throw new SoundFontException("Unable to read SoundFont file.");
+        }
+    }
+
+    void SoundFontClass::Parse()
+    {
+        unsigned char header[12];
+
+        if(length < 12)
+        {
+            throw new SoundFontException("Not a SoundFont 2 file.");
+        }
+
+        ReadAt(0, header, 12);
+
+        if(!IsTag(header, "RIFF") || !IsTag(header + 8, "sfbk"))
+        {
+            throw new SoundFontException("Not a SoundFont 2 file.");
+        }
+
+        long long end = 8 + (unsigned int)ReadDword(header + 4);
+        long long position = 12;
+        bool hasSamples = false;
+        bool hasPresets = false;
+
+        if(end > length)
+        {
+            end = length;
+        }
+
+        // Only the chunk headers and the preset data are read; the sample
+        // data is left to the voices.
+        while(position + 12 <= end)
+        {
+            unsigned char chunk[12];
+
+            ReadAt(position, chunk, 12);
+
+            long long size = (unsigned int)ReadDword(chunk + 4);
+
+            if(position + 8 + size > end)
+            {
+                throw new SoundFontException("End of SoundFont file unexpectedly reached.");
+            }
+
+            if(IsTag(chunk, "LIST") && IsTag(chunk + 8, "sdta"))
+            {
+                long long sub = 12;
+
+                while(sub + 8 <= size + 8)
+                {
+                    unsigned char subChunk[8];
+
+                    ReadAt(position + sub, subChunk, 8);
+
+                    long long subSize = (unsigned int)ReadDword(subChunk + 4);
+
+                    if(sub + 8 + subSize > size + 8)
+                    {
+                        throw new SoundFontException("End of SoundFont file unexpectedly reached.");
+                    }
+
+                    if(IsTag(subChunk, "smpl"))
+                    {
+                        dataOffset = position + sub + 8;
+                        sampleCount = (int)(subSize / 2);
+                        hasSamples = true;
+
+                        MapSamples();
+                    }
+
+                    sub += 8 + subSize + (subSize & 1);
+                }
+            }
+            else if(IsTag(chunk, "LIST") && IsTag(chunk + 8, "pdta"))
+            {
+                if(!streaming)
+                {
+                    // The view is only needed while the regions are built.
+                    const unsigned char* base;
+                    const unsigned char* pdta = MapWindow(mapping, position + 12, size - 4, base);
+
+                    if(pdta == nullptr)
+                    {
+                        throw new SoundFontException("Unable to map SoundFont file.");
+                    }
+
+                    try
+                    {
+                        ParsePresets(pdta, size - 4);
+                    }
+                    catch(...)
+                    {
+                        UnmapViewOfFile(base);
+
+                        throw;
+                    }
+
+                    UnmapViewOfFile(base);
+                }
+                else
+                {
+                    // The preset data is only needed while the regions are
+                    // built.
+                    unsigned char* pdta = new unsigned char[(size_t)(size - 4)];
+
+                    try
+                    {
+                        ReadAt(position + 12, pdta, (int)(size - 4));
+                        ParsePresets(pdta, size - 4);
+                    }
+                    catch(...)
+                    {
+                        delete[] pdta;
+
+                        throw;
+                    }
+
+                    delete[] pdta;
+                }
+
+                hasPresets = true;
+            }
+
+            position += 8 + size + (size & 1);
+        }
+
+        if(!hasSamples || !hasPresets)
+        {
+            throw new SoundFontException("SoundFont file has no samples or presets.");
+        }
+
+        Sort();
+    }
+
+    // Maps a view of the sample data of a bank opened for mapping. Sample
+    // data too large for the address space is streamed instead, with the
+    // heads of the samples in memory and the rest read in blocks as notes
+    // play it.
+    void SoundFontClass::MapSamples()
+    {
+        REGION(Guard)
+
+        if(streaming)
+        {
+            return;
+        }
+
+        ENDREGION()
+
+        long long bytes = (long long)sampleCount * sizeof(short);
+
+        if(bytes <= MaxMappedSampleBytes)
+        {
+            samples = (const short*)MapWindow(mapping, dataOffset, bytes, view);
+        }
+
+        if(samples == nullptr)
+        {
+            streaming = true;
+            residentMilliseconds = FallbackResidentMilliseconds;
+        }
+    }
+
+    void SoundFontClass::ParsePresets(const unsigned char* pdta, long long size)
+    {
+        PresetChunks chunks = { };
+        long long position = 0;
+
+        while(position + 8 <= size)
+        {
+            const unsigned char* chunk = pdta + position;
+            int chunkSize = ReadDword(chunk + 4);
+            const unsigned char* data = chunk + 8;
+
+            if(position + 8 + chunkSize > size)
+            {
+                throw new SoundFontException("End of SoundFont file unexpectedly reached.");
+            }
+
+            if(IsTag(chunk, "phdr"))
+            {
+                chunks.phdr = data;
+                chunks.phdrCount = chunkSize / PresetHeaderSize;
+            }
+            else if(IsTag(chunk, "pbag"))
+            {
+                chunks.pbag = data;
+                chunks.pbagCount = chunkSize / BagSize;
+            }
+            else if(IsTag(chunk, "pgen"))
+            {
+                chunks.pgen = data;
+                chunks.pgenCount = chunkSize / GeneratorSize;
+            }
+            else if(IsTag(chunk, "inst"))
+            {
+                chunks.inst = data;
+                chunks.instCount = chunkSize / InstrumentSize;
+            }
+            else if(IsTag(chunk, "ibag"))
+            {
+                chunks.ibag = data;
+                chunks.ibagCount = chunkSize / BagSize;
+            }
+            else if(IsTag(chunk, "igen"))
+            {
+                chunks.igen = data;
+                chunks.igenCount = chunkSize / GeneratorSize;
+            }
+            else if(IsTag(chunk, "shdr"))
+            {
+                chunks.shdr = data;
+                chunks.shdrCount = chunkSize / SampleHeaderSize;
+            }
+
+            position += 8 + chunkSize + (chunkSize & 1);
+        }
+
+        // Every list ends with a terminal record.
+        if(chunks.phdrCount < 2 || chunks.pbagCount < 1 || chunks.pgenCount < 1 ||
+            chunks.instCount < 2 || chunks.ibagCount < 1 || chunks.igenCount < 1 ||
+            chunks.shdrCount < 2)
+        {
+            throw new SoundFontException("SoundFont preset data is incomplete.");
+        }
+
+        for(int i = 0; i < chunks.phdrCount - 1; i++)
+        {
+            const unsigned char* header = chunks.phdr + i * PresetHeaderSize;
+            int firstBag = ReadWord(header + 24);
+            int lastBag = ReadWord(header + PresetHeaderSize + 24);
+            SoundFontPreset preset;
+
+            for(int c = 0; c < 20; c++)
+            {
+                preset.name[c] = (char)header[c];
+            }
+
+            preset.name[20] = '\0';
+            preset.program = ReadWord(header + 20);
+            preset.bank = ReadWord(header + 22);
+
+            if(firstBag > lastBag || lastBag > chunks.pbagCount - 1)
+            {
+                throw new SoundFontException("SoundFont preset zones out of range.");
+            }
+
+            AddRegions(chunks, preset, firstBag, lastBag);
+
+            presets.Add(preset);
+        }
+
+        LoadHeads(chunks);
+    }
+
+    void SoundFontClass::AddRegions(const PresetChunks& chunks, SoundFontPreset& preset,
+        int firstBag, int lastBag)
+    {
+        int presetGlobal[GeneratorCount];
+        int presetValues[GeneratorCount];
+        int instrumentGlobal[GeneratorCount];
+        int instrumentValues[GeneratorCount];
+        int first;
+        int last;
+
+        SetPresetDefaults(presetGlobal);
+
+        preset.firstRegion = regions.Count;
+
+        for(int bag = firstBag; bag < lastBag; bag++)
+        {
+            GetGenerators(chunks.pbag, chunks.pgenCount, bag, first, last);
+
+            if(first == last)
+            {
+                continue;
+            }
+
+            // A zone not ending in an instrument is the global zone if it
+            // comes first, and is ignored otherwise.
+            if(ReadWord(chunks.pgen + (last - 1) * GeneratorSize) != InstrumentGenerator)
+            {
+                if(bag == firstBag)
+                {
+                    ApplyGenerators(chunks.pgen, first, last, presetGlobal);
+                }
+
+                continue;
+            }
+
+            for(int i = 0; i < GeneratorCount; i++)
+            {
+                presetValues[i] = presetGlobal[i];
+            }
+
+            ApplyGenerators(chunks.pgen, first, last, presetValues);
+
+            int instrument = presetValues[InstrumentGenerator];
+
+            if(instrument < 0 || instrument >= chunks.instCount - 1)
+            {
+                continue;
+            }
+
+            const unsigned char* header = chunks.inst + instrument * InstrumentSize;
+            int firstInstrumentBag = ReadWord(header + 20);
+            int lastInstrumentBag = ReadWord(header + InstrumentSize + 20);
+
+            if(firstInstrumentBag > lastInstrumentBag ||
+                lastInstrumentBag > chunks.ibagCount - 1)
+            {
+                continue;
+            }
+
+            SetInstrumentDefaults(instrumentGlobal);
+
+            for(int instrumentBag = firstInstrumentBag; instrumentBag < lastInstrumentBag;
+                instrumentBag++)
+            {
+                GetGenerators(chunks.ibag, chunks.igenCount, instrumentBag, first, last);
+
+                if(first == last)
+                {
+                    continue;
+                }
+
+                if(ReadWord(chunks.igen + (last - 1) * GeneratorSize) != SampleId)
+                {
+                    if(instrumentBag == firstInstrumentBag)
+                    {
+                        ApplyGenerators(chunks.igen, first, last, instrumentGlobal);
+                    }
+
+                    continue;
+                }
+
+                for(int i = 0; i < GeneratorCount; i++)
+                {
+                    instrumentValues[i] = instrumentGlobal[i];
+                }
+
+                ApplyGenerators(chunks.igen, first, last, instrumentValues);
+
+                AddRegion(chunks, presetValues, instrumentValues);
+            }
+        }
+
+        preset.regionCount = regions.Count - preset.firstRegion;
+    }
+
+    void SoundFontClass::AddRegion(const PresetChunks& chunks, const int* presetValues,
+        const int* instrumentValues)
+    {
+        const int* p = presetValues;
+        const int* v = instrumentValues;
+        int sample = v[SampleId];
+
+        if(sample < 0 || sample >= chunks.shdrCount - 1)
+        {
+            return;
+        }
+
+        const unsigned char* header = chunks.shdr + sample * SampleHeaderSize;
+
+        if((ReadWord(header + 44) & RomSample) != 0)
+        {
+            return;
+        }
+
+        SoundFontRegion region;
+
+        region.keyLow = (v[KeyRange] & 0xFF) > (p[KeyRange] & 0xFF) ?
+            (v[KeyRange] & 0xFF) : (p[KeyRange] & 0xFF);
+        region.keyHigh = (v[KeyRange] >> 8) < (p[KeyRange] >> 8) ?
+            (v[KeyRange] >> 8) : (p[KeyRange] >> 8);
+        region.velocityLow = (v[VelRange] & 0xFF) > (p[VelRange] & 0xFF) ?
+            (v[VelRange] & 0xFF) : (p[VelRange] & 0xFF);
+        region.velocityHigh = (v[VelRange] >> 8) < (p[VelRange] >> 8) ?
+            (v[VelRange] >> 8) : (p[VelRange] >> 8);
+
+        if(region.keyLow > region.keyHigh || region.velocityLow > region.velocityHigh)
+        {
+            return;
+        }
+
+        // The address offsets belong to the instrument alone.
+        region.start = Clamp(ReadDword(header + 20) + v[StartAddrsOffset] +
+            v[StartAddrsCoarseOffset] * 32768, 0, sampleCount);
+        region.end = Clamp(ReadDword(header + 24) + v[EndAddrsOffset] +
+            v[EndAddrsCoarseOffset] * 32768, region.start, sampleCount);
+        region.loopStart = Clamp(ReadDword(header + 28) + v[StartloopAddrsOffset] +
+            v[StartloopAddrsCoarseOffset] * 32768, region.start, region.end);
+        region.loopEnd = Clamp(ReadDword(header + 32) + v[EndloopAddrsOffset] +
+            v[EndloopAddrsCoarseOffset] * 32768, region.loopStart, region.end);
+        region.loopMode = v[SampleModes] & 3;
+
+        if(region.loopMode == 2 || region.loopEnd - region.loopStart < 2)
+        {
+            region.loopMode = 0;
+        }
+
+        int originalPitch = header[40];
+
+        region.rootKey = v[OverridingRootKey] >= 0 ? v[OverridingRootKey] :
+            originalPitch <= 127 ? originalPitch : 60;
+        region.tune = (v[CoarseTune] + p[CoarseTune]) * 100 + v[FineTune] + p[FineTune] +
+            (signed char)header[41];
+        region.scaleTuning = v[ScaleTuning] + p[ScaleTuning];
+        region.sampleRate = ReadDword(header + 36);
+
+        if(region.sampleRate <= 0)
+        {
+            region.sampleRate = 44100;
+        }
+
+        int attenuation = Clamp(v[InitialAttenuation] + p[InitialAttenuation], 0, 1440);
+
+        region.gain = (float)pow(10.0, -attenuation / 200.0);
+        region.pan = Clamp(v[PanGenerator] + p[PanGenerator], -500, 500) / 1000.0f;
+        region.attack = TimecentsToSeconds(v[AttackVolEnv] + p[AttackVolEnv]);
+        region.decay = TimecentsToSeconds(v[DecayVolEnv] + p[DecayVolEnv]);
+        region.sustain = (float)pow(10.0,
+            -Clamp(v[SustainVolEnv] + p[SustainVolEnv], 0, 1440) / 200.0);
+        region.release = TimecentsToSeconds(v[ReleaseVolEnv] + p[ReleaseVolEnv]);
+        region.sample = sample;
+        region.head = nullptr;
+        region.headLength = 0;
+
+        regions.Add(region);
+    }
+
+    void SoundFontClass::LoadHeads(const PresetChunks& chunks)
+    {
+        if(!streaming)
+        {
+            for(int i = 0; i < regions.Count; i++)
+            {
+                SoundFontRegion& region = regions[i];
+
+                region.head = samples + region.start;
+                region.headLength = region.end - region.start;
+            }
+
+            return;
+        }
+
+        // Presets share instruments, so the head of each sample is loaded
+        // once however many regions play it.
+        int headerCount = chunks.shdrCount - 1;
+        int* starts = new int[headerCount];
+        int* offsets = new int[headerCount];
+        int* lengths = new int[headerCount];
+        long long total = 0;
+
+        for(int i = 0; i < headerCount; i++)
+        {
+            offsets[i] = -1;
+        }
+
+        for(int i = 0; i < regions.Count; i++)
+        {
+            const SoundFontRegion& region = regions[i];
+            int sample = region.sample;
+
+            if(offsets[sample] >= 0)
+            {
+                continue;
+            }
+
+            const unsigned char* header = chunks.shdr + sample * SampleHeaderSize;
+            int start = Clamp(ReadDword(header + 20), 0, sampleCount);
+            int end = Clamp(ReadDword(header + 24), start, sampleCount);
+            long long frames = (long long)residentMilliseconds * region.sampleRate / 1000;
+
+            starts[sample] = start;
+            offsets[sample] = (int)total;
+            lengths[sample] = frames < end - start ? (int)frames : end - start;
+            total += lengths[sample];
+
+            if(total > 0x7FFFFFFF)
+            {
+                delete[] starts;
+                delete[] offsets;
+                delete[] lengths;
+
+                throw new SoundFontException("SoundFont sample heads too large.");
+            }
+        }
+
+        heads = new short[total > 0 ? (size_t)total : 1];
+
+        try
+        {
+            for(int i = 0; i < headerCount; i++)
+            {
+                if(offsets[i] >= 0 && lengths[i] > 0)
+                {
+                    ReadAt(dataOffset + (long long)starts[i] * sizeof(short),
+                        heads + offsets[i], lengths[i] * (int)sizeof(short));
+                }
+            }
+        }
+        catch(...)
+        {
+            delete[] starts;
+            delete[] offsets;
+            delete[] lengths;
+
+            throw;
+        }
+
+        // A region can start inside its sample, past some or all of the
+        // head.
+        for(int i = 0; i < regions.Count; i++)
+        {
+            SoundFontRegion& region = regions[i];
+            int sample = region.sample;
+            int skip = region.start - starts[sample];
+            int length = lengths[sample] - skip;
+
+            if(skip < 0 || length <= 0)
+            {
+                region.head = heads;
+                region.headLength = 0;
+            }
+            else
+            {
+                region.head = heads + offsets[sample] + skip;
+                region.headLength = length < region.end - region.start ? length :
+                    region.end - region.start;
+            }
+        }
+
+        delete[] starts;
+        delete[] offsets;
+        delete[] lengths;
+    }
+
+    // Sorts the presets by bank and program for FindPreset. Banks hold a
+    // few hundred presets at most, so an insertion sort will do.
+    void SoundFontClass::Sort()
+    {
+        for(int i = 1; i < presets.Count; i++)
+        {
+            SoundFontPreset preset = presets[i];
+            int key = (preset.bank << 7) | preset.program;
+            int j = i - 1;
+
+            while(j >= 0 && ((presets[j].bank << 7) | presets[j].program) > key)
+            {
+                presets[j + 1] = presets[j];
+                j--;
+            }
+
+            presets[j + 1] = preset;
+        }
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets the sample data.
+    /// </summary>
+    const short* SoundFontClass::get_Samples()
+    {
+        return samples;
+    }
+
+    /// <summary>
+    /// Gets the number of frames of sample data.
+    /// </summary>
+    int SoundFontClass::get_SampleCount()
+    {
+        return sampleCount;
+    }
+
+    /// <summary>
+    /// Gets the number of presets.
+    /// </summary>
+    int SoundFontClass::get_PresetCount()
+    {
+        return presets.Count;
+    }
+
+    /// <summary>
+    /// Gets a value indicating whether the samples are streamed.
+    /// </summary>
+    bool SoundFontClass::get_Streaming()
+    {
+        return streaming;
+    }
+
+    ENDREGION()
+
+    REGION(IDisposable Members)
+
+    void SoundFontClass::Dispose()
+    {
+        REGION(Guard)
+
+        if(disposed)
+        {
+            return;
+        }
+
+        ENDREGION()
+
+        if(view != nullptr)
+        {
+            UnmapViewOfFile(view);
+        }
+
+        if(mapping != nullptr)
+        {
+            CloseHandle(mapping);
+        }
+
+        if(file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(file);
+        }
+
+        delete[] heads;
+
+        view = nullptr;
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+        samples = nullptr;
+        sampleCount = 0;
+        heads = nullptr;
+
+        presets.Clear();
+        regions.Clear();
+
+        disposed = true;
+    }
+
+    ENDREGION()
+
+}}}
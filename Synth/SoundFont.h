@@ -0,0 +1,336 @@
+#ifndef SOUNDFONT_H
+#define SOUNDFONT_H
+
+#include "Types.h"
+#include "ArrayList.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    /// <summary>
+    /// Represents one key and velocity range of a SoundFont preset with the
+    /// sample it plays and how it plays it.
+    /// </summary>
+    /// <remarks>
+    /// A region is a preset zone and an instrument zone flattened into one:
+    /// the instrument values with the preset values added, and the ranges
+    /// of both intersected.
+    /// </remarks>
+    struct SoundFontRegion
+    {
+        // The keys and velocities the region plays for.
+        int keyLow;
+
+        int keyHigh;
+
+        int velocityLow;
+
+        int velocityHigh;
+
+        // The sample data in frames from the start of the smpl chunk: the
+        // first frame, one past the last, and the loop.
+        int start;
+
+        int end;
+
+        int loopStart;
+
+        int loopEnd;
+
+        // 0 plays once, 1 loops, and 3 loops until the note is released
+        // and then plays on to the end.
+        int loopMode;
+
+        // The key the sample plays at its own pitch, the tuning in cents,
+        // and the cents per key.
+        int rootKey;
+
+        int tune;
+
+        int scaleTuning;
+
+        // The rate in samples per second the sample was recorded at.
+        int sampleRate;
+
+        // The gain from the initial attenuation.
+        float gain;
+
+        // The position from -0.5 for left to 0.5 for right.
+        float pan;
+
+        // The volume envelope attack, decay and release times in seconds,
+        // and the sustain level as a gain.
+        float attack;
+
+        float decay;
+
+        float sustain;
+
+        float release;
+
+        // The sample header the region plays.
+        int sample;
+
+        // The frames from start on that are held in memory: all of them,
+        // unless the SoundFont streams its samples.
+        const short* head;
+
+        int headLength;
+    };
+
+    /// <summary>
+    /// Represents a SoundFont preset and its regions.
+    /// </summary>
+    struct SoundFontPreset
+    {
+        char name[21];
+
+        int bank;
+
+        int program;
+
+        // The regions of the preset in the SoundFont's region list.
+        int firstRegion;
+
+        int regionCount;
+    };
+
+    class SoundFontClass;
+    typedef SoundFontClass& SoundFont;
+
+    /// <summary>
+    /// Loads a SoundFont 2 bank with its sample data memory-mapped.
+    /// </summary>
+    /// <remarks>
+    /// The file is mapped into memory rather than read, a view of each
+    /// chunk it needs rather than of the whole file. Only the preset data
+    /// chunk (pdta), which is small whatever the size of the bank, is
+    /// parsed when the bank is opened, and its view is unmapped once it
+    /// has been; the sample data chunk (smpl) is never read by the loader,
+    /// so its pages are brought in by the operating system the first time
+    /// a note plays them. Opening a 2 GB bank for a song that uses a few
+    /// instruments therefore costs about as much time and memory as
+    /// opening a small one.
+    ///
+    /// Every preset is flattened into regions when the bank is opened, so
+    /// finding the samples for a note is a search over a short list.
+    /// Presets are kept sorted by bank and program.
+    ///
+    /// A bank too large for the address space, or whose pages should not be
+    /// faulted in by the audio thread, can be opened for streaming instead.
+    /// The file is then not mapped: the preset data is read, and only the
+    /// first milliseconds of each sample are loaded into memory as the
+    /// region heads. The rest is read with ReadSamples, normally by a
+    /// SampleStreamer while the heads play. A bank opened for mapping whose
+    /// sample data does not fit, as a large bank in a 32-bit process
+    /// often does not, is streamed this way on its own, keeping
+    /// FallbackResidentMilliseconds of each sample in memory.
+    /// </remarks>
+    class SoundFontClass : public IDisposableIf
+    {
+        REGION(SoundFont Members)
+
+        REGION(Constants)
+
+    public:
+
+        /// <summary>
+        /// The bank holding percussion presets.
+        /// </summary>
+        static const int PercussionBank = 128;
+
+        /// <summary>
+        /// The length in milliseconds of the start of each sample kept in
+        /// memory when a bank opened for mapping is too large to map and is
+        /// streamed instead.
+        /// </summary>
+        static const int FallbackResidentMilliseconds = 250;
+
+        ENDREGION()
+
+        REGION(Fields)
+
+    private:
+
+        // The file, its mapping and the view of the sample data.
+        void* file;
+
+        void* mapping;
+
+        const unsigned char* view;
+
+        long long length;
+
+        // The 16-bit sample data inside the view, and its offset in the
+        // file.
+        const short* samples;
+
+        int sampleCount;
+
+        long long dataOffset;
+
+        // Indicates whether the samples are streamed, and the heads kept
+        // in memory when they are.
+        bool streaming;
+
+        int residentMilliseconds;
+
+        short* heads;
+
+        ArrayList<SoundFontPreset> presets;
+
+        ArrayList<SoundFontRegion> regions;
+
+        bool disposed;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the SoundFont class with the
+        /// specified file.
+        /// </summary>
+        SoundFontClass(string fileName);
+
+        /// <summary>
+        /// Initializes a new instance of the SoundFont class that streams
+        /// the samples of the specified file.
+        /// </summary>
+        /// <param name="fileName">
+        /// The SoundFont file.
+        /// </param>
+        /// <param name="residentMilliseconds">
+        /// The length of the start of each sample kept in memory.
+        /// </param>
+        SoundFontClass(string fileName, int residentMilliseconds);
+
+        ~SoundFontClass();
+
+    private:
+
+        SoundFontClass(const SoundFontClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Finds the preset for the specified bank and program.
+        /// </summary>
+        /// <returns>
+        /// The preset, or nullptr if the bank has no such preset.
+        /// </returns>
+        const SoundFontPreset* FindPreset(int bank, int program);
+
+        /// <summary>
+        /// Gets the region at the specified index of the region list.
+        /// </summary>
+        const SoundFontRegion& GetRegion(int index);
+
+        /// <summary>
+        /// Reads sample frames from the file.
+        /// </summary>
+        /// <param name="frame">
+        /// The first frame, from the start of the sample data.
+        /// </param>
+        /// <param name="buffer">
+        /// The buffer that receives the frames.
+        /// </param>
+        /// <param name="count">
+        /// The number of frames.
+        /// </param>
+        /// <returns>
+        /// true if the frames were read; otherwise, false.
+        /// </returns>
+        /// <remarks>
+        /// Each read is positioned independently, so threads can read at
+        /// the same time.
+        /// </remarks>
+        bool ReadSamples(int frame, short* buffer, int count);
+
+    private:
+
+        // The records of the preset data chunk.
+        struct PresetChunks;
+
+        void Open(string fileName);
+
+        // Reads part of the file with ReadFile.
+        void ReadAt(long long offset, void* buffer, int count);
+
+        void Parse();
+
+        // Maps the sample data, or falls back to streaming it.
+        void MapSamples();
+
+        void ParsePresets(const unsigned char* pdta, long long size);
+
+        // Flattens the zones of one preset into regions.
+        void AddRegions(const PresetChunks& chunks, SoundFontPreset& preset,
+            int firstBag, int lastBag);
+
+        // Adds the region of one instrument zone played by one preset
+        // zone.
+        void AddRegion(const PresetChunks& chunks, const int* presetValues,
+            const int* instrumentValues);
+
+        // Points the regions at their sample data, loading the heads of
+        // a streamed bank.
+        void LoadHeads(const PresetChunks& chunks);
+
+        void Sort();
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets the sample data, or nullptr if the samples are streamed.
+        /// </summary>
+        ReadOnlyProperty<const short*> Samples;
+
+        /// <summary>
+        /// Gets the number of frames of sample data.
+        /// </summary>
+        ReadOnlyProperty<int> SampleCount;
+
+        /// <summary>
+        /// Gets the number of presets.
+        /// </summary>
+        ReadOnlyProperty<int> PresetCount;
+
+        /// <summary>
+        /// Gets a value indicating whether the samples are streamed.
+        /// </summary>
+        ReadOnlyProperty<bool> Streaming;
+
+        ENDREGION()
+
+        ENDREGION()
+
+        REGION(IDisposable Members)
+
+    public:
+
+        void Dispose();
+
+        ENDREGION()
+
+    private:
+        void init();
+        const short* get_Samples();
+        int get_SampleCount();
+        int get_PresetCount();
+        bool get_Streaming();
+
+    };
+
+}}}
+
+#endif
@@ -0,0 +1,1543 @@
+#include <windows.h>
+#include <math.h>
+#include "Synthesizer.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef SynthesizerClass cls;
+
+    static const double Pi = 3.14159265358979323846;
+
+    // The pitch wheel value with no bend.
+    static const int PitchWheelCenter = 8192;
+
+    // The registered parameter number of the pitch bend range, and the
+    // value meaning no parameter is selected.
+    static const int PitchBendRangeParameter = 0;
+    static const int NullParameter = 0x3FFF;
+
+    // The channel General MIDI reserves for percussion.
+    static const int PercussionChannel = 9;
+
+    static const double Sqrt2 = 1.41421356237309504880;
+
+    // The seconds of audio over which the rendering load is measured, the
+    // loads above and below which the pressure on quality rises and falls,
+    // and the most steps quality is lowered by.
+    static const double LoadWindow = 0.05;
+    static const double HighLoad = 0.8;
+    static const double LowLoad = 0.5;
+    static const int MaxPressure = 2;
+
+    // The rate of the vibrato LFO in cycles per second, and its depth in
+    // cents with the ModulationWheel all the way up, which is what the
+    // SoundFont 2 default modulator gives.
+    static const double VibratoRate = 5.0;
+    static const double MaxVibratoCents = 50.0;
+
+    // The time constant in seconds of the smoothing of controllers, and the
+    // distance at which a smoothed value snaps to its target, which keeps
+    // it out of the denormal range.
+    static const double SmoothingTime = 0.005;
+    static const float SmoothingFloor = 1.0e-6f;
+
+    // The EffectsLevel General MIDI 2 sets a channel to on reset.
+    static const int DefaultEffectsLevel = 40;
+
+    // Moves a smoothed value a share of the way to its target.
+    static float Smooth(float value, float target, float share)
+    {
+        float difference = target - value;
+
+        return fabs(difference) < SmoothingFloor ? target : value + difference * share;
+    }
+
+    void cls::init()
+    {
+        this->SampleRate = Functor::New(this, &cls::get_SampleRate);
+        this->VoiceCount = Functor::New(this, &cls::get_VoiceCount);
+        this->ActiveVoices = Functor::New(this, &cls::get_ActiveVoices);
+        this->Stealing = Functor::New(this, &cls::get_Stealing, &cls::set_Stealing);
+        this->SoundFont = Functor::New(this, &cls::get_SoundFont, &cls::set_SoundFont);
+        this->Quality = Functor::New(this, &cls::get_Quality, &cls::set_Quality);
+        this->AdaptiveQuality = Functor::New(this, &cls::get_AdaptiveQuality,
+            &cls::set_AdaptiveQuality);
+        this->Underruns = Functor::New(this, &cls::get_Underruns);
+        this->WaitForData = Functor::New(this, &cls::get_WaitForData, &cls::set_WaitForData);
+        this->ControlRate = Functor::New(this, &cls::get_ControlRate, &cls::set_ControlRate);
+        this->Effects = Functor::New(this, &cls::get_Effects, &cls::set_Effects);
+        this->Reverb = Functor::New(this, &cls::get_Reverb);
+        this->Chorus = Functor::New(this, &cls::get_Chorus);
+        this->sampleRate = 0;
+        this->voices = nullptr;
+        this->bank = nullptr;
+        this->sampleBank = nullptr;
+        this->envelopes = nullptr;
+        this->controlRate = DefaultControlRate;
+        this->controlPhase = 0;
+        this->smoothing = 1.0f;
+        this->reverb = nullptr;
+        this->chorus = nullptr;
+        this->effects = true;
+        this->reverbSend = nullptr;
+        this->chorusSend = nullptr;
+        this->soundFont = nullptr;
+        this->streamer = nullptr;
+        this->waitForData = false;
+        this->voiceCount = 0;
+        this->activeCount = 0;
+        this->nextSerial = 0;
+        this->noteSerial = 0;
+        this->stealing = VoiceStealing::Oldest;
+        this->quality = ResamplerQuality::Sinc;
+        this->adaptiveQuality = false;
+        this->pressure = 0;
+        this->busySeconds = 0.0;
+        this->renderedSeconds = 0.0;
+
+        for(int i = 0; i < ProgramCount; i++)
+        {
+            patches[i].waveform = Waveform::Sine;
+            patches[i].wavetable = nullptr;
+            patches[i].wavetableSize = 0;
+            patches[i].attack = 0.005f;
+            patches[i].decay = 0.0f;
+            patches[i].sustain = 1.0f;
+            patches[i].release = 0.1f;
+        }
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the Synthesizer class with the
+    /// specified sample rate and number of voices.
+    /// </summary>
+    /// <param name="sampleRate">
+    /// The sample rate in samples per second.
+    /// </param>
+    /// <param name="voiceCount">
+    /// The number of voices that can play at once.
+    /// </param>
+    SynthesizerClass::SynthesizerClass(int sampleRate, int voiceCount)
+    {
+        init();
+
+        REGION(Require)
+
+        if(sampleRate <= 0)
+        {
+            throw new ArgumentOutOfRangeException("sampleRate", sampleRate,
+                "Sample rate out of range.");
+        }
+        else if(voiceCount <= 0)
+        {
+            throw new ArgumentOutOfRangeException("voiceCount", voiceCount,
+                "Voice count out of range.");
+        }
+
+        ENDREGION()
+
+        this->sampleRate = sampleRate;
+        this->voiceCount = voiceCount;
+        this->voices = new Voice[voiceCount];
+        this->bank = new OscillatorBankClass(voiceCount);
+        this->sampleBank = new SampleBankClass(voiceCount);
+        this->envelopes = new EnvelopeBankClass(voiceCount);
+        this->reverb = new ReverbClass(sampleRate);
+        this->chorus = new ChorusClass(sampleRate);
+        this->reverbSend = new float[OscillatorBankClass::MaxBlockSize];
+        this->chorusSend = new float[OscillatorBankClass::MaxBlockSize];
+
+        set_ControlRate(DefaultControlRate);
+        Reset();
+    }
+
+    SynthesizerClass::~SynthesizerClass()
+    {
+        delete[] voices;
+        delete bank;
+        delete sampleBank;
+        delete envelopes;
+        delete reverb;
+        delete chorus;
+        delete[] reverbSend;
+        delete[] chorusSend;
+        delete streamer;
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Plays a ChannelMessage.
+    /// </summary>
+    /// <param name="message">
+    /// The ChannelMessage as a packed integer.
+    /// </param>
+    void SynthesizerClass::Process(int message)
+    {
+        int channel = ChannelMessageClass::UnpackMidiChannel(message);
+        int data1 = ShortMessageClass::UnpackData1(message);
+        int data2 = ShortMessageClass::UnpackData2(message);
+
+        switch(ChannelMessageClass::UnpackCommand(message))
+        {
+            case ChannelCommand::NoteOn:
+                // A NoteOn with zero velocity is a NoteOff.
+                if(data2 == 0)
+                {
+                    NoteOff(channel, data1);
+                }
+                else
+                {
+                    NoteOn(channel, data1, data2);
+                }
+                break;
+
+            case ChannelCommand::NoteOff:
+                NoteOff(channel, data1);
+                break;
+
+            case ChannelCommand::Controller:
+                Controller(channel, data1, data2);
+                break;
+
+            case ChannelCommand::ProgramChange:
+                channels[channel].program = data1;
+                SelectPreset(channel);
+                break;
+
+            case ChannelCommand::PitchWheel:
+                channels[channel].pitchBend = (data2 << 7) | data1;
+                UpdatePitch(channel);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    /// <summary>
+    /// Renders the playing voices.
+    /// </summary>
+    /// <param name="left">
+    /// The buffer that receives the left channel.
+    /// </param>
+    /// <param name="right">
+    /// The buffer that receives the right channel.
+    /// </param>
+    /// <param name="count">
+    /// The number of samples to render.
+    /// </param>
+    void SynthesizerClass::Render(float* left, float* right, int count)
+    {
+        Render(left, right, nullptr, nullptr, count);
+    }
+
+    void SynthesizerClass::Render(float* left, float* right, float* reverb, float* chorus, int count)
+    {
+        double started = adaptiveQuality ? GetSeconds() : 0.0;
+
+        for(int i = 0; i < count; i++)
+        {
+            left[i] = 0.0f;
+            right[i] = 0.0f;
+        }
+
+        for(int start = 0; start < count; start += OscillatorBankClass::MaxBlockSize)
+        {
+            int n = count - start < OscillatorBankClass::MaxBlockSize ?
+                count - start : OscillatorBankClass::MaxBlockSize;
+            float* l = left + start;
+            float* r = right + start;
+
+            for(int i = 0; i < n; i++)
+            {
+                reverbSend[i] = 0.0f;
+                chorusSend[i] = 0.0f;
+            }
+
+            // The modulation is evaluated on a grid of samples that does
+            // not depend on how the output is divided into blocks.
+            for(int offset = 0; offset < n; )
+            {
+                if(controlPhase == 0)
+                {
+                    UpdateControl();
+                }
+
+                int length = controlRate - controlPhase;
+
+                if(length > n - offset)
+                {
+                    length = n - offset;
+                }
+
+                bank->Render(l + offset, r + offset, reverbSend + offset, chorusSend + offset,
+                    length);
+                sampleBank->Render(l + offset, r + offset, reverbSend + offset,
+                    chorusSend + offset, length);
+
+                offset += length;
+                controlPhase = (controlPhase + length) % controlRate;
+            }
+
+            if(reverb != nullptr)
+            {
+                for(int i = 0; i < n; i++)
+                {
+                    reverb[start + i] = reverbSend[i];
+                    chorus[start + i] = chorusSend[i];
+                }
+            }
+            else
+            {
+                ProcessEffects(reverbSend, chorusSend, l, r, n);
+            }
+        }
+
+        for(int n = 0; n < voiceCount; n++)
+        {
+            const Voice& voice = voices[n];
+
+            if(voice.state == VoiceFree)
+            {
+                continue;
+            }
+
+            // A sample that does not loop can end before the note does.
+            if((voice.state == VoiceReleasing && GetLevel(n) <= 0.0f) ||
+                (voice.region != nullptr && !sampleBank->IsPlaying(n)))
+            {
+                Free(n);
+            }
+        }
+
+        if(adaptiveQuality)
+        {
+            MeasureLoad(GetSeconds() - started, count);
+        }
+    }
+
+    /// <summary>
+    /// Renders the playing voices, playing each of the specified messages
+    /// at the sample it is due.
+    /// </summary>
+    /// <param name="left">
+    /// The buffer that receives the left channel.
+    /// </param>
+    /// <param name="right">
+    /// The buffer that receives the right channel.
+    /// </param>
+    /// <param name="count">
+    /// The number of samples to render.
+    /// </param>
+    /// <param name="messages">
+    /// The messages in order of their timestamps, which are sample frames.
+    /// </param>
+    /// <param name="messageCount">
+    /// The number of messages.
+    /// </param>
+    /// <param name="position">
+    /// The sample frame of the first sample of the block.
+    /// </param>
+    /// <returns>
+    /// The number of messages played. Messages due at or after the end of
+    /// the block are left for the next call; messages already late are
+    /// played at the start of the block.
+    /// </returns>
+    int SynthesizerClass::Render(float* left, float* right, int count,
+        const TimestampedMessage* messages, int messageCount, long long position)
+    {
+        return Render(left, right, nullptr, nullptr, count, messages, messageCount, position);
+    }
+
+    /// <summary>
+    /// Renders the playing voices without the effects, playing each of the
+    /// specified messages at the sample it is due.
+    /// </summary>
+    /// <param name="left">
+    /// The buffer that receives the left channel.
+    /// </param>
+    /// <param name="right">
+    /// The buffer that receives the right channel.
+    /// </param>
+    /// <param name="reverb">
+    /// The buffer that receives the reverb send.
+    /// </param>
+    /// <param name="chorus">
+    /// The buffer that receives the chorus send.
+    /// </param>
+    /// <param name="count">
+    /// The number of samples to render.
+    /// </param>
+    /// <param name="messages">
+    /// The messages in order of their timestamps, which are sample frames.
+    /// </param>
+    /// <param name="messageCount">
+    /// The number of messages.
+    /// </param>
+    /// <param name="position">
+    /// The sample frame of the first sample of the block.
+    /// </param>
+    /// <returns>
+    /// The number of messages played.
+    /// </returns>
+    int SynthesizerClass::Render(float* left, float* right, float* reverb, float* chorus, int count,
+        const TimestampedMessage* messages, int messageCount, long long position)
+    {
+        long long end = position + count;
+        int offset = 0;
+        int played = 0;
+
+        // Render the run up to each message, then play it, so it takes
+        // effect on exactly its sample. Without send buffers the runs
+        // get the effects.
+        while(played < messageCount && messages[played].timestamp < end)
+        {
+            long long due = messages[played].timestamp - position;
+            int at = due > offset ? (int)due : offset;
+
+            if(at > offset)
+            {
+                Render(left + offset, right + offset,
+                    reverb != nullptr ? reverb + offset : nullptr,
+                    chorus != nullptr ? chorus + offset : nullptr, at - offset);
+                offset = at;
+            }
+
+            Process(messages[played].message);
+            played++;
+        }
+
+        if(offset < count)
+        {
+            Render(left + offset, right + offset,
+                reverb != nullptr ? reverb + offset : nullptr,
+                chorus != nullptr ? chorus + offset : nullptr, count - offset);
+        }
+
+        return played;
+    }
+
+    /// <summary>
+    /// Runs the reverb and chorus on the specified sends and adds them to
+    /// the output, if Effects is on.
+    /// </summary>
+    /// <param name="reverb">
+    /// The reverb send.
+    /// </param>
+    /// <param name="chorus">
+    /// The chorus send.
+    /// </param>
+    /// <param name="left">
+    /// The buffer the left channel is added to.
+    /// </param>
+    /// <param name="right">
+    /// The buffer the right channel is added to.
+    /// </param>
+    /// <param name="count">
+    /// The number of samples.
+    /// </param>
+    void SynthesizerClass::ProcessEffects(const float* reverb, const float* chorus, float* left,
+        float* right, int count)
+    {
+        if(effects)
+        {
+            this->reverb->Process(reverb, left, right, count);
+            this->chorus->Process(chorus, left, right, count);
+        }
+    }
+
+    /// <summary>
+    /// Renders the playing voices, playing each message in the specified
+    /// ShortMessageRing at the sample it is due.
+    /// </summary>
+    /// <param name="left">
+    /// The buffer that receives the left channel.
+    /// </param>
+    /// <param name="right">
+    /// The buffer that receives the right channel.
+    /// </param>
+    /// <param name="count">
+    /// The number of samples to render.
+    /// </param>
+    /// <param name="ring">
+    /// The ring to read from, whose timestamps are sample frames. Only the
+    /// messages due before the end of the block are read.
+    /// </param>
+    /// <param name="position">
+    /// The sample frame of the first sample of the block.
+    /// </param>
+    void SynthesizerClass::Render(float* left, float* right, int count, ShortMessageRing ring,
+        long long position)
+    {
+        const int BatchSize = 64;
+        TimestampedMessage batch[BatchSize];
+        long long end = position + count;
+        int offset = 0;
+        int read;
+
+        // Read the ring in batches, rendering each batch's runs before
+        // reading the next, so the stack buffer stays small however many
+        // messages are due. A short batch does not mean none are left, as
+        // the producer may have written more meanwhile, so the ring is
+        // read until nothing due is found; each empty read rereads the
+        // producer's index.
+        do
+        {
+            read = ring.PopBefore(end, batch, BatchSize);
+
+            for(int i = 0; i < read; i++)
+            {
+                long long due = batch[i].timestamp - position;
+                int at = due > offset ? (int)due : offset;
+
+                if(at > offset)
+                {
+                    Render(left + offset, right + offset, at - offset);
+                    offset = at;
+                }
+
+                Process(batch[i].message);
+            }
+        }
+        while(read > 0);
+
+        if(offset < count)
+        {
+            Render(left + offset, right + offset, count - offset);
+        }
+    }
+
+    /// <summary>
+    /// Silences every voice and resets every channel.
+    /// </summary>
+    void SynthesizerClass::Reset()
+    {
+        for(int i = 0; i < voiceCount; i++)
+        {
+            voices[i].state = VoiceFree;
+            voices[i].region = nullptr;
+            bank->Stop(i);
+            sampleBank->Stop(i);
+            envelopes->Stop(i);
+        }
+
+        activeCount = 0;
+
+        reverb->Clear();
+        chorus->Clear();
+
+        for(int i = 0; i < ChannelCount; i++)
+        {
+            channels[i].program = 0;
+            channels[i].bankSelect = 0;
+            channels[i].bankSelectFine = 0;
+            channels[i].hold = false;
+            channels[i].depth = 0.0f;
+            channels[i].lfoPhase = 0.0;
+            channels[i].vibrato = 1.0f;
+            channels[i].vibratoChanged = false;
+            channels[i].reverb = (float)DefaultEffectsLevel / 127.0f;
+            channels[i].chorus = 0.0f;
+            channels[i].celeste = 0.0f;
+            channels[i].phaser = 0.0f;
+            SelectPreset(i);
+            ResetChannel(i);
+            UpdatePan(i, 64);
+            channels[i].volume = (100.0f / 127.0f) * (100.0f / 127.0f);
+            channels[i].smoothLeft = channels[i].volume * channels[i].left;
+            channels[i].smoothRight = channels[i].volume * channels[i].right;
+            channels[i].smoothReverb = channels[i].volume * channels[i].reverb;
+            channels[i].smoothChorus = 0.0f;
+        }
+    }
+
+    /// <summary>
+    /// Sets the sound played for the specified program.
+    /// </summary>
+    void SynthesizerClass::SetPatch(int program, const Patch& patch)
+    {
+        REGION(Require)
+
+        if(program < 0 || program >= ProgramCount)
+        {
+            throw new ArgumentOutOfRangeException("program", program,
+                "Program out of range.");
+        }
+
+        ENDREGION()
+
+        patches[program] = patch;
+    }
+
+    /// <summary>
+    /// Gets the sound played for the specified program.
+    /// </summary>
+    const Patch& SynthesizerClass::GetPatch(int program)
+    {
+        REGION(Require)
+
+        if(program < 0 || program >= ProgramCount)
+        {
+            throw new ArgumentOutOfRangeException("program", program,
+                "Program out of range.");
+        }
+
+        ENDREGION()
+
+        return patches[program];
+    }
+
+    /// <summary>
+    /// Copies the patches, voice stealing, SoundFont, quality, streaming,
+    /// control rate and effects settings of another Synthesizer.
+    /// </summary>
+    void SynthesizerClass::CopySettings(Synthesizer other)
+    {
+        for(int i = 0; i < ProgramCount; i++)
+        {
+            patches[i] = other.patches[i];
+        }
+
+        stealing = other.stealing;
+        quality = other.quality;
+        adaptiveQuality = other.adaptiveQuality;
+        waitForData = other.waitForData;
+
+        effects = other.effects;
+        reverb->Time = (float)other.reverb->Time;
+        reverb->Damping = (float)other.reverb->Damping;
+        chorus->Rate = (float)other.chorus->Rate;
+        chorus->Depth = (float)other.chorus->Depth;
+
+        set_ControlRate(other.controlRate);
+        SetSoundFont(other.soundFont);
+    }
+
+    void SynthesizerClass::NoteOn(int channel, int note, int velocity)
+    {
+        noteSerial = nextSerial;
+
+        if(channels[channel].preset != nullptr)
+        {
+            NoteOnSampled(channel, note, velocity);
+
+            return;
+        }
+
+        int index = Allocate(channel, note);
+        Voice& voice = voices[index];
+        const Patch& patch = patches[channels[channel].program];
+        float level = 0.0f;
+
+        if(voice.state == VoiceFree)
+        {
+            activeCount++;
+        }
+        // A stolen voice keeps its level and attacks from there, which
+        // avoids a click when it is retriggered.
+        else if(voice.region == nullptr && voice.waveform == patch.waveform)
+        {
+            level = bank->GetLevel(index);
+        }
+        else if(voice.region != nullptr)
+        {
+            sampleBank->Stop(index);
+        }
+
+        voice.state = VoiceHeld;
+        voice.region = nullptr;
+        voice.regionLeft = 1.0f;
+        voice.regionRight = 1.0f;
+        voice.regionGain = 1.0f;
+        voice.channel = channel;
+        voice.note = note;
+        voice.velocity = ((float)velocity / 127.0f) * ((float)velocity / 127.0f);
+        voice.serial = nextSerial++;
+        voice.waveform = patch.waveform;
+        voice.increment = (float)GetIncrement(channel, note);
+
+        Envelope envelope = { patch.attack, patch.decay, patch.sustain, patch.release };
+
+        bank->Start(index, patch.waveform, voice.increment * channels[channel].vibrato,
+            patch.wavetable, patch.wavetableSize);
+        StartControl(index, envelope, level);
+    }
+
+    void SynthesizerClass::NoteOnSampled(int channel, int note, int velocity)
+    {
+        const SoundFontPreset* preset = channels[channel].preset;
+
+        for(int r = 0; r < preset->regionCount; r++)
+        {
+            const SoundFontRegion& region = soundFont->GetRegion(preset->firstRegion + r);
+
+            if(note < region.keyLow || note > region.keyHigh ||
+                velocity < region.velocityLow || velocity > region.velocityHigh)
+            {
+                continue;
+            }
+
+            int index = Allocate(channel, note);
+            Voice& voice = voices[index];
+            float level = 0.0f;
+
+            if(voice.state == VoiceFree)
+            {
+                activeCount++;
+            }
+            else if(voice.region != nullptr)
+            {
+                level = sampleBank->GetLevel(index);
+            }
+            else
+            {
+                bank->Stop(index);
+            }
+
+            // The region pans with the same constant power law as the
+            // channel, scaled so a centred region keeps unity gain.
+            double angle = (region.pan + 0.5) * Pi / 2.0;
+
+            voice.state = VoiceHeld;
+            voice.channel = channel;
+            voice.note = note;
+            voice.velocity = ((float)velocity / 127.0f) * ((float)velocity / 127.0f);
+            voice.serial = nextSerial++;
+            voice.region = &region;
+            voice.regionLeft = region.gain * (float)(cos(angle) * Sqrt2);
+            voice.regionRight = region.gain * (float)(sin(angle) * Sqrt2);
+            voice.regionGain = region.gain;
+            voice.increment = (float)GetSampleIncrement(channel, note, region);
+
+            Envelope envelope = { region.attack, region.decay, region.sustain, region.release };
+
+            // The sample data is only touched from here on, so a bank's
+            // pages are read in as its notes first play. The voice plays
+            // the region's head, and the rest of a streamed sample is read
+            // ahead of it from here on.
+            sampleBank->Start(index, region.head, 0, region.end - region.start,
+                region.loopStart - region.start, region.loopEnd - region.start,
+                region.loopMode != 0, voice.increment * channels[channel].vibrato,
+                GetQuality(index));
+            StartControl(index, envelope, level);
+
+            if(region.headLength < region.end - region.start)
+            {
+                sampleBank->Stream(index, region.start, region.headLength);
+            }
+        }
+    }
+
+    // Resolves the preset the way General MIDI banks expect: BankSelect
+    // chooses the bank, or BankSelectFine when BankSelect is zero, as XG
+    // uses it for variations; the percussion channel always uses the
+    // percussion bank. A missing variation falls back to bank zero.
+    void SynthesizerClass::SelectPreset(int channel)
+    {
+        Channel& state = channels[channel];
+
+        if(soundFont == nullptr)
+        {
+            state.preset = nullptr;
+
+            return;
+        }
+
+        int bank = channel == PercussionChannel ? SoundFontClass::PercussionBank :
+            state.bankSelect != 0 ? state.bankSelect : state.bankSelectFine;
+
+        state.preset = soundFont->FindPreset(bank, state.program);
+
+        if(state.preset == nullptr)
+        {
+            state.preset = channel == PercussionChannel ?
+                soundFont->FindPreset(SoundFontClass::PercussionBank, 0) :
+                soundFont->FindPreset(0, state.program);
+        }
+    }
+
+    void SynthesizerClass::SetSoundFont(SoundFontClass* value)
+    {
+        // Sampled voices point into the old SoundFont.
+        for(int i = 0; i < voiceCount; i++)
+        {
+            if(voices[i].state != VoiceFree && voices[i].region != nullptr)
+            {
+                Free(i);
+            }
+        }
+
+        sampleBank->SetStreamer(nullptr);
+
+        delete streamer;
+
+        streamer = nullptr;
+        soundFont = value;
+
+        if(soundFont != nullptr && soundFont->Streaming)
+        {
+            streamer = new SampleStreamerClass(*soundFont, voiceCount);
+            streamer->Blocking = waitForData;
+
+            sampleBank->SetStreamer(streamer);
+        }
+
+        for(int i = 0; i < ChannelCount; i++)
+        {
+            SelectPreset(i);
+        }
+    }
+
+    float SynthesizerClass::GetLevel(int index)
+    {
+        return voices[index].region != nullptr ? sampleBank->GetLevel(index) :
+            bank->GetLevel(index);
+    }
+
+    void SynthesizerClass::StartControl(int index, const Envelope& envelope, float level)
+    {
+        Voice& voice = voices[index];
+
+        // The envelope is run on to the end of the control period under
+        // way, so the note starts on its own sample rather than at the
+        // next evaluation.
+        int remaining = controlRate - controlPhase;
+
+        envelopes->Start(index, envelope, level);
+        envelopes->Advance(index, (float)remaining / sampleRate);
+
+        float step = (envelopes->GetLevel(index) - level) / remaining;
+
+        GetGains(index, voice.leftGain, voice.rightGain);
+        GetSends(index, voice.reverbGain, voice.chorusGain);
+
+        if(voice.region != nullptr)
+        {
+            sampleBank->SetLevel(index, level, step);
+            sampleBank->SetGain(index, voice.leftGain, voice.rightGain, 0.0f, 0.0f);
+            sampleBank->SetSend(index, voice.reverbGain, voice.chorusGain, 0.0f, 0.0f);
+        }
+        else
+        {
+            bank->SetLevel(index, level, step);
+            bank->SetGain(index, voice.leftGain, voice.rightGain, 0.0f, 0.0f);
+            bank->SetSend(index, voice.reverbGain, voice.chorusGain, 0.0f, 0.0f);
+        }
+    }
+
+    void SynthesizerClass::UpdateControl()
+    {
+        float seconds = (float)controlRate / sampleRate;
+
+        for(int i = 0; i < ChannelCount; i++)
+        {
+            Channel& state = channels[i];
+            float gain = state.volume * state.expression;
+            float previous = state.vibrato;
+            float modulation = state.chorus + state.celeste + state.phaser;
+
+            if(modulation > 1.0f)
+            {
+                modulation = 1.0f;
+            }
+
+            state.smoothLeft = Smooth(state.smoothLeft, gain * state.left, smoothing);
+            state.smoothRight = Smooth(state.smoothRight, gain * state.right, smoothing);
+            state.smoothReverb = Smooth(state.smoothReverb, gain * state.reverb, smoothing);
+            state.smoothChorus = Smooth(state.smoothChorus, gain * modulation, smoothing);
+            state.depth = Smooth(state.depth, state.modulation, smoothing);
+            state.lfoPhase += VibratoRate * seconds;
+            state.lfoPhase -= floor(state.lfoPhase);
+
+            if(state.depth > 0.0f)
+            {
+                double cents = sin(2.0 * Pi * state.lfoPhase) * state.depth * MaxVibratoCents;
+
+                state.vibrato = (float)pow(2.0, cents / 1200.0);
+            }
+            else
+            {
+                state.vibrato = 1.0f;
+            }
+
+            state.vibratoChanged = state.vibrato != previous;
+        }
+
+        envelopes->Advance(seconds);
+
+        // Every ramp starts where the last one ended and reaches the new
+        // values at the end of the period.
+        for(int n = 0; n < voiceCount; n++)
+        {
+            Voice& voice = voices[n];
+
+            if(voice.state == VoiceFree)
+            {
+                continue;
+            }
+
+            const Channel& state = channels[voice.channel];
+            float level = GetLevel(n);
+            float step = (envelopes->GetLevel(n) - level) / controlRate;
+            float left;
+            float right;
+            float reverbGain;
+            float chorusGain;
+
+            GetGains(n, left, right);
+            GetSends(n, reverbGain, chorusGain);
+
+            float leftStep = (left - voice.leftGain) / controlRate;
+            float rightStep = (right - voice.rightGain) / controlRate;
+            float reverbStep = (reverbGain - voice.reverbGain) / controlRate;
+            float chorusStep = (chorusGain - voice.chorusGain) / controlRate;
+
+            if(voice.region != nullptr)
+            {
+                sampleBank->SetLevel(n, level, step);
+                sampleBank->SetGain(n, voice.leftGain, voice.rightGain, leftStep, rightStep);
+                sampleBank->SetSend(n, voice.reverbGain, voice.chorusGain, reverbStep,
+                    chorusStep);
+
+                if(state.vibratoChanged)
+                {
+                    sampleBank->SetIncrement(n, voice.increment * state.vibrato);
+                }
+            }
+            else
+            {
+                bank->SetLevel(n, level, step);
+                bank->SetGain(n, voice.leftGain, voice.rightGain, leftStep, rightStep);
+                bank->SetSend(n, voice.reverbGain, voice.chorusGain, reverbStep, chorusStep);
+
+                if(state.vibratoChanged)
+                {
+                    bank->SetIncrement(n, voice.increment * state.vibrato);
+                }
+            }
+
+            voice.leftGain = left;
+            voice.rightGain = right;
+            voice.reverbGain = reverbGain;
+            voice.chorusGain = chorusGain;
+        }
+    }
+
+    void SynthesizerClass::GetGains(int index, float& left, float& right)
+    {
+        const Voice& voice = voices[index];
+        const Channel& state = channels[voice.channel];
+
+        left = voice.velocity * state.smoothLeft * voice.regionLeft;
+        right = voice.velocity * state.smoothRight * voice.regionRight;
+    }
+
+    void SynthesizerClass::GetSends(int index, float& reverb, float& chorus)
+    {
+        const Voice& voice = voices[index];
+        const Channel& state = channels[voice.channel];
+
+        reverb = voice.velocity * state.smoothReverb * voice.regionGain;
+        chorus = voice.velocity * state.smoothChorus * voice.regionGain;
+    }
+
+    ResamplerQuality SynthesizerClass::GetQuality(int index)
+    {
+        int steps = pressure;
+
+        if(pressure > 0 && voices[index].state == VoiceReleasing)
+        {
+            steps++;
+        }
+
+        return steps >= (int)quality ? ResamplerQuality::Linear :
+            (ResamplerQuality)((int)quality - steps);
+    }
+
+    void SynthesizerClass::UpdateQuality()
+    {
+        for(int i = 0; i < voiceCount; i++)
+        {
+            if(voices[i].state != VoiceFree && voices[i].region != nullptr)
+            {
+                sampleBank->SetQuality(i, GetQuality(i));
+            }
+        }
+    }
+
+    void SynthesizerClass::MeasureLoad(double seconds, int count)
+    {
+        busySeconds += seconds;
+        renderedSeconds += (double)count / sampleRate;
+
+        if(renderedSeconds < LoadWindow)
+        {
+            return;
+        }
+
+        double load = busySeconds / renderedSeconds;
+        int previous = pressure;
+
+        if(load > HighLoad && pressure < MaxPressure)
+        {
+            pressure++;
+        }
+        else if(load < LowLoad && pressure > 0)
+        {
+            pressure--;
+        }
+
+        busySeconds = 0.0;
+        renderedSeconds = 0.0;
+
+        if(pressure != previous)
+        {
+            UpdateQuality();
+        }
+    }
+
+    double SynthesizerClass::GetSeconds()
+    {
+        LARGE_INTEGER counter;
+        LARGE_INTEGER frequency;
+
+        QueryPerformanceCounter(&counter);
+        QueryPerformanceFrequency(&frequency);
+
+        return (double)counter.QuadPart / frequency.QuadPart;
+    }
+
+    void SynthesizerClass::NoteOff(int channel, int note)
+    {
+        for(int i = 0; i < voiceCount; i++)
+        {
+            Voice& voice = voices[i];
+
+            if(voice.state == VoiceHeld && voice.channel == channel && voice.note == note)
+            {
+                if(channels[channel].hold)
+                {
+                    voice.state = VoiceSustained;
+                }
+                else
+                {
+                    Release(i);
+                }
+            }
+        }
+    }
+
+    void SynthesizerClass::Controller(int channel, int type, int value)
+    {
+        Channel& state = channels[channel];
+
+        switch(type)
+        {
+            case ControllerType::BankSelect:
+                state.bankSelect = value;
+                break;
+
+            case ControllerType::BankSelectFine:
+                state.bankSelectFine = value;
+                break;
+
+            case ControllerType::ModulationWheel:
+                state.modulation = (float)value / 127.0f;
+                break;
+
+            case ControllerType::Volume:
+                state.volume = ((float)value / 127.0f) * ((float)value / 127.0f);
+                break;
+
+            case ControllerType::Expression:
+                state.expression = ((float)value / 127.0f) * ((float)value / 127.0f);
+                break;
+
+            case ControllerType::Pan:
+                UpdatePan(channel, value);
+                break;
+
+            case ControllerType::EffectsLevel:
+                state.reverb = (float)value / 127.0f;
+                break;
+
+            case ControllerType::ChorusLevel:
+                state.chorus = (float)value / 127.0f;
+                break;
+
+            case ControllerType::CelesteLevel:
+                state.celeste = (float)value / 127.0f;
+                break;
+
+            case ControllerType::PhaserLevel:
+                state.phaser = (float)value / 127.0f;
+                break;
+
+            case ControllerType::HoldPedal1:
+                state.hold = value >= 64;
+
+                if(!state.hold)
+                {
+                    ReleaseSustained(channel);
+                }
+                break;
+
+            case ControllerType::RegisteredParameterCoarse:
+                state.parameter = (value << 7) | (state.parameter & 0x7F);
+                break;
+
+            case ControllerType::RegisteredParameterFine:
+                state.parameter = (state.parameter & ~0x7F) | value;
+                break;
+
+            // Data entry after a non-registered parameter select is not
+            // for the registered parameter selected before it.
+            case ControllerType::NonRegisteredParameterCoarse:
+            case ControllerType::NonRegisteredParameterFine:
+                state.parameter = NullParameter;
+                break;
+
+            // The null parameter, selected by 127 on both registered
+            // parameter selects, is no parameter and takes no data entry.
+            case ControllerType::DataEntrySlider:
+                if(state.parameter == PitchBendRangeParameter)
+                {
+                    state.bendRange = value;
+                    UpdatePitch(channel);
+                }
+                break;
+
+            case ControllerType::AllSoundOff:
+                SilenceAll(channel);
+                break;
+
+            case ControllerType::AllControllersOff:
+                ResetChannel(channel);
+                break;
+
+            case ControllerType::AllNotesOff:
+                ReleaseAll(channel);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    int SynthesizerClass::Allocate(int channel, int note)
+    {
+        if(activeCount < voiceCount)
+        {
+            for(int i = 0; i < voiceCount; i++)
+            {
+                if(voices[i].state == VoiceFree)
+                {
+                    return i;
+                }
+            }
+        }
+
+        // The voices the NoteOn has already started for its other regions
+        // are not taken, unless there is nothing else.
+        if(stealing == VoiceStealing::SameNote)
+        {
+            for(int i = 0; i < voiceCount; i++)
+            {
+                if(voices[i].channel == channel && voices[i].note == note &&
+                    !IsCurrentNote(i))
+                {
+                    return i;
+                }
+            }
+        }
+
+        // Releasing voices are taken before held ones; within each group
+        // the oldest or the quietest voice is taken.
+        int victim = -1;
+        bool victimReleasing = false;
+        double victimKey = 0.0;
+
+        for(int i = 0; i < voiceCount; i++)
+        {
+            const Voice& voice = voices[i];
+
+            if(IsCurrentNote(i))
+            {
+                continue;
+            }
+
+            bool releasing = voice.state == VoiceReleasing;
+            double key = stealing == VoiceStealing::Quietest ?
+                (double)(GetLevel(i) * voice.velocity) :
+                -(double)(nextSerial - voice.serial);
+
+            if(victim < 0 || (releasing && !victimReleasing) ||
+                (releasing == victimReleasing && key < victimKey))
+            {
+                victim = i;
+                victimReleasing = releasing;
+                victimKey = key;
+            }
+        }
+
+        return victim >= 0 ? victim : 0;
+    }
+
+    bool SynthesizerClass::IsCurrentNote(int index)
+    {
+        const Voice& voice = voices[index];
+
+        // The difference keeps the test right when the serials wrap.
+        return voice.state != VoiceFree && (int)(voice.serial - noteSerial) >= 0;
+    }
+
+    void SynthesizerClass::Release(int index)
+    {
+        Voice& voice = voices[index];
+
+        voice.state = VoiceReleasing;
+
+        // The release takes over from the next evaluation of the
+        // envelopes.
+        envelopes->Release(index);
+
+        if(voice.region != nullptr)
+        {
+            if(voice.region->loopMode == 3)
+            {
+                sampleBank->EndLoop(index);
+            }
+
+            sampleBank->SetQuality(index, GetQuality(index));
+        }
+    }
+
+    void SynthesizerClass::Free(int index)
+    {
+        voices[index].state = VoiceFree;
+        activeCount--;
+
+        envelopes->Stop(index);
+
+        if(voices[index].region != nullptr)
+        {
+            sampleBank->Stop(index);
+        }
+        else
+        {
+            bank->Stop(index);
+        }
+    }
+
+    void SynthesizerClass::ReleaseAll(int channel)
+    {
+        for(int i = 0; i < voiceCount; i++)
+        {
+            VoiceState state = voices[i].state;
+
+            if((state == VoiceHeld || state == VoiceSustained) && voices[i].channel == channel)
+            {
+                Release(i);
+            }
+        }
+    }
+
+    void SynthesizerClass::ReleaseSustained(int channel)
+    {
+        for(int i = 0; i < voiceCount; i++)
+        {
+            if(voices[i].state == VoiceSustained && voices[i].channel == channel)
+            {
+                Release(i);
+            }
+        }
+    }
+
+    void SynthesizerClass::SilenceAll(int channel)
+    {
+        for(int i = 0; i < voiceCount; i++)
+        {
+            if(voices[i].state != VoiceFree && voices[i].channel == channel)
+            {
+                Free(i);
+            }
+        }
+    }
+
+    // Resets the controllers a reset all controllers message resets,
+    // leaving volume, pan and program alone.
+    void SynthesizerClass::ResetChannel(int channel)
+    {
+        Channel& state = channels[channel];
+
+        state.pitchBend = PitchWheelCenter;
+        state.bendRange = 2;
+        state.parameter = NullParameter;
+        state.expression = 1.0f;
+        state.modulation = 0.0f;
+
+        if(state.hold)
+        {
+            state.hold = false;
+
+            ReleaseSustained(channel);
+        }
+
+        UpdatePitch(channel);
+    }
+
+    void SynthesizerClass::UpdatePitch(int channel)
+    {
+        float vibrato = channels[channel].vibrato;
+
+        for(int i = 0; i < voiceCount; i++)
+        {
+            Voice& voice = voices[i];
+
+            if(voice.state == VoiceFree || voice.channel != channel)
+            {
+                continue;
+            }
+
+            if(voice.region != nullptr)
+            {
+                voice.increment = (float)GetSampleIncrement(channel, voice.note, *voice.region);
+                sampleBank->SetIncrement(i, voice.increment * vibrato);
+            }
+            else
+            {
+                voice.increment = (float)GetIncrement(channel, voice.note);
+                bank->SetIncrement(i, voice.increment * vibrato);
+            }
+        }
+    }
+
+    // Uses a constant power pan law so that a centred sound is as loud
+    // as a hard panned one.
+    void SynthesizerClass::UpdatePan(int channel, int value)
+    {
+        double angle = (double)value / 127.0 * Pi / 2.0;
+
+        channels[channel].left = (float)cos(angle);
+        channels[channel].right = (float)sin(angle);
+    }
+
+    double SynthesizerClass::GetIncrement(int channel, int note)
+    {
+        double semitones = note - 69 + GetBend(channel);
+
+        return 440.0 * pow(2.0, semitones / 12.0) / sampleRate;
+    }
+
+    double SynthesizerClass::GetSampleIncrement(int channel, int note,
+        const SoundFontRegion& region)
+    {
+        double semitones = (note - region.rootKey) * region.scaleTuning / 100.0 +
+            region.tune / 100.0 + GetBend(channel);
+
+        return pow(2.0, semitones / 12.0) * region.sampleRate / sampleRate;
+    }
+
+    double SynthesizerClass::GetBend(int channel)
+    {
+        const Channel& state = channels[channel];
+
+        return (double)(state.pitchBend - PitchWheelCenter) / PitchWheelCenter * state.bendRange;
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets the sample rate in samples per second.
+    /// </summary>
+    int SynthesizerClass::get_SampleRate()
+    {
+        return sampleRate;
+    }
+
+    /// <summary>
+    /// Gets the number of voices that can play at once.
+    /// </summary>
+    int SynthesizerClass::get_VoiceCount()
+    {
+        return voiceCount;
+    }
+
+    /// <summary>
+    /// Gets the number of voices playing.
+    /// </summary>
+    int SynthesizerClass::get_ActiveVoices()
+    {
+        return activeCount;
+    }
+
+    /// <summary>
+    /// Gets or sets how a voice is chosen when every voice is playing.
+    /// </summary>
+    VoiceStealing SynthesizerClass::get_Stealing()
+    {
+        return stealing;
+    }
+    void SynthesizerClass::set_Stealing(VoiceStealing value)
+    {
+        stealing = value;
+    }
+
+    /// <summary>
+    /// Gets or sets the SoundFont whose presets the channels play.
+    /// </summary>
+    Midi::SoundFont SynthesizerClass::get_SoundFont()
+    {
+        return *soundFont;
+    }
+    void SynthesizerClass::set_SoundFont(Midi::SoundFont value)
+    {
+        SetSoundFont(&value);
+    }
+
+    /// <summary>
+    /// Gets or sets the interpolation sampled voices are read with.
+    /// </summary>
+    ResamplerQuality SynthesizerClass::get_Quality()
+    {
+        return quality;
+    }
+    void SynthesizerClass::set_Quality(ResamplerQuality value)
+    {
+        quality = value;
+
+        UpdateQuality();
+    }
+
+    /// <summary>
+    /// Gets or sets a value indicating whether the interpolation is lowered
+    /// while rendering takes a large share of real time.
+    /// </summary>
+    bool SynthesizerClass::get_AdaptiveQuality()
+    {
+        return adaptiveQuality;
+    }
+    void SynthesizerClass::set_AdaptiveQuality(bool value)
+    {
+        adaptiveQuality = value;
+        pressure = 0;
+        busySeconds = 0.0;
+        renderedSeconds = 0.0;
+
+        UpdateQuality();
+    }
+
+    /// <summary>
+    /// Gets the number of times a voice found streamed sample data missing
+    /// and played silence.
+    /// </summary>
+    int SynthesizerClass::get_Underruns()
+    {
+        return streamer != nullptr ? (int)streamer->Underruns : 0;
+    }
+
+    /// <summary>
+    /// Gets or sets a value indicating whether rendering waits for streamed
+    /// sample data that is late instead of playing silence.
+    /// </summary>
+    bool SynthesizerClass::get_WaitForData()
+    {
+        return waitForData;
+    }
+    void SynthesizerClass::set_WaitForData(bool value)
+    {
+        waitForData = value;
+
+        if(streamer != nullptr)
+        {
+            streamer->Blocking = value;
+        }
+    }
+
+    /// <summary>
+    /// Gets or sets the number of samples between evaluations of the
+    /// envelopes, LFOs and smoothed controllers.
+    /// </summary>
+    int SynthesizerClass::get_ControlRate()
+    {
+        return controlRate;
+    }
+    void SynthesizerClass::set_ControlRate(int value)
+    {
+        REGION(Require)
+
+        if(value <= 0 || value > MaxControlRate)
+        {
+            throw new ArgumentOutOfRangeException("ControlRate", value,
+                "Control rate out of range.");
+        }
+
+        ENDREGION()
+
+        controlRate = value;
+        controlPhase = 0;
+        smoothing = (float)(1.0 - exp(-(double)value / (SmoothingTime * sampleRate)));
+    }
+
+    /// <summary>
+    /// Gets or sets a value indicating whether the reverb and chorus are
+    /// run.
+    /// </summary>
+    bool SynthesizerClass::get_Effects()
+    {
+        return effects;
+    }
+    void SynthesizerClass::set_Effects(bool value)
+    {
+        // A tail left in the lines would play when they are next run.
+        if(value && !effects)
+        {
+            reverb->Clear();
+            chorus->Clear();
+        }
+
+        effects = value;
+    }
+
+    /// <summary>
+    /// Gets the reverb the voices' reverb sends are processed by.
+    /// </summary>
+    Midi::Reverb SynthesizerClass::get_Reverb()
+    {
+        return *reverb;
+    }
+
+    /// <summary>
+    /// Gets the chorus the voices' chorus sends are processed by.
+    /// </summary>
+    Midi::Chorus SynthesizerClass::get_Chorus()
+    {
+        return *chorus;
+    }
+
+    ENDREGION()
+
+    REGION(IMidiSink Members)
+
+    /// <summary>
+    /// Plays a ChannelMessage immediately. Other messages are ignored.
+    /// </summary>
+    void SynthesizerClass::Send(IMidiMessage message, long long microseconds)
+    {
+        if(message.MessageType == MessageType::Channel)
+        {
+            Process(((ChannelMessage)message).Message);
+        }
+    }
+
+    ENDREGION()
+
+}}}
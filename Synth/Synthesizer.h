@@ -0,0 +1,761 @@
+#ifndef SYNTHESIZER_H
+#define SYNTHESIZER_H
+
+#include "Types.h"
+#include "ChannelMessage.h"
+#include "IMidiSink.h"
+#include "ShortMessageRing.h"
+#include "OscillatorBank.h"
+#include "SampleBank.h"
+#include "EnvelopeBank.h"
+#include "Reverb.h"
+#include "Chorus.h"
+#include "SoundFont.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    /// <summary>
+    /// Defines constants representing the ways a Synthesizer chooses the
+    /// voice to take over when every voice is playing.
+    /// </summary>
+    enum VoiceStealing
+    {
+        /// <summary>
+        /// Steal the voice that started first.
+        /// </summary>
+        Oldest,
+
+        /// <summary>
+        /// Steal the voice with the lowest output level.
+        /// </summary>
+        Quietest,
+
+        /// <summary>
+        /// Retrigger a voice already playing the same note on the same
+        /// channel, or else steal the oldest voice.
+        /// </summary>
+        SameNote
+    };
+
+    /// <summary>
+    /// Represents the sound a Synthesizer plays for a program.
+    /// </summary>
+    struct Patch
+    {
+        // The oscillator waveform.
+        Midi::Waveform waveform;
+
+        // The wavetable played by the Wavetable waveform and its size, a
+        // power of two not counting the guard sample.
+        const float* wavetable;
+
+        int wavetableSize;
+
+        // The time in seconds the level takes to rise to full.
+        float attack;
+
+        // The time in seconds the level takes to fall from full to the
+        // sustain level, and the level held while the note is down.
+        float decay;
+
+        float sustain;
+
+        // The time in seconds the level takes to fall to silence once the
+        // note is released.
+        float release;
+    };
+
+    class SynthesizerClass;
+    typedef SynthesizerClass& Synthesizer;
+
+    /// <summary>
+    /// Plays ChannelMessages on a fixed pool of oscillator voices and renders
+    /// the result into float buffers.
+    /// </summary>
+    /// <remarks>
+    /// Every voice is allocated by the constructor, so Process and Render
+    /// never allocate or lock and can be called from an audio callback.
+    /// Both must be called from the same thread; messages coming from
+    /// another thread should be passed through a ShortMessageRing. The
+    /// voices are rendered together by an OscillatorBank. When a NoteOn
+    /// arrives and every voice is playing, a voice is stolen according to
+    /// the Stealing property, releasing voices being taken before held
+    /// ones.
+    ///
+    /// When a SoundFont is set, each channel plays the preset chosen by its
+    /// last ProgramChange and the BankSelect and BankSelectFine values in
+    /// effect at that time. A note starts a sampled voice for every region
+    /// of the preset it falls in, rendered by a SampleBank. Channels whose
+    /// preset is not in the SoundFont play their Patch instead. Samples are
+    /// read with the interpolation set by the Quality property. With
+    /// AdaptiveQuality on, the time spent rendering is measured against the
+    /// time rendered, and while it is a large share sampled voices step
+    /// down to cheaper interpolation, releasing voices first. This makes
+    /// the output depend on the speed of the machine, so it is off by
+    /// default and best left off for offline rendering.
+    ///
+    /// A SoundFont opened for streaming gets a SampleStreamer with a slot
+    /// for every voice: a note starts on the head of its sample and the
+    /// rest is read by the streamer's thread while the head plays.
+    ///
+    /// Render can also be given the messages due during the block, each
+    /// stamped with the sample frame it falls on. The block is then
+    /// rendered in runs between the messages and every message is played
+    /// at its exact sample, so large blocks cost no timing accuracy.
+    ///
+    /// Modulation is evaluated at control rate, once every ControlRate
+    /// samples counted from the first sample rendered: the voice envelopes
+    /// are advanced by an EnvelopeBank, each channel's vibrato LFO, whose
+    /// depth follows the ModulationWheel, is stepped, and the Volume,
+    /// Expression and Pan controllers are smoothed towards their latest
+    /// values. The levels and gains this gives for the end of the period
+    /// are handed to the banks as per sample steps, so they ramp linearly
+    /// inside the render loops, and controller changes do not click.
+    ///
+    /// Every voice also feeds a reverb and a chorus send, scaled by its
+    /// channel's EffectsLevel and ChorusLevel controllers; CelesteLevel and
+    /// PhaserLevel, having no effects of their own, add to the chorus
+    /// send. The banks sum the sends of all voices, and with Effects on a
+    /// single Reverb and Chorus process the sums once per block, so the
+    /// cost of the effects does not grow with the number of voices. Render
+    /// can also hand the sends to the caller instead, so that the sends of
+    /// several Synthesizers are summed and processed once by
+    /// ProcessEffects.
+    /// </remarks>
+    class SynthesizerClass : public IMidiSinkIf
+    {
+        REGION(Synthesizer Members)
+
+        REGION(Constants)
+
+    public:
+
+        /// <summary>
+        /// The number of MIDI channels.
+        /// </summary>
+        static const int ChannelCount = ChannelMessageClass::MidiChannelMaxValue + 1;
+
+        /// <summary>
+        /// The number of programs.
+        /// </summary>
+        static const int ProgramCount = 128;
+
+        /// <summary>
+        /// The number of voices used when none is specified.
+        /// </summary>
+        static const int DefaultVoiceCount = 256;
+
+        /// <summary>
+        /// The number of samples between evaluations of the modulation
+        /// unless ControlRate is set.
+        /// </summary>
+        static const int DefaultControlRate = 32;
+
+        /// <summary>
+        /// The largest number of samples between evaluations of the
+        /// modulation.
+        /// </summary>
+        static const int MaxControlRate = 256;
+
+        ENDREGION()
+
+        REGION(Fields)
+
+    private:
+
+        enum VoiceState
+        {
+            // The voice is not playing.
+            VoiceFree,
+
+            // The note is held down.
+            VoiceHeld,
+
+            // The note was released while the hold pedal was down.
+            VoiceSustained,
+
+            // The note was released and the voice is fading out.
+            VoiceReleasing
+        };
+
+        struct Voice
+        {
+            VoiceState state;
+
+            int channel;
+
+            int note;
+
+            // The gain from the NoteOn velocity.
+            float velocity;
+
+            // The order in which the voice was started.
+            unsigned int serial;
+
+            Midi::Waveform waveform;
+
+            // The SoundFont region a sampled voice plays, or nullptr for
+            // an oscillator voice, and the gains from its attenuation and
+            // pan.
+            const SoundFontRegion* region;
+
+            float regionLeft;
+
+            float regionRight;
+
+            // The region's gain without its pan, which scales the sends.
+            float regionGain;
+
+            // The increment with the pitch wheel but not the vibrato
+            // applied.
+            float increment;
+
+            // The gains the voice's ramps reach at the end of the control
+            // period.
+            float leftGain;
+
+            float rightGain;
+
+            float reverbGain;
+
+            float chorusGain;
+        };
+
+        struct Channel
+        {
+            int program;
+
+            // The BankSelect and BankSelectFine values, and the SoundFont
+            // preset they chose with the program, if any.
+            int bankSelect;
+
+            int bankSelectFine;
+
+            const SoundFontPreset* preset;
+
+            // The 14-bit pitch wheel value and the bend range in
+            // semitones.
+            int pitchBend;
+
+            int bendRange;
+
+            // The registered parameter selected for data entry.
+            int parameter;
+
+            // The Volume and Expression controllers as gains.
+            float volume;
+
+            float expression;
+
+            // The Pan controller as left and right gains.
+            float left;
+
+            float right;
+
+            // The EffectsLevel, ChorusLevel, CelesteLevel and PhaserLevel
+            // controllers from zero to one.
+            float reverb;
+
+            float chorus;
+
+            float celeste;
+
+            float phaser;
+
+            // The product of the volume, expression and pan gains, smoothed
+            // at control rate.
+            float smoothLeft;
+
+            float smoothRight;
+
+            // The reverb and chorus sends times the volume and expression
+            // gains, smoothed the same way.
+            float smoothReverb;
+
+            float smoothChorus;
+
+            // The ModulationWheel controller from zero to one, and the
+            // vibrato depth smoothed towards it.
+            float modulation;
+
+            float depth;
+
+            // The phase of the vibrato LFO in cycles, the factor it scales
+            // increments by, and whether the factor changed at the last
+            // evaluation.
+            double lfoPhase;
+
+            float vibrato;
+
+            bool vibratoChanged;
+
+            // Indicates whether HoldPedal1 is down.
+            bool hold;
+        };
+
+        // The sample rate in samples per second.
+        int sampleRate;
+
+        // The voice pool.
+        Voice* voices;
+
+        // The oscillator of each voice, in the slot matching its index.
+        OscillatorBankClass* bank;
+
+        // The sampler of each voice, in the slot matching its index.
+        SampleBankClass* sampleBank;
+
+        // The envelope of each voice, in the slot matching its index.
+        EnvelopeBankClass* envelopes;
+
+        // The samples between evaluations of the modulation, the samples
+        // rendered since the last one, and the share of the distance to
+        // its target a smoothed controller covers at each one.
+        int controlRate;
+
+        int controlPhase;
+
+        float smoothing;
+
+        // The send effects, whether they are run, and the sums of the
+        // voices' sends for a block.
+        ReverbClass* reverb;
+
+        ChorusClass* chorus;
+
+        bool effects;
+
+        float* reverbSend;
+
+        float* chorusSend;
+
+        SoundFontClass* soundFont;
+
+        // The streamer of a streamed SoundFont, or nullptr.
+        SampleStreamerClass* streamer;
+
+        bool waitForData;
+
+        int voiceCount;
+
+        // The number of voices that are not free.
+        int activeCount;
+
+        // The serial given to the next voice started, and the serial of
+        // the first voice of the NoteOn being played.
+        unsigned int nextSerial;
+
+        unsigned int noteSerial;
+
+        VoiceStealing stealing;
+
+        Channel channels[ChannelCount];
+
+        Patch patches[ProgramCount];
+
+        ResamplerQuality quality;
+
+        bool adaptiveQuality;
+
+        // How many steps below the set quality sampled voices play, from
+        // zero to MaxPressure.
+        int pressure;
+
+        // The seconds spent rendering and the seconds of audio rendered
+        // since the load was last checked.
+        double busySeconds;
+
+        double renderedSeconds;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the Synthesizer class with the
+        /// specified sample rate and number of voices.
+        /// </summary>
+        /// <param name="sampleRate">
+        /// The sample rate in samples per second.
+        /// </param>
+        /// <param name="voiceCount">
+        /// The number of voices that can play at once.
+        /// </param>
+        SynthesizerClass(int sampleRate, int voiceCount);
+
+        ~SynthesizerClass();
+
+    private:
+
+        SynthesizerClass(const SynthesizerClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Plays a ChannelMessage.
+        /// </summary>
+        /// <param name="message">
+        /// The ChannelMessage as a packed integer.
+        /// </param>
+        void Process(int message);
+
+        /// <summary>
+        /// Renders the playing voices.
+        /// </summary>
+        /// <param name="left">
+        /// The buffer that receives the left channel.
+        /// </param>
+        /// <param name="right">
+        /// The buffer that receives the right channel.
+        /// </param>
+        /// <param name="count">
+        /// The number of samples to render.
+        /// </param>
+        void Render(float* left, float* right, int count);
+
+        /// <summary>
+        /// Renders the playing voices, playing each of the specified
+        /// messages at the sample it is due.
+        /// </summary>
+        /// <param name="left">
+        /// The buffer that receives the left channel.
+        /// </param>
+        /// <param name="right">
+        /// The buffer that receives the right channel.
+        /// </param>
+        /// <param name="count">
+        /// The number of samples to render.
+        /// </param>
+        /// <param name="messages">
+        /// The messages in order of their timestamps, which are sample
+        /// frames.
+        /// </param>
+        /// <param name="messageCount">
+        /// The number of messages.
+        /// </param>
+        /// <param name="position">
+        /// The sample frame of the first sample of the block.
+        /// </param>
+        /// <returns>
+        /// The number of messages played. Messages due at or after the end
+        /// of the block are left for the next call; messages already late
+        /// are played at the start of the block.
+        /// </returns>
+        int Render(float* left, float* right, int count,
+            const TimestampedMessage* messages, int messageCount, long long position);
+
+        /// <summary>
+        /// Renders the playing voices without the effects, playing each of
+        /// the specified messages at the sample it is due.
+        /// </summary>
+        /// <param name="left">
+        /// The buffer that receives the left channel.
+        /// </param>
+        /// <param name="right">
+        /// The buffer that receives the right channel.
+        /// </param>
+        /// <param name="reverb">
+        /// The buffer that receives the reverb send.
+        /// </param>
+        /// <param name="chorus">
+        /// The buffer that receives the chorus send.
+        /// </param>
+        /// <param name="count">
+        /// The number of samples to render.
+        /// </param>
+        /// <param name="messages">
+        /// The messages in order of their timestamps, which are sample
+        /// frames.
+        /// </param>
+        /// <param name="messageCount">
+        /// The number of messages.
+        /// </param>
+        /// <param name="position">
+        /// The sample frame of the first sample of the block.
+        /// </param>
+        /// <returns>
+        /// The number of messages played.
+        /// </returns>
+        /// <remarks>
+        /// The sends are left for the caller, which can sum those of
+        /// several Synthesizers and pass them to ProcessEffects once.
+        /// </remarks>
+        int Render(float* left, float* right, float* reverb, float* chorus, int count,
+            const TimestampedMessage* messages, int messageCount, long long position);
+
+        /// <summary>
+        /// Runs the reverb and chorus on the specified sends and adds them
+        /// to the output, if Effects is on.
+        /// </summary>
+        /// <param name="reverb">
+        /// The reverb send.
+        /// </param>
+        /// <param name="chorus">
+        /// The chorus send.
+        /// </param>
+        /// <param name="left">
+        /// The buffer the left channel is added to.
+        /// </param>
+        /// <param name="right">
+        /// The buffer the right channel is added to.
+        /// </param>
+        /// <param name="count">
+        /// The number of samples.
+        /// </param>
+        void ProcessEffects(const float* reverb, const float* chorus, float* left,
+            float* right, int count);
+
+        /// <summary>
+        /// Renders the playing voices, playing each message in the
+        /// specified ShortMessageRing at the sample it is due.
+        /// </summary>
+        /// <param name="left">
+        /// The buffer that receives the left channel.
+        /// </param>
+        /// <param name="right">
+        /// The buffer that receives the right channel.
+        /// </param>
+        /// <param name="count">
+        /// The number of samples to render.
+        /// </param>
+        /// <param name="ring">
+        /// The ring to read from, whose timestamps are sample frames. Only
+        /// the messages due before the end of the block are read.
+        /// </param>
+        /// <param name="position">
+        /// The sample frame of the first sample of the block.
+        /// </param>
+        void Render(float* left, float* right, int count, ShortMessageRing ring,
+            long long position);
+
+        /// <summary>
+        /// Silences every voice and resets every channel.
+        /// </summary>
+        void Reset();
+
+        /// <summary>
+        /// Sets the sound played for the specified program.
+        /// </summary>
+        void SetPatch(int program, const Patch& patch);
+
+        /// <summary>
+        /// Gets the sound played for the specified program.
+        /// </summary>
+        const Patch& GetPatch(int program);
+
+        /// <summary>
+        /// Copies the patches, voice stealing, SoundFont, quality,
+        /// streaming, control rate and effects settings of another
+        /// Synthesizer.
+        /// </summary>
+        void CopySettings(Synthesizer other);
+
+    private:
+
+        // Renders the playing voices. With send buffers the sends are
+        // written to them; without, the effects are run if Effects is on.
+        void Render(float* left, float* right, float* reverb, float* chorus, int count);
+
+        void NoteOn(int channel, int note, int velocity);
+
+        // Starts a voice for every region of the channel's preset the
+        // note falls in.
+        void NoteOnSampled(int channel, int note, int velocity);
+
+        // Resolves the preset of a channel from its bank and program.
+        void SelectPreset(int channel);
+
+        // Frees the sampled voices, replaces the streamer and selects the
+        // presets of a new SoundFont.
+        void SetSoundFont(SoundFontClass* value);
+
+        // Gets the level of a voice from whichever bank plays it.
+        float GetLevel(int index);
+
+        // Starts the envelope of a new voice, ramping the bank towards it
+        // for the rest of the control period, and sets its gains.
+        void StartControl(int index, const Envelope& envelope, float level);
+
+        // Advances the envelopes, LFOs and smoothed controllers by a
+        // control period and sets the ramps the banks follow through it.
+        void UpdateControl();
+
+        // Gets the gains a voice should reach from its channel's smoothed
+        // gains.
+        void GetGains(int index, float& left, float& right);
+
+        // Gets the send gains a voice should reach from its channel's
+        // smoothed sends.
+        void GetSends(int index, float& reverb, float& chorus);
+
+        // Gets the interpolation a sampled voice is read with under the
+        // present pressure.
+        ResamplerQuality GetQuality(int index);
+
+        void UpdateQuality();
+
+        // Adds a rendered block to the load measurement and adjusts the
+        // pressure once enough audio has been rendered.
+        void MeasureLoad(double seconds, int count);
+
+        double GetSeconds();
+
+        void NoteOff(int channel, int note);
+
+        void Controller(int channel, int type, int value);
+
+        // Returns the voice to start a note on, stealing one if needed.
+        int Allocate(int channel, int note);
+
+        // Determines whether a voice was started by the NoteOn being
+        // played.
+        bool IsCurrentNote(int index);
+
+        void Release(int index);
+
+        void Free(int index);
+
+        void ReleaseAll(int channel);
+
+        void ReleaseSustained(int channel);
+
+        void SilenceAll(int channel);
+
+        void ResetChannel(int channel);
+
+        void UpdatePitch(int channel);
+
+        void UpdatePan(int channel, int value);
+
+        double GetIncrement(int channel, int note);
+
+        double GetSampleIncrement(int channel, int note, const SoundFontRegion& region);
+
+        // Gets the pitch wheel offset in semitones.
+        double GetBend(int channel);
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets the sample rate in samples per second.
+        /// </summary>
+        ReadOnlyProperty<int> SampleRate;
+
+        /// <summary>
+        /// Gets the number of voices that can play at once.
+        /// </summary>
+        ReadOnlyProperty<int> VoiceCount;
+
+        /// <summary>
+        /// Gets the number of voices playing.
+        /// </summary>
+        ReadOnlyProperty<int> ActiveVoices;
+
+        /// <summary>
+        /// Gets or sets how a voice is chosen when every voice is playing.
+        /// </summary>
+        Property<VoiceStealing> Stealing;
+
+        /// <summary>
+        /// Gets or sets the SoundFont whose presets the channels play.
+        /// </summary>
+        Property<Midi::SoundFont> SoundFont;
+
+        /// <summary>
+        /// Gets or sets the interpolation sampled voices are read with.
+        /// </summary>
+        Property<ResamplerQuality> Quality;
+
+        /// <summary>
+        /// Gets or sets a value indicating whether the interpolation is
+        /// lowered while rendering takes a large share of real time.
+        /// </summary>
+        Property<bool> AdaptiveQuality;
+
+        /// <summary>
+        /// Gets the number of times a voice found streamed sample data
+        /// missing and played silence.
+        /// </summary>
+        ReadOnlyProperty<int> Underruns;
+
+        /// <summary>
+        /// Gets or sets a value indicating whether rendering waits for
+        /// streamed sample data that is late instead of playing silence.
+        /// </summary>
+        Property<bool> WaitForData;
+
+        /// <summary>
+        /// Gets or sets the number of samples between evaluations of the
+        /// envelopes, LFOs and smoothed controllers.
+        /// </summary>
+        Property<int> ControlRate;
+
+        /// <summary>
+        /// Gets or sets a value indicating whether the reverb and chorus
+        /// are run.
+        /// </summary>
+        Property<bool> Effects;
+
+        /// <summary>
+        /// Gets the reverb the voices' reverb sends are processed by.
+        /// </summary>
+        ReadOnlyProperty<Midi::Reverb> Reverb;
+
+        /// <summary>
+        /// Gets the chorus the voices' chorus sends are processed by.
+        /// </summary>
+        ReadOnlyProperty<Midi::Chorus> Chorus;
+
+        ENDREGION()
+
+        ENDREGION()
+
+        REGION(IMidiSink Members)
+
+    public:
+
+        /// <summary>
+        /// Plays a ChannelMessage immediately. Other messages are ignored.
+        /// </summary>
+        void Send(IMidiMessage message, long long microseconds);
+
+        ENDREGION()
+
+    private:
+        void init();
+        int get_SampleRate();
+        int get_VoiceCount();
+        int get_ActiveVoices();
+        VoiceStealing get_Stealing();
+        void set_Stealing(VoiceStealing value);
+        Midi::SoundFont get_SoundFont();
+        void set_SoundFont(Midi::SoundFont value);
+        ResamplerQuality get_Quality();
+        void set_Quality(ResamplerQuality value);
+        bool get_AdaptiveQuality();
+        void set_AdaptiveQuality(bool value);
+        int get_Underruns();
+        bool get_WaitForData();
+        void set_WaitForData(bool value);
+        int get_ControlRate();
+        void set_ControlRate(int value);
+        bool get_Effects();
+        void set_Effects(bool value);
+        Midi::Reverb get_Reverb();
+        Midi::Chorus get_Chorus();
+
+    };
+
+}}}
+
+#endif
@@ -0,0 +1,678 @@
+#include "TempoMap.h"
+#include "Sequence.h"
+#include "PpqnClock.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef TempoMapClass cls;
+
+    void cls::init()
+    {
+        this->Count = Functor::New(this, &cls::get_Count);
+        this->Division = Functor::New(this, &cls::get_Division, &cls::set_Division);
+        this->IsSmpte = Functor::New(this, &cls::get_IsSmpte);
+        this->FrameRate = Functor::New(this, &cls::get_FrameRate);
+        this->TicksPerFrame = Functor::New(this, &cls::get_TicksPerFrame);
+        this->division = PpqnClockClass::PpqnMinValue;
+        this->smpte = false;
+        this->frameRate = SmpteFrameRate::Smpte30;
+        this->ticksPerFrame = 0;
+        this->tickNumerator = 0;
+        this->tickDenominator = 1;
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the TempoMap class with the
+    /// specified division.
+    /// </summary>
+    /// <param name="division">
+    /// The division of the Sequence.
+    /// </param>
+    TempoMapClass::TempoMapClass(int division)
+    {
+        init();
+        Division = division;
+        Clear();
+    }
+
+    TempoMapClass::~TempoMapClass()
+    {
+        DetachTracks();
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Rebuilds the TempoMap from the tempo MetaMessages in every Track
+    /// of the specified Sequence.
+    /// </summary>
+    void TempoMapClass::Build(Sequence sequence)
+    {
+        Clear();
+
+        Division = sequence.Division;
+
+        List<Track>::iterator it = sequence.GetIterator();
+        for(it = it.begin(); it != it.end(); it++)
+        {
+            AddTrack((Track)it);
+        }
+    }
+
+    /// <summary>
+    /// Adds the tempo MetaMessages in the specified Track and follows
+    /// further edits made to it.
+    /// </summary>
+    void TempoMapClass::AddTrack(Track track)
+    {
+        REGION(Guard)
+
+        for(int i = 0; i < tracks.Count; i++)
+        {
+            if(tracks[i] == &track)
+            {
+                return;
+            }
+        }
+
+        ENDREGION()
+
+        for(MidiEvent e = track.GetMidiEvent(0); e != MidiEventClass::null; e = e.Next)
+        {
+            if(IsTempoMessage(e.MidiMessage))
+            {
+                Insert(e.AbsoluteTicks, UnpackTempo((MetaMessage)e.MidiMessage), &track);
+            }
+        }
+
+        track.Attach(*this);
+        tracks.Add(&track);
+    }
+
+    /// <summary>
+    /// Removes the tempo MetaMessages taken from the specified Track and
+    /// stops following it.
+    /// </summary>
+    void TempoMapClass::RemoveTrack(Track track)
+    {
+        for(int i = 0; i < tracks.Count; i++)
+        {
+            if(tracks[i] == &track)
+            {
+                tracks.RemoveAt(i);
+                break;
+            }
+        }
+
+        track.Detach(*this);
+
+        TrackCleared(track);
+    }
+
+    /// <summary>
+    /// Removes all of the tempo changes from the TempoMap and stops
+    /// following every Track.
+    /// </summary>
+    void TempoMapClass::Clear()
+    {
+        DetachTracks();
+
+        TempoSegment initial;
+
+        initial.ticks = 0;
+        initial.microseconds = 0;
+        initial.tempo = DefaultTempo;
+        initial.microsecondsPerTick = GetMicrosecondsPerTick(DefaultTempo);
+        initial.owner = nullptr;
+
+        segments.Clear();
+        segments.Add(initial);
+    }
+
+    /// <summary>
+    /// Replaces the division and the tempo changes with those of another
+    /// TempoMap, and stops following every Track without following those
+    /// of the other TempoMap.
+    /// </summary>
+    void TempoMapClass::CopyFrom(TempoMap other)
+    {
+        DetachTracks();
+
+        Division = other.division;
+
+        segments.Clear();
+        segments.EnsureCapacity(other.segments.Count);
+
+        // The copy follows no Track, so its segments have no owner.
+        for(int i = 0; i < other.segments.Count; i++)
+        {
+            TempoSegment segment = other.segments[i];
+
+            segment.owner = nullptr;
+            segments.Add(segment);
+        }
+    }
+
+    /// <summary>
+    /// Adds a tempo change at the specified position.
+    /// </summary>
+    /// <param name="ticks">
+    /// The position in absolute ticks of the tempo change.
+    /// </param>
+    /// <param name="tempo">
+    /// The tempo in microseconds per quarter note.
+    /// </param>
+    void TempoMapClass::Insert(int ticks, int tempo)
+    {
+        Insert(ticks, tempo, nullptr);
+    }
+
+    void TempoMapClass::Insert(int ticks, int tempo, objectClass* owner)
+    {
+        REGION(Require)
+
+        if(ticks < 0)
+        {
+            throw new ArgumentOutOfRangeException("ticks", ticks,
+                "Tempo change position out of range.");
+        }
+        else if(tempo <= 0)
+        {
+            throw new ArgumentOutOfRangeException("tempo", tempo,
+                "Tempo out of range.");
+        }
+
+        ENDREGION()
+
+        TempoSegment segment;
+
+        segment.ticks = ticks;
+        segment.microseconds = 0;
+        segment.tempo = tempo;
+        segment.microsecondsPerTick = GetMicrosecondsPerTick(tempo);
+        segment.owner = owner;
+
+        // Tempo changes at the same position are applied in the order they
+        // were added, so the new segment goes after any existing ones.
+        int index = FindSegment(ticks) + 1;
+
+        segments.Insert(index, segment);
+
+        Recalculate(index);
+    }
+
+    /// <summary>
+    /// Removes a tempo change from the specified position.
+    /// </summary>
+    /// <returns>
+    /// <b>true</b> if a matching tempo change was found; otherwise,
+    /// <b>false</b>.
+    /// </returns>
+    bool TempoMapClass::Remove(int ticks, int tempo)
+    {
+        return Remove(ticks, tempo, nullptr);
+    }
+
+    bool TempoMapClass::Remove(int ticks, int tempo, objectClass* owner)
+    {
+        // Never remove the initial segment.
+        for(int i = FindSegment(ticks); i > 0 && segments[i].ticks == ticks; i--)
+        {
+            if(segments[i].tempo == tempo && segments[i].owner == owner)
+            {
+                segments.RemoveAt(i);
+
+                Recalculate(i);
+
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void TempoMapClass::DetachTracks()
+    {
+        for(int i = 0; i < tracks.Count; i++)
+        {
+            tracks[i]->Detach(*this);
+        }
+
+        tracks.Clear();
+    }
+
+    /// <summary>
+    /// Converts a position in ticks to time in microseconds.
+    /// </summary>
+    long long TempoMapClass::TicksToMicroseconds(int ticks)
+    {
+        if(smpte)
+        {
+            return SmpteTicksToMicroseconds(ticks);
+        }
+
+        const TempoSegment& segment = segments[FindSegment(ticks)];
+
+        return segment.microseconds +
+            (long long)(ticks - segment.ticks) * segment.tempo / division;
+    }
+
+    /// <summary>
+    /// Converts time in microseconds to a position in ticks.
+    /// </summary>
+    int TempoMapClass::MicrosecondsToTicks(long long microseconds)
+    {
+        if(smpte)
+        {
+            return (int)(microseconds * tickDenominator / tickNumerator);
+        }
+
+        const TempoSegment& segment = segments[FindSegmentByTime(microseconds)];
+
+        return segment.ticks +
+            (int)((microseconds - segment.microseconds) * division / segment.tempo);
+    }
+
+    /// <summary>
+    /// Converts a position in ticks to time in seconds.
+    /// </summary>
+    double TempoMapClass::TicksToSeconds(int ticks)
+    {
+        if(smpte)
+        {
+            return (double)ticks * tickNumerator / tickDenominator / 1000000.0;
+        }
+
+        const TempoSegment& segment = segments[FindSegment(ticks)];
+
+        return (segment.microseconds +
+            (ticks - segment.ticks) * segment.microsecondsPerTick) / 1000000.0;
+    }
+
+    /// <summary>
+    /// Gets the tempo in effect at the specified position.
+    /// </summary>
+    int TempoMapClass::GetTempo(int ticks)
+    {
+        return segments[FindSegment(ticks)].tempo;
+    }
+
+    /// <summary>
+    /// Converts a position in ticks to SMPTE timecode. Only valid with
+    /// an SMPTE division.
+    /// </summary>
+    void TempoMapClass::TicksToSmpte(int ticks, SmpteTime& time)
+    {
+        REGION(Require)
+
+        if(!smpte)
+        {
+            throw new InvalidOperationException("The division is not an SMPTE division.");
+        }
+        else if(ticks < 0)
+        {
+            throw new ArgumentOutOfRangeException("ticks", ticks,
+                "Position out of range.");
+        }
+
+        ENDREGION()
+
+        int frame = ticks / ticksPerFrame;
+        int fps = frameRate == SmpteFrameRate::Smpte30Drop ? 30 : (int)frameRate;
+
+        time.subframes = ticks % ticksPerFrame;
+
+        // Drop frame timecode skips two frame numbers every minute except
+        // every tenth, so 17982 real frames make up ten labelled minutes
+        // and 1798 real frames make up each dropped minute.
+        if(frameRate == SmpteFrameRate::Smpte30Drop)
+        {
+            int tens = frame / 17982;
+            int remainder = frame % 17982;
+
+            frame += 18 * tens;
+
+            if(remainder > 1)
+            {
+                frame += 2 * ((remainder - 2) / 1798);
+            }
+        }
+
+        time.frames = frame % fps;
+        time.seconds = (frame / fps) % 60;
+        time.minutes = (frame / (fps * 60)) % 60;
+        time.hours = frame / (fps * 3600);
+    }
+
+    /// <summary>
+    /// Converts SMPTE timecode to a position in ticks. Only valid with
+    /// an SMPTE division.
+    /// </summary>
+    int TempoMapClass::SmpteToTicks(const SmpteTime& time)
+    {
+        REGION(Require)
+
+        if(!smpte)
+        {
+            throw new InvalidOperationException("The division is not an SMPTE division.");
+        }
+
+        ENDREGION()
+
+        int fps = frameRate == SmpteFrameRate::Smpte30Drop ? 30 : (int)frameRate;
+        int frame = ((time.hours * 60 + time.minutes) * 60 + time.seconds) * fps + time.frames;
+
+        if(frameRate == SmpteFrameRate::Smpte30Drop)
+        {
+            int minutes = time.hours * 60 + time.minutes;
+
+            frame -= 2 * (minutes - minutes / 10);
+        }
+
+        return frame * ticksPerFrame + time.subframes;
+    }
+
+    /// <summary>
+    /// Gets the tempo stored in a tempo MetaMessage.
+    /// </summary>
+    int TempoMapClass::UnpackTempo(MetaMessage message)
+    {
+        REGION(Require)
+
+        if(message.MetaType != MetaType::Tempo)
+        {
+            throw new ArgumentException("Not a tempo message.", "message");
+        }
+
+        ENDREGION()
+
+        return ((message[0] & 0xFF) << 16) |
+            ((message[1] & 0xFF) << 8) |
+            (message[2] & 0xFF);
+    }
+
+    /// <summary>
+    /// Determines whether the specified message is a tempo MetaMessage.
+    /// </summary>
+    bool TempoMapClass::IsTempoMessage(IMidiMessage message)
+    {
+        return (message.MessageType == MessageType::Meta &&
+            ((MetaMessage)message).MetaType == MetaType::Tempo);
+    }
+
+    int TempoMapClass::FindSegment(int ticks)
+    {
+        int low = 0;
+        int high = segments.Count - 1;
+
+        // The initial segment starts at zero, so there is always a match.
+        while(low < high)
+        {
+            int mid = (low + high + 1) / 2;
+
+            if(segments[mid].ticks <= ticks)
+            {
+                low = mid;
+            }
+            else
+            {
+                high = mid - 1;
+            }
+        }
+
+        return low;
+    }
+
+    int TempoMapClass::FindSegmentByTime(long long microseconds)
+    {
+        int low = 0;
+        int high = segments.Count - 1;
+
+        while(low < high)
+        {
+            int mid = (low + high + 1) / 2;
+
+            if(segments[mid].microseconds <= microseconds)
+            {
+                low = mid;
+            }
+            else
+            {
+                high = mid - 1;
+            }
+        }
+
+        return low;
+    }
+
+    void TempoMapClass::Recalculate(int index)
+    {
+        if(index == 0)
+        {
+            index = 1;
+        }
+
+        for(int i = index; i < segments.Count; i++)
+        {
+            if(smpte)
+            {
+                segments[i].microseconds = SmpteTicksToMicroseconds(segments[i].ticks);
+
+                continue;
+            }
+
+            TempoSegment& previous = segments[i - 1];
+
+            segments[i].microseconds = previous.microseconds +
+                (long long)(segments[i].ticks - previous.ticks) * previous.tempo / division;
+        }
+    }
+
+    double TempoMapClass::GetMicrosecondsPerTick(int tempo)
+    {
+        if(smpte)
+        {
+            return (double)tickNumerator / tickDenominator;
+        }
+
+        return (double)tempo / division;
+    }
+
+    long long TempoMapClass::SmpteTicksToMicroseconds(long long ticks)
+    {
+        // Divisions such as 25 frames of 40 ticks have a whole number of
+        // microseconds per tick and need no division.
+        if(tickDenominator == 1)
+        {
+            return ticks * tickNumerator;
+        }
+
+        return ticks * tickNumerator / tickDenominator;
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets the number of tempo segments, including the initial one.
+    /// </summary>
+    int TempoMapClass::get_Count()
+    {
+        return segments.Count;
+    }
+
+    /// <summary>
+    /// Gets or sets the division, either pulses per quarter note or an
+    /// SMPTE frame rate and ticks per frame.
+    /// </summary>
+    int TempoMapClass::get_Division()
+    {
+        return division;
+    }
+    void TempoMapClass::set_Division(int value)
+    {
+        // SMPTE divisions have the negative frame rate in the upper byte
+        // and the ticks per frame in the lower byte.
+        bool isSmpte = (short)value < 0;
+        int rate = -(sbyte)(((short)value) >> 8);
+        int resolution = value & 0xFF;
+
+        REGION(Require)
+
+        if(!isSmpte && value <= 0)
+        {
+            throw new ArgumentOutOfRangeException("Division", value,
+                "Division out of range.");
+        }
+        else if(isSmpte && rate != SmpteFrameRate::Smpte24 &&
+            rate != SmpteFrameRate::Smpte25 &&
+            rate != SmpteFrameRate::Smpte30Drop &&
+            rate != SmpteFrameRate::Smpte30)
+        {
+            throw new ArgumentException("Invalid SMPTE frame rate.", "Division");
+        }
+        else if(isSmpte && resolution == 0)
+        {
+            throw new ArgumentOutOfRangeException("Division", value,
+                "Ticks per frame out of range.");
+        }
+
+        ENDREGION()
+
+        division = value;
+        smpte = isSmpte;
+
+        if(smpte)
+        {
+            frameRate = (SmpteFrameRate)rate;
+            ticksPerFrame = resolution;
+
+            // Microseconds per tick as a fraction, reduced per frame rate.
+            // Smpte30Drop runs at 30000/1001 frames per second.
+            switch(frameRate)
+            {
+            case SmpteFrameRate::Smpte24:
+                tickNumerator = 125000;
+                tickDenominator = 3 * resolution;
+                break;
+
+            case SmpteFrameRate::Smpte25:
+                tickNumerator = 40000;
+                tickDenominator = resolution;
+                break;
+
+            case SmpteFrameRate::Smpte30Drop:
+                tickNumerator = 100100;
+                tickDenominator = 3 * resolution;
+                break;
+
+            default:
+                tickNumerator = 100000;
+                tickDenominator = 3 * resolution;
+                break;
+            }
+
+            long long a = tickNumerator;
+            long long b = tickDenominator;
+
+            while(b != 0)
+            {
+                long long t = a % b;
+
+                a = b;
+                b = t;
+            }
+
+            tickNumerator /= a;
+            tickDenominator /= a;
+        }
+
+        for(int i = 0; i < segments.Count; i++)
+        {
+            segments[i].microsecondsPerTick = GetMicrosecondsPerTick(segments[i].tempo);
+        }
+
+        Recalculate(1);
+    }
+
+    /// <summary>
+    /// Gets a value indicating whether the division is an SMPTE
+    /// division.
+    /// </summary>
+    bool TempoMapClass::get_IsSmpte()
+    {
+        return smpte;
+    }
+
+    /// <summary>
+    /// Gets the SMPTE frame rate.
+    /// </summary>
+    SmpteFrameRate TempoMapClass::get_FrameRate()
+    {
+        return frameRate;
+    }
+
+    /// <summary>
+    /// Gets the number of ticks per SMPTE frame.
+    /// </summary>
+    int TempoMapClass::get_TicksPerFrame()
+    {
+        return ticksPerFrame;
+    }
+
+    ENDREGION()
+
+    REGION(ITrackObserver Members)
+
+    void TempoMapClass::MidiEventInserted(Track track, MidiEvent e)
+    {
+        if(IsTempoMessage(e.MidiMessage))
+        {
+            Insert(e.AbsoluteTicks, UnpackTempo((MetaMessage)e.MidiMessage), &track);
+        }
+    }
+
+    void TempoMapClass::MidiEventRemoved(Track track, MidiEvent e)
+    {
+        if(IsTempoMessage(e.MidiMessage))
+        {
+            Remove(e.AbsoluteTicks, UnpackTempo((MetaMessage)e.MidiMessage), &track);
+        }
+    }
+
+    void TempoMapClass::MidiEventMoved(Track track, MidiEvent e, int oldPosition)
+    {
+        if(IsTempoMessage(e.MidiMessage))
+        {
+            int tempo = UnpackTempo((MetaMessage)e.MidiMessage);
+
+            Remove(oldPosition, tempo, &track);
+            Insert(e.AbsoluteTicks, tempo, &track);
+        }
+    }
+
+    void TempoMapClass::TrackCleared(Track track)
+    {
+        int first = segments.Count;
+
+        for(int i = segments.Count - 1; i > 0; i--)
+        {
+            if(segments[i].owner == &track)
+            {
+                segments.RemoveAt(i);
+                first = i;
+            }
+        }
+
+        Recalculate(first);
+    }
+
+    ENDREGION()
+
+}}}
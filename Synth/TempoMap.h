@@ -0,0 +1,330 @@
+#ifndef TEMPOMAP_H
+#define TEMPOMAP_H
+
+#include "Types.h"
+#include "ArrayList.h"
+#include "Track.h"
+#include "MetaMessage.h"
+#include "MidiFileProperties.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    class SequenceClass;
+    typedef SequenceClass& Sequence;
+
+    /// <summary>
+    /// Represents a span of ticks played at a constant tempo.
+    /// </summary>
+    struct TempoSegment
+    {
+        // The position in absolute ticks at which the segment starts.
+        int ticks;
+
+        // The time in microseconds at which the segment starts.
+        long long microseconds;
+
+        // The tempo in microseconds per quarter note.
+        int tempo;
+
+        // The length of a single tick in microseconds.
+        double microsecondsPerTick;
+
+        // The Track containing the tempo MetaMessage for the segment, or
+        // nullptr for segments that were not taken from a Track.
+        objectClass* owner;
+    };
+
+    /// <summary>
+    /// Represents a position as SMPTE timecode.
+    /// </summary>
+    struct SmpteTime
+    {
+        int hours;
+
+        int minutes;
+
+        int seconds;
+
+        // The frame number. With Smpte30Drop the frame numbers 0 and 1 are
+        // skipped at the start of every minute except every tenth.
+        int frames;
+
+        // The ticks into the frame.
+        int subframes;
+    };
+
+    class TempoMapClass;
+    typedef TempoMapClass& TempoMap;
+
+    /// <summary>
+    /// Converts between positions in ticks and time in microseconds using
+    /// the tempo MetaMessages of a Sequence.
+    /// </summary>
+    /// <remarks>
+    /// The TempoMap keeps the tempo changes as a sorted array of segments,
+    /// each one storing the time at which it starts, so conversions in
+    /// either direction are a binary search rather than a walk over every
+    /// tempo change from the start of the Sequence. The TempoMap observes
+    /// the Tracks it was built from and updates only the segments that
+    /// follow an edited tempo MetaMessage.
+    ///
+    /// When the division is an SMPTE division, ticks are a fixed fraction
+    /// of a frame and tempo MetaMessages do not affect timing. Each frame
+    /// rate then converts with exact integer arithmetic, Smpte30Drop
+    /// running at 30000/1001 frames per second.
+    /// </remarks>
+    class TempoMapClass : public ITrackObserverIf
+    {
+        REGION(TempoMap Members)
+
+        REGION(Constants)
+
+    public:
+
+        /// <summary>
+        /// The tempo in microseconds per quarter note used until the first
+        /// tempo MetaMessage.
+        /// </summary>
+        static const int DefaultTempo = 500000;
+
+        ENDREGION()
+
+        REGION(Fields)
+
+    private:
+
+        // The tempo segments sorted by position. The first segment always
+        // starts at tick zero with the default tempo.
+        ArrayList<TempoSegment> segments;
+
+        // The Tracks followed.
+        ArrayList<TrackClass*> tracks;
+
+        // The division of the Sequence, either pulses per quarter note or
+        // an SMPTE frame rate and ticks per frame.
+        int division;
+
+        // Indicates whether the division is an SMPTE division.
+        bool smpte;
+
+        // The SMPTE frame rate and resolution.
+        SmpteFrameRate frameRate;
+
+        int ticksPerFrame;
+
+        // The length of a tick in microseconds with an SMPTE division as a
+        // reduced fraction.
+        long long tickNumerator;
+
+        long long tickDenominator;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the TempoMap class with the
+        /// specified division.
+        /// </summary>
+        /// <param name="division">
+        /// The division of the Sequence.
+        /// </param>
+        TempoMapClass(int division);
+
+        ~TempoMapClass();
+
+    private:
+
+        TempoMapClass(const TempoMapClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Rebuilds the TempoMap from the tempo MetaMessages in every Track
+        /// of the specified Sequence.
+        /// </summary>
+        void Build(Sequence sequence);
+
+        /// <summary>
+        /// Adds the tempo MetaMessages in the specified Track and follows
+        /// further edits made to it.
+        /// </summary>
+        void AddTrack(Track track);
+
+        /// <summary>
+        /// Removes the tempo MetaMessages taken from the specified Track and
+        /// stops following it.
+        /// </summary>
+        void RemoveTrack(Track track);
+
+        /// <summary>
+        /// Removes all of the tempo changes from the TempoMap and stops
+        /// following every Track.
+        /// </summary>
+        void Clear();
+
+        /// <summary>
+        /// Replaces the division and the tempo changes with those of
+        /// another TempoMap, and stops following every Track without
+        /// following those of the other TempoMap.
+        /// </summary>
+        void CopyFrom(TempoMap other);
+
+        /// <summary>
+        /// Adds a tempo change at the specified position.
+        /// </summary>
+        /// <param name="ticks">
+        /// The position in absolute ticks of the tempo change.
+        /// </param>
+        /// <param name="tempo">
+        /// The tempo in microseconds per quarter note.
+        /// </param>
+        void Insert(int ticks, int tempo);
+
+        /// <summary>
+        /// Removes a tempo change from the specified position.
+        /// </summary>
+        /// <returns>
+        /// <b>true</b> if a matching tempo change was found; otherwise,
+        /// <b>false</b>.
+        /// </returns>
+        bool Remove(int ticks, int tempo);
+
+        /// <summary>
+        /// Converts a position in ticks to time in microseconds.
+        /// </summary>
+        long long TicksToMicroseconds(int ticks);
+
+        /// <summary>
+        /// Converts time in microseconds to a position in ticks.
+        /// </summary>
+        int MicrosecondsToTicks(long long microseconds);
+
+        /// <summary>
+        /// Converts a position in ticks to time in seconds.
+        /// </summary>
+        double TicksToSeconds(int ticks);
+
+        /// <summary>
+        /// Gets the tempo in effect at the specified position.
+        /// </summary>
+        int GetTempo(int ticks);
+
+        /// <summary>
+        /// Converts a position in ticks to SMPTE timecode. Only valid with
+        /// an SMPTE division.
+        /// </summary>
+        void TicksToSmpte(int ticks, SmpteTime& time);
+
+        /// <summary>
+        /// Converts SMPTE timecode to a position in ticks. Only valid with
+        /// an SMPTE division.
+        /// </summary>
+        int SmpteToTicks(const SmpteTime& time);
+
+        /// <summary>
+        /// Gets the tempo stored in a tempo MetaMessage.
+        /// </summary>
+        static int UnpackTempo(MetaMessage message);
+
+        /// <summary>
+        /// Determines whether the specified message is a tempo MetaMessage.
+        /// </summary>
+        static bool IsTempoMessage(IMidiMessage message);
+
+    private:
+
+        void Insert(int ticks, int tempo, objectClass* owner);
+
+        bool Remove(int ticks, int tempo, objectClass* owner);
+
+        // Stops following every Track.
+        void DetachTracks();
+
+        // Returns the index of the last segment starting at or before the
+        // specified position.
+        int FindSegment(int ticks);
+
+        // Returns the index of the last segment starting at or before the
+        // specified time.
+        int FindSegmentByTime(long long microseconds);
+
+        // Recalculates the start times of the segments from the specified
+        // index onward.
+        void Recalculate(int index);
+
+        double GetMicrosecondsPerTick(int tempo);
+
+        long long SmpteTicksToMicroseconds(long long ticks);
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets the number of tempo segments, including the initial one.
+        /// </summary>
+        ReadOnlyProperty<int> Count;
+
+        /// <summary>
+        /// Gets or sets the division, either pulses per quarter note or an
+        /// SMPTE frame rate and ticks per frame.
+        /// </summary>
+        Property<int> Division;
+
+        /// <summary>
+        /// Gets a value indicating whether the division is an SMPTE
+        /// division.
+        /// </summary>
+        ReadOnlyProperty<bool> IsSmpte;
+
+        /// <summary>
+        /// Gets the SMPTE frame rate.
+        /// </summary>
+        ReadOnlyProperty<SmpteFrameRate> FrameRate;
+
+        /// <summary>
+        /// Gets the number of ticks per SMPTE frame.
+        /// </summary>
+        ReadOnlyProperty<int> TicksPerFrame;
+
+        ENDREGION()
+
+        ENDREGION()
+
+        REGION(ITrackObserver Members)
+
+    public:
+
+        void MidiEventInserted(Track track, MidiEvent e);
+
+        void MidiEventRemoved(Track track, MidiEvent e);
+
+        void MidiEventMoved(Track track, MidiEvent e, int oldPosition);
+
+        void TrackCleared(Track track);
+
+        ENDREGION()
+
+    private:
+        void init();
+        int get_Count();
+        int get_Division();
+        void set_Division(int value);
+        bool get_IsSmpte();
+        SmpteFrameRate get_FrameRate();
+        int get_TicksPerFrame();
+
+    };
+
+}}}
+
+#endif
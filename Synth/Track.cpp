@@ -32,9 +32,11 @@
 
 //ENDREGION()
 
+#include <windows.h>
 #include "Track.h"
 #include "NullMessage.h"
 #include "MetaMessage.h"
+#include "EventPostings.h"
 #include "Exception.h"
 
 namespace Sanford { namespace Multimedia { namespace Midi {
@@ -43,16 +45,24 @@ namespace Sanford { namespace Multimedia { namespace Midi {
 
     const Track cls::null = cls();
 
+    volatile long cls::lastRevision = 0;
+
 	void cls::init() 
     {
         this->Count = Functor::New(this, &cls::get_Count);
         this->Length = Functor::New(this, &cls::get_Length);
         this->EndOfTrackOffset = Functor::New(this, &cls::get_EndOfTrackOffset, &cls::set_EndOfTrackOffset);
         this->SyncRoot = Functor::New(this, &cls::get_SyncRoot);
+        this->PostingsEnabled = Functor::New(this, &cls::get_PostingsEnabled, &cls::set_PostingsEnabled);
+        this->Postings = Functor::New(this, &cls::get_Postings);
+        this->Revision = Functor::New(this, &cls::get_Revision);
         this->count = 1;
         this->endOfTrackOffset = 0;
         this->head = MidiEventClass::null;
         this->tail = MidiEventClass::null;
+        this->indexed = false;
+        this->postings = nullptr;
+        this->revision = InterlockedIncrement(&lastRevision);
     }
 	
 	bool cls::operator == (Track other)
@@ -76,6 +86,13 @@ namespace Sanford { namespace Multimedia { namespace Midi {
             this->endOfTrackOffset = other.endOfTrackOffset;
             this->head = other.head;
             this->tail = other.tail;
+            this->indexed = false;
+            this->revision = InterlockedIncrement(&lastRevision);
+
+            // Postings hold the MidiEvents they were built from, so they
+            // are rebuilt for the new ones.
+            set_PostingsEnabled(false);
+            set_PostingsEnabled(other.postings != nullptr);
         }
         return *this;
     }
@@ -89,6 +106,11 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         this->endOfTrackMidiEvent = MidiEventClass(*this, Length, MetaMessageClass::EndOfTrackMessage);
     }
 
+    TrackClass::~TrackClass()
+    {
+        delete postings;
+    }
+
     /// <summary>
     /// Inserts an IMidiMessage at the specified position in absolute ticks.
     /// </summary>
@@ -161,6 +183,8 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         AssertValid();
 
         ENDREGION()
+
+        OnMidiEventInserted(newMidiEvent);
     }
 
     /// <summary>
@@ -178,6 +202,8 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         AssertValid();
 
         ENDREGION()
+
+        OnTrackCleared();
     }
 
     /// <summary>
@@ -287,6 +313,14 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         AssertValid();
 
         ENDREGION()
+
+        // Merging rebuilds every MidiEvent, so observers start over.
+        OnTrackCleared();
+
+        for(current = head; current != MidiEventClass::null; current = current.Next)
+        {
+            OnMidiEventInserted(current);
+        }
     }
 
     /// <summary>
@@ -310,26 +344,48 @@ namespace Sanford { namespace Multimedia { namespace Midi {
 
         ENDREGION()
 
-        MidiEvent current = GetMidiEvent(index);
+        Remove(GetMidiEvent(index));
+    }
+
+    /// <summary>
+    /// Removes the specified MidiEvent.
+    /// </summary>
+    /// <param name="e">
+    /// The MidiEvent to remove.
+    /// </param>
+    void TrackClass::Remove(MidiEvent e)
+    {
+        REGION(Require)
+
+        if((object)e.Owner != this)
+        {
+            throw new ArgumentException("MidiEvent does not belong to this Track.", "e");
+        }
+        else if(e == endOfTrackMidiEvent)
+        {
+            throw new ArgumentException("Cannot remove the end of track event.", "e");
+        }
+
+        ENDREGION()
 
-        if((MidiEvent)current.Previous != MidiEventClass::null)
+        if((MidiEvent)e.Previous != MidiEventClass::null)
         {
-            ((MidiEvent)current.Previous).Next = current.Next;
+            ((MidiEvent)e.Previous).Next = e.Next;
         }
         else
         {
-            Assert(current == head);
+            Assert(e == head);
 
             head = head.Next;
         }
 
-        if((MidiEvent)current.Next != MidiEventClass::null)
+        if((MidiEvent)e.Next != MidiEventClass::null)
         {
-            ((MidiEvent)current.Next).Previous = current.Previous;
+            ((MidiEvent)e.Next).Previous = e.Previous;
         }
         else
         {
-            Assert(current == tail);
+            Assert(e == tail);
 
             tail = tail.Previous;
 
@@ -337,7 +393,7 @@ namespace Sanford { namespace Multimedia { namespace Midi {
             endOfTrackMidiEvent.Previous = tail;
         }
 
-        current.Next = current.Previous = MidiEventClass::null;
+        e.Next = e.Previous = MidiEventClass::null;
 
         count--;
 
@@ -346,6 +402,8 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         AssertValid();
 
         ENDREGION()
+
+        OnMidiEventRemoved(e);
     }
 
     /// <summary>
@@ -369,6 +427,11 @@ namespace Sanford { namespace Multimedia { namespace Midi {
 
         ENDREGION()
 
+        if(indexed && index < Count - 1)
+        {
+            return *events[index];
+        }
+
         MidiEvent result = MidiEventClass::null;
 
         if(index == Count - 1)
@@ -423,6 +486,43 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         return result;
     }
 
+    /// <summary>
+    /// Finds the first MidiEvent at or after the specified position.
+    /// </summary>
+    /// <param name="position">
+    /// The position in absolute ticks.
+    /// </param>
+    /// <returns>
+    /// The index of the MidiEvent, or the index of the end of track
+    /// message if every other MidiEvent is before the position.
+    /// </returns>
+    int TrackClass::FindIndex(int position)
+    {
+        if(!indexed)
+        {
+            BuildIndex();
+        }
+
+        int low = 0;
+        int high = events.Count;
+
+        while(low < high)
+        {
+            int mid = (low + high) / 2;
+
+            if(events[mid]->AbsoluteTicks < position)
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+
+        return low;
+    }
+
     /// <summary>
     /// Moves the MidiEvent to the specified index.
     /// </summary>
@@ -463,6 +563,10 @@ namespace Sanford { namespace Multimedia { namespace Midi {
             {
                 ((MidiEvent)e.Next).Previous = e.Previous;
             }
+            else
+            {
+                tail = e.Previous;
+            }
 
             while(previous != MidiEventClass::null && previous.AbsoluteTicks > newPosition)
             {
@@ -478,6 +582,10 @@ namespace Sanford { namespace Multimedia { namespace Midi {
             {
                 ((MidiEvent)e.Previous).Next = e.Next;
             }
+            else
+            {
+                head = e.Next;
+            }
 
             while(next != MidiEventClass::null && next.AbsoluteTicks < newPosition)
             {
@@ -496,18 +604,22 @@ namespace Sanford { namespace Multimedia { namespace Midi {
             next.Previous = e;
         }
 
+        int oldPosition = e.AbsoluteTicks;
+
         e.Previous = previous;
         e.Next = next;
         e.SetAbsoluteTicks(newPosition);
 
-        if(newPosition < head.AbsoluteTicks)
+        // The MidiEvent may have been the first or last one before it was
+        // moved, so the ends are taken from where it is now.
+        if(previous == MidiEventClass::null)
         {
             head = e;
         }
 
-        if(newPosition > tail.AbsoluteTicks)
+        if(next == MidiEventClass::null)
         {
-            tail = e;                
+            tail = e;
         }
 
         endOfTrackMidiEvent.SetAbsoluteTicks(Length);
@@ -518,6 +630,370 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         AssertValid();
 
         ENDREGION()
+
+        OnMidiEventMoved(e, oldPosition);
+    }
+
+    /// <summary>
+    /// Inserts an IMidiMessage at the specified position directly after the
+    /// specified MidiEvent, which places it among the MidiEvents sharing
+    /// its position.
+    /// </summary>
+    /// <param name="previous">
+    /// The MidiEvent to insert after, or MidiEventClass::null to insert at
+    /// the start of the Track.
+    /// </param>
+    /// <param name="position">
+    /// The position in absolute ticks, which must lie between those of the
+    /// previous MidiEvent and the one following it.
+    /// </param>
+    /// <param name="message">
+    /// The IMidiMessage to insert.
+    /// </param>
+    void TrackClass::InsertAfter(MidiEvent previous, int position, IMidiMessage message)
+    {
+        REGION(Require)
+
+        if(previous != MidiEventClass::null && (object)previous.Owner != this)
+        {
+            throw new ArgumentException("MidiEvent does not belong to this Track.", "previous");
+        }
+        else if(previous == endOfTrackMidiEvent)
+        {
+            throw new ArgumentException("Cannot insert after the end of track event.", "previous");
+        }
+        else if(message == NullMessageClass::null)
+        {
+            throw new ArgumentNullException("message");
+        }
+
+        ENDREGION()
+
+        MidiEvent next = previous != MidiEventClass::null ? (MidiEvent)previous.Next : head;
+
+        REGION(Require)
+
+        if(position < (previous != MidiEventClass::null ? previous.AbsoluteTicks : 0) ||
+            (next != MidiEventClass::null && position > next.AbsoluteTicks))
+        {
+            throw new ArgumentOutOfRangeException("position", position,
+                "IMidiMessage position out of range.");
+        }
+
+        ENDREGION()
+
+        MidiEvent newMidiEvent = MidiEventClass(*this, position, message);
+
+        Link(newMidiEvent, previous, next);
+
+        count++;
+
+        REGION(Invariant)
+
+        AssertValid();
+
+        ENDREGION()
+
+        OnMidiEventInserted(newMidiEvent);
+    }
+
+    /// <summary>
+    /// Moves the MidiEvent directly after the specified MidiEvent without
+    /// changing its position, which reorders the MidiEvents sharing it.
+    /// </summary>
+    /// <param name="e">
+    /// The MidiEvent to be moved.
+    /// </param>
+    /// <param name="previous">
+    /// The MidiEvent to move it after, or MidiEventClass::null to move it
+    /// to the start of the Track. The MidiEvent's position must lie between
+    /// those of the previous MidiEvent and the one following it.
+    /// </param>
+    void TrackClass::MoveAfter(MidiEvent e, MidiEvent previous)
+    {
+        REGION(Require)
+
+        if((object)e.Owner != this ||
+            (previous != MidiEventClass::null && (object)previous.Owner != this))
+        {
+            throw new ArgumentException("MidiEvent does not belong to this Track.");
+        }
+        else if(e == endOfTrackMidiEvent || previous == endOfTrackMidiEvent)
+        {
+            throw new InvalidOperationException(
+                "Cannot move end of track message. Use the EndOfTrackOffset property instead.");
+        }
+        else if(e == previous)
+        {
+            throw new ArgumentException("Cannot move a MidiEvent after itself.", "previous");
+        }
+
+        ENDREGION()
+
+        REGION(Guard)
+
+        if((MidiEvent)e.Previous == previous)
+        {
+            return;
+        }
+
+        ENDREGION()
+
+        MidiEvent next = previous != MidiEventClass::null ? (MidiEvent)previous.Next : head;
+
+        REGION(Require)
+
+        if(e.AbsoluteTicks < (previous != MidiEventClass::null ? previous.AbsoluteTicks : 0) ||
+            (next != MidiEventClass::null && e.AbsoluteTicks > next.AbsoluteTicks))
+        {
+            throw new ArgumentException("The MidiEvent's position does not fit after the previous MidiEvent.", "previous");
+        }
+
+        ENDREGION()
+
+        Unlink(e);
+        Link(e, previous, next);
+
+        REGION(Invariant)
+
+        AssertValid();
+
+        ENDREGION()
+
+        OnMidiEventMoved(e, e.AbsoluteTicks);
+    }
+
+    /// <summary>
+    /// Relinks the MidiEvents of the Track in the specified order after
+    /// their positions or messages have been changed in place.
+    /// </summary>
+    /// <param name="order">
+    /// Every MidiEvent of the Track except the end of track message, in
+    /// position order.
+    /// </param>
+    void TrackClass::Relink(const ArrayList<MidiEventClass*>& order)
+    {
+        REGION(Require)
+
+        if(order.Count != Count - 1)
+        {
+            throw new ArgumentException("The MidiEvents do not match the Track.", "order");
+        }
+
+        ENDREGION()
+
+        REGION(Guard)
+
+        if(order.Count == 0)
+        {
+            return;
+        }
+
+        ENDREGION()
+
+        head = *order[0];
+        head.Previous = MidiEventClass::null;
+
+        for(int i = 1; i < order.Count; i++)
+        {
+            Assert(order[i]->AbsoluteTicks >= order[i - 1]->AbsoluteTicks);
+
+            order[i - 1]->Next = *order[i];
+            order[i]->Previous = *order[i - 1];
+        }
+
+        tail = *order[order.Count - 1];
+        tail.Next = MidiEventClass::null;
+
+        endOfTrackMidiEvent.SetAbsoluteTicks(Length);
+        endOfTrackMidiEvent.Previous = tail;
+
+        REGION(Invariant)
+
+        AssertValid();
+
+        ENDREGION()
+
+        // The MidiEvents may have changed in any way, so observers start
+        // over as they do after a merge.
+        OnTrackCleared();
+
+        for(int i = 0; i < order.Count; i++)
+        {
+            OnMidiEventInserted(*order[i]);
+        }
+    }
+
+    /// <summary>
+    /// Attaches an observer that is notified of edits made to the Track.
+    /// </summary>
+    /// <param name="observer">
+    /// The observer to attach.
+    /// </param>
+    void TrackClass::Attach(ITrackObserver observer)
+    {
+        REGION(Guard)
+
+        for(int i = 0; i < observers.Count; i++)
+        {
+            if(observers[i] == &observer)
+            {
+                return;
+            }
+        }
+
+        ENDREGION()
+
+        observers.Add(&observer);
+    }
+
+    /// <summary>
+    /// Detaches an observer previously attached to the Track.
+    /// </summary>
+    /// <param name="observer">
+    /// The observer to detach.
+    /// </param>
+    void TrackClass::Detach(ITrackObserver observer)
+    {
+        for(int i = 0; i < observers.Count; i++)
+        {
+            if(observers[i] == &observer)
+            {
+                observers.RemoveAt(i);
+                return;
+            }
+        }
+    }
+
+    // Links the MidiEvent in between two neighbouring MidiEvents, either of
+    // which is null at the ends of the Track.
+    void TrackClass::Link(MidiEvent e, MidiEvent previous, MidiEvent next)
+    {
+        e.Previous = previous;
+        e.Next = next;
+
+        if(previous != MidiEventClass::null)
+        {
+            previous.Next = e;
+        }
+        else
+        {
+            head = e;
+        }
+
+        if(next != MidiEventClass::null)
+        {
+            next.Previous = e;
+        }
+        else
+        {
+            tail = e;
+
+            endOfTrackMidiEvent.SetAbsoluteTicks(Length);
+            endOfTrackMidiEvent.Previous = tail;
+        }
+    }
+
+    // Takes the MidiEvent out of the list, leaving its position as it is.
+    void TrackClass::Unlink(MidiEvent e)
+    {
+        if((MidiEvent)e.Previous != MidiEventClass::null)
+        {
+            ((MidiEvent)e.Previous).Next = e.Next;
+        }
+        else
+        {
+            head = e.Next;
+        }
+
+        if((MidiEvent)e.Next != MidiEventClass::null)
+        {
+            ((MidiEvent)e.Next).Previous = e.Previous;
+        }
+        else
+        {
+            tail = e.Previous;
+        }
+
+        e.Next = e.Previous = MidiEventClass::null;
+    }
+
+    void TrackClass::BuildIndex()
+    {
+        events.Clear();
+        events.EnsureCapacity(count - 1);
+
+        MidiEventClass* current = head != MidiEventClass::null ? &head : nullptr;
+
+        while(current != nullptr)
+        {
+            events.Add(current);
+
+            MidiEvent next = current->Next;
+
+            current = next != MidiEventClass::null ? &next : nullptr;
+        }
+
+        indexed = true;
+    }
+
+    // Every edit goes through one of the notifications below, which drop
+    // the index and take a new revision before telling the observers.
+
+    void TrackClass::OnMidiEventInserted(MidiEvent e)
+    {
+        indexed = false;
+        revision = InterlockedIncrement(&lastRevision);
+
+        for(int i = 0; i < observers.Count; i++)
+        {
+            observers[i]->MidiEventInserted(*this, e);
+        }
+    }
+
+    void TrackClass::OnMidiEventRemoved(MidiEvent e)
+    {
+        indexed = false;
+        revision = InterlockedIncrement(&lastRevision);
+
+        for(int i = 0; i < observers.Count; i++)
+        {
+            observers[i]->MidiEventRemoved(*this, e);
+        }
+    }
+
+    void TrackClass::OnMidiEventMoved(MidiEvent e, int oldPosition)
+    {
+        indexed = false;
+        revision = InterlockedIncrement(&lastRevision);
+
+        for(int i = 0; i < observers.Count; i++)
+        {
+            observers[i]->MidiEventMoved(*this, e, oldPosition);
+        }
+    }
+
+    void TrackClass::OnTrackCleared()
+    {
+        indexed = false;
+        revision = InterlockedIncrement(&lastRevision);
+
+        for(int i = 0; i < observers.Count; i++)
+        {
+            observers[i]->TrackCleared(*this);
+        }
+    }
+
+    // Changing the end of track offset moves no MidiEvent, so the index is
+    // kept.
+    void TrackClass::OnLengthChanged()
+    {
+        revision = InterlockedIncrement(&lastRevision);
+
+        for(int i = 0; i < observers.Count; i++)
+        {
+            observers[i]->LengthChanged(*this);
+        }
     }
 
     #if(DEBUG)
@@ -605,6 +1081,8 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         endOfTrackOffset = value;
 
         endOfTrackMidiEvent.SetAbsoluteTicks(Length);
+
+        OnLengthChanged();
     }
 
     /// <summary>
@@ -615,4 +1093,53 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         return *this;
     }
 
+    /// <summary>
+    /// Gets or sets a value indicating whether the Track keeps lists of its
+    /// MidiEvents by channel and message type.
+    /// </summary>
+    bool TrackClass::get_PostingsEnabled()
+    {
+        return postings != nullptr;
+    }
+    void TrackClass::set_PostingsEnabled(bool value)
+    {
+        if(value && postings == nullptr)
+        {
+            postings = new EventPostingsClass(*this);
+        }
+        else if(!value && postings != nullptr)
+        {
+            delete postings;
+            postings = nullptr;
+        }
+    }
+
+    /// <summary>
+    /// Gets the lists of the Track's MidiEvents by channel and message type.
+    /// Only available while PostingsEnabled is set.
+    /// </summary>
+    EventPostings TrackClass::get_Postings()
+    {
+        REGION(Require)
+
+        if(postings == nullptr)
+        {
+            throw new InvalidOperationException("The Track does not keep postings.");
+        }
+
+        ENDREGION()
+
+        return *postings;
+    }
+
+    /// <summary>
+    /// Gets a number that every edit changes to one no Track has had
+    /// before, so that a copy can tell whether its Track was edited since
+    /// the copy was made.
+    /// </summary>
+    long TrackClass::get_Revision()
+    {
+        return revision;
+    }
+
 }}}
@@ -36,6 +36,7 @@
 //ENDREGION()
 
 #include "Types.h"
+#include "ArrayList.h"
 #include "MidiEvent.h"
 
 namespace Sanford { namespace Multimedia { namespace Midi {
@@ -43,6 +44,52 @@ namespace Sanford { namespace Multimedia { namespace Midi {
     class TrackClass;
     typedef TrackClass& Track;
 
+    class ITrackObserverIf;
+    typedef ITrackObserverIf& ITrackObserver;
+
+    class EventPostingsClass;
+    typedef EventPostingsClass& EventPostings;
+
+    /// <summary>
+    /// Represents the functionality for objects that follow the edits made
+    /// to a Track, such as indexes and caches built over its MidiEvents.
+    /// </summary>
+    /// <remarks>
+    /// Observers are notified after the Track has been modified. Only the
+    /// notifications an observer cares about need to be overridden.
+    /// </remarks>
+    class ITrackObserverIf
+    {
+    public:
+
+        /// <summary>
+        /// Called after a MidiEvent has been inserted into the Track.
+        /// </summary>
+        virtual void MidiEventInserted(Track track, MidiEvent e) { }
+
+        /// <summary>
+        /// Called after a MidiEvent has been removed from the Track.
+        /// </summary>
+        virtual void MidiEventRemoved(Track track, MidiEvent e) { }
+
+        /// <summary>
+        /// Called after a MidiEvent has been moved to a new position.
+        /// </summary>
+        virtual void MidiEventMoved(Track track, MidiEvent e, int oldPosition) { }
+
+        /// <summary>
+        /// Called after all of the MidiEvents have been removed from the Track.
+        /// </summary>
+        virtual void TrackCleared(Track track) { }
+
+        /// <summary>
+        /// Called after the end of track offset of the Track has changed
+        /// its length.
+        /// </summary>
+        virtual void LengthChanged(Track track) { }
+
+    };
+
     /// <summary>
     /// Represents a collection of MidiEvents and a MIDI track within a 
     /// Sequence.
@@ -71,6 +118,26 @@ namespace Sanford { namespace Multimedia { namespace Midi {
 
         // The end of track MIDI event.
         MidiEvent endOfTrackMidiEvent;
+
+        // The observers notified of edits made to the Track.
+        ArrayList<ITrackObserverIf*> observers;
+
+        // The MidiEvents in order, not including the end of track message,
+        // so that positions and indices can be found without walking the
+        // list. Built when first needed and dropped by every edit.
+        ArrayList<MidiEventClass*> events;
+
+        bool indexed;
+
+        // The lists of MidiEvents by channel and message type, or nullptr
+        // if they are not kept.
+        EventPostingsClass* postings;
+
+        // Changed by every edit to a number no Track has had before.
+        long revision;
+
+        // The last revision given to any Track.
+        static volatile long lastRevision;
         
         ENDREGION()
 
@@ -79,6 +146,8 @@ namespace Sanford { namespace Multimedia { namespace Midi {
     public:
 
         TrackClass();
+
+        ~TrackClass();
         
         ENDREGION()
 
@@ -120,6 +189,14 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         /// </param>
         void RemoveAt(int index);
 
+        /// <summary>
+        /// Removes the specified MidiEvent.
+        /// </summary>
+        /// <param name="e">
+        /// The MidiEvent to remove.
+        /// </param>
+        void Remove(MidiEvent e);
+
         /// <summary>
         /// Gets the MidiEvent at the specified index.
         /// </summary>
@@ -131,6 +208,18 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         /// </returns>
         MidiEvent GetMidiEvent(int index);
 
+        /// <summary>
+        /// Finds the first MidiEvent at or after the specified position.
+        /// </summary>
+        /// <param name="position">
+        /// The position in absolute ticks.
+        /// </param>
+        /// <returns>
+        /// The index of the MidiEvent, or the index of the end of track
+        /// message if every other MidiEvent is before the position.
+        /// </returns>
+        int FindIndex(int position);
+
         /// <summary>
         /// Moves the MidiEvent to the specified index.
         /// </summary>
@@ -141,6 +230,64 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         /// The index that MidiEvent will be put.
         /// </param>
         void Move(MidiEvent e, int newPosition);
+
+        /// <summary>
+        /// Inserts an IMidiMessage at the specified position directly after
+        /// the specified MidiEvent, which places it among the MidiEvents
+        /// sharing its position.
+        /// </summary>
+        /// <param name="previous">
+        /// The MidiEvent to insert after, or MidiEventClass::null to insert
+        /// at the start of the Track.
+        /// </param>
+        /// <param name="position">
+        /// The position in absolute ticks, which must lie between those of
+        /// the previous MidiEvent and the one following it.
+        /// </param>
+        /// <param name="message">
+        /// The IMidiMessage to insert.
+        /// </param>
+        void InsertAfter(MidiEvent previous, int position, IMidiMessage message);
+
+        /// <summary>
+        /// Moves the MidiEvent directly after the specified MidiEvent without
+        /// changing its position, which reorders the MidiEvents sharing it.
+        /// </summary>
+        /// <param name="e">
+        /// The MidiEvent to be moved.
+        /// </param>
+        /// <param name="previous">
+        /// The MidiEvent to move it after, or MidiEventClass::null to move
+        /// it to the start of the Track. The MidiEvent's position must lie
+        /// between those of the previous MidiEvent and the one following it.
+        /// </param>
+        void MoveAfter(MidiEvent e, MidiEvent previous);
+
+        /// <summary>
+        /// Relinks the MidiEvents of the Track in the specified order after
+        /// their positions or messages have been changed in place.
+        /// </summary>
+        /// <param name="order">
+        /// Every MidiEvent of the Track except the end of track message,
+        /// in position order.
+        /// </param>
+        void Relink(const ArrayList<MidiEventClass*>& order);
+
+        /// <summary>
+        /// Attaches an observer that is notified of edits made to the Track.
+        /// </summary>
+        /// <param name="observer">
+        /// The observer to attach.
+        /// </param>
+        void Attach(ITrackObserver observer);
+
+        /// <summary>
+        /// Detaches an observer previously attached to the Track.
+        /// </summary>
+        /// <param name="observer">
+        /// The observer to detach.
+        /// </param>
+        void Detach(ITrackObserver observer);
  
         ENDREGION()
 
@@ -167,6 +314,25 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         /// Gets an object that can be used to synchronize access to the Track.
         /// </summary>
         ReadOnlyProperty<object> SyncRoot;
+
+        /// <summary>
+        /// Gets or sets a value indicating whether the Track keeps lists of
+        /// its MidiEvents by channel and message type.
+        /// </summary>
+        Property<bool> PostingsEnabled;
+
+        /// <summary>
+        /// Gets the lists of the Track's MidiEvents by channel and message
+        /// type. Only available while PostingsEnabled is set.
+        /// </summary>
+        ReadOnlyProperty<EventPostings> Postings;
+
+        /// <summary>
+        /// Gets a number that every edit changes to one no Track has had
+        /// before, so that a copy can tell whether its Track was edited
+        /// since the copy was made.
+        /// </summary>
+        ReadOnlyProperty<long> Revision;
         
         ENDREGION()
 
@@ -175,6 +341,22 @@ namespace Sanford { namespace Multimedia { namespace Midi {
 	private:
 		void AssertValid();
 
+        void BuildIndex();
+
+        void Link(MidiEvent e, MidiEvent previous, MidiEvent next);
+
+        void Unlink(MidiEvent e);
+
+        void OnMidiEventInserted(MidiEvent e);
+
+        void OnMidiEventRemoved(MidiEvent e);
+
+        void OnMidiEventMoved(MidiEvent e, int oldPosition);
+
+        void OnTrackCleared();
+
+        void OnLengthChanged();
+
     private:
         void init();
         int get_Count();
@@ -182,6 +364,10 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         int get_EndOfTrackOffset();
         void set_EndOfTrackOffset(int value);
         object get_SyncRoot();
+        bool get_PostingsEnabled();
+        void set_PostingsEnabled(bool value);
+        EventPostings get_Postings();
+        long get_Revision();
 
     public:
         static const Track null;
@@ -0,0 +1,1246 @@
+#include "TrackDiff.h"
+#include "ChannelMessage.h"
+#include "SysCommonMessage.h"
+#include "SysRealtimeMessage.h"
+#include "MetaMessage.h"
+#include "SysExMessage.h"
+#include "MessagePool.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef TrackDiffClass cls;
+
+    // Stands in front of a SysRealtimeMessage when written, as its status
+    // byte could be mistaken for the status of a MetaMessage. The status
+    // is undefined in MIDI.
+    static const int RealtimeEscape = 0xF5;
+
+    // A MidiEvent of one of the versions, with its position, index and the
+    // hash of its message, the index of the MidiEvent of the other version
+    // it is paired with, or -1, and whether the pair is a move.
+    struct DiffEntry
+    {
+        int ticks;
+        int hash;
+        int index;
+        int partner;
+        bool moved;
+        IMidiMessageIf* message;
+    };
+
+    // Orders entries by position, then by message hash.
+    struct PositionOrder
+    {
+        bool operator()(const DiffEntry& a, const DiffEntry& b) const
+        {
+            return a.ticks < b.ticks || (a.ticks == b.ticks && a.hash < b.hash);
+        }
+    };
+
+    // Orders entries by message hash, then by position.
+    struct MessageOrder
+    {
+        bool operator()(const DiffEntry& a, const DiffEntry& b) const
+        {
+            return a.hash < b.hash || (a.hash == b.hash && a.ticks < b.ticks);
+        }
+    };
+
+    // Orders entries by message hash alone, so that the entries with the
+    // same hash are matched together whatever their positions.
+    struct HashOrder
+    {
+        bool operator()(const DiffEntry& a, const DiffEntry& b) const
+        {
+            return a.hash < b.hash;
+        }
+    };
+
+    // A stable bottom-up merge sort, as NoteIndex uses.
+    template<typename T, typename Order>
+    static void MergeSort(T* items, T* scratch, int count, Order before)
+    {
+        T* source = items;
+        T* destination = scratch;
+
+        for(int width = 1; width < count; width *= 2)
+        {
+            for(int low = 0; low < count; low += 2 * width)
+            {
+                int middle = low + width < count ? low + width : count;
+                int high = low + 2 * width < count ? low + 2 * width : count;
+                int a = low;
+                int b = middle;
+
+                for(int i = low; i < high; i++)
+                {
+                    if(a < middle && (b >= high || !before(source[b], source[a])))
+                    {
+                        destination[i] = source[a++];
+                    }
+                    else
+                    {
+                        destination[i] = source[b++];
+                    }
+                }
+            }
+
+            T* swap = source;
+
+            source = destination;
+            destination = swap;
+        }
+
+        if(source != items)
+        {
+            for(int i = 0; i < count; i++)
+            {
+                items[i] = source[i];
+            }
+        }
+    }
+
+    template<typename Order>
+    static void Sort(ArrayList<DiffEntry>& entries, Order before)
+    {
+        if(entries.Count > 1)
+        {
+            DiffEntry* scratch = new DiffEntry[entries.Count];
+
+            MergeSort(&entries[0], scratch, entries.Count, before);
+
+            delete[] scratch;
+        }
+    }
+
+    static MidiEventClass* Next(MidiEventClass* e)
+    {
+        MidiEvent next = e->Next;
+
+        return next != MidiEventClass::null ? &next : nullptr;
+    }
+
+    // Gets the packed value of a short message. The second data byte of a
+    // channel message with a single data byte is left over from whatever
+    // was built before it, so it is cleared.
+    static int GetPackedMessage(IMidiMessage message)
+    {
+        int packed = ((ShortMessage)message).Message;
+
+        if(message.MessageType == MessageType::Channel &&
+            ChannelMessageClass::DataBytesPerType(ChannelMessageClass::UnpackCommand(packed)) == 1)
+        {
+            packed &= 0xFFFF;
+        }
+
+        return packed;
+    }
+
+    // Hashes the bytes of a MetaMessage or SysExMessage with FNV-1a.
+    template<typename T>
+    static int HashBytes(int seed, T& bytes, int length)
+    {
+        unsigned int hash = 2166136261u;
+
+        hash = (hash ^ (unsigned int)seed) * 16777619u;
+
+        for(int i = 0; i < length; i++)
+        {
+            hash = (hash ^ (unsigned char)bytes[i]) * 16777619u;
+        }
+
+        return (int)hash;
+    }
+
+    template<typename T>
+    static bool SameBytes(T& a, T& b)
+    {
+        if(a.Length != b.Length)
+        {
+            return false;
+        }
+
+        for(int i = 0; i < a.Length; i++)
+        {
+            if(a[i] != b[i])
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    static int HashMessage(IMidiMessage message)
+    {
+        if(message.MessageType == MessageType::Meta)
+        {
+            MetaMessage meta = (MetaMessage)message;
+
+            return HashBytes(0x100 | meta.MetaType, meta, meta.Length);
+        }
+        else if(message.MessageType == MessageType::SystemExclusive)
+        {
+            SysExMessage sysEx = (SysExMessage)message;
+
+            return HashBytes(0, sysEx, sysEx.Length);
+        }
+
+        return (int)((unsigned int)GetPackedMessage(message) * 2654435761u);
+    }
+
+    static bool SameMessage(IMidiMessage a, IMidiMessage b)
+    {
+        if(&a == &b)
+        {
+            return true;
+        }
+        else if(a.MessageType != b.MessageType)
+        {
+            return false;
+        }
+        else if(a.MessageType == MessageType::Meta)
+        {
+            return ((MetaMessage)a).MetaType == ((MetaMessage)b).MetaType &&
+                SameBytes((MetaMessage)a, (MetaMessage)b);
+        }
+        else if(a.MessageType == MessageType::SystemExclusive)
+        {
+            return SameBytes((SysExMessage)a, (SysExMessage)b);
+        }
+
+        return GetPackedMessage(a) == GetPackedMessage(b);
+    }
+
+    static void Collect(Track track, ArrayList<DiffEntry>& entries)
+    {
+        entries.EnsureCapacity(track.Count - 1);
+
+        MidiEventClass* current = track.Count > 1 ? &track.GetMidiEvent(0) : nullptr;
+
+        for(int index = 0; current != nullptr; current = Next(current), index++)
+        {
+            DiffEntry entry;
+
+            IMidiMessage message = current->MidiMessage;
+
+            entry.ticks = current->AbsoluteTicks;
+            entry.message = &message;
+            entry.hash = HashMessage(message);
+            entry.index = index;
+            entry.partner = -1;
+            entry.moved = false;
+
+            entries.Add(entry);
+        }
+    }
+
+    // Unpairs the entries at each position whose pairs are not in the same
+    // order in both versions, keeping the longest run of pairs that is, so
+    // the MidiEvents kept never need reordering among themselves.
+    static void KeepInOrder(ArrayList<DiffEntry>& olds, ArrayList<DiffEntry>& news)
+    {
+        REGION(Guard)
+
+        if(olds.Count == 0)
+        {
+            return;
+        }
+
+        ENDREGION()
+
+        // The last entry of the best run of each length found so far, and
+        // the entry before each one in its run.
+        ArrayList<int> tails;
+        int* previous = new int[olds.Count];
+        bool* kept = new bool[olds.Count];
+
+        for(int start = 0, end; start < olds.Count; start = end)
+        {
+            end = start + 1;
+
+            while(end < olds.Count && olds[end].ticks == olds[start].ticks)
+            {
+                end++;
+            }
+
+            tails.Clear();
+
+            for(int i = start; i < end; i++)
+            {
+                kept[i] = false;
+
+                if(olds[i].partner < 0)
+                {
+                    continue;
+                }
+
+                int low = 0;
+                int high = tails.Count;
+
+                while(low < high)
+                {
+                    int middle = (low + high) / 2;
+
+                    if(olds[tails[middle]].partner < olds[i].partner)
+                    {
+                        low = middle + 1;
+                    }
+                    else
+                    {
+                        high = middle;
+                    }
+                }
+
+                previous[i] = low > 0 ? tails[low - 1] : -1;
+
+                if(low == tails.Count)
+                {
+                    tails.Add(i);
+                }
+                else
+                {
+                    tails[low] = i;
+                }
+            }
+
+            for(int i = tails.Count > 0 ? tails[tails.Count - 1] : -1; i >= 0; i = previous[i])
+            {
+                kept[i] = true;
+            }
+
+            for(int i = start; i < end; i++)
+            {
+                if(olds[i].partner >= 0 && !kept[i])
+                {
+                    news[olds[i].partner].partner = -1;
+                    olds[i].partner = -1;
+                }
+            }
+        }
+
+        delete[] previous;
+        delete[] kept;
+    }
+
+    static MidiEvent Ref(MidiEventClass* e)
+    {
+        return e != nullptr ? *e : MidiEventClass::null;
+    }
+
+    // Pairs the entries of two lists sorted in the specified order that
+    // the order does not tell apart and that have equal messages, each
+    // with the earliest one of the other list still unpaired.
+    template<typename Order>
+    static void Match(ArrayList<DiffEntry>& a, ArrayList<DiffEntry>& b, Order before)
+    {
+        int i = 0;
+        int j = 0;
+
+        while(i < a.Count && j < b.Count)
+        {
+            if(before(a[i], b[j]))
+            {
+                i++;
+            }
+            else if(before(b[j], a[i]))
+            {
+                j++;
+            }
+            else
+            {
+                int aEnd = i + 1;
+                int bEnd = j + 1;
+
+                while(aEnd < a.Count && !before(a[i], a[aEnd]))
+                {
+                    aEnd++;
+                }
+
+                while(bEnd < b.Count && !before(b[j], b[bEnd]))
+                {
+                    bEnd++;
+                }
+
+                // The entries before first are all paired, so runs of equal
+                // messages are paired in one pass.
+                int first = j;
+
+                for(int k = i; k < aEnd; k++)
+                {
+                    while(first < bEnd && b[first].partner >= 0)
+                    {
+                        first++;
+                    }
+
+                    for(int m = first; m < bEnd; m++)
+                    {
+                        if(b[m].partner < 0 && SameMessage(*a[k].message, *b[m].message))
+                        {
+                            a[k].partner = b[m].index;
+                            b[m].partner = a[k].index;
+
+                            break;
+                        }
+                    }
+                }
+
+                i = aEnd;
+                j = bEnd;
+            }
+        }
+    }
+
+    static void WriteVariableLength(ArrayList<unsigned char>& data, int value)
+    {
+        unsigned char bytes[5];
+        int count = 0;
+
+        bytes[count++] = value & 0x7F;
+
+        while((value = (int)((unsigned int)value >> 7)) != 0)
+        {
+            bytes[count++] = 0x80 | (value & 0x7F);
+        }
+
+        while(count > 0)
+        {
+            data.Add(bytes[--count]);
+        }
+    }
+
+    static int ReadByte(const unsigned char* data, int length, int& index)
+    {
+        if(index >= length)
+        {
+            throw new ArgumentException("The edit script is not valid.", "data");
+        }
+
+        return data[index++];
+    }
+
+    static int ReadVariableLength(const unsigned char* data, int length, int& index)
+    {
+        int result = 0;
+        int b;
+
+        do
+        {
+            b = ReadByte(data, length, index);
+            result = (result << 7) | (b & 0x7F);
+        }while((b & 0x80) == 0x80);
+
+        return result;
+    }
+
+    // Writes a signed difference so that small ones of either sign take
+    // few bytes.
+    static void WriteDifference(ArrayList<unsigned char>& data, int value)
+    {
+        WriteVariableLength(data, (value << 1) ^ (value >> 31));
+    }
+
+    static int ReadDifference(const unsigned char* data, int length, int& index)
+    {
+        unsigned int value = (unsigned int)ReadVariableLength(data, length, index);
+
+        return (int)(value >> 1) ^ -(int)(value & 1);
+    }
+
+    static int SysCommonDataBytes(int status)
+    {
+        switch((SysCommonType)status)
+        {
+            case SysCommonType::MidiTimeCode:
+            case SysCommonType::SongSelect:
+                return 1;
+
+            case SysCommonType::SongPositionPointer:
+                return 2;
+
+            case SysCommonType::TuneRequest:
+                return 0;
+        }
+
+        return -1;
+    }
+
+    void cls::init()
+    {
+        this->Count = Functor::New(this, &cls::get_Count);
+        this->EndOfTrackOffset = Functor::New(this, &cls::get_EndOfTrackOffset);
+        this->endOfTrackOffset = 0;
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the TrackDiff class.
+    /// </summary>
+    TrackDiffClass::TrackDiffClass()
+    {
+        init();
+    }
+
+    TrackDiffClass::~TrackDiffClass()
+    {
+        ClearEdits();
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Finds the edits that turn one version of a Track into another.
+    /// </summary>
+    /// <param name="oldTrack">
+    /// The version the edits are applied to.
+    /// </param>
+    /// <param name="newTrack">
+    /// The version the edits produce. The inserted messages are those of
+    /// this Track.
+    /// </param>
+    void TrackDiffClass::Compute(Track oldTrack, Track newTrack)
+    {
+        ArrayList<DiffEntry> olds;
+        ArrayList<DiffEntry> news;
+
+        Collect(oldTrack, olds);
+        Collect(newTrack, news);
+
+        // Keeps the MidiEvents at the same position with equal messages.
+        ArrayList<DiffEntry> sortedOlds;
+        ArrayList<DiffEntry> sortedNews;
+
+        sortedOlds.EnsureCapacity(olds.Count);
+        sortedNews.EnsureCapacity(news.Count);
+
+        for(int i = 0; i < olds.Count; i++)
+        {
+            sortedOlds.Add(olds[i]);
+        }
+
+        for(int i = 0; i < news.Count; i++)
+        {
+            sortedNews.Add(news[i]);
+        }
+
+        Sort(sortedOlds, PositionOrder());
+        Sort(sortedNews, PositionOrder());
+        Match(sortedOlds, sortedNews, PositionOrder());
+
+        for(int i = 0; i < sortedOlds.Count; i++)
+        {
+            olds[sortedOlds[i].index].partner = sortedOlds[i].partner;
+        }
+
+        for(int i = 0; i < sortedNews.Count; i++)
+        {
+            news[sortedNews[i].index].partner = sortedNews[i].partner;
+        }
+
+        KeepInOrder(olds, news);
+
+        // Pairs up what is left with equal messages, elsewhere or out of
+        // order at the same position, as moves.
+        ArrayList<DiffEntry> removed;
+        ArrayList<DiffEntry> inserted;
+
+        for(int i = 0; i < olds.Count; i++)
+        {
+            if(olds[i].partner < 0)
+            {
+                removed.Add(olds[i]);
+            }
+        }
+
+        for(int i = 0; i < news.Count; i++)
+        {
+            if(news[i].partner < 0)
+            {
+                inserted.Add(news[i]);
+            }
+        }
+
+        Sort(removed, MessageOrder());
+        Sort(inserted, MessageOrder());
+        Match(removed, inserted, HashOrder());
+
+        for(int i = 0; i < removed.Count; i++)
+        {
+            olds[removed[i].index].partner = removed[i].partner;
+            olds[removed[i].index].moved = true;
+        }
+
+        for(int i = 0; i < inserted.Count; i++)
+        {
+            news[inserted[i].index].partner = inserted[i].partner;
+        }
+
+        ClearEdits();
+
+        TrackEdit edit;
+
+        edit.message = nullptr;
+        edit.position = 0;
+        edit.newIndex = -1;
+
+        for(int i = 0; i < olds.Count; i++)
+        {
+            if(olds[i].partner < 0)
+            {
+                edit.type = TrackEditType::RemoveEdit;
+                edit.index = i;
+
+                edits.Add(edit);
+            }
+        }
+
+        for(int i = 0; i < olds.Count; i++)
+        {
+            if(olds[i].partner >= 0 && olds[i].moved)
+            {
+                edit.type = TrackEditType::MoveEdit;
+                edit.index = i;
+                edit.position = news[olds[i].partner].ticks;
+                edit.newIndex = olds[i].partner;
+
+                edits.Add(edit);
+            }
+        }
+
+        for(int i = 0; i < news.Count; i++)
+        {
+            if(news[i].partner < 0)
+            {
+                edit.type = TrackEditType::InsertEdit;
+                edit.index = -1;
+                edit.position = news[i].ticks;
+                edit.newIndex = i;
+                edit.message = news[i].message;
+
+                MessagePoolClass::Shared.AddReference(*edit.message);
+
+                edits.Add(edit);
+            }
+        }
+
+        endOfTrackOffset = newTrack.EndOfTrackOffset;
+
+        REGION(Ensure)
+
+        AssertRoundTrip(oldTrack, newTrack);
+
+        ENDREGION()
+    }
+
+    /// <summary>
+    /// Applies the edits to the specified Track.
+    /// </summary>
+    /// <param name="track">
+    /// The Track, which must be the old version the edits were found or
+    /// read for.
+    /// </param>
+    void TrackDiffClass::Apply(Track track)
+    {
+        int removeCount = 0;
+        int moveCount = 0;
+
+        while(removeCount < edits.Count && edits[removeCount].type == TrackEditType::RemoveEdit)
+        {
+            removeCount++;
+        }
+
+        while(removeCount + moveCount < edits.Count &&
+            edits[removeCount + moveCount].type == TrackEditType::MoveEdit)
+        {
+            moveCount++;
+        }
+
+        int newCount = track.Count - 1 - removeCount + edits.Count - removeCount - moveCount;
+
+        REGION(Require)
+
+        for(int i = 0; i < edits.Count; i++)
+        {
+            if(edits[i].type != TrackEditType::InsertEdit &&
+                (edits[i].index < 0 || edits[i].index >= track.Count - 1 ||
+                (i > 0 && edits[i - 1].type == edits[i].type && edits[i - 1].index >= edits[i].index)))
+            {
+                throw new ArgumentOutOfRangeException("index", edits[i].index,
+                    "Track index out of range.");
+            }
+            else if(edits[i].type != TrackEditType::RemoveEdit &&
+                (edits[i].newIndex < 0 || edits[i].newIndex >= newCount))
+            {
+                throw new ArgumentOutOfRangeException("newIndex", edits[i].newIndex,
+                    "Track index out of range.");
+            }
+        }
+
+        ENDREGION()
+
+        // The edit placing the MidiEvent at each index of the new version,
+        // or -1 where a MidiEvent is kept.
+        int* placed = new int[newCount];
+
+        for(int i = 0; i < newCount; i++)
+        {
+            placed[i] = -1;
+        }
+
+        for(int i = removeCount; i < edits.Count; i++)
+        {
+            if(placed[edits[i].newIndex] >= 0)
+            {
+                delete[] placed;
+
+                throw new ArgumentException("The edits are not valid.", "track");
+            }
+
+            placed[edits[i].newIndex] = i;
+        }
+
+        // The MidiEvents removed, moved and kept are found in one walk, so
+        // no edit needs the index of the Track.
+        ArrayList<MidiEventClass*> removed;
+        ArrayList<MidiEventClass*> moved;
+        ArrayList<MidiEventClass*> kept;
+        MidiEventClass* current = track.Count > 1 ? &track.GetMidiEvent(0) : nullptr;
+        int removal = 0;
+        int move = removeCount;
+
+        removed.EnsureCapacity(removeCount);
+        moved.EnsureCapacity(moveCount);
+        kept.EnsureCapacity(track.Count - 1 - removeCount - moveCount);
+
+        for(int index = 0; current != nullptr; current = Next(current), index++)
+        {
+            if(removal < removeCount && edits[removal].index == index)
+            {
+                removed.Add(current);
+                removal++;
+            }
+            else if(move < removeCount + moveCount && edits[move].index == index)
+            {
+                moved.Add(current);
+                move++;
+            }
+            else
+            {
+                kept.Add(current);
+            }
+        }
+
+        // A MidiEvent both removed and moved leaves edits unmatched.
+        if(removal < removeCount || move < removeCount + moveCount)
+        {
+            delete[] placed;
+
+            throw new ArgumentException("The edits are not valid.", "track");
+        }
+
+        for(int i = 0; i < removeCount; i++)
+        {
+            track.Remove(*removed[i]);
+        }
+
+        // The moved MidiEvents are given their positions in place and
+        // linked in among the kept ones in a single pass, as a quantize
+        // does, rather than each walking the Track to its place.
+        if(moveCount > 0)
+        {
+            ArrayList<MidiEventClass*> order;
+            int next = 0;
+
+            order.EnsureCapacity(kept.Count + moveCount);
+
+            for(int i = 0; i < moveCount; i++)
+            {
+                moved[i]->SetAbsoluteTicks(edits[removeCount + i].position);
+            }
+
+            for(int i = 0; i < newCount; i++)
+            {
+                if(placed[i] < 0)
+                {
+                    order.Add(kept[next++]);
+                }
+                else if(edits[placed[i]].type == TrackEditType::MoveEdit)
+                {
+                    order.Add(moved[placed[i] - removeCount]);
+                }
+            }
+
+            track.Relink(order);
+        }
+
+        // Every MidiEvent kept or moved is now in its place, so the
+        // messages are inserted going forward through the new version.
+        MidiEventClass* previous = nullptr;
+        int next = 0;
+
+        for(int i = 0; i < newCount; i++)
+        {
+            if(placed[i] < 0)
+            {
+                previous = kept[next++];
+            }
+            else if(edits[placed[i]].type == TrackEditType::MoveEdit)
+            {
+                previous = moved[placed[i] - removeCount];
+            }
+            else
+            {
+                IMidiMessage message = *edits[placed[i]].message;
+
+                MessagePoolClass::Shared.AddReference(message);
+
+                track.InsertAfter(Ref(previous), edits[placed[i]].position, message);
+
+                previous = previous != nullptr ? Next(previous) : &track.GetMidiEvent(0);
+            }
+        }
+
+        delete[] placed;
+
+        track.EndOfTrackOffset = endOfTrackOffset;
+    }
+
+    /// <summary>
+    /// Writes the edits as bytes.
+    /// </summary>
+    /// <param name="data">
+    /// The list the bytes are added to.
+    /// </param>
+    void TrackDiffClass::Write(ArrayList<unsigned char>& data)
+    {
+        int counts[3] = { 0, 0, 0 };
+
+        for(int i = 0; i < edits.Count; i++)
+        {
+            counts[edits[i].type]++;
+        }
+
+        WriteVariableLength(data, endOfTrackOffset);
+        WriteVariableLength(data, counts[TrackEditType::RemoveEdit]);
+        WriteVariableLength(data, counts[TrackEditType::MoveEdit]);
+        WriteVariableLength(data, counts[TrackEditType::InsertEdit]);
+
+        int previousIndex = 0;
+        int previousPosition = 0;
+        int previousNewIndex = 0;
+        int runningStatus = 0;
+
+        for(int i = 0; i < edits.Count; i++)
+        {
+            const TrackEdit& edit = edits[i];
+
+            if(edit.type == TrackEditType::RemoveEdit)
+            {
+                WriteVariableLength(data, edit.index - previousIndex);
+
+                previousIndex = edit.index;
+            }
+            else if(edit.type == TrackEditType::MoveEdit)
+            {
+                // The moves start over from the first index.
+                if(i == 0 || edits[i - 1].type != TrackEditType::MoveEdit)
+                {
+                    previousIndex = 0;
+                }
+
+                WriteVariableLength(data, edit.index - previousIndex);
+                WriteDifference(data, edit.position - previousPosition);
+                WriteDifference(data, edit.newIndex - previousNewIndex);
+
+                previousIndex = edit.index;
+                previousPosition = edit.position;
+                previousNewIndex = edit.newIndex;
+            }
+            else
+            {
+                // The insertions start over from the first position and
+                // index, and go forward through both.
+                if(i == 0 || edits[i - 1].type != TrackEditType::InsertEdit)
+                {
+                    previousPosition = 0;
+                    previousNewIndex = 0;
+                }
+
+                WriteVariableLength(data, edit.position - previousPosition);
+                WriteVariableLength(data, edit.newIndex - previousNewIndex);
+
+                previousPosition = edit.position;
+                previousNewIndex = edit.newIndex;
+
+                IMidiMessage message = *edit.message;
+
+                if(message.MessageType == MessageType::Channel)
+                {
+                    int packed = GetPackedMessage(message);
+                    int status = ShortMessageClass::UnpackStatus(packed);
+
+                    if(status != runningStatus)
+                    {
+                        data.Add(status);
+                        runningStatus = status;
+                    }
+
+                    data.Add(ShortMessageClass::UnpackData1(packed));
+
+                    if(ChannelMessageClass::DataBytesPerType(ChannelMessageClass::UnpackCommand(packed)) == 2)
+                    {
+                        data.Add(ShortMessageClass::UnpackData2(packed));
+                    }
+
+                    continue;
+                }
+
+                runningStatus = 0;
+
+                if(message.MessageType == MessageType::Meta)
+                {
+                    MetaMessage meta = (MetaMessage)message;
+
+                    data.Add(0xFF);
+                    data.Add(meta.MetaType);
+                    WriteVariableLength(data, meta.Length);
+
+                    for(int j = 0; j < meta.Length; j++)
+                    {
+                        data.Add(meta[j]);
+                    }
+                }
+                else if(message.MessageType == MessageType::SystemExclusive)
+                {
+                    SysExMessage sysEx = (SysExMessage)message;
+
+                    data.Add(sysEx[0]);
+                    WriteVariableLength(data, sysEx.Length - 1);
+
+                    for(int j = 1; j < sysEx.Length; j++)
+                    {
+                        data.Add(sysEx[j]);
+                    }
+                }
+                else if(message.MessageType == MessageType::SystemCommon)
+                {
+                    int packed = GetPackedMessage(message);
+                    int status = ShortMessageClass::UnpackStatus(packed);
+
+                    data.Add(status);
+
+                    if(SysCommonDataBytes(status) > 0)
+                    {
+                        data.Add(ShortMessageClass::UnpackData1(packed));
+                    }
+
+                    if(SysCommonDataBytes(status) > 1)
+                    {
+                        data.Add(ShortMessageClass::UnpackData2(packed));
+                    }
+                }
+                else
+                {
+                    data.Add(RealtimeEscape);
+                    data.Add(ShortMessageClass::UnpackStatus(GetPackedMessage(message)));
+                }
+            }
+        }
+    }
+
+    /// <summary>
+    /// Reads edits written by Write in place of the current ones.
+    /// </summary>
+    /// <param name="data">
+    /// The bytes written.
+    /// </param>
+    /// <param name="length">
+    /// The number of bytes.
+    /// </param>
+    void TrackDiffClass::Read(const unsigned char* data, int length)
+    {
+        REGION(Require)
+
+        if(data == nullptr)
+        {
+            throw new ArgumentNullException("data");
+        }
+
+        ENDREGION()
+
+        int index = 0;
+
+        ClearEdits();
+
+        endOfTrackOffset = ReadVariableLength(data, length, index);
+
+        int removeCount = ReadVariableLength(data, length, index);
+        int moveCount = ReadVariableLength(data, length, index);
+        int insertCount = ReadVariableLength(data, length, index);
+
+        TrackEdit edit;
+
+        edit.type = TrackEditType::RemoveEdit;
+        edit.index = 0;
+        edit.position = 0;
+        edit.newIndex = -1;
+        edit.message = nullptr;
+
+        for(int i = 0; i < removeCount; i++)
+        {
+            edit.index += ReadVariableLength(data, length, index);
+
+            edits.Add(edit);
+        }
+
+        edit.type = TrackEditType::MoveEdit;
+        edit.index = 0;
+        edit.newIndex = 0;
+
+        for(int i = 0; i < moveCount; i++)
+        {
+            edit.index += ReadVariableLength(data, length, index);
+            edit.position += ReadDifference(data, length, index);
+            edit.newIndex += ReadDifference(data, length, index);
+
+            edits.Add(edit);
+        }
+
+        edit.type = TrackEditType::InsertEdit;
+        edit.index = -1;
+        edit.position = 0;
+        edit.newIndex = 0;
+
+        int runningStatus = 0;
+
+        for(int i = 0; i < insertCount; i++)
+        {
+            edit.position += ReadVariableLength(data, length, index);
+            edit.newIndex += ReadVariableLength(data, length, index);
+
+            int status = runningStatus;
+
+            if(index < length && (data[index] & 0x80) == 0x80)
+            {
+                status = data[index++];
+            }
+
+            if(status >= (int)ChannelCommand::NoteOff && status < (int)SysExType::Start)
+            {
+                int data1 = ReadByte(data, length, index) & 0x7F;
+                int data2 = 0;
+
+                if(ChannelMessageClass::DataBytesPerType(ChannelMessageClass::UnpackCommand(status)) == 2)
+                {
+                    data2 = ReadByte(data, length, index) & 0x7F;
+                }
+
+                edit.message = new ChannelMessageClass(status | data1 << 8 | data2 << 16);
+                runningStatus = status;
+            }
+            else if(status == 0xFF)
+            {
+                MetaType type = (MetaType)ReadByte(data, length, index);
+                bytebuffer bytes = bytebufferclass(ReadVariableLength(data, length, index));
+
+                for(int j = 0; j < bytes.Length; j++)
+                {
+                    bytes[j] = (byte)ReadByte(data, length, index);
+                }
+
+                edit.message = new MetaMessageClass(type, bytes);
+                runningStatus = 0;
+            }
+            else if(status == (int)SysExType::Start || status == (int)SysExType::Continuation)
+            {
+                bytebuffer bytes = bytebufferclass(ReadVariableLength(data, length, index) + 1);
+
+                bytes[0] = (byte)status;
+
+                for(int j = 1; j < bytes.Length; j++)
+                {
+                    bytes[j] = (byte)ReadByte(data, length, index);
+                }
+
+                edit.message = new SysExMessageClass(bytes);
+                runningStatus = 0;
+            }
+            else if(status == RealtimeEscape)
+            {
+                switch((SysRealtimeType)ReadByte(data, length, index))
+                {
+                    case SysRealtimeType::ActiveSense:
+                        edit.message = (IMidiMessageIf*)&SysRealtimeMessageClass::ActiveSenseMessage;
+                        break;
+
+                    case SysRealtimeType::Clock:
+                        edit.message = (IMidiMessageIf*)&SysRealtimeMessageClass::ClockMessage;
+                        break;
+
+                    case SysRealtimeType::Continue:
+                        edit.message = (IMidiMessageIf*)&SysRealtimeMessageClass::ContinueMessage;
+                        break;
+
+                    case SysRealtimeType::Reset:
+                        edit.message = (IMidiMessageIf*)&SysRealtimeMessageClass::ResetMessage;
+                        break;
+
+                    case SysRealtimeType::StartRealtime:
+                        edit.message = (IMidiMessageIf*)&SysRealtimeMessageClass::StartMessage;
+                        break;
+
+                    case SysRealtimeType::StopRealtime:
+                        edit.message = (IMidiMessageIf*)&SysRealtimeMessageClass::StopMessage;
+                        break;
+
+                    case SysRealtimeType::Tick:
+                        edit.message = (IMidiMessageIf*)&SysRealtimeMessageClass::TickMessage;
+                        break;
+
+                    default:
+                        throw new ArgumentException("The edit script is not valid.", "data");
+                }
+
+                runningStatus = 0;
+            }
+            else if(SysCommonDataBytes(status) >= 0)
+            {
+                int packed = status;
+
+                if(SysCommonDataBytes(status) > 0)
+                {
+                    packed |= (ReadByte(data, length, index) & 0x7F) << 8;
+                }
+
+                if(SysCommonDataBytes(status) > 1)
+                {
+                    packed |= (ReadByte(data, length, index) & 0x7F) << 16;
+                }
+
+                edit.message = new SysCommonMessageClass(packed);
+                runningStatus = 0;
+            }
+            else
+            {
+                throw new ArgumentException("The edit script is not valid.", "data");
+            }
+
+            edits.Add(edit);
+        }
+    }
+
+    /// <summary>
+    /// Removes every edit.
+    /// </summary>
+    void TrackDiffClass::Clear()
+    {
+        ClearEdits();
+        endOfTrackOffset = 0;
+    }
+
+    void TrackDiffClass::ClearEdits()
+    {
+        for(int i = 0; i < edits.Count; i++)
+        {
+            if(edits[i].type == TrackEditType::InsertEdit)
+            {
+                MessagePoolClass::Shared.Release(*edits[i].message);
+            }
+        }
+
+        edits.Clear();
+    }
+
+    #if(DEBUG)
+    // Applies the edits to a copy of the old version and checks that it
+    // comes out the same as the new version, MidiEvent for MidiEvent.
+    void TrackDiffClass::AssertRoundTrip(Track oldTrack, Track newTrack)
+    {
+        TrackClass copy;
+        MidiEventClass* current = oldTrack.Count > 1 ? &oldTrack.GetMidiEvent(0) : nullptr;
+
+        // Each MidiEvent is at or after the last one, so it is appended.
+        for(; current != nullptr; current = Next(current))
+        {
+            IMidiMessage message = current->MidiMessage;
+
+            copy.Insert(current->AbsoluteTicks, message);
+        }
+
+        copy.EndOfTrackOffset = oldTrack.EndOfTrackOffset;
+
+        Apply(copy);
+
+        Assert(copy.Count == newTrack.Count);
+        Assert(copy.Length == newTrack.Length);
+
+        MidiEventClass* a = copy.Count > 1 ? &copy.GetMidiEvent(0) : nullptr;
+        MidiEventClass* b = newTrack.Count > 1 ? &newTrack.GetMidiEvent(0) : nullptr;
+
+        for(; a != nullptr && b != nullptr; a = Next(a), b = Next(b))
+        {
+            Assert(a->AbsoluteTicks == b->AbsoluteTicks);
+            Assert(SameMessage(a->MidiMessage, b->MidiMessage));
+        }
+
+        Assert(a == nullptr && b == nullptr);
+
+        // The copy is dropped, so the references Apply gave it go back.
+        for(int i = 0; i < edits.Count; i++)
+        {
+            if(edits[i].type == TrackEditType::InsertEdit)
+            {
+                MessagePoolClass::Shared.Release(*edits[i].message);
+            }
+        }
+    }
+    #else
+    void TrackDiffClass::AssertRoundTrip(Track oldTrack, Track newTrack) { }
+    #endif
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets the edit at the specified index.
+    /// </summary>
+    const TrackEdit& TrackDiffClass::operator [](int index)
+    {
+        REGION(Require)
+
+        if(index < 0 || index >= edits.Count)
+        {
+            throw new ArgumentOutOfRangeException("index", index,
+                "Edit index out of range.");
+        }
+
+        ENDREGION()
+
+        return edits[index];
+    }
+
+    /// <summary>
+    /// Gets the number of edits.
+    /// </summary>
+    int TrackDiffClass::get_Count()
+    {
+        return edits.Count;
+    }
+
+    /// <summary>
+    /// Gets the end of track offset of the new version, which Apply sets
+    /// once the edits are made.
+    /// </summary>
+    int TrackDiffClass::get_EndOfTrackOffset()
+    {
+        return endOfTrackOffset;
+    }
+
+    ENDREGION()
+
+}}}
@@ -0,0 +1,222 @@
+#ifndef TRACKDIFF_H
+#define TRACKDIFF_H
+
+#include "Types.h"
+#include "ArrayList.h"
+#include "Track.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    /// <summary>
+    /// Specifies the kind of a TrackEdit.
+    /// </summary>
+    enum TrackEditType
+    {
+        /// <summary>
+        /// Inserts a message at a position.
+        /// </summary>
+        InsertEdit,
+
+        /// <summary>
+        /// Removes a MidiEvent.
+        /// </summary>
+        RemoveEdit,
+
+        /// <summary>
+        /// Moves a MidiEvent to another position.
+        /// </summary>
+        MoveEdit
+    };
+
+    /// <summary>
+    /// Represents one edit of a TrackDiff.
+    /// </summary>
+    struct TrackEdit
+    {
+        TrackEditType type;
+
+        // The index of the MidiEvent removed or moved, in the Track as it
+        // was before any of the edits.
+        int index;
+
+        // The position in absolute ticks the message is inserted at or the
+        // MidiEvent is moved to.
+        int position;
+
+        // The index of the MidiEvent inserted or moved, in the Track as it
+        // is after all of the edits, which orders it among the MidiEvents
+        // sharing its position.
+        int newIndex;
+
+        // The message inserted.
+        IMidiMessageIf* message;
+    };
+
+    class TrackDiffClass;
+    typedef TrackDiffClass& TrackDiff;
+
+    /// <summary>
+    /// Finds the edits that turn one version of a Track into another, and
+    /// applies them.
+    /// </summary>
+    /// <remarks>
+    /// The MidiEvents of both versions are sorted by position and message
+    /// and merged, which keeps every MidiEvent found at the same position
+    /// with an equal message in both. Of the rest, those whose message is
+    /// found in both versions at different positions are paired up by a
+    /// second sort on the message, and become moves. What is left is
+    /// removed from the old version or inserted from the new one. Finding
+    /// the edits costs O(n log n) in the number of MidiEvents. Messages
+    /// are compared by their content, so the versions can come from
+    /// different copies of a Track.
+    ///
+    /// At each position, only the MidiEvents kept in the same order in both
+    /// versions stay where they are; the others are moved. Every move and
+    /// insertion carries its index in the new version, and Apply places
+    /// them in that order, so the new version is reproduced exactly,
+    /// including the order of MidiEvents sharing a position.
+    ///
+    /// The edits can be written to a compact stream of bytes and read back
+    /// on another machine that holds the old version. Indices and
+    /// positions are written as differences in variable length values and
+    /// messages the way they are in a MIDI file, with running status.
+    /// </remarks>
+    class TrackDiffClass
+    {
+        REGION(TrackDiff Members)
+
+        REGION(Fields)
+
+    private:
+
+        // The removals by index, then the moves by index, then the
+        // insertions by new index.
+        ArrayList<TrackEdit> edits;
+
+        int endOfTrackOffset;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the TrackDiff class.
+        /// </summary>
+        TrackDiffClass();
+
+        ~TrackDiffClass();
+
+    private:
+
+        TrackDiffClass(const TrackDiffClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Finds the edits that turn one version of a Track into another.
+        /// </summary>
+        /// <param name="oldTrack">
+        /// The version the edits are applied to.
+        /// </param>
+        /// <param name="newTrack">
+        /// The version the edits produce. The inserted messages are those
+        /// of this Track, and the TrackDiff holds a reference in the shared
+        /// MessagePool to each pooled one.
+        /// </param>
+        void Compute(Track oldTrack, Track newTrack);
+
+        /// <summary>
+        /// Applies the edits to the specified Track.
+        /// </summary>
+        /// <param name="track">
+        /// The Track, which must be the old version the edits were found
+        /// or read for.
+        /// </param>
+        /// <remarks>
+        /// The MidiEvents removed and moved are found in one walk before
+        /// any edit is made, and are then removed and moved by reference,
+        /// so applying the edits takes time in proportion to the size of
+        /// the Track plus the number of edits. The removals and insertions
+        /// are made with Remove and InsertAfter, so observers of the Track
+        /// are told of each. The moves are made together with Relink, so
+        /// observers are told the Track was cleared and given back its
+        /// MidiEvents, as after a quantize. The Track is given a reference
+        /// in the shared MessagePool to each pooled message inserted, as
+        /// loading with interning gives it one.
+        /// </remarks>
+        void Apply(Track track);
+
+        /// <summary>
+        /// Writes the edits as bytes.
+        /// </summary>
+        /// <param name="data">
+        /// The list the bytes are added to.
+        /// </param>
+        void Write(ArrayList<unsigned char>& data);
+
+        /// <summary>
+        /// Reads edits written by Write in place of the current ones.
+        /// </summary>
+        /// <param name="data">
+        /// The bytes written.
+        /// </param>
+        /// <param name="length">
+        /// The number of bytes.
+        /// </param>
+        /// <exception cref="ArgumentException">
+        /// The bytes are not a valid list of edits.
+        /// </exception>
+        void Read(const unsigned char* data, int length);
+
+        /// <summary>
+        /// Removes every edit.
+        /// </summary>
+        void Clear();
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets the edit at the specified index.
+        /// </summary>
+        const TrackEdit& operator[](int index);
+
+        /// <summary>
+        /// Gets the number of edits.
+        /// </summary>
+        ReadOnlyProperty<int> Count;
+
+        /// <summary>
+        /// Gets the end of track offset of the new version, which Apply
+        /// sets once the edits are made.
+        /// </summary>
+        ReadOnlyProperty<int> EndOfTrackOffset;
+
+        ENDREGION()
+
+        ENDREGION()
+
+    private:
+        void init();
+        void AssertRoundTrip(Track oldTrack, Track newTrack);
+
+        // Removes every edit, releasing the pooled messages inserted.
+        void ClearEdits();
+
+        int get_Count();
+        int get_EndOfTrackOffset();
+
+    };
+
+}}}
+
+#endif
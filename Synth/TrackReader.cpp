@@ -35,6 +35,7 @@
 #include "TrackReader.h"
 #include "MetaMessage.h"
 #include "SysExMessage.h"
+#include "MessagePool.h"
 #include "SysRealtimeMessage.h"
 #include "Exception.h"
 
@@ -44,6 +45,8 @@ namespace Sanford { namespace Multimedia { namespace Midi {
 	void cls::init() 
     {
         this->Track = Functor::New(this, &cls::get_Track);
+        this->PostingsEnabled = Functor::New(this, &cls::get_PostingsEnabled, &cls::set_PostingsEnabled);
+        this->InterningEnabled = Functor::New(this, &cls::get_InterningEnabled, &cls::set_InterningEnabled);
         this->stream = StreamClass();
 		this->trackData = bytebufferclass::null;
         this->trackIndex = 0;
@@ -51,6 +54,8 @@ namespace Sanford { namespace Multimedia { namespace Midi {
 		this->ticks = 0;
 		this->status = 0;
 		this->runningStatus = 0;
+        this->postingsEnabled = false;
+        this->interningEnabled = false;
     }
 
     TrackReaderClass::TrackReaderClass() :
@@ -84,6 +89,7 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         }
             
         newTrack = TrackClass();
+        newTrack.PostingsEnabled = postingsEnabled;
 
         ParseTrackData();
 
@@ -263,7 +269,15 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         {
             bytebuffer data = bytebufferclass(ReadVariableLengthValue());
 			trackData.Offset(trackIndex).CopyTo(data, 0, data.Length);
-            newTrack.Insert(ticks, MetaMessageClass(type, data));                   
+
+            if(interningEnabled)
+            {
+                newTrack.Insert(ticks, MessagePoolClass::Shared.Intern(type, data));
+            }
+            else
+            {
+                newTrack.Insert(ticks, MetaMessageClass(type, data));
+            }
 
             trackIndex += data.Length;
         }
@@ -278,7 +292,15 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         data[0] = (byte)SysExType::Start;
 
 		trackData.Offset(trackIndex).CopyTo(data, 1, data.Length - 1);
-        newTrack.Insert(ticks, SysExMessageClass(data));
+
+        if(interningEnabled)
+        {
+            newTrack.Insert(ticks, MessagePoolClass::Shared.Intern(data));
+        }
+        else
+        {
+            newTrack.Insert(ticks, SysExMessageClass(data));
+        }
 
         trackIndex += data.Length - 1;
     }
@@ -310,7 +332,15 @@ namespace Sanford { namespace Multimedia { namespace Midi {
             data[0] = (byte)SysExType::Continuation;
 
 			trackData.Offset(trackIndex).CopyTo(data, 1, data.Length - 1);
-            newTrack.Insert(ticks, SysExMessageClass(data));
+
+            if(interningEnabled)
+            {
+                newTrack.Insert(ticks, MessagePoolClass::Shared.Intern(data));
+            }
+            else
+            {
+                newTrack.Insert(ticks, SysExMessageClass(data));
+            }
 
             trackIndex += data.Length - 1;
         }
@@ -442,6 +472,34 @@ namespace Sanford { namespace Multimedia { namespace Midi {
         return track;
     }
 
+    /// <summary>
+    /// Gets or sets a value indicating whether the Tracks read keep lists
+    /// of their MidiEvents by channel and message type, which are then
+    /// built while parsing.
+    /// </summary>
+    bool TrackReaderClass::get_PostingsEnabled()
+    {
+        return postingsEnabled;
+    }
+    void TrackReaderClass::set_PostingsEnabled(bool value)
+    {
+        postingsEnabled = value;
+    }
+
+    /// <summary>
+    /// Gets or sets a value indicating whether the MetaMessages and
+    /// SysExMessages read are taken from the shared MessagePool, so that
+    /// equal payloads share one message.
+    /// </summary>
+    bool TrackReaderClass::get_InterningEnabled()
+    {
+        return interningEnabled;
+    }
+    void TrackReaderClass::set_InterningEnabled(bool value)
+    {
+        interningEnabled = value;
+    }
+
 }}}
 
 
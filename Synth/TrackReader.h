@@ -77,6 +77,13 @@ namespace Sanford { namespace Multimedia { namespace Midi {
 
         int runningStatus;
 
+        // Indicates whether the Tracks read keep EventPostings.
+        bool postingsEnabled;
+
+        // Indicates whether MetaMessages and SysExMessages come from the
+        // shared MessagePool.
+        bool interningEnabled;
+
     public:
 
         TrackReaderClass();
@@ -111,9 +118,27 @@ namespace Sanford { namespace Multimedia { namespace Midi {
 
         ReadOnlyProperty<Track> Track;
 
+        /// <summary>
+        /// Gets or sets a value indicating whether the Tracks read keep
+        /// lists of their MidiEvents by channel and message type, which
+        /// are then built while parsing.
+        /// </summary>
+        Property<bool> PostingsEnabled;
+
+        /// <summary>
+        /// Gets or sets a value indicating whether the MetaMessages and
+        /// SysExMessages read are taken from the shared MessagePool, so
+        /// that equal payloads share one message.
+        /// </summary>
+        Property<bool> InterningEnabled;
+
     private:
         void init();
 		Midi::Track get_Track();
+        bool get_PostingsEnabled();
+        void set_PostingsEnabled(bool value);
+        bool get_InterningEnabled();
+        void set_InterningEnabled(bool value);
 
     };
 
@@ -0,0 +1,577 @@
+#include <malloc.h>
+#include "TrackTransform.h"
+#include "SimdVector.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef TrackTransformClass cls;
+
+    // The number of MIDI channels, which is also the channel given to the
+    // rows of other messages.
+    static const int ChannelCount = ChannelMessageClass::MidiChannelMaxValue + 1;
+
+    // The number of entries in the selection, enough for a vector of
+    // floats to start at any of them.
+    static const int SelectionSize = 32;
+
+    void cls::init()
+    {
+        this->Count = Functor::New(this, &cls::get_Count);
+        this->Channels = Functor::New(this, &cls::get_Channels, &cls::set_Channels);
+        this->InstructionSet = Functor::New(this, &cls::get_InstructionSet, &cls::set_InstructionSet);
+        this->track = nullptr;
+        this->ticks = nullptr;
+        this->channels = nullptr;
+        this->commands = nullptr;
+        this->data1 = nullptr;
+        this->data2 = nullptr;
+        this->messages = nullptr;
+        this->capacity = 0;
+        this->selection = nullptr;
+        this->channelMask = 0;
+        this->instructionSet = OscillatorBankClass::DetectInstructionSet();
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the TrackTransform class.
+    /// </summary>
+    TrackTransformClass::TrackTransformClass()
+    {
+        init();
+
+        selection = (float*)_aligned_malloc(SelectionSize * sizeof(float), 32);
+
+        set_Channels(AllChannels);
+    }
+
+    TrackTransformClass::~TrackTransformClass()
+    {
+        _aligned_free(ticks);
+        _aligned_free(channels);
+        _aligned_free(commands);
+        _aligned_free(data1);
+        _aligned_free(data2);
+        _aligned_free(messages);
+        _aligned_free(selection);
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Loads the MidiEvents of the specified Track, discarding any edits
+    /// not yet applied.
+    /// </summary>
+    void TrackTransformClass::Load(Track track)
+    {
+        this->track = &track;
+
+        events.Clear();
+        events.EnsureCapacity(track.Count - 1);
+
+        Reserve(track.Count - 1);
+
+        MidiEventClass* current = track.Count > 1 ? &track.GetMidiEvent(0) : nullptr;
+
+        while(current != nullptr)
+        {
+            events.Add(current);
+
+            MidiEvent next = current->Next;
+
+            current = next != MidiEventClass::null ? &next : nullptr;
+        }
+
+        int padded = GetPaddedCount();
+
+        for(int i = 0; i < padded; i++)
+        {
+            ticks[i] = 0;
+            channels[i] = ChannelCount;
+            commands[i] = 0.0f;
+            data1[i] = 0.0f;
+            data2[i] = 0.0f;
+            messages[i] = 0;
+
+            if(i < events.Count)
+            {
+                IMidiMessage message = events[i]->MidiMessage;
+
+                ticks[i] = events[i]->AbsoluteTicks;
+
+                if(message.MessageType == MessageType::Channel)
+                {
+                    int packed = ((ChannelMessage)message).Message;
+
+                    channels[i] = ChannelMessageClass::UnpackMidiChannel(packed);
+                    commands[i] = (float)ChannelMessageClass::UnpackCommand(packed);
+                    data1[i] = (float)ShortMessageClass::UnpackData1(packed);
+                    data2[i] = (float)ShortMessageClass::UnpackData2(packed);
+                    messages[i] = packed;
+                }
+            }
+        }
+    }
+
+    /// <summary>
+    /// Transposes the notes of NoteOn, NoteOff and PolyPressure messages.
+    /// Notes moved outside the MIDI range are removed by Apply, together
+    /// with their NoteOffs.
+    /// </summary>
+    /// <param name="semitones">
+    /// The number of semitones to transpose by.
+    /// </param>
+    void TrackTransformClass::Transpose(int semitones)
+    {
+        switch(instructionSet)
+        {
+            case InstructionSet::Avx2:
+                TransposeWith<Avx2Vector>((float)semitones);
+                break;
+
+            case InstructionSet::Sse2:
+                TransposeWith<Sse2Vector>((float)semitones);
+                break;
+
+            default:
+                TransposeWith<ScalarVector>((float)semitones);
+                break;
+        }
+    }
+
+    /// <summary>
+    /// Scales the velocities of NoteOn messages, clamping them between 1
+    /// and 127 so that no note becomes a NoteOff.
+    /// </summary>
+    /// <param name="scale">
+    /// The factor to scale by.
+    /// </param>
+    void TrackTransformClass::ScaleVelocity(float scale)
+    {
+        REGION(Require)
+
+        if(!(scale >= 0.0f))
+        {
+            throw new ArgumentOutOfRangeException("scale", (int)scale,
+                "Velocity scale out of range.");
+        }
+
+        ENDREGION()
+
+        switch(instructionSet)
+        {
+            case InstructionSet::Avx2:
+                ScaleVelocityWith<Avx2Vector>(scale);
+                break;
+
+            case InstructionSet::Sse2:
+                ScaleVelocityWith<Sse2Vector>(scale);
+                break;
+
+            default:
+                ScaleVelocityWith<ScalarVector>(scale);
+                break;
+        }
+    }
+
+    /// <summary>
+    /// Moves ChannelMessages to other MIDI channels.
+    /// </summary>
+    /// <param name="map">
+    /// The channel each of the 16 MIDI channels is moved to.
+    /// </param>
+    void TrackTransformClass::RemapChannels(const int* map)
+    {
+        REGION(Require)
+
+        if(map == nullptr)
+        {
+            throw new ArgumentNullException("map");
+        }
+
+        for(int i = 0; i < ChannelCount; i++)
+        {
+            if(map[i] < 0 || map[i] >= ChannelCount)
+            {
+                throw new ArgumentOutOfRangeException("map", map[i],
+                    "MIDI channel out of range.");
+            }
+        }
+
+        ENDREGION()
+
+        // Unselected channels and other messages map to themselves, so
+        // every row is a lookup.
+        int table[ChannelCount + 1];
+
+        for(int i = 0; i < ChannelCount; i++)
+        {
+            table[i] = selection[i] != 0.0f ? map[i] : i;
+        }
+
+        table[ChannelCount] = ChannelCount;
+
+        int padded = GetPaddedCount();
+
+        for(int i = 0; i < padded; i++)
+        {
+            channels[i] = table[channels[i]];
+        }
+    }
+
+    /// <summary>
+    /// Moves ChannelMessages to the nearest multiple of a grid.
+    /// </summary>
+    /// <param name="grid">
+    /// The spacing of the grid in ticks.
+    /// </param>
+    void TrackTransformClass::Quantize(int grid)
+    {
+        REGION(Require)
+
+        if(grid <= 0)
+        {
+            throw new ArgumentOutOfRangeException("grid", grid,
+                "Quantize grid out of range.");
+        }
+
+        ENDREGION()
+
+        int half = grid / 2;
+
+        for(int i = 0; i < events.Count; i++)
+        {
+            if(selection[channels[i]] != 0.0f)
+            {
+                ticks[i] = (ticks[i] + half) / grid * grid;
+            }
+        }
+    }
+
+    /// <summary>
+    /// Writes the edits back to the Track.
+    /// </summary>
+    /// <remarks>
+    /// The TrackTransform stays loaded with the Track as edited.
+    /// </remarks>
+    void TrackTransformClass::Apply()
+    {
+        REGION(Require)
+
+        if(track == nullptr)
+        {
+            throw new InvalidOperationException("No Track is loaded.");
+        }
+
+        ENDREGION()
+
+        bool changed = RemoveNotesOutOfRange();
+        bool ordered = true;
+
+        for(int i = 0; i < events.Count; i++)
+        {
+            MidiEventClass* e = events[i];
+
+            if(messages[i] != 0)
+            {
+                int note = (int)(data1[i] + 0.5f);
+                int velocity = (int)(data2[i] + 0.5f);
+                int packed = ShortMessageClass::PackStatus(0, (int)commands[i] | channels[i]);
+
+                packed = ShortMessageClass::PackData1(packed, note);
+                packed = ShortMessageClass::PackData2(packed, velocity);
+
+                // Later edits start from the values written.
+                data1[i] = (float)note;
+                data2[i] = (float)velocity;
+
+                if(packed != messages[i])
+                {
+                    builder.Message = packed;
+                    builder.Build();
+
+                    e->SetMidiMessage(builder.Result);
+
+                    messages[i] = packed;
+                    changed = true;
+                }
+            }
+
+            if(ticks[i] != e->AbsoluteTicks)
+            {
+                e->SetAbsoluteTicks(ticks[i]);
+
+                changed = true;
+            }
+
+            if(i > 0 && ticks[i] < ticks[i - 1])
+            {
+                ordered = false;
+            }
+        }
+
+        REGION(Guard)
+
+        if(!changed)
+        {
+            return;
+        }
+
+        ENDREGION()
+
+        // Quantizing moves a MidiEvent by at most half the grid, so an
+        // insertion sort has little to do. It is stable, so MidiEvents
+        // that end up at the same position keep their order.
+        if(!ordered)
+        {
+            for(int i = 1; i < events.Count; i++)
+            {
+                MidiEventClass* e = events[i];
+                int position = e->AbsoluteTicks;
+                int j = i;
+
+                while(j > 0 && events[j - 1]->AbsoluteTicks > position)
+                {
+                    events[j] = events[j - 1];
+                    j--;
+                }
+
+                events[j] = e;
+            }
+        }
+
+        track->Relink(events);
+
+        // The rows follow the MidiEvents, so they are reloaded in the new
+        // order.
+        if(!ordered)
+        {
+            Load(*track);
+        }
+    }
+
+    bool TrackTransformClass::RemoveNotesOutOfRange()
+    {
+        int padded = GetPaddedCount();
+        int kept = 0;
+
+        // Clamping would turn the note into another one and could leave
+        // it sounding on top of a note already there. A NoteOff is on the
+        // channel and note of its NoteOn, so the two are always transposed
+        // together and both fall out of range.
+        for(int i = 0; i < events.Count; i++)
+        {
+            if(messages[i] != 0 && commands[i] < (float)ChannelCommand::Controller &&
+                (data1[i] < 0.0f || data1[i] > (float)ShortMessageClass::DataMaxValue))
+            {
+                track->Remove(*events[i]);
+
+                continue;
+            }
+
+            events[kept] = events[i];
+            ticks[kept] = ticks[i];
+            channels[kept] = channels[i];
+            commands[kept] = commands[i];
+            data1[kept] = data1[i];
+            data2[kept] = data2[i];
+            messages[kept] = messages[i];
+            kept++;
+        }
+
+        REGION(Guard)
+
+        if(kept == events.Count)
+        {
+            return false;
+        }
+
+        ENDREGION()
+
+        events.RemoveRange(kept, events.Count - kept);
+
+        // The rows left over are padding again, which no edit selects.
+        for(int i = kept; i < padded; i++)
+        {
+            ticks[i] = 0;
+            channels[i] = ChannelCount;
+            commands[i] = 0.0f;
+            data1[i] = 0.0f;
+            data2[i] = 0.0f;
+            messages[i] = 0;
+        }
+
+        return true;
+    }
+
+    void TrackTransformClass::Reserve(int count)
+    {
+        REGION(Guard)
+
+        if(count <= capacity)
+        {
+            return;
+        }
+
+        ENDREGION()
+
+        _aligned_free(ticks);
+        _aligned_free(channels);
+        _aligned_free(commands);
+        _aligned_free(data1);
+        _aligned_free(data2);
+        _aligned_free(messages);
+
+        capacity = (count + Avx2Vector::Width - 1) / Avx2Vector::Width * Avx2Vector::Width;
+
+        ticks = (int*)_aligned_malloc(capacity * sizeof(int), 32);
+        channels = (int*)_aligned_malloc(capacity * sizeof(int), 32);
+        commands = (float*)_aligned_malloc(capacity * sizeof(float), 32);
+        data1 = (float*)_aligned_malloc(capacity * sizeof(float), 32);
+        data2 = (float*)_aligned_malloc(capacity * sizeof(float), 32);
+        messages = (int*)_aligned_malloc(capacity * sizeof(int), 32);
+
+        if(ticks == nullptr || channels == nullptr || commands == nullptr ||
+            data1 == nullptr || data2 == nullptr || messages == nullptr)
+        {
+            _aligned_free(ticks);
+            _aligned_free(channels);
+            _aligned_free(commands);
+            _aligned_free(data1);
+            _aligned_free(data2);
+            _aligned_free(messages);
+
+            ticks = nullptr;
+            channels = nullptr;
+            commands = nullptr;
+            data1 = nullptr;
+            data2 = nullptr;
+            messages = nullptr;
+            capacity = 0;
+
+            throw new OutOfMemoryException("Cannot allocate the columns.");
+        }
+    }
+
+    int TrackTransformClass::GetPaddedCount()
+    {
+        return (events.Count + Avx2Vector::Width - 1) / Avx2Vector::Width * Avx2Vector::Width;
+    }
+
+    template<typename V>
+    void TrackTransformClass::TransposeWith(float semitones)
+    {
+        typedef typename V::Type Vector;
+
+        Vector one = V::Set(1.0f);
+        Vector amount = V::Set(semitones);
+
+        // NoteOff, NoteOn and PolyPressure are the commands below
+        // Controller, and the only ones with a note in data 1.
+        Vector first = V::Set((float)ChannelCommand::NoteOff);
+        Vector last = V::Set((float)ChannelCommand::Controller);
+
+        int padded = GetPaddedCount();
+
+        for(int i = 0; i < padded; i += V::Width)
+        {
+            Vector command = V::Load(commands + i);
+            Vector selected = V::Equal(V::Gather(selection, channels + i), one);
+            Vector noted = V::And(selected,
+                V::And(V::GreaterEqual(command, first), V::Less(command, last)));
+            Vector note = V::Add(V::Load(data1 + i), V::And(noted, amount));
+
+            V::Store(data1 + i, note);
+        }
+
+        V::End();
+    }
+
+    template<typename V>
+    void TrackTransformClass::ScaleVelocityWith(float scale)
+    {
+        typedef typename V::Type Vector;
+
+        Vector one = V::Set(1.0f);
+        Vector top = V::Set((float)ShortMessageClass::DataMaxValue);
+        Vector factor = V::Set(scale);
+        Vector noteOn = V::Set((float)ChannelCommand::NoteOn);
+
+        int padded = GetPaddedCount();
+
+        for(int i = 0; i < padded; i += V::Width)
+        {
+            Vector velocity = V::Load(data2 + i);
+            Vector selected = V::Equal(V::Gather(selection, channels + i), one);
+
+            // A NoteOn with velocity 0 is a NoteOff and is left alone.
+            Vector sounding = V::And(selected,
+                V::And(V::Equal(V::Load(commands + i), noteOn), V::GreaterEqual(velocity, one)));
+            Vector scaled = V::Min(V::Max(V::Mul(velocity, factor), one), top);
+
+            V::Store(data2 + i, V::Select(sounding, scaled, velocity));
+        }
+
+        V::End();
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets the number of MidiEvents loaded.
+    /// </summary>
+    int TrackTransformClass::get_Count()
+    {
+        return events.Count;
+    }
+
+    /// <summary>
+    /// Gets or sets the MIDI channels edited, as a mask with the bit
+    /// 1 &lt;&lt; channel set for each one.
+    /// </summary>
+    int TrackTransformClass::get_Channels()
+    {
+        return channelMask;
+    }
+    void TrackTransformClass::set_Channels(int value)
+    {
+        channelMask = value & AllChannels;
+
+        for(int i = 0; i < SelectionSize; i++)
+        {
+            selection[i] = i < ChannelCount && (channelMask & (1 << i)) != 0 ? 1.0f : 0.0f;
+        }
+    }
+
+    /// <summary>
+    /// Gets or sets the instruction set used for the edits. It can be
+    /// lowered for testing but not raised above what the processor
+    /// supports.
+    /// </summary>
+    Midi::InstructionSet TrackTransformClass::get_InstructionSet()
+    {
+        return instructionSet;
+    }
+    void TrackTransformClass::set_InstructionSet(Midi::InstructionSet value)
+    {
+        REGION(Require)
+
+        if(value > OscillatorBankClass::DetectInstructionSet())
+        {
+            throw new ArgumentException("Instruction set not supported.", "InstructionSet");
+        }
+
+        ENDREGION()
+
+        instructionSet = value;
+    }
+
+    ENDREGION()
+
+}}}
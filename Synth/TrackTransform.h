@@ -0,0 +1,219 @@
+#ifndef TRACKTRANSFORM_H
+#define TRACKTRANSFORM_H
+
+#include "Types.h"
+#include "ArrayList.h"
+#include "Track.h"
+#include "ChannelMessageBuilder.h"
+#include "OscillatorBank.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    class TrackTransformClass;
+    typedef TrackTransformClass& TrackTransform;
+
+    /// <summary>
+    /// Applies edits such as transposition, velocity scaling, channel
+    /// remapping and quantization to every ChannelMessage of a Track at
+    /// once.
+    /// </summary>
+    /// <remarks>
+    /// Loading a Track unpacks the commands, channels, data values and
+    /// positions of its MidiEvents into columns, and each edit is one pass
+    /// over a column, the ones over data values with SIMD instructions.
+    /// Any number of edits can be made before Apply writes the columns
+    /// back. Apply builds a ChannelMessage only for the MidiEvents whose
+    /// message changed and sorts the MidiEvents only if quantizing has put
+    /// them out of order, then relinks the Track once, so its observers
+    /// rebuild once for the whole batch rather than once per MidiEvent.
+    ///
+    /// The edits only affect ChannelMessages on the channels selected by
+    /// the Channels mask. Other messages keep their positions.
+    /// </remarks>
+    class TrackTransformClass
+    {
+        REGION(TrackTransform Members)
+
+        REGION(Constants)
+
+    public:
+
+        /// <summary>
+        /// The channel mask that selects every MIDI channel.
+        /// </summary>
+        static const int AllChannels = 0xFFFF;
+
+        ENDREGION()
+
+        REGION(Fields)
+
+    private:
+
+        // The Track loaded and its MidiEvents in order, not including the
+        // end of track message.
+        TrackClass* track;
+
+        ArrayList<MidiEventClass*> events;
+
+        // The columns, one row per MidiEvent and padded to a whole number
+        // of vectors. Rows of other messages have the command 0 and the
+        // channel 16, which no edit selects.
+        int* ticks;
+
+        int* channels;
+
+        float* commands;
+
+        float* data1;
+
+        float* data2;
+
+        // The packed message of each row as loaded, or 0 for other
+        // messages.
+        int* messages;
+
+        int capacity;
+
+        // 1 for each selected channel and 0 for the rest, including the
+        // entry for other messages, read by channel with a gather.
+        float* selection;
+
+        int channelMask;
+
+        ChannelMessageBuilderClass builder;
+
+        Midi::InstructionSet instructionSet;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the TrackTransform class.
+        /// </summary>
+        TrackTransformClass();
+
+        ~TrackTransformClass();
+
+    private:
+
+        TrackTransformClass(const TrackTransformClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Loads the MidiEvents of the specified Track, discarding any
+        /// edits not yet applied.
+        /// </summary>
+        void Load(Track track);
+
+        /// <summary>
+        /// Transposes the notes of NoteOn, NoteOff and PolyPressure
+        /// messages. Notes moved outside the MIDI range are removed by
+        /// Apply, together with their NoteOffs.
+        /// </summary>
+        /// <param name="semitones">
+        /// The number of semitones to transpose by.
+        /// </param>
+        void Transpose(int semitones);
+
+        /// <summary>
+        /// Scales the velocities of NoteOn messages, clamping them between
+        /// 1 and 127 so that no note becomes a NoteOff.
+        /// </summary>
+        /// <param name="scale">
+        /// The factor to scale by.
+        /// </param>
+        void ScaleVelocity(float scale);
+
+        /// <summary>
+        /// Moves ChannelMessages to other MIDI channels.
+        /// </summary>
+        /// <param name="map">
+        /// The channel each of the 16 MIDI channels is moved to.
+        /// </param>
+        void RemapChannels(const int* map);
+
+        /// <summary>
+        /// Moves ChannelMessages to the nearest multiple of a grid.
+        /// </summary>
+        /// <param name="grid">
+        /// The spacing of the grid in ticks.
+        /// </param>
+        void Quantize(int grid);
+
+        /// <summary>
+        /// Writes the edits back to the Track.
+        /// </summary>
+        /// <remarks>
+        /// The TrackTransform stays loaded with the Track as edited.
+        /// </remarks>
+        void Apply();
+
+    private:
+
+        // Removes the MidiEvents of notes transposed outside the MIDI
+        // range from the Track and their rows from the columns, and
+        // returns whether there were any.
+        bool RemoveNotesOutOfRange();
+
+        // Makes room for the specified number of rows.
+        void Reserve(int count);
+
+        // Gets the number of rows rounded up to a whole number of the
+        // widest vectors.
+        int GetPaddedCount();
+
+        template<typename V>
+        void TransposeWith(float semitones);
+
+        template<typename V>
+        void ScaleVelocityWith(float scale);
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets the number of MidiEvents loaded.
+        /// </summary>
+        ReadOnlyProperty<int> Count;
+
+        /// <summary>
+        /// Gets or sets the MIDI channels edited, as a mask with the bit
+        /// 1 &lt;&lt; channel set for each one.
+        /// </summary>
+        Property<int> Channels;
+
+        /// <summary>
+        /// Gets or sets the instruction set used for the edits. It can be
+        /// lowered for testing but not raised above what the processor
+        /// supports.
+        /// </summary>
+        Property<Midi::InstructionSet> InstructionSet;
+
+        ENDREGION()
+
+        ENDREGION()
+
+    private:
+        void init();
+        int get_Count();
+        int get_Channels();
+        void set_Channels(int value);
+        Midi::InstructionSet get_InstructionSet();
+        void set_InstructionSet(Midi::InstructionSet value);
+
+    };
+
+}}}
+
+#endif
@@ -0,0 +1,185 @@
+#include "WaveWriter.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef WaveWriterClass cls;
+
+    void cls::init()
+    {
+        this->SampleRate = Functor::New(this, &cls::get_SampleRate);
+        this->FramesWritten = Functor::New(this, &cls::get_FramesWritten);
+        this->stream = nullptr;
+        this->used = 0;
+        this->sampleRate = 0;
+        this->frameCount = 0;
+        this->framesWritten = 0;
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the WaveWriter class with the
+    /// specified Stream, sample rate and buffer size.
+    /// </summary>
+    WaveWriterClass::WaveWriterClass(Stream stream, int sampleRate, int bufferSize) :
+        data(bufferSize)
+    {
+        init();
+
+        REGION(Require)
+
+        if(sampleRate <= 0)
+        {
+            throw new ArgumentOutOfRangeException("sampleRate", sampleRate,
+                "Sample rate out of range.");
+        }
+        else if(bufferSize < HeaderLength)
+        {
+            throw new ArgumentOutOfRangeException("bufferSize", bufferSize,
+                "Buffer size out of range.");
+        }
+
+        ENDREGION()
+
+        this->stream = &stream;
+        this->sampleRate = sampleRate;
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Writes the WAV header.
+    /// </summary>
+    /// <param name="frameCount">
+    /// The number of stereo frames that will be written.
+    /// </param>
+    void WaveWriterClass::WriteHeader(long long frameCount)
+    {
+        long long dataLength = frameCount * Channels * BytesPerSample;
+
+        REGION(Require)
+
+        if(frameCount < 0 || dataLength + HeaderLength - 8 > 0xFFFFFFFFLL)
+        {
+            throw new ArgumentOutOfRangeException("frameCount", (int)frameCount,
+                "Too many frames for a WAV file.");
+        }
+
+        ENDREGION()
+
+        this->frameCount = frameCount;
+
+        WriteTag("RIFF");
+        WriteInt((int)(dataLength + HeaderLength - 8));
+        WriteTag("WAVE");
+        WriteTag("fmt ");
+        WriteInt(16);
+        WriteShort(1);
+        WriteShort(Channels);
+        WriteInt(sampleRate);
+        WriteInt(sampleRate * Channels * BytesPerSample);
+        WriteShort(Channels * BytesPerSample);
+        WriteShort(BytesPerSample * 8);
+        WriteTag("data");
+        WriteInt((int)dataLength);
+    }
+
+    /// <summary>
+    /// Converts and writes the specified samples.
+    /// </summary>
+    void WaveWriterClass::Write(const float* left, const float* right, int count)
+    {
+        for(int i = 0; i < count; i++)
+        {
+            if(used + Channels * BytesPerSample > data.Length)
+            {
+                Flush();
+            }
+
+            float sample[Channels] = { left[i], right[i] };
+
+            for(int c = 0; c < Channels; c++)
+            {
+                float s = sample[c] * 32767.0f;
+
+                if(s > 32767.0f)
+                {
+                    s = 32767.0f;
+                }
+                else if(s < -32768.0f)
+                {
+                    s = -32768.0f;
+                }
+
+                int value = (int)(s < 0.0f ? s - 0.5f : s + 0.5f);
+
+                data[used++] = (byte)(value & 0xFF);
+                data[used++] = (byte)((value >> 8) & 0xFF);
+            }
+        }
+
+        framesWritten += count;
+    }
+
+    /// <summary>
+    /// Writes any buffered samples to the Stream.
+    /// </summary>
+    void WaveWriterClass::Flush()
+    {
+        if(used > 0)
+        {
+            stream->Write(data, 0, used);
+            used = 0;
+        }
+    }
+
+    void WaveWriterClass::WriteTag(const char* tag)
+    {
+        for(int i = 0; i < 4; i++)
+        {
+            data[used++] = tag[i];
+        }
+    }
+
+    // WAV files are little endian regardless of the platform.
+
+    void WaveWriterClass::WriteInt(int value)
+    {
+        for(int i = 0; i < 4; i++)
+        {
+            data[used++] = (byte)((value >> (i * 8)) & 0xFF);
+        }
+    }
+
+    void WaveWriterClass::WriteShort(int value)
+    {
+        data[used++] = (byte)(value & 0xFF);
+        data[used++] = (byte)((value >> 8) & 0xFF);
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets the sample rate in samples per second.
+    /// </summary>
+    int WaveWriterClass::get_SampleRate()
+    {
+        return sampleRate;
+    }
+
+    /// <summary>
+    /// Gets the number of frames written.
+    /// </summary>
+    long long WaveWriterClass::get_FramesWritten()
+    {
+        return framesWritten;
+    }
+
+    ENDREGION()
+
+}}}
@@ -0,0 +1,144 @@
+#ifndef WAVEWRITER_H
+#define WAVEWRITER_H
+
+#include "Types.h"
+#include "Buffer.h"
+#include "Stream.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    class WaveWriterClass;
+    typedef WaveWriterClass& WaveWriter;
+
+    /// <summary>
+    /// Writes stereo float samples to a Stream as a 16-bit PCM WAV file.
+    /// </summary>
+    /// <remarks>
+    /// Samples are converted into a large byte buffer that is written to
+    /// the Stream only when it fills up, so the Stream sees a few big
+    /// writes rather than one per block. The number of frames must be
+    /// known when the header is written, since the Stream cannot seek
+    /// back to fix it up.
+    /// </remarks>
+    class WaveWriterClass
+    {
+        REGION(WaveWriter Members)
+
+        REGION(Constants)
+
+    public:
+
+        /// <summary>
+        /// The size in bytes of the write buffer used when none is
+        /// specified.
+        /// </summary>
+        static const int DefaultBufferSize = 1 << 20;
+
+    private:
+
+        static const int HeaderLength = 44;
+
+        static const int Channels = 2;
+
+        static const int BytesPerSample = 2;
+
+        ENDREGION()
+
+        REGION(Fields)
+
+    private:
+
+        StreamClass* stream;
+
+        // The converted samples waiting to be written.
+        bytebufferclass data;
+
+        // The number of bytes in the buffer.
+        int used;
+
+        int sampleRate;
+
+        // The number of frames announced by the header and the number
+        // written so far.
+        long long frameCount;
+
+        long long framesWritten;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the WaveWriter class with the
+        /// specified Stream, sample rate and buffer size.
+        /// </summary>
+        WaveWriterClass(Stream stream, int sampleRate, int bufferSize);
+
+    private:
+
+        WaveWriterClass(const WaveWriterClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Writes the WAV header.
+        /// </summary>
+        /// <param name="frameCount">
+        /// The number of stereo frames that will be written.
+        /// </param>
+        void WriteHeader(long long frameCount);
+
+        /// <summary>
+        /// Converts and writes the specified samples.
+        /// </summary>
+        void Write(const float* left, const float* right, int count);
+
+        /// <summary>
+        /// Writes any buffered samples to the Stream.
+        /// </summary>
+        void Flush();
+
+    private:
+
+        void WriteTag(const char* tag);
+
+        void WriteInt(int value);
+
+        void WriteShort(int value);
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets the sample rate in samples per second.
+        /// </summary>
+        ReadOnlyProperty<int> SampleRate;
+
+        /// <summary>
+        /// Gets the number of frames written.
+        /// </summary>
+        ReadOnlyProperty<long long> FramesWritten;
+
+        ENDREGION()
+
+        ENDREGION()
+
+    private:
+        void init();
+        int get_SampleRate();
+        long long get_FramesWritten();
+
+    };
+
+}}}
+
+#endif
@@ -0,0 +1,179 @@
+#include <windows.h>
+#include <process.h>
+#include "WorkerPool.h"
+#include "Exception.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    typedef WorkerPoolClass cls;
+
+    void cls::init()
+    {
+        this->ThreadCount = Functor::New(this, &cls::get_ThreadCount);
+        this->threads = nullptr;
+        this->threadCount = 0;
+        this->wakeSemaphore = nullptr;
+        this->doneEvent = nullptr;
+        this->task = nullptr;
+        this->count = 0;
+        this->next = 0;
+        this->busy = 0;
+        this->stopping = false;
+    }
+
+    REGION(Construction)
+
+    /// <summary>
+    /// Initializes a new instance of the WorkerPool class with the
+    /// specified number of threads, including the calling thread.
+    /// </summary>
+    WorkerPoolClass::WorkerPoolClass(int threadCount)
+    {
+        init();
+
+        REGION(Require)
+
+        if(threadCount <= 0)
+        {
+            throw new ArgumentOutOfRangeException("threadCount", threadCount,
+                "Thread count out of range.");
+        }
+
+        ENDREGION()
+
+        this->threadCount = threadCount;
+        this->wakeSemaphore = CreateSemaphore(nullptr, 0, threadCount, nullptr);
+        this->doneEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        this->threads = new void*[threadCount];
+
+        // The calling thread is the first thread, so it needs no handle.
+        threads[0] = nullptr;
+
+        for(int i = 1; i < threadCount; i++)
+        {
+            threads[i] = (void*)_beginthreadex(nullptr, 0, &ThreadProc, this, 0, nullptr);
+        }
+    }
+
+    WorkerPoolClass::~WorkerPoolClass()
+    {
+        stopping = true;
+
+        ReleaseSemaphore(wakeSemaphore, threadCount - 1, nullptr);
+
+        // WaitForMultipleObjects is limited to 64 handles.
+        for(int i = 1; i < threadCount; i++)
+        {
+            WaitForSingleObject(threads[i], INFINITE);
+            CloseHandle(threads[i]);
+        }
+
+        CloseHandle(wakeSemaphore);
+        CloseHandle(doneEvent);
+
+        delete[] threads;
+    }
+
+    ENDREGION()
+
+    REGION(Methods)
+
+    /// <summary>
+    /// Runs every item of the specified task and waits for them to
+    /// finish.
+    /// </summary>
+    /// <param name="task">
+    /// The task to run.
+    /// </param>
+    /// <param name="count">
+    /// The number of items.
+    /// </param>
+    void WorkerPoolClass::For(IParallelTask task, int count)
+    {
+        REGION(Guard)
+
+        if(count <= 0)
+        {
+            return;
+        }
+
+        ENDREGION()
+
+        this->task = &task;
+        this->count = count;
+        this->next = 0;
+
+        int woken = (count < threadCount ? count : threadCount) - 1;
+
+        if(woken > 0)
+        {
+            // Publish the task before any thread can see the wake up.
+            InterlockedExchange(&busy, woken);
+            ReleaseSemaphore(wakeSemaphore, woken, nullptr);
+        }
+
+        Work();
+
+        // Every woken thread must leave Work before the task can change,
+        // or a late thread could run an item of the next task with this
+        // one.
+        if(woken > 0)
+        {
+            WaitForSingleObject(doneEvent, INFINITE);
+        }
+    }
+
+    void WorkerPoolClass::Work()
+    {
+        for(;;)
+        {
+            long index = InterlockedIncrement(&next) - 1;
+
+            if(index >= count)
+            {
+                break;
+            }
+
+            task->Execute(index);
+        }
+    }
+
+    unsigned int __stdcall WorkerPoolClass::ThreadProc(void* argument)
+    {
+        WorkerPoolClass* pool = (WorkerPoolClass*)argument;
+
+        for(;;)
+        {
+            WaitForSingleObject(pool->wakeSemaphore, INFINITE);
+
+            if(pool->stopping)
+            {
+                break;
+            }
+
+            pool->Work();
+
+            if(InterlockedDecrement(&pool->busy) == 0)
+            {
+                SetEvent(pool->doneEvent);
+            }
+        }
+
+        return 0;
+    }
+
+    ENDREGION()
+
+    REGION(Properties)
+
+    /// <summary>
+    /// Gets the number of threads, including the calling thread.
+    /// </summary>
+    int WorkerPoolClass::get_ThreadCount()
+    {
+        return threadCount;
+    }
+
+    ENDREGION()
+
+}}}
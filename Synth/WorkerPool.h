@@ -0,0 +1,140 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include "Types.h"
+
+namespace Sanford { namespace Multimedia { namespace Midi {
+
+    class IParallelTaskIf;
+    typedef IParallelTaskIf& IParallelTask;
+
+    /// <summary>
+    /// Represents work that can be split into independent items.
+    /// </summary>
+    class IParallelTaskIf
+    {
+    public:
+
+        /// <summary>
+        /// Performs one item of the work. Items may run at the same time on
+        /// different threads and in any order.
+        /// </summary>
+        virtual void Execute(int index) = 0;
+
+    };
+
+    class WorkerPoolClass;
+    typedef WorkerPoolClass& WorkerPool;
+
+    /// <summary>
+    /// Runs the items of an IParallelTask on a fixed set of threads.
+    /// </summary>
+    /// <remarks>
+    /// The threads are created once and wait between calls to For, so
+    /// running a task costs a few signals rather than thread creation. The
+    /// calling thread takes items too. Items are handed out through an
+    /// interlocked counter, so which thread runs an item varies from run
+    /// to run; tasks that must give the same result every time have to
+    /// write each item's result to its own place.
+    /// </remarks>
+    class WorkerPoolClass
+    {
+        REGION(WorkerPool Members)
+
+        REGION(Fields)
+
+    private:
+
+        // The threads besides the caller.
+        void** threads;
+
+        int threadCount;
+
+        // Counts the wake ups owed to the threads. Every wake up is
+        // matched by one decrement of busy.
+        void* wakeSemaphore;
+
+        // Signalled when the last woken thread runs out of items.
+        void* doneEvent;
+
+        // The task being run, its number of items and the next item to
+        // hand out.
+        IParallelTaskIf* task;
+
+        int count;
+
+        volatile long next;
+
+        // The number of woken threads still taking items.
+        volatile long busy;
+
+        // Indicates whether the threads should exit.
+        volatile bool stopping;
+
+        ENDREGION()
+
+        REGION(Construction)
+
+    public:
+
+        /// <summary>
+        /// Initializes a new instance of the WorkerPool class with the
+        /// specified number of threads, including the calling thread.
+        /// </summary>
+        WorkerPoolClass(int threadCount);
+
+        ~WorkerPoolClass();
+
+    private:
+
+        WorkerPoolClass(const WorkerPoolClass& other);
+
+        ENDREGION()
+
+        REGION(Methods)
+
+    public:
+
+        /// <summary>
+        /// Runs every item of the specified task and waits for them to
+        /// finish.
+        /// </summary>
+        /// <param name="task">
+        /// The task to run.
+        /// </param>
+        /// <param name="count">
+        /// The number of items.
+        /// </param>
+        void For(IParallelTask task, int count);
+
+    private:
+
+        // Takes and runs items until there are none left.
+        void Work();
+
+        static unsigned int __stdcall ThreadProc(void* argument);
+
+        ENDREGION()
+
+        REGION(Properties)
+
+    public:
+
+        /// <summary>
+        /// Gets the number of threads, including the calling thread.
+        /// </summary>
+        ReadOnlyProperty<int> ThreadCount;
+
+        ENDREGION()
+
+        ENDREGION()
+
+    private:
+        void init();
+        int get_ThreadCount();
+
+    };
+
+}}}
+
+#endif